@@ -0,0 +1,241 @@
+#ifndef artdaq_core_Core_NumaUtils_hh
+#define artdaq_core_Core_NumaUtils_hh 1
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace artdaq {
+/**
+ * \brief Namespace to hold helper functions for NUMA memory placement
+ *
+ * These functions use the mbind(2), move_pages(2) and getcpu(2) system calls directly, so that no
+ * additional library is needed. On a machine with a single NUMA node (or a kernel without NUMA
+ * support), placement requests succeed without doing anything.
+ */
+namespace NumaUtils {
+/**
+ * \brief Memory placement policies, with the values of the corresponding MPOL_* constants
+ */
+enum class Policy : int
+{
+	Default = MPOL_DEFAULT,        ///< Allocate on the node of the thread that first touches the page
+	Preferred = MPOL_PREFERRED,    ///< Allocate on the given node if possible, otherwise fall back to other nodes
+	Bind = MPOL_BIND,              ///< Allocate only on the given nodes
+	Interleave = MPOL_INTERLEAVE,  ///< Interleave pages across the given nodes
+};
+
+/**
+ * \brief Convert a Policy to its string representation
+ * \param policy Policy to convert
+ * \return Name of the policy
+ */
+inline std::string PolicyToString(Policy policy)
+{
+	switch (policy)
+	{
+		case Policy::Default:
+			return "Default";
+		case Policy::Preferred:
+			return "Preferred";
+		case Policy::Bind:
+			return "Bind";
+		case Policy::Interleave:
+			return "Interleave";
+	}
+	return "Unknown";
+}
+
+/**
+ * \brief Get the number of NUMA nodes on this machine
+ * \return The number of online NUMA nodes (1 if this cannot be determined)
+ */
+inline int NodeCount()
+{
+	static int const count = [] {
+		int max_node = 0;
+		auto fp = fopen("/sys/devices/system/node/online", "r");
+		if (fp == nullptr) return 1;
+		int first = 0, last = 0;
+		char sep = 0;
+		// Format is a list of ranges, e.g. "0-1" or "0,2-3"
+		while (fscanf(fp, "%d", &first) == 1)  // NOLINT(cert-err34-c)
+		{
+			last = first;
+			if (fscanf(fp, "%c", &sep) == 1 && sep == '-' && fscanf(fp, "%d", &last) == 1)  // NOLINT(cert-err34-c)
+			{
+				if (fscanf(fp, "%c", &sep) != 1) sep = 0;
+			}
+			if (last > max_node) max_node = last;
+			if (sep != ',') break;
+		}
+		fclose(fp);
+		return max_node + 1;
+	}();
+	return count;
+}
+
+/**
+ * \brief Get the NUMA node of the CPU the calling thread is running on
+ * \return NUMA node number, or -1 if it cannot be determined
+ */
+inline int CurrentNode()
+{
+	unsigned cpu = 0, node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return -1;
+	return static_cast<int>(node);
+}
+
+/**
+ * \brief Apply a placement policy to a range of memory
+ * \param addr Start of the range. It is rounded down to a page boundary
+ * \param len Length of the range, in bytes. The end of the range is rounded up to a page boundary
+ * \param policy Placement policy
+ * \param nodes NUMA nodes used by the policy (ignored for Policy::Default)
+ * \param move Whether pages already allocated should be migrated to conform to the policy
+ * \return True if the policy was applied, or if there is only one NUMA node. False otherwise, with errno set
+ *
+ * Pages of a shared mapping (e.g. a Shared Memory segment) which other processes also map are only migrated
+ * with MPOL_MF_MOVE_ALL, which needs CAP_SYS_NICE. Without it, only the pages mapped by this process alone are
+ * migrated; the policy still applies to every page allocated from then on.
+ */
+inline bool SetPolicy(void const* addr, size_t len, Policy policy, std::vector<int> const& nodes, bool move = true)
+{
+	if (NodeCount() <= 1) return true;
+	if (len == 0) return true;
+
+	auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	auto begin = reinterpret_cast<uintptr_t>(addr) & ~(page - 1);                       // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto end = (reinterpret_cast<uintptr_t>(addr) + len + page - 1) & ~(page - 1);     // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	unsigned long const bits = 8 * sizeof(unsigned long);
+	std::vector<unsigned long> mask((NodeCount() + bits - 1) / bits + 1, 0);
+	for (auto node : nodes)
+	{
+		if (node < 0 || node >= NodeCount())
+		{
+			errno = EINVAL;
+			return false;
+		}
+		mask[node / bits] |= 1UL << (node % bits);
+	}
+
+	auto maxnode = policy == Policy::Default ? 0 : mask.size() * bits;
+	auto nodemask = policy == Policy::Default ? nullptr : mask.data();
+	if (move && syscall(SYS_mbind, begin, end - begin, static_cast<int>(policy), nodemask, maxnode, MPOL_MF_MOVE_ALL) == 0)
+	{
+		return true;
+	}
+	if (move && errno != EPERM)
+	{
+		return false;
+	}
+	return syscall(SYS_mbind, begin, end - begin, static_cast<int>(policy), nodemask, maxnode, move ? MPOL_MF_MOVE : 0) == 0;
+}
+
+/**
+ * \brief Find the NUMA node holding each page of a range of memory
+ * \param addr Start of the range
+ * \param len Length of the range, in bytes
+ * \param max_pages Maximum number of pages to query (the range is sampled evenly if it has more pages)
+ * \return One entry per queried page: the node number, or a negative errno value (e.g. -ENOENT if the page is not resident)
+ */
+inline std::vector<int> PageNodes(void const* addr, size_t len, size_t max_pages = 64)
+{
+	std::vector<int> status;
+	if (len == 0 || max_pages == 0) return status;
+
+	auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	auto begin = reinterpret_cast<uintptr_t>(addr) & ~(page - 1);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto pages = (reinterpret_cast<uintptr_t>(addr) + len - begin + page - 1) / page;  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto stride = pages > max_pages ? (pages + max_pages - 1) / max_pages : 1;
+
+	std::vector<void*> addrs;
+	for (size_t ii = 0; ii < pages; ii += stride)
+	{
+		addrs.push_back(reinterpret_cast<void*>(begin + ii * page));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,performance-no-int-to-ptr)
+	}
+	status.resize(addrs.size(), -ENOENT);
+	if (syscall(SYS_move_pages, 0, addrs.size(), addrs.data(), nullptr, status.data(), 0) != 0)
+	{
+		status.assign(addrs.size(), -errno);
+	}
+	return status;
+}
+
+/**
+ * \brief Summarize the output of PageNodes
+ * \param addr Start of the range
+ * \param len Length of the range, in bytes
+ * \return A string of the form "node 0: 10 pages, node 1: 6 pages, not resident: 2 pages"
+ */
+inline std::string DescribePlacement(void const* addr, size_t len)
+{
+	auto status = PageNodes(addr, len);
+	std::vector<size_t> counts(NodeCount(), 0);
+	size_t absent = 0;
+	for (auto st : status)
+	{
+		if (st >= 0 && st < NodeCount())
+			++counts[st];
+		else
+			++absent;
+	}
+	std::string out;
+	for (size_t node = 0; node < counts.size(); ++node)
+	{
+		if (counts[node] == 0) continue;
+		out += (out.empty() ? "" : ", ") + std::string("node ") + std::to_string(node) + ": " + std::to_string(counts[node]) + " pages";
+	}
+	if (absent > 0) out += (out.empty() ? "" : ", ") + std::string("not resident: ") + std::to_string(absent) + " pages";
+	return out.empty() ? "no pages" : out;
+}
+
+/**
+ * \brief Access the switch for node-local allocation of large buffers (see QuickVec)
+ * \return Reference to the switch. Initialized from the ARTDAQ_NUMA_LOCAL_ALLOC environment variable
+ */
+inline std::atomic<bool>& LocalAllocation()
+{
+	static std::atomic<bool> enabled(getenv("ARTDAQ_NUMA_LOCAL_ALLOC") != nullptr && atoi(getenv("ARTDAQ_NUMA_LOCAL_ALLOC")) != 0);  // NOLINT(cert-err34-c)
+	return enabled;
+}
+
+/**
+ * \brief Minimum allocation size for which node-local placement is requested
+ */
+constexpr size_t LocalAllocationThreshold = 1024 * 1024;
+
+/**
+ * \brief Place a newly-allocated block of memory on the caller's NUMA node, if LocalAllocation() is enabled
+ * \param addr Start of the block
+ * \param len Length of the block, in bytes
+ *
+ * Only the pages lying entirely inside the block are affected, so that neighbouring heap
+ * allocations keep their placement. Small blocks (below LocalAllocationThreshold) are left alone.
+ */
+inline void PlaceOnLocalNode(void const* addr, size_t len)
+{
+	if (addr == nullptr || len < LocalAllocationThreshold || !LocalAllocation().load(std::memory_order_relaxed) || NodeCount() <= 1) return;
+
+	auto node = CurrentNode();
+	if (node < 0) return;
+
+	auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	auto begin = (reinterpret_cast<uintptr_t>(addr) + page - 1) & ~(page - 1);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto end = (reinterpret_cast<uintptr_t>(addr) + len) & ~(page - 1);         // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	if (end <= begin) return;
+	SetPolicy(reinterpret_cast<void const*>(begin), end - begin, Policy::Preferred, {node}, true);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,performance-no-int-to-ptr)
+}
+
+}  // namespace NumaUtils
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_NumaUtils_hh
@@ -23,6 +23,9 @@
 #include <vector>
 /** \endcond */
 
+#include "artdaq-core/Core/NumaUtils.hh"
+#include "artdaq-core/Core/QuickVecArena.hh"
+
 // #include "trace.h"		// TRACE
 #ifndef TRACEN
 #define TRACEN(nam, lvl, ...)
@@ -36,14 +39,70 @@
  * \param boundary The alignment boundary
  * \param size The size of memory to allocate
  * \return Pointer to allocated memory.
+ *
+ * When artdaq::NumaUtils::LocalAllocation() is enabled, large allocations are placed on the
+ * NUMA node of the calling thread.
  */
 static inline void* QV_MEMALIGN(size_t boundary, size_t size)
 {
 	void* retadr = nullptr;
 	posix_memalign(&retadr, boundary, size);  // allows calling with 512-byte align to support _possible_ direct I/O. Ref. issue #24437
+	artdaq::NumaUtils::PlaceOnLocalNode(retadr, size);
 	return retadr;
 }
 
+/**
+ * \brief Allocates memory for the QuickVec, from a QuickVecArena if one applies
+ * \param size The size of memory to allocate
+ * \param current The QuickVec's current data (nullptr for a new QuickVec)
+ * \return Pointer to allocated memory, aligned to QV_ALIGN
+ *
+ * Storage which is in a registered arena grows within that arena. Otherwise, the calling thread's
+ * artdaq::CurrentQuickVecArena is used. If the arena is full, the memory comes from the heap.
+ */
+static inline void* QV_ALLOC(size_t size, void const* current)
+{
+	auto found = artdaq::FindQuickVecArena(current);
+	auto arena = found ? found.get() : artdaq::CurrentQuickVecArena();
+	if (arena != nullptr)
+	{
+		auto retadr = arena->Allocate(size);
+		if (retadr != nullptr)
+		{
+			return retadr;
+		}
+		TRACEN("QuickVec", 43, "QV_ALLOC arena is full, allocating %zu bytes from the heap", size);  // NOLINT
+	}
+	return QV_MEMALIGN(QV_ALIGN, size);
+}
+
+/**
+ * \brief Checks whether memory allocated by QV_ALLOC can hold more data without reallocating
+ * \param ptr Pointer returned by QV_ALLOC
+ * \param size Number of bytes needed
+ * \return True if ptr is in an arena whose block is at least size bytes
+ */
+static inline bool QV_FITS(void const* ptr, size_t size)
+{
+	auto arena = artdaq::FindQuickVecArena(ptr);
+	return arena && arena->UsableSize(ptr) >= size;
+}
+
+/**
+ * \brief Frees memory allocated by QV_ALLOC, returning it to its arena if it came from one
+ * \param ptr Pointer to free
+ */
+static inline void QV_FREE(void* ptr)
+{
+	auto arena = artdaq::FindQuickVecArena(ptr);
+	if (arena)
+	{
+		arena->Free(ptr);
+		return;
+	}
+	free(ptr);  // NOLINT(cppcoreguidelines-no-malloc) TODO: #24439
+}
+
 #ifndef QUICKVEC_DO_TEMPLATE
 #define QUICKVEC_DO_TEMPLATE 1
 #endif
@@ -110,6 +169,14 @@ struct QuickVec
 	 */
 	QuickVec(size_t sz, TT_ val);
 
+	/**
+	 * \brief Takes ownership of existing storage, without allocating any first (see adopt)
+	 * \param data Storage allocated with QV_ALLOC
+	 * \param size Number of elements in use
+	 * \param capacity Number of elements the storage can hold
+	 */
+	QuickVec(TT_* data, size_t size, size_t capacity);
+
 	/**
 	 * \brief Destructor calls free on data.
 	 */
@@ -121,7 +188,7 @@ struct QuickVec
 	 */
 	QuickVec(std::vector<TT_>& other)
 	    : size_(other.size())
-	    , data_(reinterpret_cast<TT_*>(QV_MEMALIGN(QV_ALIGN, other.capacity() * sizeof(TT_))))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	    , data_(reinterpret_cast<TT_*>(QV_ALLOC(other.capacity() * sizeof(TT_), nullptr)))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 	    , capacity_(other.capacity())
 	{
 		TRACEN("QuickVec", 40, "QuickVec std::vector ctor b4 memcpy this=%p data_=%p &other[0]=%p size_=%d other.size()=%d", (void*)this, (void*)data_, (void*)&other[0], size_, other.size());  // NOLINT
@@ -140,7 +207,7 @@ struct QuickVec
 	 */
 	QuickVec(const QuickVec& other)  //= delete; // non construction-copyable
 	    : size_(other.size_)
-	    , data_(reinterpret_cast<TT_*>(QV_MEMALIGN(QV_ALIGN, other.capacity() * sizeof(TT_))))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	    , data_(reinterpret_cast<TT_*>(QV_ALLOC(other.capacity() * sizeof(TT_), nullptr)))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 	    , capacity_(other.capacity_)
 	{
 		TRACEN("QuickVec", 40, "QuickVec copy ctor b4 memcpy this=%p data_=%p other.data_=%p size_=%d other.size_=%d", (void*)this, (void*)data_, (void*)other.data_, size_, other.size_);  // NOLINT
@@ -183,7 +250,7 @@ struct QuickVec
 		TRACEN("QuickVec", 40, "QuickVec move assign this=%p data_=%p other.data_=%p", (void*)this, (void*)data_, (void*)other.data_);  // NOLINT
 		size_ = other.size_;
 		// delete [] data_;
-		free(data_);  // NOLINT(cppcoreguidelines-no-malloc) TODO: #24439
+		QV_FREE(data_);
 		data_ = std::move(other.data_);
 		capacity_ = other.capacity_;
 		other.data_ = nullptr;
@@ -333,6 +400,22 @@ struct QuickVec
 	 */
 	void push_back(const value_type& val);
 
+	/**
+	 * \brief Takes ownership of existing storage, freeing the current data
+	 * \param data Storage allocated with QV_ALLOC (from the heap or from a registered artdaq::QuickVecArena)
+	 * \param size Number of elements in use
+	 * \param capacity Number of elements the storage can hold
+	 *
+	 * This lets a QuickVec use data placed in a QuickVecArena by another process without copying it.
+	 */
+	void adopt(TT_* data, size_t size, size_t capacity);
+
+	/**
+	 * \brief Gives up the storage without freeing it, leaving the QuickVec empty
+	 * \return Pointer to the storage, which the caller is now responsible for
+	 */
+	TT_* release() noexcept;
+
 	QUICKVEC_VERSION
 
 private:
@@ -347,7 +430,7 @@ private:
 QUICKVEC_TEMPLATE
 inline QUICKVEC::QuickVec(size_t sz)
     : size_(sz)
-    , data_(reinterpret_cast<TT_*>(QV_MEMALIGN(QV_ALIGN, sz * sizeof(TT_))))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    , data_(reinterpret_cast<TT_*>(QV_ALLOC(sz * sizeof(TT_), nullptr)))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
     , capacity_(sz)
 {
 	TRACEN("QuickVec", 45, "QuickVec %p ctor sz=%d data_=%p", (void*)this, size_, (void*)data_);  // NOLINT
@@ -356,7 +439,7 @@ inline QUICKVEC::QuickVec(size_t sz)
 QUICKVEC_TEMPLATE
 inline QUICKVEC::QuickVec(size_t sz, TT_ val)
     : size_(sz)
-    , data_(reinterpret_cast<TT_*>(QV_MEMALIGN(QV_ALIGN, sz * sizeof(TT_))))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    , data_(reinterpret_cast<TT_*>(QV_ALLOC(sz * sizeof(TT_), nullptr)))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
     , capacity_(sz)
 {
 	TRACEN("QuickVec", 45, "QuickVec %p ctor sz=%d/v data_=%p", (void*)this, size_, (void*)data_);  // NOLINT
@@ -364,12 +447,22 @@ inline QUICKVEC::QuickVec(size_t sz, TT_ val)
 	// bzero( &data_[0], (sz<4)?(sz*sizeof(TT_)):(4*sizeof(TT_)) );
 }
 
+QUICKVEC_TEMPLATE
+inline QUICKVEC::QuickVec(TT_* data, size_t size, size_t capacity)
+    : size_(size)
+    , data_(data)
+    , capacity_(capacity)
+{
+	TRACEN("QuickVec", 45, "QuickVec %p ctor adopting data_=%p size_=%d", (void*)this, (void*)data_, size_);  // NOLINT
+	assert(size <= capacity);
+}
+
 QUICKVEC_TEMPLATE
 inline QUICKVEC::~QuickVec() noexcept
 {
 	TRACEN("QuickVec", 45, "QuickVec %p dtor start data_=%p size_=%d", (void*)this, (void*)data_, size_);  // NOLINT
 
-	free(data_);  // NOLINT(cppcoreguidelines-no-malloc) TODO: #24439
+	QV_FREE(data_);
 
 	TRACEN("QuickVec", 45, "QuickVec %p dtor return", (void*)this);  // NOLINT
 }
@@ -415,15 +508,19 @@ inline QUICKVEC_TN::const_iterator QUICKVEC::end() const
 QUICKVEC_TEMPLATE
 inline void QUICKVEC::reserve(size_t size)
 {
-	if (size > capacity_)  // reallocation if true
+	if (size > capacity_ && QV_FITS(data_, size * sizeof(TT_)))  // arena blocks can have room to spare
+	{
+		capacity_ = size;
+	}
+	else if (size > capacity_)  // reallocation if true
 	{
 		TT_* old = data_;
 		// data_ = new TT_[size];
-		data_ = reinterpret_cast<TT_*>(QV_MEMALIGN(QV_ALIGN, size * sizeof(TT_)));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		data_ = reinterpret_cast<TT_*>(QV_ALLOC(size * sizeof(TT_), old));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 		memcpy(data_, old, size_ * sizeof(TT_));
 		TRACEN("QuickVec", 43, "QUICKVEC::reserve after memcpy this=%p old=%p data_=%p capacity=%d", (void*)this, (void*)old, (void*)data_, (int)size);  // NOLINT
 
-		free(old);  // NOLINT(cppcoreguidelines-no-malloc) TODO: #24439
+		QV_FREE(old);
 		capacity_ = size;
 	}
 }
@@ -435,14 +532,16 @@ inline void QUICKVEC::resize(size_t size)
 		size_ = size;  // decrease
 	else if (size <= capacity_)
 		size_ = size;
+	else if (QV_FITS(data_, size * sizeof(TT_)))
+		size_ = capacity_ = size;
 	else  // increase/reallocate
 	{
 		TT_* old = data_;
-		data_ = reinterpret_cast<TT_*>(QV_MEMALIGN(QV_ALIGN, size * sizeof(TT_)));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		data_ = reinterpret_cast<TT_*>(QV_ALLOC(size * sizeof(TT_), old));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 		memcpy(data_, old, size_ * sizeof(TT_));
 		TRACEN("QuickVec", 43, "QUICKVEC::resize after memcpy this=%p old=%p data_=%p size=%d", (void*)this, (void*)old, (void*)data_, (int)size);  // NOLINT
 
-		free(old);  // NOLINT(cppcoreguidelines-no-malloc) TODO: #24439
+		QV_FREE(old);
 		size_ = capacity_ = size;
 	}
 }
@@ -558,6 +657,27 @@ inline void QUICKVEC::push_back(const value_type& val)
 	++size_;
 }
 
+QUICKVEC_TEMPLATE
+inline void QUICKVEC::adopt(TT_* data, size_t size, size_t capacity)
+{
+	TRACEN("QuickVec", 42, "QUICKVEC::adopt this=%p data_=%p data=%p size=%zu", (void*)this, (void*)data_, (void*)data, size);  // NOLINT
+	assert(size <= capacity);
+	QV_FREE(data_);
+	data_ = data;
+	size_ = size;
+	capacity_ = capacity;
+}
+
+QUICKVEC_TEMPLATE
+inline TT_* QUICKVEC::release() noexcept
+{
+	TRACEN("QuickVec", 42, "QUICKVEC::release this=%p data_=%p", (void*)this, (void*)data_);  // NOLINT
+	TT_* data = data_;
+	data_ = nullptr;
+	size_ = capacity_ = 0;
+	return data;
+}
+
 }  // namespace artdaq
 
 #ifdef UNDEF_TRACE_AT_END
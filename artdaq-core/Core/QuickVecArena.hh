@@ -0,0 +1,235 @@
+#ifndef artdaq_core_Core_QuickVecArena_hh
+#define artdaq_core_Core_QuickVecArena_hh 1
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Maximum number of arenas registered at the same time in one process
+#define QV_MAX_ARENAS 32
+
+namespace artdaq {
+/**
+ * \brief A memory region which QuickVec storage can be carved from, instead of the process heap
+ *
+ * Arenas are registered with RegisterQuickVecArena. QuickVec then frees storage which lies in a registered
+ * arena back to that arena, and grows such storage within the same arena, so that code which only knows about
+ * QuickVec (e.g. Fragment::resizeBytesWithCushion) keeps the data in the arena. New QuickVec objects use the
+ * arena selected with CurrentQuickVecArena for the calling thread (see SharedMemoryFragmentHeap::Scope).
+ */
+class QuickVecArena
+{
+public:
+	/**
+	 * \brief QuickVecArena Destructor
+	 */
+	virtual ~QuickVecArena() = default;
+
+	/**
+	 * \brief Allocate storage from the arena
+	 * \param bytes Size of the storage
+	 * \return Pointer to storage aligned to QV_ALIGN, or nullptr if the arena is full
+	 */
+	virtual void* Allocate(size_t bytes) = 0;
+
+	/**
+	 * \brief Return storage to the arena
+	 * \param ptr Pointer returned by Allocate
+	 */
+	virtual void Free(void* ptr) = 0;
+
+	/**
+	 * \brief Whether a pointer lies in the arena
+	 * \param ptr Pointer to check
+	 * \return True if ptr was (or could have been) returned by Allocate
+	 */
+	virtual bool Contains(void const* ptr) const = 0;
+
+	/**
+	 * \brief Get the size of the storage Allocate actually reserved
+	 * \param ptr Pointer returned by Allocate
+	 * \return Number of bytes usable at ptr, which may exceed the size that was requested
+	 */
+	virtual size_t UsableSize(void const* ptr) const = 0;
+};
+
+/**
+ * \brief A registered arena found by FindQuickVecArena. The arena cannot be unregistered while the reference exists
+ */
+class QuickVecArenaRef
+{
+public:
+	/**
+	 * \brief Construct a reference to no arena
+	 */
+	QuickVecArenaRef() = default;
+	/**
+	 * \brief Construct a reference to an arena which has already been pinned
+	 * \param arena Arena to refer to
+	 * \param pins Pin count of the arena's registry slot, decremented when the reference goes away
+	 */
+	QuickVecArenaRef(QuickVecArena* arena, std::atomic<int>& pins)
+	    : arena_(arena), pins_(&pins) {}
+	/**
+	 * \brief Unpin the arena
+	 */
+	~QuickVecArenaRef()
+	{
+		if (pins_ != nullptr)
+		{
+			--*pins_;
+		}
+	}
+	QuickVecArenaRef(QuickVecArenaRef const&) = delete;             ///< Copy Constructor is deleted
+	QuickVecArenaRef(QuickVecArenaRef&&) = delete;                  ///< Move Constructor is deleted
+	QuickVecArenaRef& operator=(QuickVecArenaRef const&) = delete;  ///< Copy Assignment Operator is deleted
+	QuickVecArenaRef& operator=(QuickVecArenaRef&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Get the arena
+	 * \return Pointer to the arena, nullptr if there is none
+	 */
+	QuickVecArena* get() const { return arena_; }
+	/**
+	 * \brief Access the arena
+	 * \return Pointer to the arena
+	 */
+	QuickVecArena* operator->() const { return arena_; }
+	/**
+	 * \brief Whether an arena was found
+	 * \return True if the reference refers to an arena
+	 */
+	explicit operator bool() const { return arena_ != nullptr; }
+
+private:
+	QuickVecArena* arena_{nullptr};
+	std::atomic<int>* pins_{nullptr};
+};
+
+namespace detail {
+/**
+ * \brief Registered QuickVecArena objects. Slots are only written under the mutex, and read without it
+ */
+struct QuickVecArenaRegistry
+{
+	std::array<std::atomic<QuickVecArena*>, QV_MAX_ARENAS> arenas{};  ///< Registered arenas (nullptr for a free slot)
+	std::array<std::atomic<uintptr_t>, QV_MAX_ARENAS> begins{};        ///< Start address of the arena in each slot
+	std::array<std::atomic<uintptr_t>, QV_MAX_ARENAS> ends{};          ///< End address of the arena in each slot (0 for a free slot)
+	std::array<std::atomic<int>, QV_MAX_ARENAS> pins{};                ///< Lookups using the arena in each slot
+	std::atomic<int> count{0};                                          ///< Number of registered arenas
+	std::mutex mutex;                                                   ///< Serializes registration
+};
+
+/**
+ * \brief Get the process-wide arena registry
+ * \return Reference to the registry
+ */
+inline QuickVecArenaRegistry& GetQuickVecArenaRegistry()
+{
+	static QuickVecArenaRegistry registry;
+	return registry;
+}
+}  // namespace detail
+
+/**
+ * \brief Make QuickVec aware of an arena
+ * \param arena Arena to register
+ * \param begin Start of the memory the arena allocates from
+ * \param size Size of that memory, in bytes. Every pointer for which arena->Contains is true must lie in it
+ * \return Whether the arena was registered (false if QV_MAX_ARENAS arenas are already registered)
+ */
+inline bool RegisterQuickVecArena(QuickVecArena* arena, void const* begin, size_t size)
+{
+	auto& registry = detail::GetQuickVecArenaRegistry();
+	std::lock_guard<std::mutex> lk(registry.mutex);
+	for (size_t ii = 0; ii < registry.arenas.size(); ++ii)
+	{
+		if (registry.arenas[ii].load() == nullptr)
+		{
+			registry.begins[ii] = reinterpret_cast<uintptr_t>(begin);       // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+			registry.ends[ii] = reinterpret_cast<uintptr_t>(begin) + size;  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+			registry.arenas[ii] = arena;
+			++registry.count;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * \brief Remove an arena from the registry. No QuickVec may use the arena's storage afterwards
+ * \param arena Arena to remove
+ *
+ * Waits for lookups which found the arena before it was removed (see QuickVecArenaRef) to finish.
+ */
+inline void UnregisterQuickVecArena(QuickVecArena* arena)
+{
+	auto& registry = detail::GetQuickVecArenaRegistry();
+	std::lock_guard<std::mutex> lk(registry.mutex);
+	for (size_t ii = 0; ii < registry.arenas.size(); ++ii)
+	{
+		if (registry.arenas[ii].load() == arena)
+		{
+			registry.arenas[ii] = nullptr;
+			registry.ends[ii] = 0;
+			--registry.count;
+			while (registry.pins[ii].load() != 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+}
+
+/**
+ * \brief Find the arena which holds a pointer
+ * \param ptr Pointer to look up
+ * \return Reference to the registered arena containing ptr, which is empty if ptr is not in any arena
+ *
+ * This is a single atomic load when no arena is registered. Otherwise, ptr is first compared with the address
+ * range of each slot, which only loads; a slot is pinned only when ptr lies in its range, so heap storage is
+ * freed without any atomic read-modify-write. The arena is pinned until the returned reference goes away, so
+ * that e.g. a Free through it does not race with UnregisterQuickVecArena.
+ */
+inline QuickVecArenaRef FindQuickVecArena(void const* ptr)
+{
+	auto& registry = detail::GetQuickVecArenaRegistry();
+	if (ptr == nullptr || registry.count.load(std::memory_order_acquire) == 0)
+	{
+		return QuickVecArenaRef();
+	}
+	auto address = reinterpret_cast<uintptr_t>(ptr);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	for (size_t ii = 0; ii < registry.arenas.size(); ++ii)
+	{
+		// The range may be stale if the slot is being reused; the pinned check below is the one which counts
+		if (address < registry.begins[ii].load(std::memory_order_relaxed) || address >= registry.ends[ii].load(std::memory_order_relaxed))
+		{
+			continue;
+		}
+		// Pin the slot before loading it again: either Unregister sees the pin, or this sees the slot cleared
+		++registry.pins[ii];
+		auto arena = registry.arenas[ii].load();
+		if (arena != nullptr && arena->Contains(ptr))
+		{
+			return QuickVecArenaRef(arena, registry.pins[ii]);
+		}
+		--registry.pins[ii];
+	}
+	return QuickVecArenaRef();
+}
+
+/**
+ * \brief The arena new QuickVec objects of the calling thread are allocated from
+ * \return Reference to the thread's arena pointer (nullptr: use the process heap)
+ */
+inline QuickVecArena*& CurrentQuickVecArena()
+{
+	thread_local QuickVecArena* arena = nullptr;
+	return arena;
+}
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_QuickVecArena_hh
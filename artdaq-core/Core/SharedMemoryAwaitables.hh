@@ -0,0 +1,325 @@
+#ifndef artdaq_core_Core_SharedMemoryAwaitables_hh
+#define artdaq_core_Core_SharedMemoryAwaitables_hh 1
+
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+
+// C++20 coroutine support. This header is self-contained (everything is inline), so that consumers built as C++20
+// can use it with a library built as C++17. Without compiler support, it only provides the SharedMemoryManager
+// declarations, and ARTDAQ_CORE_HAS_COROUTINES is not defined.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#define ARTDAQ_CORE_HAS_COROUTINES 1
+
+// While waiting on several segments, the event loop checks all of them at least this often
+#define SHM_EVENT_LOOP_SLICE_US 1000
+
+namespace artdaq {
+class SharedMemoryEventLoop;
+
+/**
+ * \brief Return type of the coroutines run by a SharedMemoryEventLoop
+ *
+ * A SharedMemoryTask does not start until it is given to SharedMemoryEventLoop::spawn, which then owns it.
+ */
+class SharedMemoryTask
+{
+public:
+	/**
+	 * \brief Coroutine promise of a SharedMemoryTask
+	 */
+	struct promise_type
+	{
+		std::exception_ptr exception;  ///< Exception which ended the coroutine, rethrown by the event loop
+
+		/**
+		 * \brief Create the SharedMemoryTask for this coroutine
+		 * \return SharedMemoryTask owning the coroutine
+		 */
+		SharedMemoryTask get_return_object() { return SharedMemoryTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		/**
+		 * \brief Coroutines start suspended, until they are spawned
+		 * \return std::suspend_always
+		 */
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		/**
+		 * \brief Coroutines stay suspended at the end, so that the event loop can collect them
+		 * \return std::suspend_always
+		 */
+		std::suspend_always final_suspend() noexcept { return {}; }
+		/**
+		 * \brief Nothing is returned from a SharedMemoryTask
+		 */
+		void return_void() {}
+		/**
+		 * \brief Keep the exception, for the event loop to rethrow
+		 */
+		void unhandled_exception() { exception = std::current_exception(); }
+	};
+
+	/**
+	 * \brief Move Constructor
+	 * \param other SharedMemoryTask to take the coroutine from
+	 */
+	SharedMemoryTask(SharedMemoryTask&& other) noexcept
+	    : handle_(std::exchange(other.handle_, nullptr)) {}
+	/**
+	 * \brief Move Assignment Operator
+	 * \param other SharedMemoryTask to take the coroutine from
+	 * \return Reference to this SharedMemoryTask
+	 */
+	SharedMemoryTask& operator=(SharedMemoryTask&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (handle_) handle_.destroy();
+			handle_ = std::exchange(other.handle_, nullptr);
+		}
+		return *this;
+	}
+	SharedMemoryTask(SharedMemoryTask const&) = delete;             ///< Copy Constructor is deleted
+	SharedMemoryTask& operator=(SharedMemoryTask const&) = delete;  ///< Copy Assignment Operator is deleted
+	/**
+	 * \brief Destroys the coroutine, if it was never spawned
+	 */
+	~SharedMemoryTask()
+	{
+		if (handle_) handle_.destroy();
+	}
+
+private:
+	friend class SharedMemoryEventLoop;
+	explicit SharedMemoryTask(std::coroutine_handle<promise_type> handle)
+	    : handle_(handle) {}
+
+	std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * \brief Single-threaded event loop which resumes coroutines when a Shared Memory buffer is available for them
+ *
+ * Coroutines wait for buffers with co_await loop.next_buffer(segment) or co_await loop.reserve_for_write(segment),
+ * which suspend without holding a thread. run_once tries to get a buffer for every waiting coroutine, resumes those
+ * that got one, and otherwise sleeps until a segment's buffer epoch changes (see SharedMemoryManager::WaitForBufferChange).
+ * One thread can thus serve many segments (e.g. the data and broadcast segments of an event receiver) and consumers.
+ *
+ * A futex wait covers one segment, so with several segments the loop waits on each in turn for at most
+ * SHM_EVENT_LOOP_SLICE_US, checking all epochs in between.
+ */
+class SharedMemoryEventLoop
+{
+public:
+	/**
+	 * \brief Awaitable which completes with a buffer reserved for reading or writing
+	 */
+	class BufferAwaitable
+	{
+	public:
+		/**
+		 * \brief Try to get a buffer without suspending
+		 * \return Whether a buffer was reserved (or the segment is gone), so that the coroutine continues at once
+		 */
+		bool await_ready() { return tryAcquire_(); }
+		/**
+		 * \brief Register the suspended coroutine with the event loop
+		 * \param handle Coroutine to resume once a buffer is reserved
+		 */
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			handle_ = handle;
+			loop_.waiters_.push_back(this);
+		}
+		/**
+		 * \brief Get the reserved buffer
+		 * \return Buffer number, or -1 if the segment is no longer valid or has reached the end of data
+		 */
+		int await_resume() const { return buffer_; }
+
+	private:
+		friend class SharedMemoryEventLoop;
+		BufferAwaitable(SharedMemoryEventLoop& loop, SharedMemoryManager& segment, bool write, bool overwrite)
+		    : loop_(loop), segment_(segment), write_(write), overwrite_(overwrite) {}
+
+		bool tryAcquire_()
+		{
+			if (!segment_.IsValid() || segment_.IsEndOfData())
+			{
+				buffer_ = -1;
+				return true;
+			}
+			if (write_)
+			{
+				buffer_ = segment_.GetBufferForWriting(overwrite_);
+			}
+			else
+			{
+				buffer_ = segment_.ReadyForRead() ? segment_.GetBufferForReading() : -1;
+			}
+			return buffer_ != -1;
+		}
+
+		SharedMemoryEventLoop& loop_;
+		SharedMemoryManager& segment_;
+		bool write_;
+		bool overwrite_;
+		int buffer_{-1};
+		std::coroutine_handle<> handle_;
+	};
+
+	SharedMemoryEventLoop() = default;
+	/**
+	 * \brief Destroys the coroutines which have not finished
+	 */
+	~SharedMemoryEventLoop()
+	{
+		for (auto task : tasks_) task.destroy();
+	}
+	SharedMemoryEventLoop(SharedMemoryEventLoop const&) = delete;             ///< Copy Constructor is deleted
+	SharedMemoryEventLoop(SharedMemoryEventLoop&&) = delete;                  ///< Move Constructor is deleted
+	SharedMemoryEventLoop& operator=(SharedMemoryEventLoop const&) = delete;  ///< Copy Assignment Operator is deleted
+	SharedMemoryEventLoop& operator=(SharedMemoryEventLoop&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Wait for a buffer to read
+	 * \param segment Segment to read from
+	 * \return Awaitable, whose result is the buffer reserved for reading (see BufferAwaitable::await_resume)
+	 */
+	BufferAwaitable next_buffer(SharedMemoryManager& segment) { return BufferAwaitable(*this, segment, false, false); }
+
+	/**
+	 * \brief Wait for a buffer to write
+	 * \param segment Segment to write to
+	 * \param overwrite Whether Full buffers may be overwritten (see SharedMemoryManager::GetBufferForWriting)
+	 * \return Awaitable, whose result is the buffer reserved for writing (see BufferAwaitable::await_resume)
+	 */
+	BufferAwaitable reserve_for_write(SharedMemoryManager& segment, bool overwrite = false) { return BufferAwaitable(*this, segment, true, overwrite); }
+
+	/**
+	 * \brief Start a coroutine. It runs until its first suspension; the event loop owns it from then on
+	 * \param task Coroutine to start
+	 */
+	void spawn(SharedMemoryTask task)
+	{
+		auto handle = std::exchange(task.handle_, nullptr);
+		tasks_.push_back(handle);
+		handle.resume();
+		reap_();
+	}
+
+	/**
+	 * \brief Resume the coroutines whose buffers are available, waiting up to timeout_us if there are none
+	 * \param timeout_us Maximum time to wait for a buffer
+	 * \return Number of coroutines resumed
+	 *
+	 * An exception which ends a coroutine is rethrown from here.
+	 */
+	size_t run_once(size_t timeout_us)
+	{
+		std::vector<std::pair<SharedMemoryManager*, unsigned>> epochs;
+		std::vector<BufferAwaitable*> ready;
+		auto waiting = std::exchange(waiters_, {});
+		for (auto waiter : waiting)
+		{
+			// Read the epoch before trying, so that a buffer freed in between still ends the wait below
+			auto epoch = waiter->segment_.GetBufferEpoch();
+			if (waiter->tryAcquire_())
+			{
+				ready.push_back(waiter);
+				continue;
+			}
+			waiters_.push_back(waiter);
+			if (std::none_of(epochs.begin(), epochs.end(), [&](auto const& seen) { return seen.first == &waiter->segment_; }))
+			{
+				epochs.emplace_back(&waiter->segment_, epoch);
+			}
+		}
+
+		for (auto waiter : ready)
+		{
+			waiter->handle_.resume();
+		}
+		reap_();
+		if (!ready.empty() || epochs.empty())
+		{
+			return ready.size();
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		size_t turn = 0;
+		while (true)
+		{
+			auto elapsed = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+			if (elapsed >= timeout_us)
+			{
+				break;
+			}
+			if (std::any_of(epochs.begin(), epochs.end(), [](auto const& seen) { return seen.first->GetBufferEpoch() != seen.second; }))
+			{
+				break;
+			}
+			auto const& [segment, epoch] = epochs[turn++ % epochs.size()];
+			auto slice = epochs.size() == 1 ? timeout_us - elapsed : std::min<size_t>(timeout_us - elapsed, SHM_EVENT_LOOP_SLICE_US);
+			if (!segment->WaitForBufferChange(epoch, slice) && !segment->IsValid())
+			{
+				break;  // Let the next run_once resume its waiters with -1
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * \brief Run until all coroutines have finished
+	 * \param poll_us Maximum time to wait in each round (see run_once)
+	 */
+	void run(size_t poll_us = 100000)
+	{
+		while (!tasks_.empty())
+		{
+			run_once(poll_us);
+		}
+	}
+
+	/**
+	 * \brief Get the number of coroutines which have not finished
+	 * \return Number of running coroutines
+	 */
+	size_t task_count() const { return tasks_.size(); }
+
+private:
+	void reap_()
+	{
+		std::exception_ptr exception;
+		for (auto it = tasks_.begin(); it != tasks_.end();)
+		{
+			if (!it->done())
+			{
+				++it;
+				continue;
+			}
+			if (it->promise().exception && !exception)
+			{
+				exception = it->promise().exception;
+			}
+			it->destroy();
+			it = tasks_.erase(it);
+		}
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+
+	std::vector<BufferAwaitable*> waiters_;
+	std::vector<std::coroutine_handle<SharedMemoryTask::promise_type>> tasks_;
+};
+}  // namespace artdaq
+
+#endif  // __cpp_impl_coroutine
+
+#endif  // artdaq_core_Core_SharedMemoryAwaitables_hh
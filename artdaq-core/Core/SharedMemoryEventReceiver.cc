@@ -6,6 +6,43 @@
 #define TRACE_NAME "SharedMemoryEventReceiver"
 #include "TRACE/tracemf.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// Interval at which the prefetch thread looks for a new data buffer
+#define PREFETCH_POLL_US 1000
+// Number of Fragment headers touched in a prefetched buffer
+#define PREFETCH_FRAGMENT_HEADERS 4
+// Number of times a prefetched buffer is touched per buffer timeout while it waits to be handed over
+#define PREFETCH_TOUCHES_PER_TIMEOUT 4
+
+namespace {
+// Copy bytes starting at a logical offset in the data of a (possibly chained) buffer
+bool CopyFromSegments(std::vector<artdaq::SharedMemoryManager::BufferSegment> const& segments, size_t offset, void* dest, size_t size)
+{
+	auto out = static_cast<uint8_t*>(dest);
+	for (auto const& segment : segments)
+	{
+		if (offset >= segment.size)
+		{
+			offset -= segment.size;
+			continue;
+		}
+		auto chunk = std::min(segment.size - offset, size);
+		memcpy(out, static_cast<uint8_t*>(segment.data) + offset, chunk);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		out += chunk;                                                      // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		size -= chunk;
+		offset = 0;
+		if (size == 0)
+		{
+			return true;
+		}
+	}
+	return size == 0;
+}
+}  // namespace
+
 artdaq::SharedMemoryEventReceiver::SharedMemoryEventReceiver(uint32_t shm_key, uint32_t broadcast_shm_key)
     : current_read_buffer_(-1)
     , initialized_(false)
@@ -15,17 +52,177 @@ artdaq::SharedMemoryEventReceiver::SharedMemoryEventReceiver(uint32_t shm_key, u
     , broadcasts_(broadcast_shm_key)
 {
 	TLOG(TLVL_DEBUG + 33) << "SharedMemoryEventReceiver CONSTRUCTOR";
+	loadPinnedEvents_();
+}
+
+void artdaq::SharedMemoryEventReceiver::loadPinnedEvents_()
+{
+	std::vector<std::pair<size_t, std::vector<uint8_t>>> pinned;
+	for (size_t ii = 0; ii < broadcasts_.GetPinnedSlotCount(); ++ii)
+	{
+		std::vector<uint8_t> event(broadcasts_.BufferSize());
+		uint32_t tag = 0;
+		size_t sequence_id = 0;
+		auto size = broadcasts_.CopyPinnedSlot(ii, event.data(), tag, sequence_id);
+		if (size < sizeof(detail::RawEventHeader))
+		{
+			continue;
+		}
+		event.resize(size);
+		pinned.emplace_back(sequence_id, std::move(event));
+	}
+	std::sort(pinned.begin(), pinned.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+	for (auto& event : pinned)
+	{
+		catch_up_sequence_id_ = event.first;
+		catch_up_.push_back(std::move(event.second));
+	}
+	TLOG(TLVL_DEBUG + 33) << "loadPinnedEvents_: " << catch_up_.size() << " pinned broadcast events to catch up on, newest sequence ID " << catch_up_sequence_id_;
+}
+
+artdaq::SharedMemoryEventReceiver::~SharedMemoryEventReceiver()
+{
+	SetPrefetch(false);
+}
+
+void artdaq::SharedMemoryEventReceiver::SetPrefetch(bool enable)
+{
+	if (enable == prefetch_running_)
+	{
+		return;
+	}
+	if (enable)
+	{
+		TLOG(TLVL_DEBUG + 33) << "SetPrefetch: Starting prefetch thread";
+		prefetch_running_ = true;
+		prefetch_thread_ = std::thread(&SharedMemoryEventReceiver::prefetchLoop_, this);
+		return;
+	}
+
+	TLOG(TLVL_DEBUG + 33) << "SetPrefetch: Stopping prefetch thread";
+	{
+		std::lock_guard<std::mutex> lk(prefetch_mutex_);
+		prefetch_running_ = false;
+	}
+	prefetch_cv_.notify_all();
+	if (prefetch_thread_.joinable())
+	{
+		prefetch_thread_.join();
+	}
+	// Give a buffer claimed in advance back; it was never handed out, so this reader has not seen it either
+	auto last_seen = prefetched_last_seen_;
+	auto token = takePrefetched_();
+	if (token.valid() && data_.IsValid())
+	{
+		data_.MarkBufferUnread(token.buffer(), last_seen);
+	}
+}
+
+void artdaq::SharedMemoryEventReceiver::prefetchLoop_()
+{
+	while (prefetch_running_)
+	{
+		{
+			// Wait until the previous buffer has been handed over, touching it so that no other reader resets it as stale
+			auto touch_interval = std::chrono::microseconds(std::max<uint64_t>(data_.GetBufferTimeout() / PREFETCH_TOUCHES_PER_TIMEOUT, PREFETCH_POLL_US));
+			std::unique_lock<std::mutex> lk(prefetch_mutex_);
+			while (prefetch_running_ && prefetched_token_.valid())
+			{
+				if (!data_.CheckBuffer(prefetched_token_, SharedMemoryManager::BufferSemaphoreFlags::Reading))
+				{
+					TLOG(TLVL_WARNING) << "prefetchLoop_: Buffer " << prefetched_token_.buffer() << " claimed in advance was taken back, claiming another";
+					prefetched_token_ = SharedMemoryManager::BufferToken();
+					break;
+				}
+				data_.TouchBuffer(prefetched_token_.buffer());
+				prefetch_cv_.wait_for(lk, touch_interval, [this] { return !prefetch_running_ || !prefetched_token_.valid(); });
+			}
+			if (!prefetch_running_)
+			{
+				break;
+			}
+		}
+
+		auto last_seen = data_.GetLastSeenBufferID();
+		auto token = data_.IsValid() && data_.ReadyForRead() ? data_.GetBufferTokenForReading() : SharedMemoryManager::BufferToken();
+		if (!token.valid())
+		{
+			std::unique_lock<std::mutex> lk(prefetch_mutex_);
+			prefetch_cv_.wait_for(lk, std::chrono::microseconds(PREFETCH_POLL_US), [this] { return !prefetch_running_; });
+			continue;
+		}
+
+		prefetchHeaders_(token.buffer());
+		TLOG(TLVL_DEBUG + 33) << "prefetchLoop_: Claimed buffer " << token.buffer() << " in advance";
+		{
+			std::lock_guard<std::mutex> lk(prefetch_mutex_);
+			prefetched_token_ = token;
+			prefetched_last_seen_ = last_seen;
+		}
+		prefetch_cv_.notify_all();
+	}
+}
+
+void artdaq::SharedMemoryEventReceiver::prefetchHeaders_(int buffer)
+{
+	// Only the first segment of a chained buffer is walked; the headers are what the first calls after ReadyForRead touch
+	auto segments = data_.GetBufferSegments(buffer);
+	if (segments.empty())
+	{
+		return;
+	}
+	auto start = static_cast<uint8_t const*>(segments[0].data);
+	__builtin_prefetch(start);
+	size_t pos = sizeof(detail::RawEventHeader);
+	for (int ii = 0; ii < PREFETCH_FRAGMENT_HEADERS && pos + sizeof(detail::RawFragmentHeader) <= segments[0].size; ++ii)
+	{
+		__builtin_prefetch(start + pos);                                                        // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto hdr = reinterpret_cast<detail::RawFragmentHeader const*>(start + pos);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (hdr->word_count == 0)
+		{
+			break;
+		}
+		pos += hdr->word_count * sizeof(RawDataType);
+	}
+}
+
+artdaq::SharedMemoryManager::BufferToken artdaq::SharedMemoryEventReceiver::takePrefetched_()
+{
+	SharedMemoryManager::BufferToken token;
+	{
+		std::lock_guard<std::mutex> lk(prefetch_mutex_);
+		std::swap(token, prefetched_token_);
+	}
+	if (token.valid())
+	{
+		prefetch_cv_.notify_all();
+	}
+	return token;
 }
 
 bool artdaq::SharedMemoryEventReceiver::ReadyForRead(bool broadcast, size_t timeout_us)
 {
 	TLOG(TLVL_DEBUG + 33) << "ReadyForRead BEGIN timeout_us=" << timeout_us;
-	if (current_read_buffer_ != -1 && (current_data_source_ != nullptr) && (current_header_ != nullptr))
+	if ((current_read_buffer_ != -1 && (current_data_source_ != nullptr) && (current_header_ != nullptr)) || !catch_up_event_.empty())
 	{
 		TLOG(TLVL_DEBUG + 33) << "ReadyForRead Returning true because already reading buffer";
 		return true;
 	}
 
+	if (!catch_up_.empty())
+	{
+		catch_up_event_ = std::move(catch_up_.front());
+		catch_up_.pop_front();
+		current_header_ = reinterpret_cast<detail::RawEventHeader*>(catch_up_event_.data());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		TLOG(TLVL_DEBUG + 33) << "ReadyForRead Returning pinned broadcast event, sequence_id=" << current_header_->sequence_id;
+		bool err;
+		if (GetFragmentTypes(err).count(Fragment::type_t(Fragment::InitFragmentType)) != 0u)
+		{
+			initialized_ = true;
+		}
+		return true;
+	}
+
 	bool first = true;
 	auto start_time = TimeUtils::gettimeofday_us();
 	uint64_t time_diff = 0;
@@ -35,24 +232,43 @@ bool artdaq::SharedMemoryEventReceiver::ReadyForRead(bool broadcast, size_t time
 	{
 		if (broadcasts_.ReadyForRead())
 		{
-			buf = broadcasts_.GetBufferForReading();
+			current_token_ = broadcasts_.GetBufferTokenForReading();
+			buf = current_token_.buffer();
 			current_data_source_ = &broadcasts_;
 		}
+		else if (!broadcast && prefetch_running_)
+		{
+			current_token_ = takePrefetched_();
+			if (current_token_.valid() && !data_.CheckBuffer(current_token_, SharedMemoryManager::BufferSemaphoreFlags::Reading))
+			{
+				TLOG(TLVL_WARNING) << "ReadyForRead: Prefetched buffer " << current_token_.buffer() << " was taken back, dropping it";
+				current_token_ = SharedMemoryManager::BufferToken();
+			}
+			buf = current_token_.buffer();
+			current_data_source_ = &data_;
+		}
 		else if (!broadcast && data_.ReadyForRead())
 		{
-			buf = data_.GetBufferForReading();
+			current_token_ = data_.GetBufferTokenForReading();
+			buf = current_token_.buffer();
 			current_data_source_ = &data_;
 		}
 		if (buf != -1 && (current_data_source_ != nullptr))
 		{
 			current_read_buffer_ = buf;
-			current_data_source_->ResetReadPos(buf);
+			current_data_source_->ResetReadPos(current_token_);
 			current_header_ = reinterpret_cast<detail::RawEventHeader*>(current_data_source_->GetReadPos(buf));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 			TLOG(TLVL_DEBUG + 33) << "ReadyForRead Found buffer, returning true. event hdr sequence_id=" << current_header_->sequence_id;
 
 			// Ignore any Init fragments after the first
 			if (current_data_source_ == &broadcasts_)
 			{
+				if (broadcasts_.GetLastSeenBufferID() <= catch_up_sequence_id_)
+				{
+					TLOG(TLVL_DEBUG + 33) << "ReadyForRead Skipping broadcast " << broadcasts_.GetLastSeenBufferID() << ", which was replayed from the pinned events";
+					ReleaseBuffer();
+					continue;
+				}
 				bool err;
 				auto types = GetFragmentTypes(err);
 				if (!err && (types.count(Fragment::type_t(Fragment::InitFragmentType)) != 0u) && initialized_)
@@ -81,7 +297,16 @@ bool artdaq::SharedMemoryEventReceiver::ReadyForRead(bool broadcast, size_t time
 		auto sleep_time = time_diff;
 		if (sleep_time < 10000) sleep_time = 10000;
 		if (sleep_time > max_sleep) sleep_time = max_sleep;
-		usleep(sleep_time);
+		if (!broadcast && prefetch_running_)
+		{
+			// Wake up as soon as the prefetch thread has a buffer
+			std::unique_lock<std::mutex> lk(prefetch_mutex_);
+			prefetch_cv_.wait_for(lk, std::chrono::microseconds(sleep_time), [this] { return prefetched_token_.valid() || !prefetch_running_; });
+		}
+		else
+		{
+			usleep(sleep_time);
+		}
 	}
 	TLOG(TLVL_DEBUG + 33) << "ReadyForRead returning false";
 	return false;
@@ -90,14 +315,20 @@ bool artdaq::SharedMemoryEventReceiver::ReadyForRead(bool broadcast, size_t time
 artdaq::detail::RawEventHeader* artdaq::SharedMemoryEventReceiver::ReadHeader(bool& err)
 {
 	TLOG(TLVL_DEBUG + 33) << "ReadHeader BEGIN";
+	if (!catch_up_event_.empty())
+	{
+		err = false;
+		return current_header_;
+	}
 	if (current_read_buffer_ != -1 && (current_data_source_ != nullptr))
 	{
-		err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+		err = !current_data_source_->CheckBuffer(current_token_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
 		if (err)
 		{
 			TLOG(TLVL_WARNING) << "Buffer was in incorrect state, resetting";
 			current_data_source_ = nullptr;
 			current_read_buffer_ = -1;
+			current_token_ = SharedMemoryManager::BufferToken();
 			current_header_ = nullptr;
 			return nullptr;
 		}
@@ -108,31 +339,49 @@ artdaq::detail::RawEventHeader* artdaq::SharedMemoryEventReceiver::ReadHeader(bo
 
 std::set<artdaq::Fragment::type_t> artdaq::SharedMemoryEventReceiver::GetFragmentTypes(bool& err)
 {
+	if (!catch_up_event_.empty())
+	{
+		err = false;
+		auto output = std::set<Fragment::type_t>();
+		std::vector<SharedMemoryManager::BufferSegment> segments{{catch_up_event_.data(), catch_up_event_.size()}};
+		detail::RawFragmentHeader fragHdr;
+		for (size_t pos = sizeof(detail::RawEventHeader); CopyFromSegments(segments, pos, &fragHdr, sizeof(fragHdr)) && fragHdr.word_count > 0; pos += fragHdr.word_count * sizeof(RawDataType))
+		{
+			output.insert(fragHdr.type);
+		}
+		return output;
+	}
 	if (current_read_buffer_ == -1 || (current_header_ == nullptr) || (current_data_source_ == nullptr))
 	{
 		throw cet::exception("AccessViolation") << "Cannot call GetFragmentTypes when not currently reading a buffer! Call ReadHeader() first!";  // NOLINT(cert-err60-cpp)
 	}
 
-	err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+	err = !current_data_source_->CheckBuffer(current_token_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
 	if (err)
 	{
 		return std::set<Fragment::type_t>();
 	}
 
-	current_data_source_->ResetReadPos(current_read_buffer_);
-	current_data_source_->IncrementReadPos(current_read_buffer_, sizeof(detail::RawEventHeader));
+	// The buffer is owned by this reader until ReleaseBuffer, so the walk below uses the token and does not lock per call
+	current_data_source_->ResetReadPos(current_token_);
+	current_data_source_->IncrementReadPos(current_token_, sizeof(detail::RawEventHeader));
 	auto output = std::set<Fragment::type_t>();
 
-	while (current_data_source_->MoreDataInBuffer(current_read_buffer_))
+	while (current_data_source_->MoreDataInBuffer(current_token_))
 	{
-		err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+		err = !current_data_source_->CheckBuffer(current_token_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
 		if (err)
 		{
 			return std::set<Fragment::type_t>();
 		}
-		auto fragHdr = reinterpret_cast<artdaq::detail::RawFragmentHeader*>(current_data_source_->GetReadPos(current_read_buffer_));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-		output.insert(fragHdr->type);
-		current_data_source_->IncrementReadPos(current_read_buffer_, fragHdr->word_count * sizeof(RawDataType));
+		// The header is copied out, as it may straddle two segments of a chained buffer
+		detail::RawFragmentHeader fragHdr;
+		current_data_source_->Read(current_token_, &fragHdr, sizeof(fragHdr));
+		output.insert(fragHdr.type);
+		if (fragHdr.word_count > detail::RawFragmentHeader::num_words())
+		{
+			current_data_source_->IncrementReadPos(current_token_, (fragHdr.word_count - detail::RawFragmentHeader::num_words()) * sizeof(RawDataType));
+		}
 	}
 
 	return output;
@@ -140,38 +389,61 @@ std::set<artdaq::Fragment::type_t> artdaq::SharedMemoryEventReceiver::GetFragmen
 
 std::unique_ptr<artdaq::Fragments> artdaq::SharedMemoryEventReceiver::GetFragmentsByType(bool& err, Fragment::type_t type)
 {
+	if (!catch_up_event_.empty())
+	{
+		err = false;
+		std::unique_ptr<Fragments> output(new Fragments());
+		std::vector<SharedMemoryManager::BufferSegment> segments{{catch_up_event_.data(), catch_up_event_.size()}};
+		detail::RawFragmentHeader fragHdr;
+		for (size_t pos = sizeof(detail::RawEventHeader); CopyFromSegments(segments, pos, &fragHdr, sizeof(fragHdr)) && fragHdr.word_count > 0; pos += fragHdr.word_count * sizeof(RawDataType))
+		{
+			if (fragHdr.type == type || type == Fragment::InvalidFragmentType)
+			{
+				output->emplace_back(fragHdr.word_count - detail::RawFragmentHeader::num_words());
+				CopyFromSegments(segments, pos, output->back().headerAddress(), fragHdr.word_count * sizeof(RawDataType));
+				output->back().autoResize();
+			}
+		}
+		return output;
+	}
 	if ((current_data_source_ == nullptr) || (current_header_ == nullptr) || current_read_buffer_ == -1)
 	{
 		throw cet::exception("AccessViolation") << "Cannot call GetFragmentsByType when not currently reading a buffer! Call ReadHeader() first!";  // NOLINT(cert-err60-cpp)
 	}
-	err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+	err = !current_data_source_->CheckBuffer(current_token_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
 	if (err)
 	{
 		return nullptr;
 	}
 
-	current_data_source_->ResetReadPos(current_read_buffer_);
-	current_data_source_->IncrementReadPos(current_read_buffer_, sizeof(detail::RawEventHeader));
+	current_data_source_->ResetReadPos(current_token_);
+	current_data_source_->IncrementReadPos(current_token_, sizeof(detail::RawEventHeader));
 
 	std::unique_ptr<Fragments> output(new Fragments());
 
-	while (current_data_source_->MoreDataInBuffer(current_read_buffer_))
+	while (current_data_source_->MoreDataInBuffer(current_token_))
 	{
-		err = !current_data_source_->CheckBuffer(current_read_buffer_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
+		err = !current_data_source_->CheckBuffer(current_token_, SharedMemoryManager::BufferSemaphoreFlags::Reading);
 		if (err)
 		{
 			return nullptr;
 		}
-		auto fragHdr = reinterpret_cast<artdaq::detail::RawFragmentHeader*>(current_data_source_->GetReadPos(current_read_buffer_));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-		if (fragHdr->type == type || type == Fragment::InvalidFragmentType)
+		detail::RawFragmentHeader fragHdr;
+		current_data_source_->Read(current_token_, &fragHdr, sizeof(fragHdr));
+		auto payload_bytes = fragHdr.word_count > detail::RawFragmentHeader::num_words() ? (fragHdr.word_count - detail::RawFragmentHeader::num_words()) * sizeof(RawDataType) : 0;
+		if (fragHdr.type == type || type == Fragment::InvalidFragmentType)
 		{
-			output->emplace_back(fragHdr->word_count - detail::RawFragmentHeader::num_words());
-			current_data_source_->Read(current_read_buffer_, output->back().headerAddress(), fragHdr->word_count * sizeof(RawDataType));
+			output->emplace_back(fragHdr.word_count - detail::RawFragmentHeader::num_words());
+			memcpy(output->back().headerAddress(), &fragHdr, sizeof(fragHdr));
+			if (payload_bytes > 0)
+			{
+				current_data_source_->Read(current_token_, output->back().headerAddress() + detail::RawFragmentHeader::num_words(), payload_bytes);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			}
 			output->back().autoResize();
 		}
-		else
+		else if (payload_bytes > 0)
 		{
-			current_data_source_->IncrementReadPos(current_read_buffer_, fragHdr->word_count * sizeof(RawDataType));
+			current_data_source_->IncrementReadPos(current_token_, payload_bytes);
 		}
 	}
 
@@ -185,23 +457,42 @@ std::string artdaq::SharedMemoryEventReceiver::printBuffers_(SharedMemoryManager
 	{
 		ostr << "Buffer " << ii << ": " << std::endl;
 
-		void* data_ptr = data_source->GetBufferStart(ii);
-		void* end_ptr = static_cast<uint8_t*>(data_ptr) + data_source->BufferDataSize(ii);
-		data_ptr = static_cast<uint8_t*>(data_ptr) + sizeof(detail::RawEventHeader);
-		TLOG_DEBUG(33) << "Buffer " << ii << ": data_ptr: " << data_ptr << ", end_ptr: " << end_ptr;
+		auto segments = data_source->GetBufferSegments(ii);
+		if (segments.empty())
+		{
+			ostr << "    (continuation of a chained buffer)" << std::endl;
+			continue;
+		}
+		if (segments.size() > 1)
+		{
+			ostr << "    Chained over " << segments.size() << " buffers" << std::endl;
+		}
+
+		size_t end_pos = 0;
+		for (auto const& segment : segments)
+		{
+			end_pos += segment.size;
+		}
+		size_t pos = sizeof(detail::RawEventHeader);
+		TLOG_DEBUG(33) << "Buffer " << ii << ": pos: " << pos << ", end_pos: " << end_pos;
 
-		while (data_ptr < end_ptr)
+		detail::RawFragmentHeader fragHdr;
+		while (pos < end_pos && CopyFromSegments(segments, pos, &fragHdr, sizeof(fragHdr)))
 		{
-			auto fragHdr = reinterpret_cast<artdaq::detail::RawFragmentHeader*>(data_ptr);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-			ostr << "    Fragment " << fragHdr->fragment_id << ": Sequence ID: " << fragHdr->sequence_id << ", Type:" << fragHdr->type;
-			if (artdaq::detail::RawFragmentHeader::MakeVerboseSystemTypeMap().count(fragHdr->type) != 0u)
+			ostr << "    Fragment " << fragHdr.fragment_id << ": Sequence ID: " << fragHdr.sequence_id << ", Type:" << fragHdr.type;
+			auto typeName = artdaq::detail::RawFragmentHeader::SystemTypeName(fragHdr.type);
+			if (!typeName.empty())
+			{
+				ostr << " (" << typeName << ")";
+			}
+			ostr << ", Size: " << fragHdr.word_count << " words." << std::endl;
+			if (fragHdr.word_count == 0)
 			{
-				ostr << " (" << artdaq::detail::RawFragmentHeader::MakeVerboseSystemTypeMap()[fragHdr->type] << ")";
+				break;
 			}
-			ostr << ", Size: " << fragHdr->word_count << " words." << std::endl;
-			data_ptr = static_cast<uint8_t*>(data_ptr) + fragHdr->word_count * sizeof(RawDataType);
+			pos += fragHdr.word_count * sizeof(RawDataType);
 
-			TLOG_DEBUG(33) << "Buffer " << ii << ": After reading Fragment of size " << static_cast<int>(fragHdr->word_count * sizeof(RawDataType)) << " data_ptr: " << data_ptr << ", end_ptr: " << end_ptr;
+			TLOG_DEBUG(33) << "Buffer " << ii << ": After reading Fragment of size " << static_cast<int>(fragHdr.word_count * sizeof(RawDataType)) << " pos: " << pos << ", end_pos: " << end_pos;
 		}
 	}
 	return ostr.str();
@@ -227,6 +518,13 @@ std::string artdaq::SharedMemoryEventReceiver::toString()
 void artdaq::SharedMemoryEventReceiver::ReleaseBuffer()
 {
 	TLOG(TLVL_DEBUG + 33) << "ReleaseBuffer BEGIN";
+	if (!catch_up_event_.empty())
+	{
+		catch_up_event_.clear();
+		current_header_ = nullptr;
+		TLOG(TLVL_DEBUG + 33) << "ReleaseBuffer END (pinned event)";
+		return;
+	}
 	try
 	{
 		if (current_data_source_ != nullptr)
@@ -243,7 +541,18 @@ void artdaq::SharedMemoryEventReceiver::ReleaseBuffer()
 		TLOG(TLVL_ERROR) << "An unknown exception occured while trying to release the buffer";
 	}
 	current_read_buffer_ = -1;
+	current_token_ = SharedMemoryManager::BufferToken();
 	current_header_ = nullptr;
 	current_data_source_ = nullptr;
+
+	if (prefetch_running_)
+	{
+		// Bring the headers of the next event into this thread's cache as well
+		std::lock_guard<std::mutex> lk(prefetch_mutex_);
+		if (prefetched_token_.valid())
+		{
+			prefetchHeaders_(prefetched_token_.buffer());
+		}
+	}
 	TLOG(TLVL_DEBUG + 33) << "ReleaseBuffer END";
 }
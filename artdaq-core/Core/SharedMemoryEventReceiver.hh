@@ -1,7 +1,12 @@
 #ifndef artdaq_core_Core_SharedMemoryEventReceiver_hh
 #define artdaq_core_Core_SharedMemoryEventReceiver_hh 1
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <set>
+#include <thread>
 
 #include "artdaq-core/Core/SharedMemoryManager.hh"
 #include "artdaq-core/Data/Fragment.hh"
@@ -18,12 +23,16 @@ public:
 	 * \brief Connect to a Shared Memory segment using the given parameters
 	 * \param shm_key Key of the Shared Memory segment
 	 * \param broadcast_shm_key Key of the broadcast Shared Memory segment
+	 *
+	 * If the broadcast segment has pinned events (see SharedMemoryManager::PinBuffer, e.g. the Init Fragments and the
+	 * last run and subrun boundaries), they are copied now, and ReadyForRead hands them out, oldest first, before any
+	 * live event. Live broadcasts which are not newer than the pinned events are then skipped.
 	 */
 	SharedMemoryEventReceiver(uint32_t shm_key, uint32_t broadcast_shm_key);
 	/**
-	 * \brief SharedMemoryEventReceiver Destructor
+	 * \brief SharedMemoryEventReceiver Destructor. Stops the prefetch thread, if any
 	 */
-	virtual ~SharedMemoryEventReceiver() = default;
+	virtual ~SharedMemoryEventReceiver();
 
 	/**
 	 * \brief Determine whether an event is available for reading
@@ -88,7 +97,13 @@ public:
 	 * \brief Get the count of available buffers, both broadcasts and data
 	 * \return The sum of the available data buffer count and the available broadcast buffer count
 	 */
-	int ReadReadyCount() { return data_.ReadReadyCount() + broadcasts_.ReadReadyCount(); }
+	int ReadReadyCount() { return data_.ReadReadyCount() + broadcasts_.ReadReadyCount() + catch_up_.size(); }
+
+	/**
+	 * \brief Get the number of pinned broadcast events which have not been handed out yet
+	 * \return Number of catch-up events left
+	 */
+	size_t CatchUpCount() const { return catch_up_.size(); }
 
 	/**
 	 * \brief Get the size of the data buffer
@@ -96,6 +111,25 @@ public:
 	 */
 	size_t size() { return data_.size(); }
 
+	/**
+	 * \brief Enable or disable prefetching of the next data buffer
+	 * \param enable Whether to prefetch
+	 *
+	 * When enabled, a background thread claims the next data buffer while the current event is being processed, and
+	 * touches its event header and first Fragment headers, so that they are in the cache when ReadyForRead hands the
+	 * buffer over. Events are still delivered in the order they are claimed. One data buffer is held in advance, so
+	 * another reader of the same segment cannot get it; it is touched while held, so that it does not go stale. When
+	 * prefetching is disabled (or the receiver is destroyed), that buffer is returned unread (see
+	 * SharedMemoryManager::MarkBufferUnread), so that no event is lost.
+	 */
+	void SetPrefetch(bool enable);
+
+	/**
+	 * \brief Whether the next data buffer is prefetched
+	 * \return True if the prefetch thread is running
+	 */
+	bool GetPrefetch() const { return prefetch_running_; }
+
 private:
 	SharedMemoryEventReceiver(SharedMemoryEventReceiver const&) = delete;
 	SharedMemoryEventReceiver(SharedMemoryEventReceiver&&) = delete;
@@ -103,13 +137,29 @@ private:
 	SharedMemoryEventReceiver& operator=(SharedMemoryEventReceiver&&) = delete;
 
 	std::string printBuffers_(SharedMemoryManager* data_source);
+	void loadPinnedEvents_();
+	void prefetchLoop_();
+	void prefetchHeaders_(int buffer);
+	SharedMemoryManager::BufferToken takePrefetched_();
 
 	int current_read_buffer_;
+	SharedMemoryManager::BufferToken current_token_;
 	bool initialized_;
 	detail::RawEventHeader* current_header_;
 	SharedMemoryManager* current_data_source_;
 	SharedMemoryManager data_;
 	SharedMemoryManager broadcasts_;
+
+	std::atomic<bool> prefetch_running_{false};
+	std::thread prefetch_thread_;
+	std::mutex prefetch_mutex_;
+	std::condition_variable prefetch_cv_;
+	SharedMemoryManager::BufferToken prefetched_token_;
+	size_t prefetched_last_seen_{0};  // Last sequence ID seen by data_ before prefetched_token_ was claimed
+
+	std::deque<std::vector<uint8_t>> catch_up_;  // Pinned broadcast events not handed out yet, oldest first
+	std::vector<uint8_t> catch_up_event_;        // Pinned event being read, empty while reading from Shared Memory
+	size_t catch_up_sequence_id_{0};             // Sequence ID of the newest pinned event
 };
 }  // namespace artdaq
 
@@ -0,0 +1,276 @@
+#define TRACE_NAME "SharedMemoryFragmentHeap"
+#include "artdaq-core/Core/SharedMemoryFragmentHeap.hh"
+
+#include <unistd.h>
+#include <cstring>
+
+#include "TRACE/tracemf.h"
+#include "artdaq-core/Utilities/TimeUtils.hh"
+#include "cetlib_except/exception.h"
+
+#define SHM_HEAP_MAGIC 0x48454150  // "HEAP"
+#define SHM_HEAP_ATTACH_POLL_US 1000
+#define SHM_HEAP_MAX_GRANULES 0xFFFFFFFEULL  // Granule + 1 has to fit in the low word of a free list head
+
+artdaq::SharedMemoryFragmentHeap::SharedMemoryFragmentHeap(uint32_t shm_key, size_t arena_size, size_t attach_timeout_us)
+    : segment_(shm_key, arena_size > 0 ? 1 : 0, arena_size > 0 ? segmentSize_(arena_size) : 0)
+{
+	if (!segment_.IsValid())
+	{
+		TLOG(TLVL_WARNING) << "Could not attach to the heap segment with key " << std::hex << std::showbase << shm_key;
+		return;
+	}
+
+	auto base = static_cast<uint8_t*>(segment_.GetBufferStart(0));
+	auto header = reinterpret_cast<HeapHeader*>(base);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	if (arena_size > 0 && segment_.GetMyId() == 0)
+	{
+		auto granules = (arena_size + QV_ALIGN - 1) / QV_ALIGN;
+		header->granule_count = granules;
+		header->next_granule = 0;
+		for (auto& list : header->free_lists)
+		{
+			list = 0;
+		}
+		header->used_bytes = 0;
+
+		// Segments are page-aligned in every process, so an offset which aligns the arena here aligns it everywhere
+		auto arena_start = reinterpret_cast<uintptr_t>(base + sizeof(HeapHeader) + granules * sizeof(BlockDescriptor));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		arena_start = (arena_start + QV_ALIGN - 1) / QV_ALIGN * QV_ALIGN;
+		header->arena_offset = arena_start - reinterpret_cast<uintptr_t>(base);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+		auto descriptors = reinterpret_cast<BlockDescriptor*>(base + sizeof(HeapHeader));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		memset(static_cast<void*>(descriptors), 0, granules * sizeof(BlockDescriptor));
+		header->ready_magic.store(SHM_HEAP_MAGIC, std::memory_order_release);
+		TLOG(TLVL_DEBUG) << "Initialized heap with " << granules << " granules of " << QV_ALIGN << " bytes";
+	}
+	else
+	{
+		auto start = TimeUtils::gettimeofday_us();
+		while (header->ready_magic.load(std::memory_order_acquire) != SHM_HEAP_MAGIC)
+		{
+			if (TimeUtils::gettimeofday_us() - start > attach_timeout_us)
+			{
+				TLOG(TLVL_WARNING) << "Heap with key " << std::hex << std::showbase << shm_key << " was not initialized by its owner in time";
+				return;
+			}
+			usleep(SHM_HEAP_ATTACH_POLL_US);
+		}
+	}
+
+	descriptors_ = reinterpret_cast<BlockDescriptor*>(base + sizeof(HeapHeader));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	arena_ = base + header->arena_offset;                                            // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	header_ = header;
+	if (!RegisterQuickVecArena(this, arena_, ArenaSize()))
+	{
+		header_ = nullptr;
+		throw cet::exception("SharedMemoryFragmentHeap") << "Too many heaps in this process, at most " << QV_MAX_ARENAS << " can be attached at once";  // NOLINT(cert-err60-cpp)
+	}
+}
+
+artdaq::SharedMemoryFragmentHeap::~SharedMemoryFragmentHeap()
+{
+	if (IsValid())
+	{
+		UnregisterQuickVecArena(this);
+	}
+}
+
+size_t artdaq::SharedMemoryFragmentHeap::segmentSize_(size_t arena_size)
+{
+	auto granules = (arena_size + QV_ALIGN - 1) / QV_ALIGN;
+	if (granules > SHM_HEAP_MAX_GRANULES)
+	{
+		throw cet::exception("SharedMemoryFragmentHeap") << "Arena size " << arena_size << " is too large";  // NOLINT(cert-err60-cpp)
+	}
+	return sizeof(HeapHeader) + granules * sizeof(BlockDescriptor) + QV_ALIGN + granules * QV_ALIGN;
+}
+
+size_t artdaq::SharedMemoryFragmentHeap::sizeClass_(size_t bytes)
+{
+	size_t size_class = 0;
+	while ((static_cast<size_t>(QV_ALIGN) << size_class) < bytes)
+	{
+		++size_class;
+	}
+	return size_class;
+}
+
+bool artdaq::SharedMemoryFragmentHeap::pop_(size_t size_class, size_t& granule)
+{
+	auto& list = header_->free_lists[size_class];
+	auto head = list.load(std::memory_order_acquire);
+	while ((head & 0xFFFFFFFF) != 0)
+	{
+		auto first = (head & 0xFFFFFFFF) - 1;
+		// The tag in the high word changes on every update, so a block freed and reused meanwhile makes the exchange fail
+		auto next = descriptors_[first].next.load(std::memory_order_relaxed);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto new_head = (((head >> 32) + 1) << 32) | next;
+		if (list.compare_exchange_weak(head, new_head, std::memory_order_acq_rel, std::memory_order_acquire))
+		{
+			granule = first;
+			return true;
+		}
+	}
+	return false;
+}
+
+void artdaq::SharedMemoryFragmentHeap::push_(size_t size_class, size_t granule)
+{
+	auto& list = header_->free_lists[size_class];
+	auto head = list.load(std::memory_order_relaxed);
+	uint64_t new_head = 0;
+	do
+	{
+		descriptors_[granule].next.store(static_cast<uint32_t>(head & 0xFFFFFFFF), std::memory_order_relaxed);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		new_head = (((head >> 32) + 1) << 32) | (granule + 1);
+	} while (!list.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void* artdaq::SharedMemoryFragmentHeap::Allocate(size_t bytes)
+{
+	if (!IsValid())
+	{
+		return nullptr;
+	}
+	auto size_class = sizeClass_(bytes);
+	if (size_class >= SHM_HEAP_SIZE_CLASSES)
+	{
+		return nullptr;
+	}
+
+	size_t granule = 0;
+	auto found = pop_(size_class, granule);
+	if (!found)
+	{
+		auto granules = 1ULL << size_class;
+		auto next = header_->next_granule.load();
+		while (next + granules <= header_->granule_count)
+		{
+			if (header_->next_granule.compare_exchange_weak(next, next + granules))
+			{
+				granule = next;
+				descriptors_[granule].size_class = size_class;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				found = true;
+				break;
+			}
+		}
+	}
+	// A larger block wastes space, but is better than falling back to the process heap
+	for (auto larger = size_class + 1; !found && larger < SHM_HEAP_SIZE_CLASSES; ++larger)
+	{
+		found = pop_(larger, granule);
+	}
+	if (!found)
+	{
+		TLOG(TLVL_DEBUG + 33) << "Allocate: No block for " << bytes << " bytes, " << UsedBytes() << " of " << ArenaSize() << " bytes are in use";
+		return nullptr;
+	}
+
+	auto& descriptor = descriptors_[granule];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	descriptor.refs = 1;
+	descriptor.exported = 0;
+	header_->used_bytes += static_cast<size_t>(QV_ALIGN) << descriptor.size_class;
+	TLOG(TLVL_DEBUG + 34) << "Allocate: " << bytes << " bytes at granule " << granule << ", size class " << descriptor.size_class;
+	return blockStart_(granule);
+}
+
+void artdaq::SharedMemoryFragmentHeap::Free(void* ptr)
+{
+	auto granule = granule_(ptr);
+	auto& descriptor = descriptors_[granule];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	if (descriptor.refs.fetch_sub(1) != 1)
+	{
+		return;
+	}
+	header_->used_bytes -= static_cast<size_t>(QV_ALIGN) << descriptor.size_class;
+	TLOG(TLVL_DEBUG + 34) << "Free: Returning granule " << granule << " to size class " << descriptor.size_class;
+	push_(descriptor.size_class, granule);
+}
+
+size_t artdaq::SharedMemoryFragmentHeap::UsableSize(void const* ptr) const
+{
+	return static_cast<size_t>(QV_ALIGN) << descriptors_[granule_(ptr)].size_class;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+bool artdaq::SharedMemoryFragmentHeap::validHandle_(Handle const& handle) const
+{
+	if (!IsValid() || !handle.valid() || handle.offset % QV_ALIGN != 0 || handle.offset >= ArenaSize())
+	{
+		return false;
+	}
+	auto granule = handle.offset / QV_ALIGN;
+	auto const& descriptor = descriptors_[granule];                                                 // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	return descriptor.refs > 0 && handle.length <= (static_cast<size_t>(QV_ALIGN) << descriptor.size_class);
+}
+
+bool artdaq::SharedMemoryFragmentHeap::consumeHandle_(Handle const& handle)
+{
+	if (!validHandle_(handle))
+	{
+		return false;
+	}
+	// Only one Import or Release, in any process, takes over the reference the handle holds
+	uint32_t exported = 1;
+	return descriptors_[handle.offset / QV_ALIGN].exported.compare_exchange_strong(exported, 0);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+artdaq::SharedMemoryFragmentHeap::Handle artdaq::SharedMemoryFragmentHeap::Export(Fragment&& fragment)
+{
+	Handle handle;
+	if (!IsValid())
+	{
+		return handle;
+	}
+	Fragment frag(std::move(fragment));
+	frag.unshare();
+	auto data = &*frag.headerBegin();
+	handle.length = frag.sizeBytes();
+
+	if (Contains(data))
+	{
+		// The handle takes a reference, and the Fragment drops its own when it goes out of scope
+		++descriptors_[granule_(data)].refs;        // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		descriptors_[granule_(data)].exported = 1;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		handle.offset = static_cast<uint8_t*>(static_cast<void*>(data)) - arena_;
+		TLOG(TLVL_DEBUG + 35) << "Export: Fragment with seqID=" << frag.sequenceID() << " is at offset " << handle.offset;
+		return handle;
+	}
+
+	auto block = Allocate(handle.length);
+	if (block == nullptr)
+	{
+		TLOG(TLVL_WARNING) << "Export: The heap is full, cannot copy a Fragment of " << handle.length << " bytes into it";
+		return Handle();
+	}
+	memcpy(block, data, handle.length);
+	descriptors_[granule_(block)].exported = 1;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	handle.offset = static_cast<uint8_t*>(block) - arena_;
+	TLOG(TLVL_DEBUG + 35) << "Export: Copied Fragment with seqID=" << frag.sequenceID() << " to offset " << handle.offset;
+	return handle;
+}
+
+bool artdaq::SharedMemoryFragmentHeap::Import(Handle const& handle, Fragment& fragment)
+{
+	if (!consumeHandle_(handle))
+	{
+		TLOG(TLVL_WARNING) << "Import: Invalid or already consumed handle, offset " << handle.offset << " length " << handle.length;
+		return false;
+	}
+	auto block = blockStart_(handle.offset / QV_ALIGN);
+	DATAVEC_T vals(static_cast<RawDataType*>(block), handle.length / sizeof(RawDataType), UsableSize(block) / sizeof(RawDataType));
+	fragment.swap(vals);
+	return true;
+}
+
+void artdaq::SharedMemoryFragmentHeap::Release(Handle const& handle)
+{
+	if (consumeHandle_(handle))
+	{
+		Free(blockStart_(handle.offset / QV_ALIGN));
+	}
+	else
+	{
+		TLOG(TLVL_WARNING) << "Release: Invalid or already consumed handle, offset " << handle.offset << " length " << handle.length;
+	}
+}
@@ -0,0 +1,208 @@
+#ifndef artdaq_core_Core_SharedMemoryFragmentHeap_hh
+#define artdaq_core_Core_SharedMemoryFragmentHeap_hh 1
+
+#include <array>
+#include <atomic>
+#include <limits>
+
+#include "artdaq-core/Core/QuickVec.hh"
+#include "artdaq-core/Core/QuickVecArena.hh"
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Data/Fragment.hh"
+
+// Number of block size classes. Class N holds blocks of QV_ALIGN << N bytes
+#define SHM_HEAP_SIZE_CLASSES 40
+
+namespace artdaq {
+/**
+ * \brief A heap in a Shared Memory segment, which Fragments can be built in and handed to other processes without copying
+ *
+ * Inside a Scope, new Fragments (more precisely, their QuickVec storage) are allocated from the heap's arena, and
+ * Fragment::resizeBytesWithCushion keeps growing them within the arena. A finished Fragment is turned into a Handle
+ * (an offset into the arena and a length) with Export. Any process attached to the same segment turns the Handle
+ * back into a Fragment with Import, whose storage is the same memory. The handle itself can be sent over any
+ * channel, e.g. a SharedMemoryManager buffer.
+ *
+ * Blocks are powers of two times QV_ALIGN bytes. Freed blocks go to a lock-free free list for their size class,
+ * kept in the segment, so that any process can reuse them. Blocks are never split or merged.
+ *
+ * Fragments using the heap must be destroyed before the SharedMemoryFragmentHeap which maps it, and blocks
+ * held by a process which dies are not reclaimed.
+ */
+class SharedMemoryFragmentHeap : public QuickVecArena
+{
+public:
+	/**
+	 * \brief Location of a Fragment in the heap, valid in every process attached to the heap
+	 */
+	struct Handle
+	{
+		uint64_t offset{std::numeric_limits<uint64_t>::max()};  ///< Offset of the Fragment from the start of the arena
+		uint64_t length{0};                                     ///< Size of the Fragment, in bytes
+
+		/**
+		 * \brief Whether the handle refers to a Fragment
+		 * \return True if the offset is set
+		 */
+		bool valid() const { return offset != std::numeric_limits<uint64_t>::max(); }
+	};
+
+	/**
+	 * \brief Allocate new QuickVec storage of the calling thread from a heap, for the lifetime of the Scope
+	 */
+	class Scope
+	{
+	public:
+		/**
+		 * \brief Make heap the calling thread's current QuickVecArena
+		 * \param heap Heap to allocate from
+		 */
+		explicit Scope(SharedMemoryFragmentHeap& heap)
+		    : previous_(CurrentQuickVecArena())
+		{
+			CurrentQuickVecArena() = &heap;
+		}
+		/**
+		 * \brief Restore the previous QuickVecArena
+		 */
+		~Scope() { CurrentQuickVecArena() = previous_; }
+		Scope(Scope const&) = delete;             ///< Copy Constructor is deleted
+		Scope(Scope&&) = delete;                  ///< Move Constructor is deleted
+		Scope& operator=(Scope const&) = delete;  ///< Copy Assignment Operator is deleted
+		Scope& operator=(Scope&&) = delete;       ///< Move Assignment Operator is deleted
+
+	private:
+		QuickVecArena* previous_;
+	};
+
+	/**
+	 * \brief SharedMemoryFragmentHeap Constructor
+	 * \param shm_key The key to use when attaching/creating the shared memory segment
+	 * \param arena_size Size of the arena, in bytes (0 to attach to an existing heap)
+	 * \param attach_timeout_us Time to wait for the owner to initialize an existing heap
+	 */
+	explicit SharedMemoryFragmentHeap(uint32_t shm_key, size_t arena_size = 0, size_t attach_timeout_us = 1000000);
+
+	/**
+	 * \brief SharedMemoryFragmentHeap Destructor. Fragments in the heap may not be used afterwards
+	 */
+	~SharedMemoryFragmentHeap() override;
+	SharedMemoryFragmentHeap(SharedMemoryFragmentHeap const&) = delete;             ///< Copy Constructor is deleted
+	SharedMemoryFragmentHeap(SharedMemoryFragmentHeap&&) = delete;                  ///< Move Constructor is deleted
+	SharedMemoryFragmentHeap& operator=(SharedMemoryFragmentHeap const&) = delete;  ///< Copy Assignment Operator is deleted
+	SharedMemoryFragmentHeap& operator=(SharedMemoryFragmentHeap&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Whether the heap is attached and initialized
+	 * \return True if the heap can be used
+	 */
+	bool IsValid() const { return header_ != nullptr; }
+
+	/**
+	 * \brief Get the size of the arena
+	 * \return Size of the arena, in bytes
+	 */
+	size_t ArenaSize() const { return IsValid() ? header_->granule_count * QV_ALIGN : 0; }
+
+	/**
+	 * \brief Get the amount of memory in blocks which are in use
+	 * \return Bytes in allocated blocks, in all processes
+	 */
+	size_t UsedBytes() const { return IsValid() ? header_->used_bytes.load() : 0; }
+
+	/**
+	 * \brief Access the Shared Memory segment holding the heap
+	 * \return Reference to the SharedMemoryManager (e.g. for NUMA placement)
+	 */
+	SharedMemoryManager& Segment() { return segment_; }
+
+	/**
+	 * \brief Hand a finished Fragment over to the heap
+	 * \param fragment Fragment to hand over. Its storage stays in the heap, owned by the returned Handle
+	 * \return Handle of the Fragment, or an invalid Handle if it had to be copied into the heap and the heap is full
+	 *
+	 * Fragments built in a Scope of this heap are not copied. Other Fragments are copied into the heap.
+	 */
+	Handle Export(Fragment&& fragment);
+
+	/**
+	 * \brief Turn a Handle into a Fragment, without copying
+	 * \param handle Handle returned by Export, in this or another process. It is consumed
+	 * \param fragment Output Fragment, whose storage is the heap block
+	 * \return Whether the handle referred to a Fragment in use in this heap, and had not been consumed yet
+	 *
+	 * A handle is consumed by exactly one Import or Release, in any process; using it again fails.
+	 */
+	bool Import(Handle const& handle, Fragment& fragment);
+
+	/**
+	 * \brief Free the Fragment of a Handle which will not be imported
+	 * \param handle Handle returned by Export. It is consumed; a handle which was already consumed is ignored
+	 */
+	void Release(Handle const& handle);
+
+	/**
+	 * \brief Allocate a block from the arena
+	 * \param bytes Size of the storage
+	 * \return Pointer to the block, aligned to QV_ALIGN, or nullptr if the arena is full
+	 *
+	 * A free block of the right size class is taken first, then unused space, then a free block of a larger class.
+	 */
+	void* Allocate(size_t bytes) override;
+
+	/**
+	 * \brief Return a block to its free list, once every reference to it is gone
+	 * \param ptr Pointer returned by Allocate
+	 */
+	void Free(void* ptr) override;
+
+	/**
+	 * \brief Whether a pointer lies in the arena
+	 * \param ptr Pointer to check
+	 * \return True if ptr is in this process's mapping of the arena
+	 */
+	bool Contains(void const* ptr) const override { return arena_ != nullptr && ptr >= arena_ && ptr < arena_ + ArenaSize(); }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	/**
+	 * \brief Get the size of a block
+	 * \param ptr Pointer returned by Allocate
+	 * \return Size of the block, in bytes
+	 */
+	size_t UsableSize(void const* ptr) const override;
+
+private:
+	struct HeapHeader
+	{
+		std::atomic<uint32_t> ready_magic;
+		uint64_t arena_offset;  // From the start of the Shared Memory buffer
+		uint64_t granule_count;
+		std::atomic<uint64_t> next_granule;                                         // First granule never allocated
+		std::array<std::atomic<uint64_t>, SHM_HEAP_SIZE_CLASSES> free_lists;        // Tag << 32 | (first granule + 1)
+		std::atomic<uint64_t> used_bytes;
+	};
+
+	struct BlockDescriptor
+	{
+		std::atomic<uint32_t> next;  // Next free block (granule + 1), 0 at the end of the list
+		std::atomic<uint32_t> size_class;
+		std::atomic<int32_t> refs;
+		std::atomic<uint32_t> exported;  // 1 while a Handle to the block has not been imported or released
+	};
+
+	static size_t segmentSize_(size_t arena_size);
+	static size_t sizeClass_(size_t bytes);
+	size_t granule_(void const* ptr) const { return static_cast<size_t>(static_cast<uint8_t const*>(ptr) - arena_) / QV_ALIGN; }
+	void* blockStart_(size_t granule) const { return arena_ + granule * QV_ALIGN; }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	bool pop_(size_t size_class, size_t& granule);
+	void push_(size_t size_class, size_t granule);
+	bool validHandle_(Handle const& handle) const;
+	bool consumeHandle_(Handle const& handle);
+
+	SharedMemoryManager segment_;
+	HeapHeader* header_{nullptr};
+	BlockDescriptor* descriptors_{nullptr};
+	uint8_t* arena_{nullptr};
+};
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_SharedMemoryFragmentHeap_hh
@@ -1,14 +1,29 @@
 
 #define TRACE_NAME "SharedMemoryFragmentManager"
 #include "artdaq-core/Core/SharedMemoryFragmentManager.hh"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <utility>
 #include "TRACE/tracemf.h"
 
-artdaq::SharedMemoryFragmentManager::SharedMemoryFragmentManager(uint32_t shm_key, size_t buffer_count, size_t max_buffer_size, size_t buffer_timeout_us)
-    : SharedMemoryManager(shm_key, buffer_count, max_buffer_size, buffer_timeout_us)
+artdaq::SharedMemoryFragmentManager::SharedMemoryFragmentManager(uint32_t shm_key, size_t buffer_count, size_t max_buffer_size, size_t buffer_timeout_us, uint32_t segment_flags)
+    : SharedMemoryManager(shm_key, buffer_count, max_buffer_size, buffer_timeout_us, true, segment_flags)
     , active_buffer_(-1)
+    , spill_buffer_(0)
+    , spill_rate_(1.0, 60.0)
+    , restore_rate_(1.0, 60.0)
 {
 }
 
+artdaq::SharedMemoryFragmentManager::~SharedMemoryFragmentManager()
+{
+	DisableSpill();
+}
+
 bool artdaq::SharedMemoryFragmentManager::ReadyForWrite(bool overwrite)
 {
 	TLOG(TLVL_DEBUG + 40) << "ReadyForWrite: active_buffer is " << active_buffer_;
@@ -34,6 +49,20 @@ int artdaq::SharedMemoryFragmentManager::WriteFragment(Fragment&& fragment, bool
 		TLOG(TLVL_INFO) << "WriteFragment: Shared memory was successfully reconnected";
 	}
 
+	if (spill_fd_ != -1)
+	{
+		drainSpill_(false);
+		// Once anything is in the spill file, later Fragments have to follow it there to stay in order
+		if (!spill_records_.empty() || (active_buffer_ == -1 && aboveWatermark_()))
+		{
+			if (spillFragment_(fragment))
+			{
+				return 0;
+			}
+			TLOG(TLVL_WARNING) << "WriteFragment: Could not spill Fragment with seqID=" << fragment.sequenceID() << ", writing it to Shared Memory instead";
+		}
+	}
+
 	auto waitStart = std::chrono::steady_clock::now();
 	while (!ReadyForWrite(overwrite) && TimeUtils::GetElapsedTimeMicroseconds(waitStart) < 1000)
 	{
@@ -68,17 +97,28 @@ int artdaq::SharedMemoryFragmentManager::WriteFragment(Fragment&& fragment, bool
 	}
 
 	TLOG(TLVL_DEBUG + 41) << "Sending fragment with seqID=" << fragment.sequenceID() << " using buffer " << active_buffer_;
-	artdaq::RawDataType* fragAddr = fragment.headerAddress();
 	size_t fragSize = fragment.size() * sizeof(artdaq::RawDataType);
 
+	// Read through the const accessor, so that a shared Fragment (see Fragment::makeShared) is not copied first
+	auto fragAddr = const_cast<artdaq::RawDataType*>(&*std::as_const(fragment).headerBegin());  // NOLINT(cppcoreguidelines-pro-type-const-cast)
+
 	auto sts = Write(active_buffer_, fragAddr, fragSize);
 	if (sts == fragSize)
 	{
 		TLOG(TLVL_DEBUG + 41) << "Done sending Fragment with seqID=" << fragment.sequenceID() << " using buffer " << active_buffer_;
 		MarkBufferFull(active_buffer_);
 		active_buffer_ = -1;
+		if (spill_headroom_ > 0)
+		{
+			--spill_headroom_;
+		}
 		return 0;
 	}
+	// A chained write can stop partway, when no continuation buffer frees up; return the buffers it claimed
+	if (IsValid())
+	{
+		MarkBufferEmpty(active_buffer_, true);
+	}
 	active_buffer_ = -1;
 	TLOG(TLVL_ERROR) << "Unexpected status from SharedMemory Write call!";
 	return -2;
@@ -154,3 +194,333 @@ int artdaq::SharedMemoryFragmentManager::ReadFragmentData(RawDataType* destinati
 	active_buffer_ = -1;
 	return 0;
 }
+
+bool artdaq::SharedMemoryFragmentManager::EnableSpill(std::string const& path, double watermark)
+{
+	DisableSpill();
+	if (watermark <= 0.0 || watermark > 1.0)
+	{
+		TLOG(TLVL_ERROR) << "EnableSpill: Watermark " << watermark << " is not in the range (0.0, 1.0]";
+		return false;
+	}
+
+	// The file is not truncated: Fragments left in it by an earlier DisableSpill are recovered below
+	spill_direct_io_ = true;
+	spill_fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT, 0644);  // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-signed-bitwise)
+	if (spill_fd_ == -1 && errno == EINVAL)
+	{
+		TLOG(TLVL_WARNING) << "EnableSpill: The file system of " << path << " does not support O_DIRECT, using buffered I/O";
+		spill_direct_io_ = false;
+		spill_fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);  // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-signed-bitwise)
+	}
+	if (spill_fd_ == -1)
+	{
+		TLOG(TLVL_ERROR) << "EnableSpill: Could not open spill file " << path << ", errno=" << errno << " (" << strerror(errno) << ")";
+		return false;
+	}
+
+	spill_path_ = path;
+	spill_watermark_ = watermark;
+	spill_write_offset_ = 0;
+	spill_headroom_ = 0;
+	spill_above_watermark_ = false;
+	spill_rate_.reset();
+	restore_rate_.reset();
+	recoverSpill_();
+	TLOG(TLVL_INFO) << "EnableSpill: Spilling Fragments to " << path << " when more than " << watermark * 100.0 << "% of the buffers are in use";
+	return true;
+}
+
+void artdaq::SharedMemoryFragmentManager::DisableSpill(size_t drain_timeout_us)
+{
+	if (spill_fd_ == -1)
+	{
+		return;
+	}
+	auto drainStart = std::chrono::steady_clock::now();
+	while (!spill_records_.empty() && IsValid() && !IsEndOfData())
+	{
+		if (DrainSpill() == 0)
+		{
+			if (TimeUtils::GetElapsedTimeMicroseconds(drainStart) >= drain_timeout_us)
+			{
+				break;
+			}
+			usleep(1000);
+		}
+	}
+	if (!spill_records_.empty())
+	{
+		compactSpill_();
+		TLOG(TLVL_WARNING) << "DisableSpill: " << spill_records_.size() << " Fragments (" << spill_depth_bytes_ << " bytes) were not delivered, and are left in spill file " << spill_path_
+		                   << " until spilling is enabled again with it";
+	}
+	close(spill_fd_);
+	spill_fd_ = -1;
+	if (spill_records_.empty())
+	{
+		unlink(spill_path_.c_str());
+	}
+	spill_records_.clear();
+	spill_depth_bytes_ = 0;
+	spill_write_offset_ = 0;
+}
+
+size_t artdaq::SharedMemoryFragmentManager::DrainSpill()
+{
+	return drainSpill_(true);
+}
+
+size_t artdaq::SharedMemoryFragmentManager::drainSpill_(bool recheck)
+{
+	if (recheck)
+	{
+		spill_above_watermark_ = false;
+	}
+
+	size_t restored = 0;
+	// Feeding back stops at the watermark, like writing does, so the segment keeps the same headroom
+	while (!spill_records_.empty() && IsValid() && !aboveWatermark_() && ReadyForWrite(false))
+	{
+		auto record = spill_records_.front();
+		if (!readSpill_(record))
+		{
+			TLOG(TLVL_ERROR) << "DrainSpill: Dropping Fragment at offset " << record.offset << " of spill file " << spill_path_;
+			spill_records_.pop_front();
+			spill_depth_bytes_ -= record.bytes;
+			continue;
+		}
+		auto sts = Write(active_buffer_, spill_buffer_.begin(), record.bytes);
+		if (sts != record.bytes)
+		{
+			// The record stays at the front of the spill file, and is written again on the next call
+			TLOG(TLVL_WARNING) << "DrainSpill: Unexpected status from SharedMemory Write call, will retry Fragment at offset " << record.offset << " of spill file " << spill_path_;
+			if (IsValid())
+			{
+				MarkBufferEmpty(active_buffer_, true);
+			}
+			active_buffer_ = -1;
+			break;
+		}
+		TLOG(TLVL_DEBUG + 44) << "DrainSpill: Fed back spilled Fragment with seqID=" << reinterpret_cast<detail::RawFragmentHeader*>(spill_buffer_.begin())->sequence_id  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		                      << " using buffer " << active_buffer_;
+		MarkBufferFull(active_buffer_);
+		active_buffer_ = -1;
+		spill_records_.pop_front();
+		spill_depth_bytes_ -= record.bytes;
+		if (spill_headroom_ > 0)
+		{
+			--spill_headroom_;
+		}
+		++restored;
+		++restored_fragments_;
+		restore_rate_.addSample(record.bytes);
+	}
+
+	if (spill_records_.empty() && spill_write_offset_ > 0)
+	{
+		// Everything was fed back: start the file over, so that it does not keep growing
+		if (ftruncate(spill_fd_, 0) == -1)
+		{
+			TLOG(TLVL_WARNING) << "DrainSpill: Could not truncate spill file " << spill_path_ << ", errno=" << errno << " (" << strerror(errno) << ")";
+		}
+		spill_write_offset_ = 0;
+	}
+	return restored;
+}
+
+artdaq::SharedMemoryFragmentManager::SpillStats artdaq::SharedMemoryFragmentManager::GetSpillStats()
+{
+	SpillStats stats;
+	stats.depth_fragments = spill_records_.size();
+	stats.depth_bytes = spill_depth_bytes_;
+	stats.spilled_fragments = spilled_fragments_;
+	stats.restored_fragments = restored_fragments_;
+	stats.direct_io = spill_fd_ != -1 && spill_direct_io_;
+
+	MonitoredQuantityStats mqStats;
+	spill_rate_.calculateStatistics();
+	spill_rate_.getStats(mqStats);
+	stats.spill_rate = mqStats.getValueRate(MonitoredQuantityStats::DataSetType::RECENT);
+	restore_rate_.calculateStatistics();
+	restore_rate_.getStats(mqStats);
+	stats.restore_rate = mqStats.getValueRate(MonitoredQuantityStats::DataSetType::RECENT);
+	return stats;
+}
+
+bool artdaq::SharedMemoryFragmentManager::aboveWatermark_()
+{
+	// WriteReadyCount scans every buffer, so it is not called for each Fragment. Readers only ever free buffers,
+	// so after a scan, this manager can write spill_headroom_ Fragments before it may reach the watermark
+	if (spill_headroom_ > 0)
+	{
+		return false;
+	}
+	if (spill_above_watermark_ && TimeUtils::GetElapsedTimeMicroseconds(spill_watermark_check_) < spill_watermark_check_interval_us_)
+	{
+		return true;
+	}
+
+	auto count = size();
+	if (count == 0)
+	{
+		return false;
+	}
+	auto used = count - WriteReadyCount(false);
+	auto limit = spill_watermark_ * count;
+	spill_headroom_ = static_cast<double>(used) < limit ? static_cast<size_t>(std::ceil(limit - used)) : 0;
+	spill_above_watermark_ = spill_headroom_ == 0;
+	spill_watermark_check_ = std::chrono::steady_clock::now();
+	return spill_above_watermark_;
+}
+
+void artdaq::SharedMemoryFragmentManager::recoverSpill_()
+{
+	struct stat st;
+	if (fstat(spill_fd_, &st) == -1 || st.st_size == 0)
+	{
+		return;
+	}
+
+	// Each record is a whole Fragment, padded to QV_ALIGN, so the records can be found again from the Fragment headers
+	off_t offset = 0;
+	auto headerBytes = detail::RawFragmentHeader::num_words() * sizeof(RawDataType);
+	while (offset < st.st_size)
+	{
+		if (!readSpill_({offset, headerBytes}))
+		{
+			break;
+		}
+		auto wordCount = reinterpret_cast<detail::RawFragmentHeader*>(spill_buffer_.begin())->word_count;  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto bytes = wordCount * sizeof(RawDataType);
+		auto padded = (bytes + QV_ALIGN - 1) / QV_ALIGN * QV_ALIGN;
+		if (wordCount < detail::RawFragmentHeader::num_words() || offset + static_cast<off_t>(padded) > st.st_size)
+		{
+			TLOG(TLVL_ERROR) << "recoverSpill_: Spill file " << spill_path_ << " has no valid Fragment at offset " << offset << ", discarding the rest of it";
+			break;
+		}
+		spill_records_.push_back({offset, bytes});
+		spill_depth_bytes_ += bytes;
+		offset += padded;
+	}
+	if (offset < st.st_size && ftruncate(spill_fd_, offset) == -1)
+	{
+		TLOG(TLVL_WARNING) << "recoverSpill_: Could not truncate spill file " << spill_path_ << ", errno=" << errno << " (" << strerror(errno) << ")";
+	}
+	spill_write_offset_ = offset;
+	if (!spill_records_.empty())
+	{
+		TLOG(TLVL_INFO) << "recoverSpill_: Recovered " << spill_records_.size() << " Fragments (" << spill_depth_bytes_ << " bytes) from spill file " << spill_path_;
+	}
+}
+
+void artdaq::SharedMemoryFragmentManager::compactSpill_()
+{
+	// Move the records which were not delivered to the start of the file, so that recoverSpill_ only finds those.
+	// Records only move toward the start, so a record is always read before anything is written over it
+	off_t offset = 0;
+	size_t kept = 0;
+	for (auto& record : spill_records_)
+	{
+		auto padded = (record.bytes + QV_ALIGN - 1) / QV_ALIGN * QV_ALIGN;
+		if (record.offset != offset)
+		{
+			spill_write_offset_ = offset;
+			if (!readSpill_(record) || !writeSpill_(padded))
+			{
+				TLOG(TLVL_ERROR) << "compactSpill_: Could not move Fragment at offset " << record.offset << " of spill file " << spill_path_ << ", " << spill_records_.size() - kept << " Fragments are lost";
+				break;
+			}
+			record.offset = offset;
+		}
+		offset += padded;
+		++kept;
+	}
+	if (ftruncate(spill_fd_, offset) == -1)
+	{
+		TLOG(TLVL_WARNING) << "compactSpill_: Could not truncate spill file " << spill_path_ << ", errno=" << errno << " (" << strerror(errno) << ")";
+	}
+	spill_records_.resize(kept);
+	spill_write_offset_ = offset;
+}
+
+bool artdaq::SharedMemoryFragmentManager::spillFragment_(Fragment const& fragment)
+{
+	auto bytes = fragment.sizeBytes();
+	if (bytes > BufferSize() && (GetSegmentFlags() & ChainedBuffers) == 0)
+	{
+		TLOG(TLVL_ERROR) << "spillFragment_: Fragment with seqID=" << fragment.sequenceID() << " is larger than a buffer, and could never be fed back";
+		return false;
+	}
+
+	// O_DIRECT needs the address, size and file offset of each transfer to be aligned. QuickVec storage is aligned to QV_ALIGN
+	auto padded = (bytes + QV_ALIGN - 1) / QV_ALIGN * QV_ALIGN;
+	spill_buffer_.resize(padded / sizeof(RawDataType));
+	auto data = reinterpret_cast<uint8_t*>(spill_buffer_.begin());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	memcpy(data, &*fragment.headerBegin(), bytes);
+	memset(data + bytes, 0, padded - bytes);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	if (!writeSpill_(padded))
+	{
+		return false;
+	}
+	spill_records_.push_back({spill_write_offset_, bytes});
+	spill_write_offset_ += padded;
+	spill_depth_bytes_ += bytes;
+	++spilled_fragments_;
+	spill_rate_.addSample(bytes);
+	TLOG(TLVL_DEBUG + 44) << "spillFragment_: Spilled Fragment with seqID=" << fragment.sequenceID() << ", " << spill_records_.size() << " Fragments in spill file";
+	return true;
+}
+
+bool artdaq::SharedMemoryFragmentManager::writeSpill_(size_t padded_bytes)
+{
+	auto data = reinterpret_cast<uint8_t const*>(spill_buffer_.begin());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	size_t written = 0;
+	while (written < padded_bytes)
+	{
+		auto sts = pwrite(spill_fd_, data + written, padded_bytes - written, spill_write_offset_ + written);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (sts == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EINVAL && spill_direct_io_)
+			{
+				// The device has a larger logical block size than QV_ALIGN
+				TLOG(TLVL_WARNING) << "writeSpill_: Direct I/O to " << spill_path_ << " was rejected, using buffered I/O";
+				fcntl(spill_fd_, F_SETFL, fcntl(spill_fd_, F_GETFL) & ~O_DIRECT);  // NOLINT(cppcoreguidelines-pro-type-vararg,hicpp-signed-bitwise)
+				spill_direct_io_ = false;
+				continue;
+			}
+			TLOG(TLVL_ERROR) << "writeSpill_: Error writing to spill file " << spill_path_ << ", errno=" << errno << " (" << strerror(errno) << ")";
+			return false;
+		}
+		written += sts;
+	}
+	return true;
+}
+
+bool artdaq::SharedMemoryFragmentManager::readSpill_(SpillRecord const& record)
+{
+	auto padded = (record.bytes + QV_ALIGN - 1) / QV_ALIGN * QV_ALIGN;
+	spill_buffer_.resize(padded / sizeof(RawDataType));
+	auto data = reinterpret_cast<uint8_t*>(spill_buffer_.begin());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	size_t read = 0;
+	while (read < padded)
+	{
+		auto sts = pread(spill_fd_, data + read, padded - read, record.offset + read);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (sts == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (sts <= 0)
+		{
+			TLOG(TLVL_ERROR) << "readSpill_: Error reading from spill file " << spill_path_ << ", errno=" << errno << " (" << strerror(errno) << ")";
+			return false;
+		}
+		read += sts;
+	}
+	return true;
+}
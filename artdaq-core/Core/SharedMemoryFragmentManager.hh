@@ -1,6 +1,13 @@
 #ifndef ARTDAQ_CORE_CORE_SHARED_MEMORY_FRAGMENT_MANAGER_HH
 #define ARTDAQ_CORE_CORE_SHARED_MEMORY_FRAGMENT_MANAGER_HH 1
 
+#include <sys/types.h>
+#include <chrono>
+#include <deque>
+#include <string>
+
+#include "artdaq-core/Core/MonitoredQuantity.hh"
+#include "artdaq-core/Core/QuickVec.hh"
 #include "artdaq-core/Core/SharedMemoryManager.hh"
 #include "artdaq-core/Data/RawEvent.hh"
 
@@ -18,24 +25,44 @@ public:
 	 * \param max_buffer_size The size of each buffer
 	 * \param buffer_timeout_us The maximum amount of time a buffer may be locked
 	 * before being returned to its previous state. This timer is reset upon any operation by the owning SharedMemoryManager.
+	 * \param segment_flags Bitmask of SharedMemoryManager::SegmentFlags (default: none). With ChainedBuffers, Fragments
+	 * larger than max_buffer_size are written across several buffers
 	 */
-	SharedMemoryFragmentManager(uint32_t shm_key, size_t buffer_count = 0, size_t max_buffer_size = 0, size_t buffer_timeout_us = 100 * 1000000);
+	SharedMemoryFragmentManager(uint32_t shm_key, size_t buffer_count = 0, size_t max_buffer_size = 0, size_t buffer_timeout_us = 100 * 1000000, uint32_t segment_flags = 0);
 
 	/**
-	 * \brief SharedMemoryFragmentManager destructor
+	 * \brief SharedMemoryFragmentManager destructor. Closes the spill file, if any (see DisableSpill)
 	 */
-	virtual ~SharedMemoryFragmentManager() = default;
+	virtual ~SharedMemoryFragmentManager();
 	SharedMemoryFragmentManager(SharedMemoryFragmentManager const&) = delete;             ///< Copy Constructor is deleted
 	SharedMemoryFragmentManager(SharedMemoryFragmentManager&&) = delete;                  ///< Move Constructor is deleted
 	SharedMemoryFragmentManager& operator=(SharedMemoryFragmentManager const&) = delete;  ///< Copy Assignment Operator is deleted
 	SharedMemoryFragmentManager& operator=(SharedMemoryFragmentManager&&) = delete;       ///< Move Assignment Operator is deleted
 
+	/**
+	 * \brief Statistics about the spill file
+	 */
+	struct SpillStats
+	{
+		size_t depth_fragments{0};     ///< Fragments currently waiting in the spill file
+		size_t depth_bytes{0};         ///< Bytes of Fragment data currently waiting in the spill file
+		size_t spilled_fragments{0};   ///< Total number of Fragments written to the spill file
+		size_t restored_fragments{0};  ///< Total number of Fragments fed back from the spill file into the Shared Memory
+		double spill_rate{0.0};        ///< Recent rate of data written to the spill file, in bytes/s
+		double restore_rate{0.0};      ///< Recent rate of data fed back into the Shared Memory, in bytes/s
+		bool direct_io{false};         ///< Whether the spill file is accessed with O_DIRECT
+	};
+
 	/**
 	 * \brief Write a Fragment to the Shared Memory
 	 * \param fragment Fragment to write
 	 * \param overwrite Whether to set the overwrite flag
 	 * \param timeout_us Time to wait for shared memory to be free (0: No timeout) (Timeout does not apply if overwrite == false)
 	 * \return 0 on success
+	 *
+	 * If a spill file is enabled (see EnableSpill), spilled Fragments are first fed back into the Shared Memory.
+	 * The Fragment is then written to the spill file instead of the Shared Memory if the segment is above the
+	 * watermark, or if older Fragments are still waiting in the spill file (so that Fragments stay in order).
 	 */
 	int WriteFragment(Fragment&& fragment, bool overwrite, size_t timeout_us);
 
@@ -68,8 +95,79 @@ public:
 	 */
 	bool ReadyForWrite(bool overwrite) override;
 
+	/**
+	 * \brief Enable spilling Fragments to a local file when the Shared Memory fills up
+	 * \param path Path of the spill file. It is created if it does not exist
+	 * \param watermark Fraction of the buffers (greater than 0.0, at most 1.0) which must be in use before Fragments are spilled
+	 * \return Whether the spill file could be opened
+	 *
+	 * Instead of blocking the writer (or overwriting data), Fragments are appended to the spill file, and fed back
+	 * into the Shared Memory in order as buffers become free. The file is opened with O_DIRECT, so that spilling
+	 * does not fill the page cache; records are padded to the QuickVec alignment for that purpose. If the file
+	 * system does not support O_DIRECT, buffered I/O is used instead.
+	 *
+	 * Fragments left in the file by an earlier DisableSpill are fed back first, before any new Fragment.
+	 */
+	bool EnableSpill(std::string const& path, double watermark = 0.9);
+
+	/**
+	 * \brief Feed the spilled Fragments back into the Shared Memory, then close the spill file
+	 * \param drain_timeout_us How long to wait for the readers to free buffers for the spilled Fragments
+	 *
+	 * Draining also stops at end of data. The file is removed if it is empty; otherwise, the Fragments left in it
+	 * are kept, and are fed back when spilling is enabled again with the same file.
+	 */
+	void DisableSpill(size_t drain_timeout_us = 1000000);
+
+	/**
+	 * \brief Feed spilled Fragments back into the Shared Memory, for as long as the segment is below the watermark
+	 * \return The number of Fragments fed back
+	 *
+	 * WriteFragment calls this before each write. Writers should also call it while they have no new data,
+	 * so that the spill file is emptied once the readers catch up. A Fragment which cannot be written to the
+	 * Shared Memory stays in the spill file, and is tried again on the next call.
+	 */
+	size_t DrainSpill();
+
+	/**
+	 * \brief Get statistics about the spill file
+	 * \return SpillStats structure. The rates are updated at most once per second
+	 */
+	SpillStats GetSpillStats();
+
 private:
+	struct SpillRecord
+	{
+		off_t offset;
+		size_t bytes;
+	};
+
+	size_t drainSpill_(bool recheck);
+	bool aboveWatermark_();
+	void recoverSpill_();
+	void compactSpill_();
+	bool spillFragment_(Fragment const& fragment);
+	bool writeSpill_(size_t padded_bytes);
+	bool readSpill_(SpillRecord const& record);
+
 	int active_buffer_;
+
+	int spill_fd_{-1};
+	std::string spill_path_;
+	double spill_watermark_{1.0};
+	size_t spill_headroom_{0};
+	bool spill_above_watermark_{false};
+	std::chrono::steady_clock::time_point spill_watermark_check_;
+	size_t spill_watermark_check_interval_us_{1000};
+	bool spill_direct_io_{false};
+	off_t spill_write_offset_{0};
+	std::deque<SpillRecord> spill_records_;
+	size_t spill_depth_bytes_{0};
+	size_t spilled_fragments_{0};
+	size_t restored_fragments_{0};
+	QuickVec<RawDataType> spill_buffer_;
+	MonitoredQuantity spill_rate_;
+	MonitoredQuantity restore_rate_;
 };
 }  // namespace artdaq
 
@@ -0,0 +1,94 @@
+
+#define TRACE_NAME "SharedMemoryFragmentRouter"
+#include "artdaq-core/Core/SharedMemoryFragmentRouter.hh"
+#include "TRACE/tracemf.h"
+
+artdaq::SharedMemoryFragmentRouter::SharedMemoryFragmentRouter(std::vector<Route> const& routes, size_t buffer_timeout_us)
+    : routes_(routes)
+{
+	segments_.reserve(routes_.size());
+	for (size_t ii = 0; ii < routes_.size(); ++ii)
+	{
+		auto const& route = routes_[ii];
+		segments_.emplace_back(new SharedMemoryFragmentManager(route.shm_key, route.buffer_count, route.max_buffer_size, buffer_timeout_us, route.segment_flags));
+
+		// Candidate routes for each type, in order of precedence, so that only the Fragment ID ranges are checked per Fragment
+		for (size_t type = 0; type < routes_by_type_.size(); ++type)
+		{
+			if (route.types.empty() || route.types.count(static_cast<Fragment::type_t>(type)) != 0)
+			{
+				routes_by_type_[type].push_back(ii);
+			}
+		}
+		TLOG(TLVL_DEBUG) << "Route " << ii << ": key " << std::hex << std::showbase << route.shm_key << std::dec << ", "
+		                 << (route.types.empty() ? std::string("all") : std::to_string(route.types.size())) << " types, Fragment IDs "
+		                 << route.min_fragment_id << " to " << route.max_fragment_id;
+	}
+}
+
+bool artdaq::SharedMemoryFragmentRouter::IsValid() const
+{
+	for (auto const& segment : segments_)
+	{
+		if (!segment->IsValid())
+		{
+			return false;
+		}
+	}
+	return !segments_.empty();
+}
+
+int artdaq::SharedMemoryFragmentRouter::FindRoute(Fragment::type_t type, Fragment::fragment_id_t fragment_id) const
+{
+	for (auto route : routes_by_type_[type])
+	{
+		if (fragment_id >= routes_[route].min_fragment_id && fragment_id <= routes_[route].max_fragment_id)
+		{
+			return static_cast<int>(route);
+		}
+	}
+	return -1;
+}
+
+int artdaq::SharedMemoryFragmentRouter::WriteFragment(Fragment&& fragment, bool overwrite, size_t timeout_us)
+{
+	auto route = FindRoute(fragment.type(), fragment.fragmentID());
+	if (route == -1)
+	{
+		TLOG(TLVL_WARNING) << "WriteFragment: No route for Fragment with type " << static_cast<int>(fragment.type()) << " and Fragment ID " << fragment.fragmentID();
+		return -4;
+	}
+	TLOG(TLVL_DEBUG + 41) << "WriteFragment: Sending Fragment with seqID=" << fragment.sequenceID() << " to route " << route;
+	return segments_[route]->WriteFragment(std::move(fragment), overwrite, timeout_us);
+}
+
+int artdaq::SharedMemoryFragmentRouter::ReadFragment(Fragment& fragment)
+{
+	// Start after the route of the last Fragment, so that a busy route does not starve the others.
+	// ReadyForRead stops at the first Full buffer, instead of counting all of them like ReadReadyCount.
+	for (size_t ii = 0; ii < segments_.size(); ++ii)
+	{
+		auto route = (next_read_route_ + ii) % segments_.size();
+		if (!segments_[route]->ReadyForRead())
+		{
+			continue;
+		}
+		auto sts = segments_[route]->ReadFragment(fragment);
+		if (sts != -1)
+		{
+			next_read_route_ = route + 1;
+			return sts;
+		}
+	}
+	return -1;
+}
+
+size_t artdaq::SharedMemoryFragmentRouter::ReadReadyCount()
+{
+	size_t count = 0;
+	for (auto& segment : segments_)
+	{
+		count += segment->ReadReadyCount();
+	}
+	return count;
+}
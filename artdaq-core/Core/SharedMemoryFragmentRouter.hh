@@ -0,0 +1,120 @@
+#ifndef ARTDAQ_CORE_CORE_SHARED_MEMORY_FRAGMENT_ROUTER_HH
+#define ARTDAQ_CORE_CORE_SHARED_MEMORY_FRAGMENT_ROUTER_HH 1
+
+#include <array>
+#include <limits>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "artdaq-core/Core/SharedMemoryFragmentManager.hh"
+#include "artdaq-core/Data/Fragment.hh"
+
+namespace artdaq {
+/**
+ * \brief The SharedMemoryFragmentRouter sends Fragments to one of several Shared Memory segments, according to their type and Fragment ID
+ *
+ * Each route is a SharedMemoryFragmentManager with its own buffer geometry, so that a stream of large Fragments
+ * (e.g. waveforms) does not hold up a stream of small, latency-sensitive ones (e.g. trigger primitives), and
+ * consumers which only need some types only attach to those segments. A Fragment goes to the first route
+ * which matches its type and Fragment ID.
+ */
+class SharedMemoryFragmentRouter
+{
+public:
+	/**
+	 * \brief Description of a route
+	 */
+	struct Route
+	{
+		uint32_t shm_key{0};                                                                     ///< Key of the route's Shared Memory segment
+		size_t buffer_count{0};                                                                  ///< Number of buffers in the segment (0 to attach to an existing segment)
+		size_t max_buffer_size{0};                                                               ///< Size of each buffer
+		uint32_t segment_flags{0};                                                               ///< Bitmask of SharedMemoryManager::SegmentFlags
+		std::set<Fragment::type_t> types;                                                        ///< Fragment types sent to this route (empty: all types)
+		Fragment::fragment_id_t min_fragment_id{0};                                              ///< Lowest Fragment ID sent to this route
+		Fragment::fragment_id_t max_fragment_id{std::numeric_limits<Fragment::fragment_id_t>::max()};  ///< Highest Fragment ID sent to this route
+	};
+
+	/**
+	 * \brief SharedMemoryFragmentRouter Constructor
+	 * \param routes Routes, in order of precedence. A route without types is a catch-all, and should come last
+	 * \param buffer_timeout_us The maximum amount of time a buffer may be locked, see SharedMemoryManager
+	 */
+	explicit SharedMemoryFragmentRouter(std::vector<Route> const& routes, size_t buffer_timeout_us = 100 * 1000000);
+
+	/**
+	 * \brief SharedMemoryFragmentRouter Destructor
+	 */
+	virtual ~SharedMemoryFragmentRouter() = default;
+	SharedMemoryFragmentRouter(SharedMemoryFragmentRouter const&) = delete;             ///< Copy Constructor is deleted
+	SharedMemoryFragmentRouter(SharedMemoryFragmentRouter&&) = delete;                  ///< Move Constructor is deleted
+	SharedMemoryFragmentRouter& operator=(SharedMemoryFragmentRouter const&) = delete;  ///< Copy Assignment Operator is deleted
+	SharedMemoryFragmentRouter& operator=(SharedMemoryFragmentRouter&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Whether all route segments are attached
+	 * \return True if every route's SharedMemoryFragmentManager is valid
+	 */
+	bool IsValid() const;
+
+	/**
+	 * \brief Get the number of routes
+	 * \return The number of routes
+	 */
+	size_t RouteCount() const { return segments_.size(); }
+
+	/**
+	 * \brief Access the SharedMemoryFragmentManager of a route
+	 * \param route Index of the route
+	 * \return Reference to the route's SharedMemoryFragmentManager
+	 */
+	SharedMemoryFragmentManager& Segment(size_t route) { return *segments_.at(route); }
+
+	/**
+	 * \brief Find the route for a Fragment
+	 * \param type Type of the Fragment
+	 * \param fragment_id Fragment ID of the Fragment
+	 * \return Index of the first matching route, or -1 if no route matches
+	 */
+	int FindRoute(Fragment::type_t type, Fragment::fragment_id_t fragment_id) const;
+
+	/**
+	 * \brief Write a Fragment to the segment of its route
+	 * \param fragment Fragment to write
+	 * \param overwrite Whether to set the overwrite flag
+	 * \param timeout_us Time to wait for shared memory to be free, see SharedMemoryFragmentManager::WriteFragment
+	 * \return 0 on success, -4 if no route matches the Fragment, otherwise the status of SharedMemoryFragmentManager::WriteFragment
+	 */
+	int WriteFragment(Fragment&& fragment, bool overwrite, size_t timeout_us);
+
+	/**
+	 * \brief Read a Fragment from any route, taking the routes in turn
+	 * \param fragment Output Fragment object
+	 * \return 0 on success, -1 if no route has a Fragment ready, otherwise the status of SharedMemoryFragmentManager::ReadFragment
+	 */
+	int ReadFragment(Fragment& fragment);
+
+	/**
+	 * \brief Read a Fragment from the given route
+	 * \param route Index of the route
+	 * \param fragment Output Fragment object
+	 * \return Status of SharedMemoryFragmentManager::ReadFragment (0 on success)
+	 */
+	int ReadFragment(size_t route, Fragment& fragment) { return Segment(route).ReadFragment(fragment); }
+
+	/**
+	 * \brief Count the Fragments ready for reading, in all routes
+	 * \return The number of buffers ready for reading
+	 */
+	size_t ReadReadyCount();
+
+private:
+	std::vector<Route> routes_;
+	std::vector<std::unique_ptr<SharedMemoryFragmentManager>> segments_;
+	std::array<std::vector<size_t>, std::numeric_limits<Fragment::type_t>::max() + 1> routes_by_type_;
+	size_t next_read_route_{0};
+};
+}  // namespace artdaq
+
+#endif  // ARTDAQ_CORE_CORE_SHARED_MEMORY_FRAGMENT_ROUTER_HH
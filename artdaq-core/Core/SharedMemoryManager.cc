@@ -1,8 +1,16 @@
 #define TRACE_NAME "SharedMemoryManager"
+#include <linux/futex.h>
 #include <sys/ipc.h>
+#include <sys/mman.h>
 #include <sys/shm.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
 #include <cstring>
 #include <list>
+#include <thread>
 #include <unordered_map>
 #ifndef SHM_DEST  // Lynn reports that this is missing on Mac OS X?!?
 #define SHM_DEST 01000
@@ -10,6 +18,7 @@
 #include <csignal>
 #include "TRACE/tracemf.h"
 #include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Core/StreamingCopy.hh"
 #include "artdaq-core/Utilities/TraceLock.hh"
 #include "cetlib_except/exception.h"
 
@@ -34,6 +43,49 @@ static std::unordered_map<int, struct sigaction> old_actions = std::unordered_ma
 static bool sighandler_init = false;
 static std::mutex sighandler_mutex;
 
+#define READY_MAGIC 0xCAFE1111
+#define SHM_LAYOUT_VERSION 6
+#define SHM_OWNER_READER 0x1
+#define SHM_OWNER_WRITER 0x2
+#define SHM_PINNED_SLOTS 4
+#define SHM_PIN_RETRIES 100
+#define ORDER_SLOT_BUSY SIZE_MAX
+#define BUFFERS_PER_INIT_THREAD 4096
+#define MAX_INIT_THREADS 8
+
+// The futex word lives in a segment shared between processes, so the non-private futex operations are used
+static void futex_wait(std::atomic<unsigned>* word, unsigned expected, size_t timeout_us)
+{
+	// Split before scaling, as a timeout in nanoseconds overflows a long for large timeout_us
+	struct timespec timeout = {static_cast<time_t>(timeout_us / 1000000), static_cast<long>(timeout_us % 1000000) * 1000};
+	syscall(SYS_futex, reinterpret_cast<unsigned*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+static void futex_wake_all(std::atomic<unsigned>* word)
+{
+	syscall(SYS_futex, reinterpret_cast<unsigned*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+namespace artdaq {
+namespace detail {
+/**
+ * \brief A segment created with SharedMemoryManager::InProcess, in anonymous memory of this process
+ */
+struct InProcessSegment
+{
+	void* memory;               ///< Start of the segment, page-aligned like a SysV segment
+	size_t size;                ///< Size of the mapping, in bytes
+	int attached;               ///< Number of managers attached, guarded by the registry mutex
+	std::atomic<bool> removed;  ///< Set once the owner removed the segment. It is unmapped when the last manager detaches
+};
+}  // namespace detail
+}  // namespace artdaq
+
+// In-process segments by key, searched before the SysV keys. Removed segments leave the table at once
+static std::unordered_map<uint32_t, artdaq::detail::InProcessSegment*> in_process_segments = std::unordered_map<uint32_t, artdaq::detail::InProcessSegment*>();
+static std::mutex in_process_mutex;
+static std::condition_variable in_process_created;  // Notified when a segment is added to the table
+
 static void signal_handler(int signum)
 {
 	// Messagefacility may already be gone at this point, TRACE ONLY!
@@ -68,7 +120,7 @@ static void signal_handler(int signum)
 	sigaction(signum, &old_actions[signum], nullptr);
 }
 
-artdaq::SharedMemoryManager::SharedMemoryManager(uint32_t shm_key, size_t buffer_count, size_t buffer_size, uint64_t buffer_timeout_us, bool destructive_read_mode)
+artdaq::SharedMemoryManager::SharedMemoryManager(uint32_t shm_key, size_t buffer_count, size_t buffer_size, uint64_t buffer_timeout_us, bool destructive_read_mode, uint32_t segment_flags)
     : shm_segment_id_(-1)
     , shm_ptr_(nullptr)
     , shm_key_(shm_key)
@@ -79,6 +131,13 @@ artdaq::SharedMemoryManager::SharedMemoryManager(uint32_t shm_key, size_t buffer
 	requested_shm_parameters_.buffer_size = buffer_size;
 	requested_shm_parameters_.buffer_timeout_us = buffer_timeout_us;
 	requested_shm_parameters_.destructive_read_mode = destructive_read_mode;
+	requested_shm_parameters_.segment_flags = segment_flags;
+
+	// Continuation buffers are only claimed from the Empty buffers, while a RingMode writer takes the oldest buffer whatever its state
+	if ((segment_flags & ChainedBuffers) != 0 && (segment_flags & RingMode) != 0)
+	{
+		throw cet::exception("SharedMemoryManager") << "The ChainedBuffers and RingMode segment flags cannot be combined: chained writes never overwrite buffers";  // NOLINT(cert-err60-cpp)
+	}
 
 	instances.push_back(this);
 	Attach();
@@ -162,8 +221,18 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 
 	size_t timeout_us = timeout_usec > 0 ? timeout_usec : 1000000;
 	auto start_time = std::chrono::steady_clock::now();
+	attach_timing_ = AttachTiming();
+	adopted_segment_ = false;
 	last_seen_id_ = 0;
 	size_t shmSize = requested_shm_parameters_.buffer_count * (requested_shm_parameters_.buffer_size + sizeof(ShmBuffer)) + sizeof(ShmStruct);
+	if ((requested_shm_parameters_.segment_flags & OrderedDelivery) != 0)
+	{
+		shmSize += requested_shm_parameters_.buffer_count * sizeof(OrderSlot);
+	}
+	if ((requested_shm_parameters_.segment_flags & PinnedSlots) != 0)
+	{
+		shmSize += alignof(PinnedSlot) + SHM_PINNED_SLOTS * (sizeof(PinnedSlot) + requested_shm_parameters_.buffer_size);
+	}
 
 	// 19-Feb-2019, KAB: separating out the determination of whether a given process owns the shared
 	// memory (indicated by manager_id_ == 0) and whether or not the shared memory already exists.
@@ -172,44 +241,85 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 		manager_id_ = 0;
 	}
 
-	shm_segment_id_ = shmget(shm_key_, shmSize, 0666);
-	if (shm_segment_id_ == -1)
+	shm_segment_id_ = -1;
+	// The in-process table and the SysV keys are separate namespaces: a manager only looks in the one its flags select,
+	// so that a SysV owner never takes over an in-process segment with the same key, or the other way around
+	if ((requested_shm_parameters_.segment_flags & InProcess) != 0)
 	{
-		if (manager_id_ == 0)
+		attachInProcess_(shmSize, manager_id_ == 0, timeout_us);
+	}
+	else
+	{
+		shm_segment_id_ = shmget(shm_key_, shmSize, 0666);
+		if (shm_segment_id_ == -1)
 		{
-			TLOG(TLVL_ATTACH) << "Creating shared memory segment with key " << std::hex << std::showbase << shm_key_ << " and size " << std::dec << shmSize;
-			shm_segment_id_ = shmget(shm_key_, shmSize, IPC_CREAT | 0666);
-
-			if (shm_segment_id_ == -1)
+			if (manager_id_ == 0)
 			{
-				TLOG(TLVL_ERROR) << "Error creating shared memory segment with key " << std::hex << std::showbase << shm_key_ << ", errno=" << std::dec << errno << " (" << strerror(errno) << ")";
+				TLOG(TLVL_ATTACH) << "Creating shared memory segment with key " << std::hex << std::showbase << shm_key_ << " and size " << std::dec << shmSize;
+				shm_segment_id_ = shmget(shm_key_, shmSize, IPC_CREAT | 0666);
+
+				if (shm_segment_id_ == -1)
+				{
+					TLOG(TLVL_ERROR) << "Error creating shared memory segment with key " << std::hex << std::showbase << shm_key_ << ", errno=" << std::dec << errno << " (" << strerror(errno) << ")";
+				}
 			}
-		}
-		else
-		{
-			while (shm_segment_id_ == -1 && TimeUtils::GetElapsedTimeMicroseconds(start_time) < timeout_us)
+			else
 			{
-				shm_segment_id_ = shmget(shm_key_, shmSize, 0666);
+				while (shm_segment_id_ == -1 && TimeUtils::GetElapsedTimeMicroseconds(start_time) < timeout_us)
+				{
+					shm_segment_id_ = shmget(shm_key_, shmSize, 0666);
+				}
 			}
 		}
 	}
-	TLOG(TLVL_ATTACH) << "shm_key == " << std::hex << std::showbase << shm_key_ << ", shm_segment_id == " << std::dec << shm_segment_id_;
+	TLOG(TLVL_ATTACH) << "shm_key == " << std::hex << std::showbase << shm_key_ << ", shm_segment_id == " << std::dec << shm_segment_id_ << (IsInProcess() ? " (in-process segment)" : "");
+	attach_timing_.segment_s = TimeUtils::GetElapsedTime(start_time);
 
-	if (shm_segment_id_ > -1)
+	if (shm_segment_id_ > -1 || IsInProcess())
 	{
 		TLOG(TLVL_ATTACH)
 		    << "Attached to shared memory segment with ID = " << shm_segment_id_
 		    << " and size " << shmSize
 		    << " bytes";
-		shm_ptr_ = static_cast<ShmStruct*>(shmat(shm_segment_id_, nullptr, 0));
+		auto phase_start = std::chrono::steady_clock::now();
+		shm_ptr_ = static_cast<ShmStruct*>(IsInProcess() ? in_process_segment_->memory : shmat(shm_segment_id_, nullptr, 0));
+		attach_timing_.map_s = TimeUtils::GetElapsedTime(phase_start);
 		TLOG(TLVL_ATTACH)
 		    << "Attached to shared memory segment at address "
 		    << std::hex << std::showbase << static_cast<void*>(shm_ptr_) << std::dec;
 		if ((shm_ptr_ != nullptr) && shm_ptr_ != reinterpret_cast<void*>(-1))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 		{
-			if (manager_id_ == 0)
+			if (manager_id_ == 0 && shm_ptr_->ready_magic == READY_MAGIC && (requested_shm_parameters_.segment_flags & PersistentSegment) != 0 && layoutMatches_(true))
+			{
+				TLOG(TLVL_ATTACH) << "Owner found persistent Shared Memory with a matching layout, taking it over";
+				if (!acquireOwnership_(timeout_us))
+				{
+					TLOG(TLVL_ERROR) << "Shared memory segment with key " << std::hex << std::showbase << shm_key_ << " is still owned by process "
+					                 << std::dec << shm_ptr_->owner_pid << ", giving up";
+					abandonAttach_();
+					return false;
+				}
+				adopted_segment_ = true;
+				shm_ptr_->buffer_timeout_us = requested_shm_parameters_.buffer_timeout_us;
+
+				mapDescriptors_();
+
+				phase_start = std::chrono::steady_clock::now();
+				adoptBuffers_();
+				attach_timing_.init_s = TimeUtils::GetElapsedTime(phase_start);
+			}
+			else if (manager_id_ == 0)
 			{
-				if (shm_ptr_->ready_magic == 0xCAFE1111)
+				// Reinitializing a persistent segment would pull the buffers out from under the managers still using it
+				auto attached = GetAttachedCount();
+				if (shm_ptr_->ready_magic == READY_MAGIC && (requested_shm_parameters_.segment_flags & PersistentSegment) != 0 && attached > 1)
+				{
+					TLOG(TLVL_ERROR) << "Persistent shared memory segment with key " << std::hex << std::showbase << shm_key_ << " cannot be reinitialized while "
+					                 << std::dec << attached - 1 << " other managers are attached, giving up";
+					abandonAttach_();
+					return false;
+				}
+				if (shm_ptr_->ready_magic == READY_MAGIC && !IsInProcess())
 				{
 					TLOG(TLVL_WARNING) << "Owner encountered already-initialized Shared Memory! "
 					                   << "Once the system is shut down, you can use one of the following commands "
@@ -218,6 +328,7 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 					// exit(-2);
 				}
 				TLOG(TLVL_ATTACH) << "Owner initializing Shared Memory";
+				shm_ptr_->ready_magic = 0;
 				shm_ptr_->next_id = 1;
 				shm_ptr_->next_sequence_id = 0;
 				shm_ptr_->reader_pos = 0;
@@ -226,49 +337,82 @@ bool artdaq::SharedMemoryManager::Attach(size_t timeout_usec)
 				shm_ptr_->buffer_count = requested_shm_parameters_.buffer_count;
 				shm_ptr_->buffer_timeout_us = requested_shm_parameters_.buffer_timeout_us;
 				shm_ptr_->destructive_read_mode = requested_shm_parameters_.destructive_read_mode;
-
-				buffer_ptrs_ = std::vector<ShmBuffer*>(shm_ptr_->buffer_count);
-				for (int ii = 0; ii < static_cast<int>(requested_shm_parameters_.buffer_count); ++ii)
+				shm_ptr_->numa_policy = static_cast<int>(NumaUtils::Policy::Default);
+				shm_ptr_->numa_nodemask = 0;
+				shm_ptr_->end_of_data_epoch = 0;
+				shm_ptr_->buffer_epoch = 0;
+				shm_ptr_->epoch_waiters = 0;
+				shm_ptr_->layout_version = SHM_LAYOUT_VERSION;
+				shm_ptr_->header_size = sizeof(ShmStruct);
+				shm_ptr_->descriptor_size = sizeof(ShmBuffer);
+				shm_ptr_->segment_flags = requested_shm_parameters_.segment_flags;
+				shm_ptr_->owner_pid = getpid();
+				shm_ptr_->owner_registrations = 0;
+
+				mapDescriptors_();
+
+				phase_start = std::chrono::steady_clock::now();
+				initBufferDescriptors_();
+				for (size_t ii = 0; ii < GetPinnedSlotCount(); ++ii)
 				{
-					buffer_ptrs_[ii] = reinterpret_cast<ShmBuffer*>(reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + ii * sizeof(ShmBuffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
-					if (getBufferInfo_(ii) == nullptr)
-					{
-						return false;
-					}
-					getBufferInfo_(ii)->writePos = 0;
-					getBufferInfo_(ii)->readPos = 0;
-					getBufferInfo_(ii)->sem = BufferSemaphoreFlags::Empty;
-					getBufferInfo_(ii)->sem_id = -1;
-					getBufferInfo_(ii)->last_touch_time = TimeUtils::gettimeofday_us();
+					pinned_slots_[ii].generation = 0;   // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+					pinned_slots_[ii].tag = 0;          // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+					pinned_slots_[ii].sequence_id = 0;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+					pinned_slots_[ii].size = 0;         // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 				}
+				attach_timing_.init_s = TimeUtils::GetElapsedTime(phase_start);
 
-				shm_ptr_->ready_magic = 0xCAFE1111;
+				shm_ptr_->ready_magic.store(READY_MAGIC, std::memory_order_release);
+				futex_wake_all(&shm_ptr_->ready_magic);
 			}
 			else
 			{
 				TLOG(TLVL_ATTACH) << "Waiting for owner to initalize Shared Memory";
-				while (shm_ptr_->ready_magic != 0xCAFE1111) { usleep(1000); }
+				phase_start = std::chrono::steady_clock::now();
+				unsigned magic;
+				while ((magic = shm_ptr_->ready_magic.load(std::memory_order_acquire)) != READY_MAGIC)
+				{
+					auto elapsed = TimeUtils::GetElapsedTimeMicroseconds(start_time);
+					if (elapsed >= timeout_us)
+					{
+						TLOG(TLVL_ERROR) << "Shared memory segment with key " << std::hex << std::showbase << shm_key_
+						                 << " was not initialized by its owner within " << std::dec << timeout_us << " us, giving up";
+						abandonAttach_();
+						return false;
+					}
+					// Time out periodically and re-check, in case the owner does not wake us (e.g. it was built without futex support)
+					futex_wait(&shm_ptr_->ready_magic, magic, std::min(timeout_us - elapsed, static_cast<size_t>(100000)));
+				}
+				attach_timing_.wait_s = TimeUtils::GetElapsedTime(phase_start);
+				// A segment created by a different build of this class cannot be read through this one's descriptors
+				if (!layoutMatches_(false))
+				{
+					TLOG(TLVL_ERROR) << "Shared memory segment with key " << std::hex << std::showbase << shm_key_ << " has an incompatible layout, giving up";
+					abandonAttach_();
+					return false;
+				}
 				TLOG(TLVL_ATTACH) << "Getting ID from Shared Memory";
 				GetNewId();
 				shm_ptr_->lowest_seq_id_read = 0;
 				TLOG(TLVL_ATTACH) << "Getting Shared Memory Size parameters";
 
 				requested_shm_parameters_.buffer_count = shm_ptr_->buffer_count;
-				buffer_ptrs_ = std::vector<ShmBuffer*>(shm_ptr_->buffer_count);
-				for (int ii = 0; ii < shm_ptr_->buffer_count; ++ii)
-				{
-					buffer_ptrs_[ii] = reinterpret_cast<ShmBuffer*>(reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + ii * sizeof(ShmBuffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
-				}
+				mapDescriptors_();
 			}
 
 			// last_seen_id_ = shm_ptr_->next_sequence_id;
 			buffer_mutexes_ = std::vector<std::mutex>(shm_ptr_->buffer_count);
 
+			attach_timing_.total_s = TimeUtils::GetElapsedTime(start_time);
+			attach_timing_.setup_s = attach_timing_.total_s - attach_timing_.segment_s - attach_timing_.map_s - attach_timing_.init_s - attach_timing_.wait_s;
 			TLOG(TLVL_ATTACH) << "Initialization Complete: "
 			                  << "key: " << std::hex << std::showbase << shm_key_
 			                  << ", manager ID: " << std::dec << manager_id_
 			                  << ", Buffer size: " << shm_ptr_->buffer_size
 			                  << ", Buffer count: " << shm_ptr_->buffer_count;
+			TLOG(TLVL_ATTACH) << "Attach took " << attach_timing_.total_s << " s: segment " << attach_timing_.segment_s
+			                  << " s, map " << attach_timing_.map_s << " s, init " << attach_timing_.init_s << " s (" << attach_timing_.init_threads
+			                  << " threads), wait " << attach_timing_.wait_s << " s, setup " << attach_timing_.setup_s << " s";
 			return true;
 		}
 
@@ -292,6 +436,10 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 	if (!registered_reader_)
 	{
 		shm_ptr_->reader_count++;
+		if (manager_id_ == 0)
+		{
+			shm_ptr_->owner_registrations |= SHM_OWNER_READER;
+		}
 		registered_reader_ = true;
 	}
 
@@ -299,11 +447,20 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 	// TraceLock lk(search_mutex_, 11, "GetBufferForReadingSearch");
 	auto rp = shm_ptr_->reader_pos.load();
 
+	if (order_slots_ != nullptr && (!shm_ptr_->destructive_read_mode || shm_ptr_->reader_count <= 1))
+	{
+		auto buffer = nextInOrder_();
+		if (buffer != -1)
+		{
+			return buffer;
+		}
+	}
+
 	TLOG(TLVL_GETBUFFER) << "GetBufferForReading lock acquired, scanning " << shm_ptr_->buffer_count << " buffers";
 
 	for (int retry = 0; retry < 5; retry++)
 	{
-		BufferSemaphoreFlags sem;
+		BufferSemaphoreFlags sem = BufferSemaphoreFlags::Empty;
 		int16_t sem_id = -2;
 		int buffer_num = -1;
 		ShmBuffer* buffer_ptr = nullptr;
@@ -327,7 +484,7 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 
 			TLOG(TLVL_GETBUFFER + 1) << "GetBufferForReading: Buffer " << buffer << ": sem=" << FlagToString(sem)
 			                         << " (expected " << FlagToString(BufferSemaphoreFlags::Full) << "), sem_id=" << sem_id << ", seq_id=" << buf->sequence_id << " )";
-			if (sem == BufferSemaphoreFlags::Full && (sem_id == -1 || sem_id == manager_id_) && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
+			if (sem == BufferSemaphoreFlags::Full && (sem_id == -1 || sem_id == manager_id_) && buf->chain_head == -1 && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
 			{
 				if (buf->sequence_id < seqID)
 				{
@@ -371,37 +528,10 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 		if (buffer_num >= 0)
 		{
 			TLOG(TLVL_GETBUFFER) << "GetBufferForReading Found buffer " << buffer_num;
-			touchBuffer_(buffer_ptr);
-			if (!buffer_ptr->sem_id.compare_exchange_strong(sem_id, manager_id_))
-			{
-				continue;
-			}
-			if (!buffer_ptr->sem.compare_exchange_strong(sem, BufferSemaphoreFlags::Reading))
-			{
-				continue;
-			}
-			if (!checkBuffer_(buffer_ptr, BufferSemaphoreFlags::Reading, false))
+			if (!claimForReading_(buffer_num, buffer_ptr, sem, sem_id, seqID))
 			{
-				TLOG(TLVL_GETBUFFER) << "GetBufferForReading: Failed to acquire buffer " << buffer_num << " (someone else changed manager ID while I was changing sem)";
 				continue;
 			}
-			buffer_ptr->readPos = 0;
-			touchBuffer_(buffer_ptr);
-			if (!checkBuffer_(buffer_ptr, BufferSemaphoreFlags::Reading, false))
-			{
-				TLOG(TLVL_GETBUFFER) << "GetBufferForReading: Failed to acquire buffer " << buffer_num << " (someone else changed manager ID while I was touching buffer SHOULD NOT HAPPEN!)";
-				continue;
-			}
-			if (shm_ptr_->destructive_read_mode && shm_ptr_->lowest_seq_id_read == last_seen_id_)
-			{
-				shm_ptr_->lowest_seq_id_read = seqID;
-			}
-			last_seen_id_ = seqID;
-			if (shm_ptr_->destructive_read_mode)
-			{
-				shm_ptr_->reader_pos = (buffer_num + 1) % shm_ptr_->buffer_count;
-			}
-
 			TLOG(TLVL_GETBUFFER) << "GetBufferForReading returning " << buffer_num;
 			return buffer_num;
 		}
@@ -412,6 +542,78 @@ int artdaq::SharedMemoryManager::GetBufferForReading()
 	return -1;
 }
 
+bool artdaq::SharedMemoryManager::claimForReading_(int buffer_num, ShmBuffer* buffer_ptr, BufferSemaphoreFlags sem, int16_t sem_id, uint64_t seqID)
+{
+	touchBuffer_(buffer_ptr);
+	if (!buffer_ptr->sem_id.compare_exchange_strong(sem_id, manager_id_))
+	{
+		return false;
+	}
+	if (!buffer_ptr->sem.compare_exchange_strong(sem, BufferSemaphoreFlags::Reading))
+	{
+		return false;
+	}
+	if (!checkBuffer_(buffer_ptr, BufferSemaphoreFlags::Reading, false))
+	{
+		TLOG(TLVL_GETBUFFER) << "GetBufferForReading: Failed to acquire buffer " << buffer_num << " (someone else changed manager ID while I was changing sem)";
+		return false;
+	}
+	buffer_ptr->readPos = 0;
+	touchBuffer_(buffer_ptr);
+	if (!checkBuffer_(buffer_ptr, BufferSemaphoreFlags::Reading, false))
+	{
+		TLOG(TLVL_GETBUFFER) << "GetBufferForReading: Failed to acquire buffer " << buffer_num << " (someone else changed manager ID while I was touching buffer SHOULD NOT HAPPEN!)";
+		return false;
+	}
+	setChainState_(buffer_ptr, BufferSemaphoreFlags::Reading, manager_id_);
+	if (shm_ptr_->destructive_read_mode && shm_ptr_->lowest_seq_id_read == last_seen_id_)
+	{
+		shm_ptr_->lowest_seq_id_read = seqID;
+	}
+	last_seen_id_ = seqID;
+	if (shm_ptr_->destructive_read_mode)
+	{
+		shm_ptr_->reader_pos = (buffer_num + 1) % shm_ptr_->buffer_count;
+	}
+	return true;
+}
+
+int artdaq::SharedMemoryManager::nextInOrder_()
+{
+	// Follow the sequence IDs from the last one this reader saw, stepping over skipped ones. Anything
+	// else (the next event is not written yet, or has left the window) is left to the full scan.
+	auto wanted = last_seen_id_ + 1;
+	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii, ++wanted)
+	{
+		int buffer = -1;
+		auto state = GetSequenceState(wanted, &buffer);
+		if (state == SequenceState::Skipped)
+		{
+			continue;
+		}
+		if (state != SequenceState::Ready)
+		{
+			return -1;
+		}
+
+		ResetBuffer(buffer);
+		auto buf = buffer_ptrs_[buffer];
+		auto sem = buf->sem.load();
+		auto sem_id = buf->sem_id.load();
+		if (sem != BufferSemaphoreFlags::Full || (sem_id != -1 && sem_id != manager_id_) || buf->sequence_id != wanted)
+		{
+			return -1;
+		}
+		if (!claimForReading_(buffer, buf, sem, sem_id, wanted))
+		{
+			return -1;
+		}
+		TLOG(TLVL_GETBUFFER) << "GetBufferForReading returning buffer " << buffer << " for sequence ID " << wanted << " from the ordering slots";
+		return buffer;
+	}
+	return -1;
+}
+
 int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 {
 	TLOG(TLVL_GETBUFFER + 1) << "GetBufferForWriting BEGIN, overwrite=" << (overwrite ? "true" : "false");
@@ -419,11 +621,19 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 	if (!registered_writer_)
 	{
 		shm_ptr_->writer_count++;
+		if (manager_id_ == 0)
+		{
+			shm_ptr_->owner_registrations |= SHM_OWNER_WRITER;
+		}
 		registered_writer_ = true;
 	}
 
 	std::lock_guard<std::mutex> lk(search_mutex_);
 	// TraceLock lk(search_mutex_, 12, "GetBufferForWritingSearch");
+	if ((shm_ptr_->segment_flags & RingMode) != 0)
+	{
+		return getRingBufferForWriting_();
+	}
 	auto wp = shm_ptr_->writer_pos.load();
 
 	TLOG(TLVL_GETBUFFER) << "GetBufferForWriting lock acquired, scanning " << shm_ptr_->buffer_count << " buffers";
@@ -459,11 +669,13 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 			{
 				continue;
 			}
+			auto generation = openGeneration_(buf);
 			shm_ptr_->writer_pos = (buffer + 1) % shm_ptr_->buffer_count;
 			buf->sequence_id = ++shm_ptr_->next_sequence_id;
 			buf->writePos = 0;
 			if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 			{
+				closeGeneration_(buf, generation);
 				continue;
 			}
 			touchBuffer_(buf);
@@ -490,8 +702,9 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 			auto sem = buf->sem.load();
 			auto sem_id = buf->sem_id.load();
 
-			if (sem == BufferSemaphoreFlags::Full)
+			if (sem == BufferSemaphoreFlags::Full && buf->chain_head == -1)
 			{
+				auto unread_id = buf->sequence_id.load();
 				touchBuffer_(buf);
 				if (!buf->sem_id.compare_exchange_strong(sem_id, manager_id_))
 				{
@@ -505,11 +718,15 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 				{
 					continue;
 				}
+				releaseChain_(buf);
+				recordSequence_(unread_id, -1);
+				auto generation = openGeneration_(buf);
 				shm_ptr_->writer_pos = (buffer + 1) % shm_ptr_->buffer_count;
 				buf->sequence_id = ++shm_ptr_->next_sequence_id;
 				buf->writePos = 0;
 				if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 				{
+					closeGeneration_(buf, generation);
 					continue;
 				}
 				touchBuffer_(buf);
@@ -534,7 +751,7 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 			auto sem = buf->sem.load();
 			auto sem_id = buf->sem_id.load();
 
-			if (sem == BufferSemaphoreFlags::Reading)
+			if (sem == BufferSemaphoreFlags::Reading && buf->chain_head == -1)
 			{
 				touchBuffer_(buf);
 				if (!buf->sem_id.compare_exchange_strong(sem_id, manager_id_))
@@ -549,11 +766,14 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 				{
 					continue;
 				}
+				releaseChain_(buf);
+				auto generation = openGeneration_(buf);
 				shm_ptr_->writer_pos = (buffer + 1) % shm_ptr_->buffer_count;
 				buf->sequence_id = ++shm_ptr_->next_sequence_id;
 				buf->writePos = 0;
 				if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
 				{
+					closeGeneration_(buf, generation);
 					continue;
 				}
 				touchBuffer_(buf);
@@ -566,6 +786,266 @@ int artdaq::SharedMemoryManager::GetBufferForWriting(bool overwrite)
 	return -1;
 }
 
+int artdaq::SharedMemoryManager::getRingBufferForWriting_()
+{
+	// The buffer at the writer position is the oldest one. It is only passed over while a reader or another writer holds it
+	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+	{
+		auto buffer = static_cast<int>((shm_ptr_->writer_pos + ii) % shm_ptr_->buffer_count);
+		auto buf = buffer_ptrs_[buffer];
+		auto sem = buf->sem.load();
+		auto sem_id = buf->sem_id.load();
+		if ((sem != BufferSemaphoreFlags::Empty && sem != BufferSemaphoreFlags::Full) || buf->chain_head != -1)
+		{
+			ResetBuffer(buffer);
+			continue;
+		}
+
+		auto unread_id = sem == BufferSemaphoreFlags::Full ? buf->sequence_id.load() : 0;
+		touchBuffer_(buf);
+		if (!buf->sem_id.compare_exchange_strong(sem_id, manager_id_) || !buf->sem.compare_exchange_strong(sem, BufferSemaphoreFlags::Writing))
+		{
+			continue;
+		}
+		auto generation = openGeneration_(buf);
+		releaseChain_(buf);
+		recordSequence_(unread_id, -1);
+		shm_ptr_->writer_pos = (buffer + 1) % shm_ptr_->buffer_count;
+		buf->sequence_id = ++shm_ptr_->next_sequence_id;
+		buf->writePos = 0;
+		if (!checkBuffer_(buf, BufferSemaphoreFlags::Writing, false))
+		{
+			closeGeneration_(buf, generation);
+			continue;
+		}
+		TLOG(TLVL_GETBUFFER + 1) << "GetBufferForWriting returning buffer " << buffer << " (ring mode" << (unread_id != 0 ? ", overwriting unread event" : "") << ")";
+		return buffer;
+	}
+	TLOG(TLVL_GETBUFFER + 1) << "GetBufferForWriting Returning -1 because all buffers are in use (ring mode)";
+	return -1;
+}
+
+bool artdaq::SharedMemoryManager::WaitForBufferChange(unsigned epoch, size_t timeout_us)
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+	if (shm_ptr_->buffer_epoch.load() != epoch)
+	{
+		return true;
+	}
+	// Registering first means that either the futex sees the new epoch, or notifyBufferChange_ sees the waiter
+	shm_ptr_->epoch_waiters++;
+	futex_wait(&shm_ptr_->buffer_epoch, epoch, timeout_us);
+	shm_ptr_->epoch_waiters--;
+	return shm_ptr_->buffer_epoch.load() != epoch;
+}
+
+void artdaq::SharedMemoryManager::notifyBufferChange_()
+{
+	shm_ptr_->buffer_epoch++;
+	if (shm_ptr_->epoch_waiters.load() > 0)
+	{
+		futex_wake_all(&shm_ptr_->buffer_epoch);
+	}
+}
+
+uint32_t artdaq::SharedMemoryManager::openGeneration_(ShmBuffer* buf)
+{
+	// Seqlock writer side: the generation is odd while the buffer's data changes
+	auto generation = buf->generation.fetch_add(1, std::memory_order_relaxed) + 1;
+	std::atomic_thread_fence(std::memory_order_release);
+	return generation;
+}
+
+void artdaq::SharedMemoryManager::closeGeneration_(ShmBuffer* buf)
+{
+	auto generation = buf->generation.load(std::memory_order_relaxed);
+	if ((generation & 1) != 0)
+	{
+		buf->generation.store(generation + 1, std::memory_order_release);
+	}
+}
+
+void artdaq::SharedMemoryManager::closeGeneration_(ShmBuffer* buf, uint32_t opened)
+{
+	// Only close the generation this manager opened: the buffer may have been released and taken by another writer since
+	buf->generation.compare_exchange_strong(opened, opened + 1, std::memory_order_release, std::memory_order_relaxed);
+}
+
+int artdaq::SharedMemoryManager::GetNewestBuffer()
+{
+	if (!IsValid())
+	{
+		return -1;
+	}
+	auto wp = shm_ptr_->writer_pos.load();
+	for (auto ii = 1; ii <= shm_ptr_->buffer_count; ++ii)
+	{
+		auto buffer = static_cast<int>((wp + shm_ptr_->buffer_count - ii) % shm_ptr_->buffer_count);
+		auto sem = buffer_ptrs_[buffer]->sem.load();
+		if ((sem == BufferSemaphoreFlags::Full || sem == BufferSemaphoreFlags::Reading) && buffer_ptrs_[buffer]->chain_head == -1)
+		{
+			return buffer;
+		}
+	}
+	return -1;
+}
+
+size_t artdaq::SharedMemoryManager::CopyBufferSnapshot(int buffer, void* data, size_t& sequence_id)
+{
+	if (!IsValid() || buffer < 0 || buffer >= shm_ptr_->buffer_count)
+	{
+		return 0;
+	}
+	auto buf = buffer_ptrs_[buffer];
+
+	// Seqlock reader side: the copy is only good if the generation was even and did not change while copying
+	auto generation = buf->generation.load(std::memory_order_acquire);
+	auto sem = buf->sem.load();
+	if ((generation & 1) != 0 || (sem != BufferSemaphoreFlags::Full && sem != BufferSemaphoreFlags::Reading) || buf->chain_next != -1 || buf->chain_head != -1)
+	{
+		return 0;
+	}
+	auto size = std::min(static_cast<size_t>(buf->writePos), shm_ptr_->buffer_size);
+	auto seq = buf->sequence_id.load();
+	memcpy(data, bufferStart_(buffer), size);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (buf->generation.load(std::memory_order_relaxed) != generation)
+	{
+		TLOG(TLVL_READ) << "CopyBufferSnapshot: Buffer " << buffer << " was overwritten during the copy";
+		return 0;
+	}
+	sequence_id = seq;
+	return size;
+}
+
+bool artdaq::SharedMemoryManager::PinBuffer(int buffer, uint32_t tag)
+{
+	if (!IsValid() || pinned_slots_ == nullptr || tag == 0 || buffer < 0 || buffer >= shm_ptr_->buffer_count)
+	{
+		return false;
+	}
+	auto buf = buffer_ptrs_[buffer];
+	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	auto sem = buf->sem.load();
+	if ((sem != BufferSemaphoreFlags::Full && (sem != BufferSemaphoreFlags::Writing || buf->sem_id != manager_id_)) || buf->chain_next != -1 || buf->chain_head != -1)
+	{
+		TLOG(TLVL_WARNING) << "PinBuffer: Buffer " << buffer << " is not a complete event held by this writer (state " << FlagToString(sem) << "), not pinning it";
+		return false;
+	}
+
+	// A Full buffer is not claimed, so a writer in RingMode may overwrite it meanwhile. It is copied aside first,
+	// and only kept if its generation was even and did not change (see CopyBufferSnapshot)
+	std::vector<uint8_t> snapshot;
+	size_t size = std::min(static_cast<size_t>(buf->writePos), shm_ptr_->buffer_size);
+	size_t sequence_id = buf->sequence_id.load();
+	if (sem == BufferSemaphoreFlags::Full)
+	{
+		snapshot.resize(shm_ptr_->buffer_size);
+		size = CopyBufferSnapshot(buffer, snapshot.data(), sequence_id);
+		if (size == 0)
+		{
+			TLOG(TLVL_WARNING) << "PinBuffer: Buffer " << buffer << " was overwritten while copying it, not pinning it";
+			return false;
+		}
+	}
+
+	// Use the slot already holding this tag, or claim an unused one
+	auto slots = GetPinnedSlotCount();
+	size_t index = slots;
+	for (size_t ii = 0; ii < slots && index == slots; ++ii)
+	{
+		if (pinned_slots_[ii].tag == tag) index = ii;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	for (size_t ii = 0; ii < slots && index == slots; ++ii)
+	{
+		uint32_t unused = 0;
+		if (pinned_slots_[ii].tag.compare_exchange_strong(unused, tag)) index = ii;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	if (index == slots)
+	{
+		TLOG(TLVL_WARNING) << "PinBuffer: All " << slots << " pinned slots are in use, cannot pin an event with tag " << tag;
+		return false;
+	}
+	auto& slot = pinned_slots_[index];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	// Make the generation odd while rewriting, so that readers copying the slot retry
+	auto generation = slot.generation.load();
+	while ((generation & 1) != 0 || !slot.generation.compare_exchange_weak(generation, generation + 1))
+	{
+		std::this_thread::yield();
+		generation = slot.generation.load();
+	}
+	StreamingCopy::Copy(pinnedData_(index), snapshot.empty() ? bufferStart_(buffer) : snapshot.data(), size);
+	slot.size = size;
+	slot.sequence_id = sequence_id;
+	slot.generation.store(generation + 2, std::memory_order_release);
+	TLOG(TLVL_BUFINFO) << "PinBuffer: Pinned event " << slot.sequence_id << " (" << size << " bytes) from buffer " << buffer << " in slot " << index << " with tag " << tag;
+	return true;
+}
+
+size_t artdaq::SharedMemoryManager::GetPinnedSlotCount() const
+{
+	return IsValid() && (shm_ptr_->segment_flags & PinnedSlots) != 0 ? SHM_PINNED_SLOTS : 0;
+}
+
+size_t artdaq::SharedMemoryManager::CopyPinnedSlot(size_t slot, void* data, uint32_t& tag, size_t& sequence_id)
+{
+	if (slot >= GetPinnedSlotCount())
+	{
+		return 0;
+	}
+	auto& pinned = pinned_slots_[slot];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	for (int tries = 0; tries < SHM_PIN_RETRIES; ++tries)
+	{
+		auto generation = pinned.generation.load(std::memory_order_acquire);
+		if ((generation & 1) != 0)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		auto slot_tag = pinned.tag.load();
+		auto size = std::min(pinned.size.load(), shm_ptr_->buffer_size);
+		auto seq = pinned.sequence_id.load();
+		if (slot_tag == 0 || size == 0)
+		{
+			return 0;
+		}
+		memcpy(data, pinnedData_(slot), size);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (pinned.generation.load(std::memory_order_relaxed) == generation)
+		{
+			tag = slot_tag;
+			sequence_id = seq;
+			return size;
+		}
+	}
+	TLOG(TLVL_WARNING) << "CopyPinnedSlot: Slot " << slot << " kept changing during " << SHM_PIN_RETRIES << " attempts to copy it";
+	return 0;
+}
+
+artdaq::SharedMemoryManager::BufferToken artdaq::SharedMemoryManager::GetBufferTokenForReading()
+{
+	auto buffer = GetBufferForReading();
+	if (buffer == -1)
+	{
+		return BufferToken();
+	}
+	return BufferToken(buffer, buffer_ptrs_[buffer]->sequence_id, BufferSemaphoreFlags::Reading);
+}
+
+artdaq::SharedMemoryManager::BufferToken artdaq::SharedMemoryManager::GetBufferTokenForWriting(bool overwrite)
+{
+	auto buffer = GetBufferForWriting(overwrite);
+	if (buffer == -1)
+	{
+		return BufferToken();
+	}
+	return BufferToken(buffer, buffer_ptrs_[buffer]->sequence_id, BufferSemaphoreFlags::Writing);
+}
+
 size_t artdaq::SharedMemoryManager::ReadReadyCount()
 {
 	if (!IsValid())
@@ -592,7 +1072,7 @@ size_t artdaq::SharedMemoryManager::ReadReadyCount()
 #ifndef __OPTIMIZE__
 		TLOG(TLVL_READREADY + 2) << std::hex << std::showbase << shm_key_ << std::dec << " ReadReadyCount: Buffer " << ii << ": sem=" << FlagToString(buf->sem) << " (expected " << FlagToString(BufferSemaphoreFlags::Full) << "), sem_id=" << buf->sem_id << " )";
 #endif
-		if (buf->sem == BufferSemaphoreFlags::Full && (buf->sem_id == -1 || buf->sem_id == manager_id_) && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
+		if (buf->sem == BufferSemaphoreFlags::Full && (buf->sem_id == -1 || buf->sem_id == manager_id_) && buf->chain_head == -1 && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
 		{
 #ifndef __OPTIMIZE__
 			TLOG(TLVL_READREADY + 3) << std::hex << std::showbase << shm_key_ << std::dec << " ReadReadyCount: Buffer " << ii << " is either unowned or owned by this manager, and is marked full.";
@@ -627,7 +1107,7 @@ size_t artdaq::SharedMemoryManager::WriteReadyCount(bool overwrite)
 		{
 			continue;
 		}
-		if ((buf->sem == BufferSemaphoreFlags::Empty && buf->sem_id == -1) || (overwrite && buf->sem != BufferSemaphoreFlags::Writing))
+		if ((buf->sem == BufferSemaphoreFlags::Empty && buf->sem_id == -1) || (overwrite && buf->sem != BufferSemaphoreFlags::Writing && buf->chain_head == -1))
 		{
 #ifndef __OPTIMIZE__
 			TLOG(TLVL_WRITEREADY + 1) << std::hex << std::showbase << shm_key_ << std::dec << " WriteReadyCount: Buffer " << ii << " is either empty or is available for overwrite.";
@@ -671,7 +1151,7 @@ bool artdaq::SharedMemoryManager::ReadyForRead()
 		                         << " seq_id=" << buf->sequence_id << " >? " << last_seen_id_;
 #endif
 
-		if (buf->sem == BufferSemaphoreFlags::Full && (buf->sem_id == -1 || buf->sem_id == manager_id_) && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
+		if (buf->sem == BufferSemaphoreFlags::Full && (buf->sem_id == -1 || buf->sem_id == manager_id_) && buf->chain_head == -1 && (shm_ptr_->destructive_read_mode || buf->sequence_id > last_seen_id_))
 		{
 			TLOG(TLVL_READREADY + 3) << std::hex << std::showbase << shm_key_ << std::dec << " ReadyForRead: Buffer " << buffer << " is either unowned or owned by this manager, and is marked full.";
 			touchBuffer_(buf);
@@ -706,7 +1186,7 @@ bool artdaq::SharedMemoryManager::ReadyForWrite(bool overwrite)
 		{
 			continue;
 		}
-		if ((buf->sem == BufferSemaphoreFlags::Empty && buf->sem_id == -1) || (overwrite && buf->sem != BufferSemaphoreFlags::Writing))
+		if ((buf->sem == BufferSemaphoreFlags::Empty && buf->sem_id == -1) || (overwrite && buf->sem != BufferSemaphoreFlags::Writing && buf->chain_head == -1))
 		{
 			TLOG(TLVL_WRITEREADY + 1) << std::hex << std::showbase << shm_key_
 			                          << std::dec
@@ -786,8 +1266,16 @@ size_t artdaq::SharedMemoryManager::BufferDataSize(int buffer)
 	}
 	touchBuffer_(buf);
 
-	TLOG(TLVL_BUFFER) << "BufferDataSize: buffer " << buffer << ", size=" << buf->writePos;
-	return buf->writePos;
+	auto size = chainDataSize_(buf);
+	TLOG(TLVL_BUFFER) << "BufferDataSize: buffer " << buffer << ", size=" << size;
+	return size;
+}
+
+size_t artdaq::SharedMemoryManager::BufferDataSize(BufferToken const& token)
+{
+	auto buf = tokenBuffer_(token, token.state_);
+	touchBuffer_(buf);
+	return chainDataSize_(buf);
 }
 
 void artdaq::SharedMemoryManager::ResetReadPos(int buffer)
@@ -815,9 +1303,16 @@ void artdaq::SharedMemoryManager::ResetReadPos(int buffer)
 	TLOG(TLVL_POS) << "ResetReadPos(" << buffer << ") ended.";
 }
 
-void artdaq::SharedMemoryManager::ResetWritePos(int buffer)
+void artdaq::SharedMemoryManager::ResetReadPos(BufferToken const& token)
 {
-	TLOG(TLVL_POS + 1) << "ResetWritePos(" << buffer << ") called.";
+	auto buf = tokenBuffer_(token, BufferSemaphoreFlags::Reading);
+	touchBuffer_(buf);
+	buf->readPos = 0;
+}
+
+void artdaq::SharedMemoryManager::ResetWritePos(int buffer)
+{
+	TLOG(TLVL_POS + 1) << "ResetWritePos(" << buffer << ") called.";
 
 	if (buffer >= shm_ptr_->buffer_count)
 	{
@@ -836,6 +1331,7 @@ void artdaq::SharedMemoryManager::ResetWritePos(int buffer)
 	}
 	checkBuffer_(buf, BufferSemaphoreFlags::Writing);
 	touchBuffer_(buf);
+	releaseChain_(buf);
 	buf->writePos = 0;
 
 	TLOG(TLVL_POS + 1) << "ResetWritePos(" << buffer << ") ended.";
@@ -869,6 +1365,17 @@ void artdaq::SharedMemoryManager::IncrementReadPos(int buffer, size_t read)
 	}
 }
 
+void artdaq::SharedMemoryManager::IncrementReadPos(BufferToken const& token, size_t read)
+{
+	auto buf = tokenBuffer_(token, BufferSemaphoreFlags::Reading);
+	if (read == 0)
+	{
+		Detach(true, "LogicError", "Cannot increment Read pos by 0! (buffer=" + std::to_string(token.buffer_) + ", readPos=" + std::to_string(buf->readPos) + ", writePos=" + std::to_string(buf->writePos) + ")");
+	}
+	touchBuffer_(buf);
+	buf->readPos = buf->readPos + read;
+}
+
 bool artdaq::SharedMemoryManager::IncrementWritePos(int buffer, size_t written)
 {
 	TLOG(TLVL_POS + 1) << "IncrementWritePos called: buffer= " << buffer << ", bytes written=" << written;
@@ -924,7 +1431,13 @@ bool artdaq::SharedMemoryManager::MoreDataInBuffer(int buffer)
 		return false;
 	}
 	TLOG(TLVL_POS + 2) << "MoreDataInBuffer: buffer= " << buffer << ", readPos=" << std::to_string(buf->readPos) << ", writePos=" << buf->writePos;
-	return buf->readPos < buf->writePos;
+	return buf->readPos < chainDataSize_(buf);
+}
+
+bool artdaq::SharedMemoryManager::MoreDataInBuffer(BufferToken const& token)
+{
+	auto buf = tokenBuffer_(token, token.state_);
+	return buf->readPos < chainDataSize_(buf);
 }
 
 bool artdaq::SharedMemoryManager::CheckBuffer(int buffer, BufferSemaphoreFlags flags)
@@ -941,6 +1454,16 @@ bool artdaq::SharedMemoryManager::CheckBuffer(int buffer, BufferSemaphoreFlags f
 	return checkBuffer_(getBufferInfo_(buffer), flags, false);
 }
 
+bool artdaq::SharedMemoryManager::CheckBuffer(BufferToken const& token, BufferSemaphoreFlags flags)
+{
+	if (!IsValid() || !token.valid() || token.buffer_ >= shm_ptr_->buffer_count)
+	{
+		return false;
+	}
+	auto buf = buffer_ptrs_[token.buffer_];
+	return buf->sem_id == manager_id_ && buf->sem == flags && buf->sequence_id == token.sequence_id_;
+}
+
 void artdaq::SharedMemoryManager::MarkBufferFull(int buffer, int destination)
 {
 	if (buffer >= shm_ptr_->buffer_count)
@@ -961,12 +1484,17 @@ void artdaq::SharedMemoryManager::MarkBufferFull(int buffer, int destination)
 	touchBuffer_(shmBuf);
 	if (shmBuf->sem_id == manager_id_)
 	{
+		// Continuations first, so that a reader never finds a Full head with part of its chain still being written
+		setChainState_(shmBuf, BufferSemaphoreFlags::Full, destination);
 		if (shmBuf->sem != BufferSemaphoreFlags::Full)
 		{
 			shmBuf->sem = BufferSemaphoreFlags::Full;
 		}
 
 		shmBuf->sem_id = destination;
+		closeGeneration_(shmBuf);
+		recordSequence_(shmBuf->sequence_id, buffer);
+		notifyBufferChange_();
 	}
 }
 
@@ -991,12 +1519,19 @@ void artdaq::SharedMemoryManager::MarkBufferEmpty(int buffer, bool force, bool d
 	}
 	touchBuffer_(shmBuf);
 
+	auto abandoned_write = shmBuf->sem == BufferSemaphoreFlags::Writing;
 	shmBuf->readPos = 0;
 	shmBuf->sem = BufferSemaphoreFlags::Full;
 
 	if ((force && (manager_id_ == 0 || manager_id_ == shmBuf->sem_id)) || (!force && shm_ptr_->destructive_read_mode))
 	{
 		TLOG(TLVL_POS + 3) << "MarkBufferEmpty Resetting buffer " << buffer << " to Empty state";
+		if (abandoned_write)
+		{
+			closeGeneration_(shmBuf);
+			recordSequence_(shmBuf->sequence_id, -1);
+		}
+		releaseChain_(shmBuf);
 		shmBuf->writePos = 0;
 		shmBuf->sem = BufferSemaphoreFlags::Empty;
 		if (shm_ptr_->reader_pos == static_cast<unsigned>(buffer) && !shm_ptr_->destructive_read_mode)
@@ -1005,10 +1540,52 @@ void artdaq::SharedMemoryManager::MarkBufferEmpty(int buffer, bool force, bool d
 			shm_ptr_->reader_pos = (buffer + 1) % shm_ptr_->buffer_count;
 		}
 	}
+	else
+	{
+		if (abandoned_write)
+		{
+			closeGeneration_(shmBuf);
+		}
+		setChainState_(shmBuf, BufferSemaphoreFlags::Full, -1);
+	}
 	shmBuf->sem_id = -1;
+	notifyBufferChange_();
 	TLOG(TLVL_POS + 3) << "MarkBufferEmpty END, buffer=" << buffer << ", force=" << force;
 }
 
+void artdaq::SharedMemoryManager::MarkBufferUnread(int buffer, size_t last_seen_id)
+{
+	if (buffer >= shm_ptr_->buffer_count)
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+	}
+	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	auto shmBuf = getBufferInfo_(buffer);
+	if (shmBuf == nullptr || !checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading, false))
+	{
+		return;
+	}
+	touchBuffer_(shmBuf);
+	TLOG(TLVL_POS + 3) << "MarkBufferUnread Returning buffer " << buffer << " (seqid=" << shmBuf->sequence_id << ") to Full, last seen ID back to " << last_seen_id;
+
+	setChainState_(shmBuf, BufferSemaphoreFlags::Full, -1);
+	shmBuf->readPos = 0;
+	shmBuf->sem = BufferSemaphoreFlags::Full;
+	shmBuf->sem_id = -1;
+
+	// Undo what claimForReading_ recorded, unless this manager has read a newer buffer since
+	size_t seen = shmBuf->sequence_id;
+	if (last_seen_id_.compare_exchange_strong(seen, last_seen_id) && shm_ptr_->destructive_read_mode)
+	{
+		if (shm_ptr_->lowest_seq_id_read == shmBuf->sequence_id)
+		{
+			shm_ptr_->lowest_seq_id_read = last_seen_id;
+		}
+		shm_ptr_->reader_pos = buffer;
+	}
+	notifyBufferChange_();
+}
+
 bool artdaq::SharedMemoryManager::ResetBuffer(int buffer)
 {
 	if (buffer >= shm_ptr_->buffer_count)
@@ -1023,7 +1600,7 @@ bool artdaq::SharedMemoryManager::ResetBuffer(int buffer)
 
 	// TraceLock lk(buffer_mutexes_[buffer], 25, "ResetBuffer" + std::to_string(buffer));
 	auto shmBuf = getBufferInfo_(buffer);
-	if (shmBuf == nullptr)
+	if (shmBuf == nullptr || shmBuf->chain_head != -1)  // Continuation buffers are reset along with their head buffer
 	{
 		return false;
 	}
@@ -1058,6 +1635,8 @@ bool artdaq::SharedMemoryManager::ResetBuffer(int buffer)
 	if (!shm_ptr_->destructive_read_mode && shmBuf->sem == BufferSemaphoreFlags::Full && manager_id_ == 0)
 	{
 		TLOG(TLVL_RESET) << "Resetting old broadcast mode buffer " << buffer << " (seqid=" << shmBuf->sequence_id << "). State: Full-->Empty";
+		recordSequence_(shmBuf->sequence_id, -1);
+		releaseChain_(shmBuf);
 		shmBuf->writePos = 0;
 		shmBuf->sem = BufferSemaphoreFlags::Empty;
 		shmBuf->sem_id = -1;
@@ -1079,6 +1658,7 @@ bool artdaq::SharedMemoryManager::ResetBuffer(int buffer)
 		TLOG(TLVL_WARNING) << "Stale Read buffer " << buffer << " at " << static_cast<void*>(shmBuf)
 		                   << " ( " << delta << " / " << shm_ptr_->buffer_timeout_us << " us ) detected! (seqid="
 		                   << shmBuf->sequence_id << ") Resetting... Reading-->Full";
+		setChainState_(shmBuf, BufferSemaphoreFlags::Full, -1);
 		shmBuf->readPos = 0;
 		shmBuf->sem = BufferSemaphoreFlags::Full;
 		shmBuf->sem_id = -1;
@@ -1094,6 +1674,25 @@ bool artdaq::SharedMemoryManager::IsEndOfData() const
 		return true;
 	}
 
+	if (shm_ptr_->end_of_data_epoch.load(std::memory_order_acquire) != 0)
+	{
+		TLOG(TLVL_INFO) << "Shared Memory end-of-data word is set. Owner is removing the Shared Memory!";
+		return true;
+	}
+
+	// Only ask the kernel periodically, in case the segment was removed without going through Detach
+	auto now = TimeUtils::gettimeofday_us();
+	auto next_check = next_end_of_data_check_us_.load(std::memory_order_relaxed);
+	if (now < next_check || !next_end_of_data_check_us_.compare_exchange_strong(next_check, now + end_of_data_check_interval_us_))
+	{
+		return false;
+	}
+
+	if (IsInProcess())
+	{
+		return in_process_segment_->removed.load(std::memory_order_acquire);
+	}
+
 	struct shmid_ds info;
 	auto sts = shmctl(shm_segment_id_, IPC_STAT, &info);
 	if (sts < 0)
@@ -1118,6 +1717,12 @@ uint16_t artdaq::SharedMemoryManager::GetAttachedCount() const
 		return 0;
 	}
 
+	if (IsInProcess())
+	{
+		std::lock_guard<std::mutex> lk(in_process_mutex);
+		return in_process_segment_->attached;
+	}
+
 	struct shmid_ds info;
 	auto sts = shmctl(shm_segment_id_, IPC_STAT, &info);
 	if (sts < 0)
@@ -1136,6 +1741,11 @@ size_t artdaq::SharedMemoryManager::Write(int buffer, void* data, size_t size)
 	{
 		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 	}
+	auto head = getBufferInfo_(buffer);
+	if (head != nullptr && needsChain_(head, size))
+	{
+		return writeChained_(buffer, data, size);
+	}
 	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
 	// TraceLock lk(buffer_mutexes_[buffer], 26, "WriteBuffer" + std::to_string(buffer));
 	auto shmBuf = getBufferInfo_(buffer);
@@ -1144,6 +1754,60 @@ size_t artdaq::SharedMemoryManager::Write(int buffer, void* data, size_t size)
 		return -1;
 	}
 	checkBuffer_(shmBuf, BufferSemaphoreFlags::Writing);
+	return write_(buffer, shmBuf, data, size);
+}
+
+size_t artdaq::SharedMemoryManager::Write(BufferToken const& token, void* data, size_t size)
+{
+	auto shmBuf = tokenBuffer_(token, BufferSemaphoreFlags::Writing);
+	if (needsChain_(shmBuf, size))
+	{
+		return writeChained_(token.buffer_, data, size);
+	}
+	return write_(token.buffer_, shmBuf, data, size);
+}
+
+bool artdaq::SharedMemoryManager::Read(int buffer, void* data, size_t size)
+{
+	if (buffer >= shm_ptr_->buffer_count)
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
+	}
+	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	// TraceLock lk(buffer_mutexes_[buffer], 27, "ReadBuffer" + std::to_string(buffer));
+	auto shmBuf = getBufferInfo_(buffer);
+	if (shmBuf == nullptr)
+	{
+		return false;
+	}
+	checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading);
+	read_(buffer, shmBuf, data, size);
+	auto sts = checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading, false);
+	if (sts)
+	{
+		shmBuf->readPos += size;
+		touchBuffer_(shmBuf);
+		return true;
+	}
+	return false;
+}
+
+bool artdaq::SharedMemoryManager::Read(BufferToken const& token, void* data, size_t size)
+{
+	auto shmBuf = tokenBuffer_(token, BufferSemaphoreFlags::Reading);
+	read_(token.buffer_, shmBuf, data, size);
+	// A stale buffer may have been taken back by another manager during the copy
+	if (shmBuf->sem_id != manager_id_ || shmBuf->sem != BufferSemaphoreFlags::Reading)
+	{
+		return false;
+	}
+	shmBuf->readPos += size;
+	touchBuffer_(shmBuf);
+	return true;
+}
+
+size_t artdaq::SharedMemoryManager::write_(int buffer, ShmBuffer* shmBuf, void* data, size_t size)
+{
 	touchBuffer_(shmBuf);
 	TLOG(TLVL_WRITE) << "Buffer Write Pos is " << std::dec << shmBuf->writePos << ", write size is " << size;
 	if (shmBuf->writePos + size > shm_ptr_->buffer_size)
@@ -1153,8 +1817,7 @@ size_t artdaq::SharedMemoryManager::Write(int buffer, void* data, size_t size)
 		Detach(true, "SharedMemoryWrite", "Attempted to write more data than fits into Shared Memory! \nRe-run with a larger buffer size!");
 	}
 
-	auto pos = GetWritePos(buffer);
-	memcpy(pos, data, size);
+	StreamingCopy::Copy(bufferStart_(buffer) + shmBuf->writePos, data, size);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 	touchBuffer_(shmBuf);
 	shmBuf->writePos = shmBuf->writePos + size;
 
@@ -1165,40 +1828,27 @@ size_t artdaq::SharedMemoryManager::Write(int buffer, void* data, size_t size)
 	return size;
 }
 
-bool artdaq::SharedMemoryManager::Read(int buffer, void* data, size_t size)
+void artdaq::SharedMemoryManager::read_(int buffer, ShmBuffer* shmBuf, void* data, size_t size)
 {
-	if (buffer >= shm_ptr_->buffer_count)
-	{
-		Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
-	}
-	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
-	// TraceLock lk(buffer_mutexes_[buffer], 27, "ReadBuffer" + std::to_string(buffer));
-	auto shmBuf = getBufferInfo_(buffer);
-	if (shmBuf == nullptr)
-	{
-		return false;
-	}
-	checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading);
 	touchBuffer_(shmBuf);
-	if (shmBuf->readPos + size > shm_ptr_->buffer_size)
+	auto limit = shmBuf->chain_next == -1 ? shm_ptr_->buffer_size : chainDataSize_(shmBuf);
+	if (shmBuf->readPos + size > limit)
 	{
 		TLOG(TLVL_ERROR) << "Attempted to read more data than fits into Shared Memory, bufferSize=" << shm_ptr_->buffer_size
-		                 << ",readPos=" << shmBuf->readPos << ",readSize=" << size;
+		                 << ",readPos=" << shmBuf->readPos << ",readSize=" << size << ",chained=" << std::boolalpha << (shmBuf->chain_next != -1);
 		Detach(true, "SharedMemoryRead", "Attempted to read more data than exists in Shared Memory!");
 	}
 
-	auto pos = GetReadPos(buffer);
 	TLOG(TLVL_READ) << "Before memcpy in Read(), size is " << size;
-	memcpy(data, pos, size);
-	TLOG(TLVL_READ) << "After memcpy in Read()";
-	auto sts = checkBuffer_(shmBuf, BufferSemaphoreFlags::Reading, false);
-	if (sts)
+	if (shmBuf->chain_next == -1)
 	{
-		shmBuf->readPos += size;
-		touchBuffer_(shmBuf);
-		return true;
+		memcpy(data, bufferStart_(buffer) + shmBuf->readPos, size);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 	}
-	return false;
+	else
+	{
+		readChained_(buffer, data, size);
+	}
+	TLOG(TLVL_READ) << "After memcpy in Read()";
 }
 
 std::string artdaq::SharedMemoryManager::toString()
@@ -1219,7 +1869,30 @@ std::string artdaq::SharedMemoryManager::toString()
 	     << "Number of Writers: " << shm_ptr_->writer_count << std::endl
 	     << "Number of Readers: " << shm_ptr_->reader_count << std::endl
 	     << "Ready Magic Bytes: " << std::hex << std::showbase << shm_ptr_->ready_magic << std::dec << std::endl
-	     << std::endl;
+	     << "Owner PID: " << shm_ptr_->owner_pid << (IsPersistent() ? " (persistent segment)" : "") << (IsInProcess() ? " (in-process segment)" : "") << std::endl
+	     << "Attach Time: " << attach_timing_.total_s << " s (segment " << attach_timing_.segment_s << " s, map " << attach_timing_.map_s
+	     << " s, init " << attach_timing_.init_s << " s, wait " << attach_timing_.wait_s << " s, setup " << attach_timing_.setup_s << " s)" << std::endl
+	     << "NUMA Nodes: " << NumaUtils::NodeCount() << std::endl
+	     << "NUMA Policy: " << NumaUtils::PolicyToString(static_cast<NumaUtils::Policy>(shm_ptr_->numa_policy));
+	if (shm_ptr_->numa_nodemask != 0)
+	{
+		ostr << " (nodes";
+		for (int node = 0; node < 64; ++node)
+		{
+			if ((shm_ptr_->numa_nodemask & (1ULL << node)) != 0) ostr << " " << node;
+		}
+		ostr << ")";
+	}
+	ostr << std::endl;
+	for (size_t ii = 0; ii < GetPinnedSlotCount(); ++ii)
+	{
+		auto const& slot = pinned_slots_[ii];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (slot.tag != 0)
+		{
+			ostr << "Pinned Slot " << ii << ": tag " << slot.tag << ", sequence ID " << slot.sequence_id << ", " << slot.size << " bytes" << std::endl;
+		}
+	}
+	ostr << std::endl;
 
 	for (auto ii = 0; ii < shm_ptr_->buffer_count; ++ii)
 	{
@@ -1235,7 +1908,9 @@ std::string artdaq::SharedMemoryManager::toString()
 		     << "readPos: " << std::to_string(buf->readPos) << std::endl
 		     << "sem: " << FlagToString(buf->sem) << std::endl
 		     << "Owner: " << std::to_string(buf->sem_id.load()) << std::endl
+		     << "Chain: head=" << std::to_string(buf->chain_head.load()) << ", next=" << std::to_string(buf->chain_next.load()) << std::endl
 		     << "Last Touch Time: " << std::to_string(buf->last_touch_time / 1000000.0) << std::endl
+		     << "NUMA Placement: " << NumaUtils::DescribePlacement(bufferStart_(ii), shm_ptr_->buffer_size) << std::endl
 		     << std::endl;
 	}
 
@@ -1249,7 +1924,15 @@ void* artdaq::SharedMemoryManager::GetReadPos(int buffer)
 	{
 		return nullptr;
 	}
-	return bufferStart_(buffer) + buf->readPos;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	// For a chain, find the segment holding the logical read position
+	size_t offset = buf->readPos;
+	auto segment = buffer;
+	while (buffer_ptrs_[segment]->chain_next != -1 && offset >= buffer_ptrs_[segment]->writePos)
+	{
+		offset -= buffer_ptrs_[segment]->writePos;
+		segment = buffer_ptrs_[segment]->chain_next;
+	}
+	return bufferStart_(segment) + offset;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 }
 void* artdaq::SharedMemoryManager::GetWritePos(int buffer)
 {
@@ -1266,6 +1949,26 @@ void* artdaq::SharedMemoryManager::GetBufferStart(int buffer)
 	return bufferStart_(buffer);
 }
 
+std::vector<artdaq::SharedMemoryManager::BufferSegment> artdaq::SharedMemoryManager::GetBufferSegments(int buffer)
+{
+	std::vector<BufferSegment> output;
+	if (!IsValid() || buffer < 0 || buffer >= shm_ptr_->buffer_count)
+	{
+		return output;
+	}
+
+	std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+	if (buffer_ptrs_[buffer]->chain_head != -1)
+	{
+		return output;
+	}
+	for (auto segment = buffer; segment != -1; segment = buffer_ptrs_[segment]->chain_next)
+	{
+		output.push_back({bufferStart_(segment), buffer_ptrs_[segment]->writePos});
+	}
+	return output;
+}
+
 std::vector<std::pair<int, artdaq::SharedMemoryManager::BufferSemaphoreFlags>> artdaq::SharedMemoryManager::GetBufferReport()
 {
 	auto output = std::vector<std::pair<int, BufferSemaphoreFlags>>(size());
@@ -1277,6 +1980,401 @@ std::vector<std::pair<int, artdaq::SharedMemoryManager::BufferSemaphoreFlags>> a
 	return output;
 }
 
+bool artdaq::SharedMemoryManager::SetNumaPolicy(NumaUtils::Policy policy, std::vector<int> const& nodes)
+{
+	if (shm_ptr_ == nullptr) return false;
+	auto end = pinned_slots_ != nullptr ? pinnedData_(GetPinnedSlotCount()) : dataStart_() + shm_ptr_->buffer_count * shm_ptr_->buffer_size;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	size_t shmSize = end - reinterpret_cast<uint8_t*>(shm_ptr_);                                                                              // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	if (!NumaUtils::SetPolicy(shm_ptr_, shmSize, policy, nodes))
+	{
+		TLOG(TLVL_WARNING) << "Unable to set NUMA policy " << NumaUtils::PolicyToString(policy) << " on shared memory segment with key " << std::hex << std::showbase << shm_key_
+		                   << ", errno=" << std::dec << errno << " (" << strerror(errno) << ")";
+		return false;
+	}
+
+	uint64_t mask = 0;
+	for (auto node : nodes)
+	{
+		if (node >= 0 && node < 64) mask |= 1ULL << node;
+	}
+	shm_ptr_->numa_policy = static_cast<int>(policy);
+	shm_ptr_->numa_nodemask = policy == NumaUtils::Policy::Default ? 0 : mask;
+	TLOG(TLVL_ATTACH) << "Set NUMA policy " << NumaUtils::PolicyToString(policy) << " on shared memory segment with key " << std::hex << std::showbase << shm_key_;
+	return true;
+}
+
+bool artdaq::SharedMemoryManager::SetBufferNumaPolicy(int buffer, size_t count, NumaUtils::Policy policy, std::vector<int> const& nodes)
+{
+	if (shm_ptr_ == nullptr) return false;
+	if (buffer < 0 || count == 0 || buffer + count > static_cast<size_t>(shm_ptr_->buffer_count))
+	{
+		TLOG(TLVL_WARNING) << "SetBufferNumaPolicy: Buffer range " << buffer << " + " << count << " is out of range (buffer count " << shm_ptr_->buffer_count << ")";
+		return false;
+	}
+	// Only the pages lying entirely inside the range are affected, so that neighbouring buffers keep their placement
+	auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	auto begin = (reinterpret_cast<uintptr_t>(bufferStart_(buffer)) + page - 1) & ~(page - 1);                   // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto end = (reinterpret_cast<uintptr_t>(bufferStart_(buffer)) + count * shm_ptr_->buffer_size) & ~(page - 1);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	if (end <= begin)
+	{
+		TLOG(TLVL_WARNING) << "SetBufferNumaPolicy: Buffers " << buffer << " through " << buffer + count - 1 << " do not contain a whole page, not setting NUMA policy";
+		return false;
+	}
+	if (!NumaUtils::SetPolicy(reinterpret_cast<void const*>(begin), end - begin, policy, nodes))  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,performance-no-int-to-ptr)
+	{
+		TLOG(TLVL_WARNING) << "Unable to set NUMA policy " << NumaUtils::PolicyToString(policy) << " on buffers " << buffer << " through " << buffer + count - 1
+		                   << ", errno=" << errno << " (" << strerror(errno) << ")";
+		return false;
+	}
+	TLOG(TLVL_BUFINFO) << "Set NUMA policy " << NumaUtils::PolicyToString(policy) << " on buffers " << buffer << " through " << buffer + count - 1;
+	return true;
+}
+
+bool artdaq::SharedMemoryManager::attachInProcess_(size_t size, bool create, size_t timeout_us)
+{
+	std::unique_lock<std::mutex> lk(in_process_mutex);
+	if (!create)
+	{
+		// Wait for the owner to create the segment, without taking the registry mutex in a loop
+		in_process_created.wait_for(lk, std::chrono::microseconds(timeout_us), [this] { return in_process_segments.count(shm_key_) != 0; });
+	}
+	auto it = in_process_segments.find(shm_key_);
+	if (it == in_process_segments.end())
+	{
+		if (!create)
+		{
+			return false;
+		}
+		TLOG(TLVL_ATTACH) << "Creating in-process shared memory segment with key " << std::hex << std::showbase << shm_key_ << " and size " << std::dec << size;
+		// Anonymous memory is zero-filled, like a new SysV segment
+		auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED)  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+		{
+			TLOG(TLVL_ERROR) << "Error creating in-process shared memory segment with key " << std::hex << std::showbase << shm_key_ << ", errno=" << std::dec << errno << " (" << strerror(errno) << ")";
+			return false;
+		}
+		auto segment = new detail::InProcessSegment();  // NOLINT(cppcoreguidelines-owning-memory)
+		segment->memory = memory;
+		segment->size = size;
+		segment->attached = 0;
+		segment->removed = false;
+		it = in_process_segments.emplace(shm_key_, segment).first;
+		in_process_created.notify_all();
+	}
+	else if (it->second->size < size)
+	{
+		// shmget refuses an existing segment which is smaller than requested in the same way
+		TLOG(TLVL_ERROR) << "In-process shared memory segment with key " << std::hex << std::showbase << shm_key_ << " has " << std::dec << it->second->size
+		                 << " bytes, " << size << " were requested";
+		errno = EINVAL;
+		return false;
+	}
+	++it->second->attached;
+	in_process_segment_ = it->second;
+	return true;
+}
+
+void artdaq::SharedMemoryManager::detachInProcess_(bool remove)
+{
+	std::lock_guard<std::mutex> lk(in_process_mutex);
+	auto segment = in_process_segment_;
+	in_process_segment_ = nullptr;
+	if (remove && !segment->removed)
+	{
+		TLOG(TLVL_DETACH) << "Detach: Removing in-process shared memory segment with key " << std::hex << std::showbase << shm_key_;
+		segment->removed.store(true, std::memory_order_release);
+		in_process_segments.erase(shm_key_);
+	}
+	if (--segment->attached == 0 && segment->removed)
+	{
+		munmap(segment->memory, segment->size);
+		delete segment;  // NOLINT(cppcoreguidelines-owning-memory)
+	}
+}
+
+void artdaq::SharedMemoryManager::mapDescriptors_()
+{
+	buffer_ptrs_ = std::vector<ShmBuffer*>(shm_ptr_->buffer_count);
+	for (int ii = 0; ii < shm_ptr_->buffer_count; ++ii)
+	{
+		buffer_ptrs_[ii] = reinterpret_cast<ShmBuffer*>(reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + ii * sizeof(ShmBuffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	order_slots_ = nullptr;
+	if ((shm_ptr_->segment_flags & OrderedDelivery) != 0)
+	{
+		order_slots_ = reinterpret_cast<OrderSlot*>(reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + shm_ptr_->buffer_count * sizeof(ShmBuffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	pinned_slots_ = nullptr;
+	if ((shm_ptr_->segment_flags & PinnedSlots) != 0)
+	{
+		auto pinned_start = reinterpret_cast<uintptr_t>(dataStart_() + shm_ptr_->buffer_count * shm_ptr_->buffer_size);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		pinned_start = (pinned_start + alignof(PinnedSlot) - 1) / alignof(PinnedSlot) * alignof(PinnedSlot);
+		pinned_slots_ = reinterpret_cast<PinnedSlot*>(pinned_start);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,performance-no-int-to-ptr)
+	}
+}
+
+void artdaq::SharedMemoryManager::recordSequence_(size_t sequence_id, int buffer)
+{
+	if (order_slots_ == nullptr || sequence_id == 0)
+	{
+		return;
+	}
+	auto& slot = order_slots_[sequence_id % shm_ptr_->buffer_count];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	// Claim the slot by swapping its sequence ID for ORDER_SLOT_BUSY, so that two writers recording events
+	// which share the slot cannot interleave, and readers know not to trust the buffer number meanwhile
+	auto current = slot.sequence_id.load(std::memory_order_acquire);
+	while (true)
+	{
+		if (current == ORDER_SLOT_BUSY)
+		{
+			std::this_thread::yield();
+			current = slot.sequence_id.load(std::memory_order_acquire);
+			continue;
+		}
+		if (current > sequence_id)
+		{
+			return;  // The slot already moved on to a later event
+		}
+		if (slot.sequence_id.compare_exchange_weak(current, ORDER_SLOT_BUSY, std::memory_order_acq_rel))
+		{
+			break;
+		}
+	}
+	slot.buffer.store(buffer, std::memory_order_release);
+	slot.sequence_id.store(sequence_id, std::memory_order_release);
+}
+
+artdaq::SharedMemoryManager::SequenceState artdaq::SharedMemoryManager::GetSequenceState(size_t sequence_id, int* buffer)
+{
+	if (!IsValid() || order_slots_ == nullptr || sequence_id == 0)
+	{
+		return SequenceState::Expired;
+	}
+	if (sequence_id > shm_ptr_->next_sequence_id)
+	{
+		return SequenceState::NotYetWritten;
+	}
+
+	auto& slot = order_slots_[sequence_id % shm_ptr_->buffer_count];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	size_t slot_id;
+	int slot_buffer;
+	do
+	{
+		slot_id = slot.sequence_id.load(std::memory_order_acquire);
+		slot_buffer = slot.buffer.load(std::memory_order_acquire);
+	} while (slot_id != ORDER_SLOT_BUSY && slot.sequence_id.load(std::memory_order_acquire) != slot_id);
+
+	if (slot_id == ORDER_SLOT_BUSY || slot_id < sequence_id)
+	{
+		return SequenceState::NotYetWritten;  // Assigned to a writer, which has not marked it Full yet (or is recording it right now)
+	}
+	if (slot_id > sequence_id)
+	{
+		return SequenceState::Expired;
+	}
+	if (slot_buffer == -1)
+	{
+		return SequenceState::Skipped;
+	}
+	auto buf = buffer_ptrs_[slot_buffer];
+	auto sem = buf->sem.load();
+	if (buf->sequence_id != sequence_id || (sem != BufferSemaphoreFlags::Full && sem != BufferSemaphoreFlags::Reading))
+	{
+		return SequenceState::Expired;
+	}
+	if (buffer != nullptr)
+	{
+		*buffer = slot_buffer;
+	}
+	return SequenceState::Ready;
+}
+
+void artdaq::SharedMemoryManager::initBufferDescriptors_()
+{
+	auto count = static_cast<size_t>(shm_ptr_->buffer_count);
+	auto now = TimeUtils::gettimeofday_us();
+	auto init_range = [this, now](size_t begin, size_t end) {
+		for (auto ii = begin; ii < end; ++ii)
+		{
+			auto buf = buffer_ptrs_[ii];
+			buf->writePos = 0;
+			buf->readPos = 0;
+			buf->sem = BufferSemaphoreFlags::Empty;
+			buf->sem_id = -1;
+			buf->chain_next = -1;
+			buf->chain_head = -1;
+			buf->generation = 0;
+			buf->last_touch_time = now;
+			if (order_slots_ != nullptr)
+			{
+				order_slots_[ii].sequence_id = 0;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				order_slots_[ii].buffer = -1;      // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			}
+		}
+	};
+
+	// Descriptor initialization is bound by memory bandwidth (first touch of each page), so only
+	// large segments are split across threads
+	size_t threads = std::min(count / BUFFERS_PER_INIT_THREAD, static_cast<size_t>(MAX_INIT_THREADS));
+	threads = std::min(threads, static_cast<size_t>(std::thread::hardware_concurrency()));
+	if (threads < 2)
+	{
+		attach_timing_.init_threads = 1;
+		init_range(0, count);
+		return;
+	}
+
+	auto chunk = (count + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	for (size_t tt = 1; tt < threads; ++tt)
+	{
+		auto begin = tt * chunk;
+		auto end = std::min(count, begin + chunk);
+		try
+		{
+			workers.emplace_back(init_range, begin, end);
+		}
+		catch (std::system_error const& ex)
+		{
+			TLOG(TLVL_WARNING) << "Unable to start buffer initialization thread, initializing buffers " << begin << " through " << end - 1 << " serially: " << ex.what();
+			init_range(begin, end);
+		}
+	}
+	init_range(0, chunk);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	attach_timing_.init_threads = workers.size() + 1;
+}
+
+artdaq::SharedMemoryManager::ShmBuffer* artdaq::SharedMemoryManager::tokenBuffer_(BufferToken const& token, BufferSemaphoreFlags flags)
+{
+	if (!IsValid() || !token.valid() || token.buffer_ >= shm_ptr_->buffer_count)
+	{
+		Detach(true, "ArgumentOutOfRange", "The specified buffer token does not refer to an existing buffer!");
+	}
+	if (token.state_ != flags)
+	{
+		Detach(true, "StateAccessViolation", "Buffer token was obtained for " + FlagToString(token.state_) + ", not " + FlagToString(flags) + "!");
+	}
+	auto buf = buffer_ptrs_[token.buffer_];
+	// Only the mutex is skipped for tokens; a mismatch means the token outlived its buffer: it was released, or reset as stale by another manager
+	auto sem_id = buf->sem_id.load();
+	auto sem = buf->sem.load();
+	auto sequence_id = buf->sequence_id.load();
+	if (sem_id != manager_id_ || sem != flags || sequence_id != token.sequence_id_)
+	{
+		Detach(true, "TokenAccessViolation", "Buffer token for buffer " + std::to_string(token.buffer_) + " (sequence ID " + std::to_string(token.sequence_id_) +
+		                                         ") is no longer valid! (owner " + std::to_string(sem_id) + ", state " + FlagToString(sem) +
+		                                         ", sequence ID " + std::to_string(sequence_id) + ")");
+	}
+	return buf;
+}
+
+bool artdaq::SharedMemoryManager::layoutMatches_(bool adopting) const
+{
+	auto matches = shm_ptr_->layout_version == SHM_LAYOUT_VERSION &&
+	               shm_ptr_->header_size == sizeof(ShmStruct) &&
+	               shm_ptr_->descriptor_size == sizeof(ShmBuffer);
+	if (!adopting)
+	{
+		// Other managers take the buffer count, buffer size and flags from the segment
+		if (!matches)
+		{
+			TLOG(TLVL_WARNING) << "Existing Shared Memory layout (version " << shm_ptr_->layout_version << ", header " << shm_ptr_->header_size << " bytes, descriptor "
+			                   << shm_ptr_->descriptor_size << " bytes) does not match this manager's layout (version " << SHM_LAYOUT_VERSION << ", header "
+			                   << sizeof(ShmStruct) << " bytes, descriptor " << sizeof(ShmBuffer) << " bytes), it cannot be attached";
+		}
+		return matches;
+	}
+
+	matches = matches &&
+	          shm_ptr_->segment_flags == requested_shm_parameters_.segment_flags &&
+	          shm_ptr_->buffer_count == requested_shm_parameters_.buffer_count &&
+	          shm_ptr_->buffer_size == requested_shm_parameters_.buffer_size;
+	if (!matches)
+	{
+		TLOG(TLVL_WARNING) << "Existing Shared Memory layout (version " << shm_ptr_->layout_version << ", flags " << shm_ptr_->segment_flags
+		                   << ", " << shm_ptr_->buffer_count << " buffers of " << shm_ptr_->buffer_size << " bytes) does not match the requested layout (version "
+		                   << SHM_LAYOUT_VERSION << ", " << requested_shm_parameters_.buffer_count << " buffers of " << requested_shm_parameters_.buffer_size
+		                   << " bytes), it cannot be adopted";
+	}
+	return matches;
+}
+
+bool artdaq::SharedMemoryManager::acquireOwnership_(size_t timeout_us)
+{
+	auto start_time = std::chrono::steady_clock::now();
+	while (true)
+	{
+		auto owner = shm_ptr_->owner_pid.load();
+		// The previous owner either released the segment, or died without detaching
+		if (owner == 0 || (owner != getpid() && kill(owner, 0) == -1 && errno == ESRCH))
+		{
+			if (shm_ptr_->owner_pid.compare_exchange_strong(owner, getpid()))
+			{
+				TLOG(TLVL_ATTACH) << "Took over ownership of Shared Memory from process " << owner;
+				return true;
+			}
+			continue;
+		}
+		if (TimeUtils::GetElapsedTimeMicroseconds(start_time) >= timeout_us)
+		{
+			return false;
+		}
+		usleep(10000);
+	}
+}
+
+void artdaq::SharedMemoryManager::adoptBuffers_()
+{
+	// Buffers held by other managers are still in use and are left alone. Only the buffers the previous
+	// owner (manager ID 0) was in the middle of writing or reading are returned, as its Detach would have done.
+	size_t full = 0;
+	for (auto buf : buffer_ptrs_)
+	{
+		if (buf->sem_id == 0 && buf->chain_head == -1)
+		{
+			auto sem = buf->sem.load();
+			if (sem == BufferSemaphoreFlags::Writing)
+			{
+				TLOG(TLVL_RESET) << "adoptBuffers_: Discarding partially-written buffer, sequence ID " << buf->sequence_id;
+				closeGeneration_(buf);
+				recordSequence_(buf->sequence_id, -1);
+				releaseChain_(buf);
+				buf->writePos = 0;
+				buf->sem = BufferSemaphoreFlags::Empty;
+				buf->sem_id = -1;
+			}
+			else if (sem == BufferSemaphoreFlags::Reading)
+			{
+				setChainState_(buf, BufferSemaphoreFlags::Full, -1);
+				buf->readPos = 0;
+				buf->sem = BufferSemaphoreFlags::Full;
+				buf->sem_id = -1;
+			}
+			touchBuffer_(buf);
+		}
+		if (buf->sem == BufferSemaphoreFlags::Full && buf->chain_head == -1)
+		{
+			++full;
+		}
+	}
+
+	// A previous owner that died without detaching is still counted among the readers and writers
+	auto stale = shm_ptr_->owner_registrations.exchange(0);
+	if ((stale & SHM_OWNER_READER) != 0)
+	{
+		shm_ptr_->reader_count--;
+	}
+	if ((stale & SHM_OWNER_WRITER) != 0)
+	{
+		shm_ptr_->writer_count--;
+	}
+	TLOG(TLVL_ATTACH) << "Adopted Shared Memory with " << full << " Full buffers, " << shm_ptr_->writer_count << " writers and " << shm_ptr_->reader_count << " readers";
+}
+
 bool artdaq::SharedMemoryManager::checkBuffer_(ShmBuffer* buffer, BufferSemaphoreFlags flags, bool exceptions)
 {
 	if (buffer == nullptr)
@@ -1321,6 +2419,199 @@ void artdaq::SharedMemoryManager::touchBuffer_(ShmBuffer* buffer)
 	buffer->last_touch_time = TimeUtils::gettimeofday_us();
 }
 
+size_t artdaq::SharedMemoryManager::chainDataSize_(ShmBuffer* head)
+{
+	size_t size = head->writePos;
+	for (auto next = head->chain_next.load(); next != -1; next = buffer_ptrs_[next]->chain_next)
+	{
+		size += buffer_ptrs_[next]->writePos;
+	}
+	return size;
+}
+
+void artdaq::SharedMemoryManager::setChainState_(ShmBuffer* head, BufferSemaphoreFlags sem, int16_t sem_id)
+{
+	for (auto next = head->chain_next.load(); next != -1; next = buffer_ptrs_[next]->chain_next)
+	{
+		auto buf = buffer_ptrs_[next];
+		buf->sem_id = sem_id;
+		buf->sem = sem;
+		buf->last_touch_time = head->last_touch_time.load();
+	}
+}
+
+void artdaq::SharedMemoryManager::releaseChain_(ShmBuffer* head)
+{
+	auto next = head->chain_next.exchange(-1);
+	while (next != -1)
+	{
+		auto buf = buffer_ptrs_[next];
+		TLOG(TLVL_BUFFER) << "releaseChain_: Releasing continuation buffer " << next << " of sequence ID " << head->sequence_id;
+		next = buf->chain_next.exchange(-1);
+		// The buffer must look like a regular Empty buffer before a writer can claim it
+		buf->chain_head = -1;
+		buf->writePos = 0;
+		buf->readPos = 0;
+		buf->sem_id = -1;
+		buf->sem = BufferSemaphoreFlags::Empty;
+	}
+}
+
+std::vector<int> artdaq::SharedMemoryManager::claimContinuations_(int head_buffer, size_t count)
+{
+	auto head = buffer_ptrs_[head_buffer];
+	std::vector<int> claimed;
+	claimed.reserve(count);
+
+	std::lock_guard<std::mutex> lk(search_mutex_);
+	auto wp = shm_ptr_->writer_pos.load();
+	for (auto ii = 0; ii < shm_ptr_->buffer_count && claimed.size() < count; ++ii)
+	{
+		auto buffer = (ii + wp) % shm_ptr_->buffer_count;
+		ResetBuffer(buffer);
+
+		auto buf = getBufferInfo_(buffer);
+		if (buf == nullptr)
+		{
+			continue;
+		}
+		auto sem = buf->sem.load();
+		int16_t sem_id = -1;
+		if (sem != BufferSemaphoreFlags::Empty || !buf->sem_id.compare_exchange_strong(sem_id, manager_id_))
+		{
+			continue;
+		}
+		if (!buf->sem.compare_exchange_strong(sem, BufferSemaphoreFlags::Writing))
+		{
+			buf->sem_id = -1;
+			continue;
+		}
+		buf->writePos = 0;
+		buf->readPos = 0;
+		buf->chain_next = -1;
+		buf->chain_head = head_buffer;
+		buf->sequence_id = head->sequence_id.load();
+		touchBuffer_(buf);
+		claimed.push_back(buffer);
+	}
+
+	if (claimed.size() < count)
+	{
+		// Holding a partial chain while waiting for readers could starve other writers, so give it back and fail right away
+		TLOG(TLVL_GETBUFFER + 1) << "claimContinuations_: Only " << claimed.size() << " of " << count << " continuation buffers for buffer " << head_buffer << " are free";
+		for (auto buffer : claimed)
+		{
+			auto buf = buffer_ptrs_[buffer];
+			buf->chain_head = -1;
+			buf->sem = BufferSemaphoreFlags::Empty;
+			buf->sem_id = -1;
+		}
+		claimed.clear();
+		return claimed;
+	}
+
+	shm_ptr_->writer_pos = (claimed.back() + 1) % shm_ptr_->buffer_count;
+	TLOG(TLVL_GETBUFFER + 1) << "claimContinuations_: Claimed " << count << " continuation buffers for buffer " << head_buffer;
+	return claimed;
+}
+
+size_t artdaq::SharedMemoryManager::writeChained_(int buffer, void* data, size_t size)
+{
+	auto head = getBufferInfo_(buffer);
+	{
+		std::lock_guard<std::mutex> lk(buffer_mutexes_[buffer]);
+		checkBuffer_(head, BufferSemaphoreFlags::Writing);
+		touchBuffer_(head);
+	}
+
+	// The buffer mutex is not held from here on, claimContinuations_ takes search_mutex_, which is taken before buffer mutexes elsewhere.
+	// Every buffer of the chain is in the Writing state and owned by this manager, so no other manager touches them.
+	auto tail = buffer;
+	while (buffer_ptrs_[tail]->chain_next != -1)
+	{
+		tail = buffer_ptrs_[tail]->chain_next;
+	}
+
+	// Reserve every continuation buffer this write needs before copying anything, so that a write either fits or leaves the chain untouched
+	auto space = shm_ptr_->buffer_size - buffer_ptrs_[tail]->writePos;
+	if (size > space)
+	{
+		auto needed = (size - space + shm_ptr_->buffer_size - 1) / shm_ptr_->buffer_size;
+		auto continuations = claimContinuations_(buffer, needed);
+		if (continuations.empty())
+		{
+			TLOG(TLVL_ERROR) << "Unable to claim " << needed << " continuation buffers for buffer " << buffer << ", not writing " << size << " bytes";
+			return 0;
+		}
+		auto last = tail;
+		for (auto next : continuations)
+		{
+			buffer_ptrs_[last]->chain_next = next;
+			last = next;
+		}
+	}
+
+	auto src = static_cast<uint8_t*>(data);
+	size_t written = 0;
+	while (written < size)
+	{
+		auto tailBuf = buffer_ptrs_[tail];
+		space = shm_ptr_->buffer_size - tailBuf->writePos;
+		if (space == 0)
+		{
+			tail = tailBuf->chain_next;
+			continue;
+		}
+		auto chunk = std::min(space, size - written);
+		StreamingCopy::Copy(bufferStart_(tail) + tailBuf->writePos, src + written, chunk);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		tailBuf->writePos = tailBuf->writePos + chunk;
+		written += chunk;
+	}
+	touchBuffer_(head);
+	TLOG(TLVL_WRITE) << "Wrote " << size << " bytes into chain starting at buffer " << buffer << ", total size " << chainDataSize_(head);
+
+	auto last_seen = last_seen_id_.load();
+	while (last_seen < head->sequence_id && !last_seen_id_.compare_exchange_weak(last_seen, head->sequence_id)) {}
+	return size;
+}
+
+void artdaq::SharedMemoryManager::readChained_(int buffer, void* data, size_t size)
+{
+	auto offset = buffer_ptrs_[buffer]->readPos;
+	auto segment = buffer;
+	while (segment != -1 && offset >= buffer_ptrs_[segment]->writePos)
+	{
+		offset -= buffer_ptrs_[segment]->writePos;
+		segment = buffer_ptrs_[segment]->chain_next;
+	}
+
+	auto dest = static_cast<uint8_t*>(data);
+	size_t read = 0;
+	while (read < size && segment != -1)
+	{
+		auto chunk = std::min(buffer_ptrs_[segment]->writePos - offset, size - read);
+		memcpy(dest + read, bufferStart_(segment) + offset, chunk);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		read += chunk;
+		offset = 0;
+		segment = buffer_ptrs_[segment]->chain_next;
+	}
+}
+
+void artdaq::SharedMemoryManager::abandonAttach_()
+{
+	if (IsInProcess())
+	{
+		detachInProcess_(false);
+	}
+	else
+	{
+		shmdt(shm_ptr_);
+	}
+	shm_ptr_ = nullptr;
+	shm_segment_id_ = -1;
+	manager_id_ = -1;
+}
+
 void artdaq::SharedMemoryManager::Detach(bool throwException, const std::string& category, const std::string& message, bool force)
 {
 	TLOG(TLVL_DETACH) << "Detach BEGIN: throwException: " << std::boolalpha << throwException << ", force: " << force;
@@ -1331,40 +2622,76 @@ void artdaq::SharedMemoryManager::Detach(bool throwException, const std::string&
 		for (auto buf : bufs)
 		{
 			auto shmBuf = getBufferInfo_(buf);
-			if (shmBuf == nullptr)
+			if (shmBuf == nullptr || shmBuf->chain_head != -1)  // Continuation buffers are returned with their head buffer
 			{
 				continue;
 			}
 			if (shmBuf->sem == BufferSemaphoreFlags::Writing)
 			{
+				closeGeneration_(shmBuf);
+				recordSequence_(shmBuf->sequence_id, -1);
+				releaseChain_(shmBuf);
 				shmBuf->sem = BufferSemaphoreFlags::Empty;
 			}
 			else if (shmBuf->sem == BufferSemaphoreFlags::Reading)
 			{
+				setChainState_(shmBuf, BufferSemaphoreFlags::Full, -1);
 				shmBuf->sem = BufferSemaphoreFlags::Full;
 			}
+			else
+			{
+				setChainState_(shmBuf, shmBuf->sem, -1);
+			}
 			shmBuf->sem_id = -1;
 		}
 		if (registered_reader_)
 		{
 			shm_ptr_->reader_count--;
+			if (manager_id_ == 0)
+			{
+				shm_ptr_->owner_registrations &= ~SHM_OWNER_READER;
+			}
 			registered_reader_ = false;
 		}
 		if (registered_writer_)
 		{
 			shm_ptr_->writer_count--;
+			if (manager_id_ == 0)
+			{
+				shm_ptr_->owner_registrations &= ~SHM_OWNER_WRITER;
+			}
 			registered_writer_ = false;
 		}
 	}
 
+	// An owner leaving a persistent segment only gives up ownership; the segment stays for the next owner
+	bool remove = (force || (manager_id_ == 0 && !IsPersistent())) && (shm_segment_id_ > -1 || IsInProcess());
 	if (shm_ptr_ != nullptr)
 	{
+		if (remove)
+		{
+			TLOG(TLVL_DETACH) << "Detach: Setting end-of-data word";
+			shm_ptr_->end_of_data_epoch.store(TimeUtils::gettimeofday_us(), std::memory_order_release);
+		}
+		else if (manager_id_ == 0)
+		{
+			TLOG(TLVL_DETACH) << "Detach: Releasing ownership of persistent shared memory";
+			shm_ptr_->owner_pid = 0;
+		}
 		TLOG(TLVL_DETACH) << "Detach: Detaching shared memory";
-		shmdt(shm_ptr_);
+		if (IsInProcess())
+		{
+			detachInProcess_(remove);
+		}
+		else
+		{
+			shmdt(shm_ptr_);
+		}
 		shm_ptr_ = nullptr;
+		order_slots_ = nullptr;
 	}
 
-	if ((force || manager_id_ == 0) && shm_segment_id_ > -1)
+	if (remove && shm_segment_id_ > -1)
 	{
 		TLOG(TLVL_DETACH) << "Detach: Marking Shared memory for removal";
 		shmctl(shm_segment_id_, IPC_RMID, nullptr);
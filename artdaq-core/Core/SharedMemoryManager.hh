@@ -6,10 +6,16 @@
 #include <list>
 #include <mutex>
 #include <string>
+#include <sys/types.h>
 #include <vector>
+#include "artdaq-core/Core/NumaUtils.hh"
 #include "artdaq-core/Utilities/TimeUtils.hh"
 
 namespace artdaq {
+namespace detail {
+struct InProcessSegment;
+}
+
 /**
  * \brief The SharedMemoryManager creates a Shared Memory area which is divided into a number of fixed-size buffers.
  * It provides for multiple readers and multiple writers through a dual semaphore system.
@@ -49,6 +55,76 @@ public:
 		return "Unknown";
 	}
 
+	/**
+	 * \brief Optional segment behaviors, combined into the segment_flags constructor argument. Only the owner's flags are used
+	 */
+	enum SegmentFlags : uint32_t
+	{
+		PersistentSegment = 0x1,  ///< The segment outlives its owner, and a restarted owner adopts it (see AdoptedSegment)
+		ChainedBuffers = 0x2,     ///< Writes which do not fit in a buffer continue in additional Empty buffers, even when overwriting (see Write). Cannot be combined with RingMode
+		OrderedDelivery = 0x4,    ///< Full buffers are indexed by sequence ID, so readers take them in order without a scan (see GetSequenceState)
+		RingMode = 0x8,           ///< Writers always take the oldest buffer, overwriting unread events, in O(1) (see CopyBufferSnapshot)
+		PinnedSlots = 0x10,       ///< The segment keeps copies of selected events for readers which attach later (see PinBuffer)
+		InProcess = 0x20,         ///< The segment is private memory of this process, found by key by the managers in it which also pass this flag, instead of SysV shared memory (see IsInProcess)
+	};
+
+	/**
+	 * \brief State of a sequence ID in a segment with the OrderedDelivery flag, see GetSequenceState
+	 */
+	enum class SequenceState : int
+	{
+		NotYetWritten,  ///< The event has not been marked Full yet (it may still be in a writer's hands)
+		Ready,          ///< The event is in a Full (or Reading) buffer
+		Skipped,        ///< The event was discarded before anyone read it (abandoned write, overwritten or timed out)
+		Expired,        ///< The event has been read, or its slot has been reused by a later event
+	};
+
+	/**
+	 * \brief A contiguous piece of the data in a buffer, see GetBufferSegments
+	 */
+	struct BufferSegment
+	{
+		void* data;   ///< Start of the segment
+		size_t size;  ///< Number of bytes of data in the segment
+	};
+
+	/**
+	 * \brief Proof that this manager owns a buffer, returned by GetBufferTokenForReading and GetBufferTokenForWriting
+	 *
+	 * The buffer state in shared memory already guarantees that only the owning manager touches a claimed
+	 * buffer, so the operations taking a token skip the process-local buffer mutex. The thread holding the
+	 * token must be the only one in this process using the buffer; handing a buffer to another thread, and
+	 * releasing it (MarkBufferFull, MarkBufferEmpty), still go through the buffer ID and the mutex.
+	 * Releasing the buffer invalidates the token. Every use checks the token against the buffer owner, state
+	 * and sequence ID, and detaches with a TokenAccessViolation on a mismatch.
+	 */
+	class BufferToken
+	{
+	public:
+		BufferToken() = default;
+
+		/**
+		 * \brief Get the ID of the buffer this token refers to
+		 * \return Buffer ID, -1 for an empty token
+		 */
+		int buffer() const { return buffer_; }
+
+		/**
+		 * \brief Whether the token refers to a buffer
+		 * \return False if no buffer was available when the token was requested
+		 */
+		bool valid() const { return buffer_ != -1; }
+
+	private:
+		friend class SharedMemoryManager;
+		BufferToken(int buffer, size_t sequence_id, BufferSemaphoreFlags state)
+		    : buffer_(buffer), sequence_id_(sequence_id), state_(state) {}
+
+		int buffer_{-1};
+		size_t sequence_id_{0};
+		BufferSemaphoreFlags state_{BufferSemaphoreFlags::Empty};
+	};
+
 	/**
 	 * \brief SharedMemoryManager Constructor
 	 * \param shm_key The key to use when attaching/creating the shared memory segment
@@ -57,8 +133,26 @@ public:
 	 * \param buffer_timeout_us The maximum amount of time a buffer can be left untouched by its owner (if 0, buffers do not expire)
 	 * before being returned to its previous state.
 	 * \param destructive_read_mode Whether a read operation empties the buffer (default: true, false for broadcast mode)
-	 */
-	SharedMemoryManager(uint32_t shm_key, size_t buffer_count = 0, size_t buffer_size = 0, uint64_t buffer_timeout_us = 100 * 1000000, bool destructive_read_mode = true);
+	 * \param segment_flags Bitmask of SegmentFlags (default: none)
+	 *
+	 * With SegmentFlags::PersistentSegment, the owner leaves the segment in place when it detaches, so that
+	 * the readers and writers attached to it can keep going while the owner is restarted. A new owner which
+	 * finds a persistent segment with the same layout (version, buffer count and buffer size) takes it over
+	 * instead of reinitializing it: Full buffers are kept, and only buffers the previous owner was in the
+	 * middle of writing or reading are returned to the Empty or Full state. If the previous owner is still
+	 * attached, the new owner waits for it to detach, for up to the Attach timeout.
+	 *
+	 * With SegmentFlags::ChainedBuffers, an event larger than buffer_size is stored in a chain of buffers
+	 * instead of detaching with an error. See Write.
+	 *
+	 * With SegmentFlags::InProcess, the segment is allocated in anonymous private memory and registered under
+	 * shm_key in a table local to the process. Managers in the same process (e.g. on other threads) attach to it
+	 * by key as usual, but have to pass the InProcess flag as well: the table is only searched with the flag, and
+	 * the SysV keys only without it, so a SysV segment with the same key is a different segment. Other processes
+	 * cannot see it, and no kernel IPC object is created, so there is nothing to clean up with ipcrm and keys only
+	 * have to be unique within the process.
+	 */
+	SharedMemoryManager(uint32_t shm_key, size_t buffer_count = 0, size_t buffer_size = 0, uint64_t buffer_timeout_us = 100 * 1000000, bool destructive_read_mode = true, uint32_t segment_flags = 0);
 
 	/**
 	 * \brief SharedMemoryManager Destructor
@@ -80,9 +174,25 @@ public:
 	 * \brief Finds a buffer that is ready to be written to, and reserves it for the calling manager.
 	 * \param overwrite Whether to consider buffers that are in the Full and Reading state as ready for write (non-reliable mode)
 	 * \return The id number of the buffer. -1 indicates no buffers available for write.
+	 *
+	 * In a RingMode segment, the buffer after the last one written is taken whatever the overwrite flag, unless a reader
+	 * or another writer holds it, so the segment always holds the latest events.
 	 */
 	int GetBufferForWriting(bool overwrite);
 
+	/**
+	 * \brief Finds a buffer that is ready to be read, and reserves it for the calling manager (see BufferToken)
+	 * \return A token for the buffer, not valid() if no buffers are available for read
+	 */
+	BufferToken GetBufferTokenForReading();
+
+	/**
+	 * \brief Finds a buffer that is ready to be written to, and reserves it for the calling manager (see BufferToken)
+	 * \param overwrite Whether to consider buffers that are in the Full and Reading state as ready for write (non-reliable mode)
+	 * \return A token for the buffer, not valid() if no buffers are available for write
+	 */
+	BufferToken GetBufferTokenForWriting(bool overwrite);
+
 	/**
 	 * \brief Whether any buffer is ready for read
 	 * \return True if there is a buffer available
@@ -119,10 +229,17 @@ public:
 	/**
 	 * \brief Get the current size of the buffer's data
 	 * \param buffer Buffer ID of buffer
-	 * \return Current size of data in the buffer, in bytes
+	 * \return Current size of data in the buffer, in bytes, including any continuation buffers
 	 */
 	size_t BufferDataSize(int buffer);
 
+	/**
+	 * \brief Get the current size of the buffer's data, without locking the buffer mutex
+	 * \param token Token of an owned buffer
+	 * \return Current size of data in the buffer, in bytes, including any continuation buffers
+	 */
+	size_t BufferDataSize(BufferToken const& token);
+
 	/**
 	 * \brief Get the size of of a single buffer
 	 * \return The configured size of a single buffer, in bytes
@@ -135,9 +252,17 @@ public:
 	 */
 	void ResetReadPos(int buffer);
 
+	/**
+	 * \brief Set the read position of the given buffer to the beginning of the buffer, without locking the buffer mutex
+	 * \param token Token of a buffer owned for reading
+	 */
+	void ResetReadPos(BufferToken const& token);
+
 	/**
 	 * \brief Set the write position of the given buffer to the beginning of the buffer
 	 * \param buffer Buffer ID of buffer
+	 *
+	 * Any continuation buffers are released.
 	 */
 	void ResetWritePos(int buffer);
 	/**
@@ -147,11 +272,20 @@ public:
 	 */
 	void IncrementReadPos(int buffer, size_t read);
 
+	/**
+	 * \brief Increment the read position for a given buffer, without locking the buffer mutex
+	 * \param token Token of a buffer owned for reading
+	 * \param read Number of bytes by which to increment read position
+	 */
+	void IncrementReadPos(BufferToken const& token, size_t read);
+
 	/**
 	 * \brief Increment the write position for a given buffer
 	 * \param buffer Buffer ID of buffer
 	 * \param written Number of bytes by which to increment write position
 	 * \return Whether the write is allowed
+	 *
+	 * Data written in place (through GetWritePos) is limited to a single buffer; only Write extends a chain.
 	 */
 	bool IncrementWritePos(int buffer, size_t written);
 
@@ -162,6 +296,13 @@ public:
 	 */
 	bool MoreDataInBuffer(int buffer);
 
+	/**
+	 * \brief Determine if more data is available to be read, without locking the buffer mutex
+	 * \param token Token of an owned buffer
+	 * \return Whether more data is available in the given buffer.
+	 */
+	bool MoreDataInBuffer(BufferToken const& token);
+
 	/**
 	 * \brief Check both semaphore conditions (Mode flag and manager ID) for a given buffer
 	 * \param buffer Buffer ID of buffer
@@ -170,6 +311,14 @@ public:
 	 */
 	bool CheckBuffer(int buffer, BufferSemaphoreFlags flags);
 
+	/**
+	 * \brief Check both semaphore conditions (Mode flag and manager ID) for a given buffer, without locking the buffer mutex
+	 * \param token Token of the buffer
+	 * \param flags Expected Mode flag
+	 * \return Whether the buffer passed the check
+	 */
+	bool CheckBuffer(BufferToken const& token, BufferSemaphoreFlags flags);
+
 	/**
 	 * \brief Release a buffer from a writer, marking it Full and ready for a reader
 	 * \param buffer Buffer ID of buffer
@@ -185,6 +334,16 @@ public:
 	 */
 	void MarkBufferEmpty(int buffer, bool force = false, bool detachOnException = true);
 
+	/**
+	 * \brief Give a buffer claimed for reading back to the readers without reading it, marking it Full again
+	 * \param buffer Buffer ID of buffer
+	 * \param last_seen_id The value GetLastSeenBufferID returned before the buffer was claimed
+	 *
+	 * Unlike MarkBufferEmpty, this also forgets that the buffer was seen, so that in non-destructive (broadcast) mode
+	 * this manager reads the event again instead of skipping it. Only has an effect if this manager is reading the buffer.
+	 */
+	void MarkBufferUnread(int buffer, size_t last_seen_id);
+
 	/**
 	 * \brief Resets the buffer from Reading to Full. This operation will only have an
 	 * effect if performed by the owning manager or if the buffer has timed out.
@@ -244,9 +403,19 @@ public:
 
 	/**
 	 * \brief Determine whether the Shared Memory is marked for destruction (End of Data)
+	 *
+	 * The owner sets an end-of-data word in the segment before removing it, so this normally does not
+	 * need a system call. The segment status is still checked with shmctl at most once per
+	 * end-of-data check interval, to catch segments removed by other means (e.g. ipcrm).
 	 */
 	bool IsEndOfData() const;
 
+	/**
+	 * \brief Set the interval between shmctl checks of the segment status in IsEndOfData
+	 * \param interval_us Interval, in microseconds (0 to check on every call)
+	 */
+	void SetEndOfDataCheckInterval(uint64_t interval_us) { end_of_data_check_interval_us_ = interval_us; }
+
 	/**
 	 * \brief Get the number of buffers in the shared memory segment
 	 * \return The number of buffers in the shared memory segment
@@ -259,18 +428,45 @@ public:
 	 * \param data Source pointer for write
 	 * \param size Size of write, in bytes
 	 * \return Amount of data written, in bytes
+	 *
+	 * If the data does not fit in the buffer and the segment was created with SegmentFlags::ChainedBuffers,
+	 * the remainder goes into continuation buffers, all claimed from the Empty buffers before anything is
+	 * copied. The chain belongs to the head buffer: it changes state with it, is skipped by GetBufferForReading
+	 * and the ready counts, and is released when the head is emptied. If not enough Empty buffers are
+	 * available, nothing is written and 0 is returned; this also applies to a head buffer taken for overwrite.
+	 * Without the flag, a write which does not fit detaches with an error.
 	 */
 	size_t Write(int buffer, void* data, size_t size);
 
+	/**
+	 * \brief Write size bytes of data from the given pointer to a buffer, without locking the buffer mutex
+	 * \param token Token of a buffer owned for writing
+	 * \param data Source pointer for write
+	 * \param size Size of write, in bytes
+	 * \return Amount of data written, in bytes
+	 */
+	size_t Write(BufferToken const& token, void* data, size_t size);
+
 	/**
 	 * \brief Read size bytes of data from buffer into the given pointer
 	 * \param buffer Buffer ID of buffer
 	 * \param data Destination pointer for read
 	 * \param size Size of read, in bytes
 	 * \return Whether the read was successful
+	 *
+	 * Reads from a chained buffer are reassembled transparently: the read position spans the whole chain.
 	 */
 	bool Read(int buffer, void* data, size_t size);
 
+	/**
+	 * \brief Read size bytes of data from buffer into the given pointer, without locking the buffer mutex
+	 * \param token Token of a buffer owned for reading
+	 * \param data Destination pointer for read
+	 * \param size Size of read, in bytes
+	 * \return Whether the read was successful (the buffer was still owned by this manager after the copy)
+	 */
+	bool Read(BufferToken const& token, void* data, size_t size);
+
 	/**
 	 *\brief Write information about the SharedMemory to a string
 	 *\return String describing current state of SharedMemory and buffers
@@ -287,6 +483,9 @@ public:
 	 * \brief Get a pointer to the current read position of the buffer
 	 * \param buffer Buffer ID of buffer
 	 * \return void* pointer to the buffer's current read position
+	 *
+	 * For a chained buffer, this points into the segment holding the read position; the data is only
+	 * contiguous up to the end of that segment (see GetBufferSegments).
 	 */
 	void* GetReadPos(int buffer);
 
@@ -304,12 +503,103 @@ public:
 	 */
 	void* GetBufferStart(int buffer);
 
+	/**
+	 * \brief Get the segments holding the data of a buffer, in order
+	 * \param buffer Buffer ID of buffer
+	 * \return The buffer itself followed by its continuation buffers, if any. Empty if the buffer is itself
+	 * a continuation buffer (its data belongs to the chain's head buffer)
+	 */
+	std::vector<BufferSegment> GetBufferSegments(int buffer);
+
+	/**
+	 * \brief Look up a sequence ID in the ordering slots of the segment
+	 * \param sequence_id Sequence ID to look up
+	 * \param buffer If not null, set to the buffer holding the event when it is Ready
+	 * \return State of the event. Always Expired if the segment does not have the OrderedDelivery flag
+	 *
+	 * The slots are indexed by sequence ID modulo the buffer count and filled by MarkBufferFull, so this is O(1).
+	 * GetBufferForReading uses them to go directly to the next event in sequence, except in destructive mode
+	 * with several readers, where events are not read in order.
+	 */
+	SequenceState GetSequenceState(size_t sequence_id, int* buffer = nullptr);
+
+	/**
+	 * \brief Find the most recently written buffer which is Full (or being read)
+	 * \return Buffer number, or -1 if there is none
+	 *
+	 * In a RingMode segment, this is O(1) unless the newest buffers are still being written. Stepping back from it
+	 * gives the older events, e.g. for a monitoring reader which wants the latest N events.
+	 */
+	int GetNewestBuffer();
+
+	/**
+	 * \brief Copy the data of a buffer without claiming it
+	 * \param buffer Buffer to copy
+	 * \param data Destination, at least BufferSize() bytes
+	 * \param sequence_id Set to the sequence ID of the copied event on success
+	 * \return Number of bytes copied, or 0 if the buffer is not Full (or being read), is chained, or was overwritten during the copy
+	 *
+	 * The buffer is not locked, so a writer may take it (e.g. in RingMode) while it is being copied. Each buffer has a
+	 * generation counter, which a writer makes odd when it takes the buffer and even again when it marks it Full;
+	 * the copy is only returned if the counter was even and did not change while copying. Readers which get 0
+	 * retry or move on to another buffer.
+	 */
+	size_t CopyBufferSnapshot(int buffer, void* data, size_t& sequence_id);
+
+	/**
+	 * \brief Keep a copy of an event in the pinned slot for a tag, replacing the event previously pinned with that tag
+	 * \param buffer Buffer holding the event, either being written by this manager or Full
+	 * \param tag Non-zero tag identifying the slot (e.g. the Fragment type of the event)
+	 * \return Whether the event was pinned. False if the segment does not have the PinnedSlots flag, all slots hold
+	 * other tags, the event is chained over several buffers, or a Full buffer was overwritten while it was copied
+	 *
+	 * Pinned events stay in the segment when their buffer is reused, so that a reader attaching later can catch up
+	 * on them (see CopyPinnedSlot) before reading live events. A pinned copy keeps the sequence ID of its buffer.
+	 */
+	bool PinBuffer(int buffer, uint32_t tag);
+
+	/**
+	 * \brief Get the number of pinned slots in the segment
+	 * \return Number of pinned slots, 0 if the segment does not have the PinnedSlots flag
+	 */
+	size_t GetPinnedSlotCount() const;
+
+	/**
+	 * \brief Copy the event in a pinned slot
+	 * \param slot Index of the slot, less than GetPinnedSlotCount()
+	 * \param data Destination, at least BufferSize() bytes
+	 * \param tag Set to the tag of the slot on success
+	 * \param sequence_id Set to the sequence ID of the pinned event on success
+	 * \return Number of bytes copied, 0 if the slot is unused
+	 *
+	 * Like CopyBufferSnapshot, this uses a generation counter and retries if the slot is replaced during the copy.
+	 */
+	size_t CopyPinnedSlot(size_t slot, void* data, uint32_t& tag, size_t& sequence_id);
+
+	/**
+	 * \brief Get the buffer epoch of the segment, which changes whenever a buffer is marked Full or Empty
+	 * \return Current buffer epoch (0 if not attached)
+	 */
+	unsigned GetBufferEpoch() const { return IsValid() ? shm_ptr_->buffer_epoch.load() : 0; }
+
+	/**
+	 * \brief Wait until the buffer epoch of the segment differs from the given value
+	 * \param epoch Epoch read (with GetBufferEpoch) before the last look at the buffers
+	 * \param timeout_us Maximum time to wait
+	 * \return Whether the epoch changed
+	 *
+	 * The wait is a futex wait on the segment, so it works across processes. Buffers which are reset because
+	 * they timed out do not change the epoch; callers which care should use a finite timeout.
+	 */
+	bool WaitForBufferChange(unsigned epoch, size_t timeout_us);
+
 	/**
 	 * \brief Detach from the Shared Memory segment, optionally throwing a cet::exception with the specified properties
 	 * \param throwException Whether to throw an exception after detaching
 	 * \param category Category for the cet::exception
 	 * \param message Message for the cet::exception
-	 * \param force Whether to mark shared memory for destruction even if not owner (i.e. from signal handler)
+	 * \param force Whether to mark shared memory for destruction even if not owner (i.e. from signal handler).
+	 * This is also the only way to remove a persistent segment
 	 */
 	void Detach(bool throwException = false, const std::string& category = "", const std::string& message = "", bool force = false);
 
@@ -353,6 +643,81 @@ public:
 	 */
 	void TouchBuffer(int buffer) { return touchBuffer_(getBufferInfo_(buffer)); }
 
+	/**
+	 * \brief Time spent in each phase of the last call to Attach
+	 */
+	struct AttachTiming
+	{
+		double segment_s{0.0};  ///< Creating or looking up the segment (shmget)
+		double map_s{0.0};      ///< Mapping the segment into the address space (shmat)
+		double init_s{0.0};     ///< Owner only: initializing the buffer descriptors
+		double wait_s{0.0};     ///< Other managers only: waiting for the owner to finish initializing the segment
+		double setup_s{0.0};    ///< Setting up local state (buffer pointers, mutexes, manager ID)
+		double total_s{0.0};    ///< Total time spent in Attach
+		int init_threads{0};    ///< Owner only: number of threads used to initialize the buffer descriptors
+	};
+
+	/**
+	 * \brief Get the time spent in each phase of the last call to Attach
+	 * \return AttachTiming structure
+	 */
+	AttachTiming GetAttachTiming() const { return attach_timing_; }
+
+	/**
+	 * \brief Set the NUMA placement policy for the whole shared memory segment
+	 * \param policy Placement policy (e.g. NumaUtils::Policy::Bind to keep the segment on the given nodes, NumaUtils::Policy::Interleave to spread it over them)
+	 * \param nodes NUMA nodes to use
+	 * \return Whether the policy was applied. Always true on a machine with a single NUMA node
+	 *
+	 * The policy applies to the segment itself, so it affects every process attached to it. Pages already
+	 * allocated are migrated to conform to the new policy if the process has CAP_SYS_NICE; otherwise only
+	 * the pages which no other process maps are moved (see NumaUtils::SetPolicy).
+	 */
+	bool SetNumaPolicy(NumaUtils::Policy policy, std::vector<int> const& nodes);
+
+	/**
+	 * \brief Set the NUMA placement policy for the data area of a range of buffers
+	 * \param buffer Buffer ID of the first buffer in the range
+	 * \param count Number of buffers in the range
+	 * \param policy Placement policy
+	 * \param nodes NUMA nodes to use
+	 * \return Whether the policy was applied. Always true on a machine with a single NUMA node, if the range holds a whole page
+	 *
+	 * Only the pages lying entirely inside the range are affected, since the pages at either end may also hold
+	 * neighbouring buffers. Returns false if the range does not contain a whole page.
+	 */
+	bool SetBufferNumaPolicy(int buffer, size_t count, NumaUtils::Policy policy, std::vector<int> const& nodes);
+
+	/**
+	 * \brief Whether the shared memory segment was created with SegmentFlags::PersistentSegment
+	 * \return True if the segment outlives its owner
+	 */
+	bool IsPersistent() const { return IsValid() && (shm_ptr_->segment_flags & PersistentSegment) != 0; }
+
+	/**
+	 * \brief Whether the last call to Attach took over an existing persistent segment instead of initializing it
+	 * \return True if this owner adopted the buffers left by a previous owner
+	 */
+	bool AdoptedSegment() const { return adopted_segment_; }
+
+	/**
+	 * \brief Get the process ID of the current owner of the shared memory segment
+	 * \return The owner's process ID, or 0 if a persistent segment currently has no owner
+	 */
+	pid_t GetOwnerPid() const { return IsValid() ? shm_ptr_->owner_pid.load() : 0; }
+
+	/**
+	 * \brief Get the SegmentFlags the shared memory segment was created with
+	 * \return Bitmask of SegmentFlags
+	 */
+	uint32_t GetSegmentFlags() const { return IsValid() ? shm_ptr_->segment_flags : 0; }
+
+	/**
+	 * \brief Whether this manager is attached to a segment in private memory of this process (see SegmentFlags::InProcess)
+	 * \return True for an in-process segment, false for a SysV shared memory segment or if not attached
+	 */
+	bool IsInProcess() const { return in_process_segment_ != nullptr; }
+
 private:
 	SharedMemoryManager(SharedMemoryManager const&) = delete;
 	SharedMemoryManager(SharedMemoryManager&&) = delete;
@@ -367,6 +732,25 @@ private:
 		std::atomic<int16_t> sem_id;
 		std::atomic<size_t> sequence_id;
 		std::atomic<uint64_t> last_touch_time;
+		std::atomic<int> chain_next;  // Next buffer of a chained event, -1 for the last (or only) buffer
+		std::atomic<int> chain_head;  // First buffer of the chain for a continuation buffer, -1 otherwise
+		std::atomic<uint32_t> generation;  // Seqlock counter, odd while a writer holds the buffer
+	};
+
+	// With OrderedDelivery, an array of buffer_count slots follows the buffer descriptors
+	struct OrderSlot
+	{
+		std::atomic<size_t> sequence_id;  // Last sequence ID recorded in this slot, 0 if none, SIZE_MAX while it is being updated
+		std::atomic<int> buffer;          // Buffer holding that event, -1 if it was skipped
+	};
+
+	// With PinnedSlots, the slot descriptors and then their data follow the buffer data
+	struct PinnedSlot
+	{
+		std::atomic<uint32_t> generation;  // Seqlock counter, odd while the slot is being rewritten
+		std::atomic<uint32_t> tag;         // 0 for an unused slot
+		std::atomic<size_t> sequence_id;
+		std::atomic<size_t> size;
 	};
 
 	struct ShmStruct
@@ -385,13 +769,28 @@ private:
 
 		std::atomic<int> next_id;
 		int rank;
-		unsigned ready_magic;
+		std::atomic<unsigned> ready_magic;  // Also used as a futex word: attaching managers wait on it until the owner sets it
+		uint32_t layout_version;            // Checked when attaching, and before a new owner adopts a persistent segment
+		uint32_t header_size;
+		uint32_t descriptor_size;
+		uint32_t segment_flags;
+		std::atomic<pid_t> owner_pid;               // 0 while a persistent segment has no owner
+		std::atomic<unsigned> owner_registrations;  // Whether the owner is counted in reader_count and/or writer_count
+
+		int numa_policy;
+		uint64_t numa_nodemask;
+
+		std::atomic<uint64_t> end_of_data_epoch;  // 0 while the segment is live, time (us) it was marked for destruction otherwise
+
+		std::atomic<unsigned> buffer_epoch;  // Futex word, incremented whenever a buffer is marked Full or Empty
+		std::atomic<int> epoch_waiters;      // Number of managers waiting on buffer_epoch, so that notifications are free when nobody waits
 	};
 
 	inline uint8_t* dataStart_() const
 	{
 		if (shm_ptr_ == nullptr) return nullptr;
-		return reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + shm_ptr_->buffer_count * sizeof(ShmBuffer);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto slots_size = (shm_ptr_->segment_flags & OrderedDelivery) != 0 ? shm_ptr_->buffer_count * sizeof(OrderSlot) : 0;
+		return reinterpret_cast<uint8_t*>(shm_ptr_ + 1) + shm_ptr_->buffer_count * sizeof(ShmBuffer) + slots_size;  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
 	}
 
 	inline uint8_t* bufferStart_(int buffer)
@@ -401,6 +800,11 @@ private:
 		return dataStart_() + buffer * shm_ptr_->buffer_size;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 	}
 
+	inline uint8_t* pinnedData_(size_t slot) const
+	{
+		return reinterpret_cast<uint8_t*>(pinned_slots_ + GetPinnedSlotCount()) + slot * shm_ptr_->buffer_size;  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
 	inline ShmBuffer* getBufferInfo_(int buffer)
 	{
 		if (shm_ptr_ == nullptr) return nullptr;
@@ -409,16 +813,49 @@ private:
 			Detach(true, "ArgumentOutOfRange", "The specified buffer does not exist!");
 		return buffer_ptrs_[buffer];
 	}
+	inline bool needsChain_(ShmBuffer* buffer, size_t size) const
+	{
+		return (shm_ptr_->segment_flags & ChainedBuffers) != 0 && (buffer->chain_next != -1 || buffer->writePos + size > shm_ptr_->buffer_size);
+	}
+
+	bool attachInProcess_(size_t size, bool create, size_t timeout_us);
+	void detachInProcess_(bool remove);
+	void mapDescriptors_();
+	void initBufferDescriptors_();
+	void recordSequence_(size_t sequence_id, int buffer);
+	bool claimForReading_(int buffer_num, ShmBuffer* buffer_ptr, BufferSemaphoreFlags sem, int16_t sem_id, uint64_t seqID);
+	int nextInOrder_();
+	int getRingBufferForWriting_();
+	uint32_t openGeneration_(ShmBuffer* buf);
+	void closeGeneration_(ShmBuffer* buf);
+	void closeGeneration_(ShmBuffer* buf, uint32_t opened);
+	void notifyBufferChange_();
+	ShmBuffer* tokenBuffer_(BufferToken const& token, BufferSemaphoreFlags flags);
+	size_t write_(int buffer, ShmBuffer* shmBuf, void* data, size_t size);
+	void read_(int buffer, ShmBuffer* shmBuf, void* data, size_t size);
+	bool layoutMatches_(bool adopting) const;
+	bool acquireOwnership_(size_t timeout_us);
+	void abandonAttach_();
+	void adoptBuffers_();
 	bool checkBuffer_(ShmBuffer* buffer, BufferSemaphoreFlags flags, bool exceptions = true);
 	void touchBuffer_(ShmBuffer* buffer);
+	size_t chainDataSize_(ShmBuffer* head);
+	void setChainState_(ShmBuffer* head, BufferSemaphoreFlags sem, int16_t sem_id);
+	void releaseChain_(ShmBuffer* head);
+	std::vector<int> claimContinuations_(int head_buffer, size_t count);
+	size_t writeChained_(int buffer, void* data, size_t size);
+	void readChained_(int buffer, void* data, size_t size);
 
 	ShmStruct requested_shm_parameters_;
 
 	int shm_segment_id_;
+	detail::InProcessSegment* in_process_segment_{nullptr};
 	ShmStruct* shm_ptr_;
 	uint32_t shm_key_;
 	int manager_id_;
 	std::vector<ShmBuffer*> buffer_ptrs_;
+	OrderSlot* order_slots_{nullptr};
+	PinnedSlot* pinned_slots_{nullptr};
 	mutable std::vector<std::mutex> buffer_mutexes_;
 	mutable std::mutex search_mutex_;
 
@@ -426,6 +863,11 @@ private:
 	bool registered_reader_{false};
 	bool registered_writer_{false};
 	size_t min_write_size_;
+
+	AttachTiming attach_timing_;
+	bool adopted_segment_{false};
+	uint64_t end_of_data_check_interval_us_{100000};
+	mutable std::atomic<uint64_t> next_end_of_data_check_us_{0};
 };
 
 }  // namespace artdaq
@@ -1,4 +1,5 @@
 #include "artdaq-core/Core/StatisticsCollection.hh"
+#include "artdaq-core/Core/ThreadPolicy.hh"
 #include <iostream>
 #include <utility>
 
@@ -14,6 +15,7 @@ StatisticsCollection& StatisticsCollection::getInstance()
 StatisticsCollection::StatisticsCollection()
 {
 	thread_stop_requested_ = false;
+	ThreadPolicy::getInstance();  // Construct the ThreadPolicy singleton first, so that it outlives the calculation thread
 	try
 	{
 		calculation_thread_ = std::make_unique<boost::thread>(boost::bind(&StatisticsCollection::run, this));
@@ -88,6 +90,7 @@ void StatisticsCollection::requestStop()
 
 void StatisticsCollection::run()
 {
+	ThreadPolicy::getInstance().registerCurrentThread("StatColl");
 	while (!thread_stop_requested_)
 	{
 		auto useconds = static_cast<uint64_t>(calculationInterval_ * 1000000);
@@ -103,5 +106,6 @@ void StatisticsCollection::run()
 			}
 		}
 	}
+	ThreadPolicy::getInstance().unregisterCurrentThread();
 }
 }  // namespace artdaq
@@ -0,0 +1,193 @@
+#define TRACE_NAME "StreamingCopy"
+#include "artdaq-core/Core/StreamingCopy.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "TRACE/tracemf.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define STREAMING_COPY_X86 1
+#endif
+
+// Below this size, the destination stays in the cache anyway, and memcpy is faster
+#define DEFAULT_STREAMING_COPY_THRESHOLD (1024 * 1024)
+
+namespace {
+#ifdef STREAMING_COPY_X86
+// Copy the unaligned head with memcpy, so that all streaming stores are aligned, then the tail
+__attribute__((target("avx2"))) void CopyAVX2(uint8_t* dest, uint8_t const* src, size_t size)
+{
+	auto head = std::min<size_t>((32 - (reinterpret_cast<uintptr_t>(dest) & 31)) & 31, size);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	memcpy(dest, src, head);
+	dest += head;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	src += head;   // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	size -= head;
+
+	for (; size >= 128; size -= 128, dest += 128, src += 128)  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	{
+		auto s = reinterpret_cast<__m256i const*>(src);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto d = reinterpret_cast<__m256i*>(dest);       // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto v0 = _mm256_loadu_si256(s);
+		auto v1 = _mm256_loadu_si256(s + 1);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto v2 = _mm256_loadu_si256(s + 2);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto v3 = _mm256_loadu_si256(s + 3);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		_mm256_stream_si256(d, v0);
+		_mm256_stream_si256(d + 1, v1);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		_mm256_stream_si256(d + 2, v2);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		_mm256_stream_si256(d + 3, v3);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	// Streaming stores are weakly ordered: make them visible before the buffer is handed to another process
+	_mm_sfence();
+	memcpy(dest, src, size);
+}
+
+__attribute__((target("avx512f"))) void CopyAVX512(uint8_t* dest, uint8_t const* src, size_t size)
+{
+	auto head = std::min<size_t>((64 - (reinterpret_cast<uintptr_t>(dest) & 63)) & 63, size);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	memcpy(dest, src, head);
+	dest += head;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	src += head;   // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	size -= head;
+
+	for (; size >= 256; size -= 256, dest += 256, src += 256)  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	{
+		auto v0 = _mm512_loadu_si512(src);
+		auto v1 = _mm512_loadu_si512(src + 64);   // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto v2 = _mm512_loadu_si512(src + 128);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto v3 = _mm512_loadu_si512(src + 192);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		_mm512_stream_si512(reinterpret_cast<__m512i*>(dest), v0);        // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		_mm512_stream_si512(reinterpret_cast<__m512i*>(dest + 64), v1);   // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		_mm512_stream_si512(reinterpret_cast<__m512i*>(dest + 128), v2);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		_mm512_stream_si512(reinterpret_cast<__m512i*>(dest + 192), v3);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	_mm_sfence();
+	memcpy(dest, src, size);
+}
+#endif
+
+artdaq::StreamingCopy::Kernel DetectKernel()
+{
+	auto best = artdaq::StreamingCopy::Kernel::Scalar;
+	if (artdaq::StreamingCopy::IsSupported(artdaq::StreamingCopy::Kernel::AVX512))
+	{
+		best = artdaq::StreamingCopy::Kernel::AVX512;
+	}
+	else if (artdaq::StreamingCopy::IsSupported(artdaq::StreamingCopy::Kernel::AVX2))
+	{
+		best = artdaq::StreamingCopy::Kernel::AVX2;
+	}
+
+	auto env = getenv("ARTDAQ_STREAMING_COPY");
+	if (env != nullptr)
+	{
+		auto limit = best;
+		if (strcmp(env, "scalar") == 0)
+		{
+			limit = artdaq::StreamingCopy::Kernel::Scalar;
+		}
+		else if (strcmp(env, "avx2") == 0)
+		{
+			limit = artdaq::StreamingCopy::Kernel::AVX2;
+		}
+		else if (strcmp(env, "avx512") != 0)
+		{
+			TLOG(TLVL_WARNING) << "Unknown ARTDAQ_STREAMING_COPY value \"" << env << "\", ignoring it";
+		}
+		if (limit < best)
+		{
+			best = limit;
+		}
+	}
+	TLOG(TLVL_DEBUG) << "Using " << artdaq::StreamingCopy::KernelToString(best) << " kernel for streaming copies";
+	return best;
+}
+
+std::atomic<size_t>& ThresholdStorage()
+{
+	static std::atomic<size_t> threshold([] {
+		auto env = getenv("ARTDAQ_STREAMING_COPY_THRESHOLD");
+		return env != nullptr ? static_cast<size_t>(strtoull(env, nullptr, 0)) : static_cast<size_t>(DEFAULT_STREAMING_COPY_THRESHOLD);
+	}());
+	return threshold;
+}
+}  // namespace
+
+std::string artdaq::StreamingCopy::KernelToString(Kernel kernel)
+{
+	switch (kernel)
+	{
+		case Kernel::Scalar:
+			return "Scalar";
+		case Kernel::AVX2:
+			return "AVX2";
+		case Kernel::AVX512:
+			return "AVX512";
+	}
+	return "Unknown";
+}
+
+bool artdaq::StreamingCopy::IsSupported(Kernel kernel)
+{
+	switch (kernel)
+	{
+		case Kernel::Scalar:
+			return true;
+#ifdef STREAMING_COPY_X86
+		// __builtin_cpu_supports also checks that the operating system saves the vector registers
+		case Kernel::AVX2:
+			return __builtin_cpu_supports("avx2");
+		case Kernel::AVX512:
+			return __builtin_cpu_supports("avx512f");
+#endif
+		default:
+			return false;
+	}
+}
+
+artdaq::StreamingCopy::Kernel artdaq::StreamingCopy::SelectedKernel()
+{
+	static Kernel const kernel = DetectKernel();
+	return kernel;
+}
+
+size_t artdaq::StreamingCopy::Threshold()
+{
+	return ThresholdStorage().load(std::memory_order_relaxed);
+}
+
+void artdaq::StreamingCopy::SetThreshold(size_t bytes)
+{
+	ThresholdStorage().store(bytes, std::memory_order_relaxed);
+}
+
+void artdaq::StreamingCopy::Copy(void* dest, void const* src, size_t size)
+{
+	if (size < Threshold())
+	{
+		memcpy(dest, src, size);
+		return;
+	}
+	CopyWith(SelectedKernel(), dest, src, size);
+}
+
+void artdaq::StreamingCopy::CopyWith(Kernel kernel, void* dest, void const* src, size_t size)
+{
+#ifdef STREAMING_COPY_X86
+	if (kernel == Kernel::AVX512 && IsSupported(Kernel::AVX512))
+	{
+		CopyAVX512(static_cast<uint8_t*>(dest), static_cast<uint8_t const*>(src), size);
+		return;
+	}
+	if (kernel == Kernel::AVX2 && IsSupported(Kernel::AVX2))
+	{
+		CopyAVX2(static_cast<uint8_t*>(dest), static_cast<uint8_t const*>(src), size);
+		return;
+	}
+#endif
+	memcpy(dest, src, size);
+}
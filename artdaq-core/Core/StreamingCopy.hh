@@ -0,0 +1,84 @@
+#ifndef artdaq_core_Core_StreamingCopy_hh
+#define artdaq_core_Core_StreamingCopy_hh 1
+
+#include <cstddef>
+#include <string>
+
+namespace artdaq {
+/**
+ * \brief Namespace to hold copy routines for large transfers into shared memory
+ *
+ * Large copies are done with non-temporal (streaming) stores, which write the destination without
+ * reading it into the cache first, and without evicting the working set of the copying thread. This
+ * is the right choice when the data is consumed by another process or much later (e.g. a Fragment
+ * written into shared memory), and the wrong one for small copies, which stay in the cache anyway.
+ * Copy therefore uses memcpy below a size threshold. Reads out of shared memory use plain memcpy,
+ * since the reader consumes the data right away.
+ *
+ * The fastest kernel supported by the CPU is selected at run time. The ARTDAQ_STREAMING_COPY
+ * environment variable ("scalar", "avx2" or "avx512") restricts the choice, and
+ * ARTDAQ_STREAMING_COPY_THRESHOLD sets the initial threshold, in bytes.
+ */
+namespace StreamingCopy {
+/**
+ * \brief Copy kernels, in order of preference
+ */
+enum class Kernel : int
+{
+	Scalar,  ///< Plain memcpy, available everywhere
+	AVX2,    ///< 32-byte non-temporal stores
+	AVX512,  ///< 64-byte non-temporal stores
+};
+
+/**
+ * \brief Convert a Kernel to its string representation
+ * \param kernel Kernel to convert
+ * \return Name of the kernel
+ */
+std::string KernelToString(Kernel kernel);
+
+/**
+ * \brief Whether the given kernel can be used on this CPU
+ * \param kernel Kernel to check
+ * \return True if the CPU (and operating system) support the instructions used by the kernel
+ */
+bool IsSupported(Kernel kernel);
+
+/**
+ * \brief Get the kernel used by Copy for transfers at or above the threshold
+ * \return The best supported kernel, limited by ARTDAQ_STREAMING_COPY if it is set
+ */
+Kernel SelectedKernel();
+
+/**
+ * \brief Get the size at or above which Copy uses the streaming kernel
+ * \return Threshold, in bytes
+ */
+size_t Threshold();
+
+/**
+ * \brief Set the size at or above which Copy uses the streaming kernel
+ * \param bytes Threshold, in bytes. SIZE_MAX disables streaming copies
+ */
+void SetThreshold(size_t bytes);
+
+/**
+ * \brief Copy size bytes from src to dest, using the streaming kernel for large copies
+ * \param dest Destination
+ * \param src Source. Must not overlap dest
+ * \param size Number of bytes to copy
+ */
+void Copy(void* dest, void const* src, size_t size);
+
+/**
+ * \brief Copy size bytes from src to dest with the given kernel, regardless of size
+ * \param kernel Kernel to use. Unsupported kernels fall back to Kernel::Scalar
+ * \param dest Destination
+ * \param src Source. Must not overlap dest
+ * \param size Number of bytes to copy
+ */
+void CopyWith(Kernel kernel, void* dest, void const* src, size_t size);
+}  // namespace StreamingCopy
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_StreamingCopy_hh
@@ -0,0 +1,125 @@
+#define TRACE_NAME "StripedSharedMemoryManager"
+#include "artdaq-core/Core/StripedSharedMemoryManager.hh"
+
+#include <unistd.h>
+#include <sstream>
+
+#include "TRACE/tracemf.h"
+#include "cetlib_except/exception.h"
+
+namespace {
+// Index of the calling thread among the threads which have written through any StripedSharedMemoryManager.
+// The process ID is read when the thread first asks, so that processes forked after the first write do not all start on the same stripe.
+size_t ThreadIndex()
+{
+	static std::atomic<size_t> next_index{0};
+	thread_local size_t const index = static_cast<size_t>(getpid()) + next_index++;
+	return index;
+}
+}  // namespace
+
+artdaq::StripedSharedMemoryManager::StripedSharedMemoryManager(std::vector<uint32_t> const& stripe_keys, size_t buffer_count, size_t buffer_size, uint64_t buffer_timeout_us,
+                                                               bool destructive_read_mode, uint32_t segment_flags)
+{
+	if (stripe_keys.empty())
+	{
+		throw cet::exception("StripedSharedMemoryManager") << "At least one stripe key must be given";  // NOLINT(cert-err60-cpp)
+	}
+	stripes_.reserve(stripe_keys.size());
+	for (auto key : stripe_keys)
+	{
+		stripes_.emplace_back(new SharedMemoryManager(key, buffer_count, buffer_size, buffer_timeout_us, destructive_read_mode, segment_flags));
+	}
+	TLOG(TLVL_DEBUG) << "Attached to " << stripe_keys.size() << " stripes, the first one with key " << std::hex << std::showbase << stripe_keys.front();
+}
+
+bool artdaq::StripedSharedMemoryManager::IsValid() const
+{
+	for (auto const& stripe : stripes_)
+	{
+		if (!stripe->IsValid())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t artdaq::StripedSharedMemoryManager::HomeStripe() const
+{
+	return ThreadIndex() % stripes_.size();
+}
+
+artdaq::StripedSharedMemoryManager::StripedBuffer artdaq::StripedSharedMemoryManager::GetBufferForWriting(bool overwrite)
+{
+	// Only look at the other stripes once the home stripe is out of buffers, so that writers stay apart
+	auto home = HomeStripe();
+	for (size_t ii = 0; ii < stripes_.size(); ++ii)
+	{
+		auto stripe = (home + ii) % stripes_.size();
+		if (!stripes_[stripe]->IsValid())
+		{
+			continue;
+		}
+		auto buffer = stripes_[stripe]->GetBufferForWriting(overwrite);
+		if (buffer != -1)
+		{
+			TLOG(TLVL_DEBUG + 35) << "GetBufferForWriting: Returning buffer " << buffer << " of stripe " << stripe << " (home stripe " << home << ")";
+			return StripedBuffer{static_cast<int>(stripe), buffer};
+		}
+	}
+	return StripedBuffer();
+}
+
+artdaq::StripedSharedMemoryManager::StripedBuffer artdaq::StripedSharedMemoryManager::GetBufferForReading()
+{
+	// Start after the stripe of the last event, so that a busy stripe does not starve the others
+	auto first = next_read_stripe_.load();
+	for (size_t ii = 0; ii < stripes_.size(); ++ii)
+	{
+		auto stripe = (first + ii) % stripes_.size();
+		if (!stripes_[stripe]->IsValid())
+		{
+			continue;
+		}
+		auto buffer = stripes_[stripe]->GetBufferForReading();
+		if (buffer != -1)
+		{
+			next_read_stripe_ = stripe + 1;
+			TLOG(TLVL_DEBUG + 35) << "GetBufferForReading: Returning buffer " << buffer << " of stripe " << stripe;
+			return StripedBuffer{static_cast<int>(stripe), buffer};
+		}
+	}
+	return StripedBuffer();
+}
+
+size_t artdaq::StripedSharedMemoryManager::ReadReadyCount()
+{
+	size_t count = 0;
+	for (auto& stripe : stripes_)
+	{
+		count += stripe->ReadReadyCount();
+	}
+	return count;
+}
+
+size_t artdaq::StripedSharedMemoryManager::WriteReadyCount(bool overwrite)
+{
+	size_t count = 0;
+	for (auto& stripe : stripes_)
+	{
+		count += stripe->WriteReadyCount(overwrite);
+	}
+	return count;
+}
+
+std::string artdaq::StripedSharedMemoryManager::toString()
+{
+	std::ostringstream ostr;
+	for (size_t ii = 0; ii < stripes_.size(); ++ii)
+	{
+		ostr << "Stripe " << ii << " (key " << std::hex << std::showbase << stripes_[ii]->GetKey() << std::dec << "):" << std::endl
+		     << stripes_[ii]->toString() << std::endl;
+	}
+	return ostr.str();
+}
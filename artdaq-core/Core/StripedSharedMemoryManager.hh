@@ -0,0 +1,171 @@
+#ifndef artdaq_core_Core_StripedSharedMemoryManager_hh
+#define artdaq_core_Core_StripedSharedMemoryManager_hh 1
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+
+namespace artdaq {
+/**
+ * \brief A set of Shared Memory segments ("stripes") used as one, so that many writers do not contend on a single segment
+ *
+ * Each stripe is a complete SharedMemoryManager segment, with its own writer position, its own sequence ID counter and
+ * its own search mutex. The stripe keys are given explicitly, like any other secondary key (e.g. the broadcast key),
+ * since keys next to the data key are often taken already. Each writing thread has a home stripe, and only moves to
+ * another stripe when its home stripe has no free buffer, so writers on different stripes never touch the same
+ * counters. Readers merge the stripes by taking events from them in turn.
+ *
+ * Striping gives up event ordering across the stripes. There is no sequence ID shared by the stripes,
+ * since a common counter is exactly the contention striping removes. Each stripe numbers its own events from
+ * the start, so the same sequence ID appears in every stripe, and an event is only identified by its stripe
+ * together with its sequence ID. Readers get events in sequence order within a stripe. Events from different
+ * stripes come in whatever order the round-robin reads find them, not in the order they were written. Readers
+ * which need a global order must sort on a field of the data itself (e.g. the Fragment sequence ID or timestamp).
+ */
+class StripedSharedMemoryManager
+{
+public:
+	/**
+	 * \brief A buffer in one of the stripes
+	 */
+	struct StripedBuffer
+	{
+		int stripe{-1};  ///< Index of the stripe
+		int buffer{-1};  ///< Buffer number within the stripe
+
+		/**
+		 * \brief Whether this refers to a buffer
+		 * \return True if both the stripe and the buffer number are set
+		 */
+		bool valid() const { return stripe >= 0 && buffer >= 0; }
+	};
+
+	/**
+	 * \brief StripedSharedMemoryManager Constructor
+	 * \param stripe_keys Keys of the stripes' Shared Memory segments, one per stripe
+	 * \param buffer_count Number of buffers in each stripe (0 to attach to existing stripes)
+	 * \param buffer_size Size of each buffer
+	 * \param buffer_timeout_us Maximum amount of time a buffer may be locked, see SharedMemoryManager
+	 * \param destructive_read_mode Whether a read operation empties the buffer
+	 * \param segment_flags Bitmask of SharedMemoryManager::SegmentFlags, applied to every stripe
+	 * \exception cet::exception if no stripe keys are given
+	 */
+	StripedSharedMemoryManager(std::vector<uint32_t> const& stripe_keys, size_t buffer_count = 0, size_t buffer_size = 0, uint64_t buffer_timeout_us = 100 * 1000000,
+	                           bool destructive_read_mode = true, uint32_t segment_flags = 0);
+
+	/**
+	 * \brief StripedSharedMemoryManager Destructor. Detaches from all stripes
+	 */
+	virtual ~StripedSharedMemoryManager() = default;
+	StripedSharedMemoryManager(StripedSharedMemoryManager const&) = delete;             ///< Copy Constructor is deleted
+	StripedSharedMemoryManager(StripedSharedMemoryManager&&) = delete;                  ///< Move Constructor is deleted
+	StripedSharedMemoryManager& operator=(StripedSharedMemoryManager const&) = delete;  ///< Copy Assignment Operator is deleted
+	StripedSharedMemoryManager& operator=(StripedSharedMemoryManager&&) = delete;       ///< Move Assignment Operator is deleted
+
+	/**
+	 * \brief Whether all stripes are attached
+	 * \return True if every stripe is a valid Shared Memory segment
+	 */
+	bool IsValid() const;
+
+	/**
+	 * \brief Get the number of stripes
+	 * \return The number of stripes
+	 */
+	size_t StripeCount() const { return stripes_.size(); }
+
+	/**
+	 * \brief Access the SharedMemoryManager of a stripe, e.g. for per-stripe sequence IDs
+	 * \param stripe Index of the stripe
+	 *
+	 * Sequence IDs are only unique within a stripe; the same ID is used in every stripe (see the class description).
+	 * \return Reference to the stripe's SharedMemoryManager
+	 */
+	SharedMemoryManager& Stripe(size_t stripe) { return *stripes_.at(stripe); }
+
+	/**
+	 * \brief Get the stripe the calling thread writes to first
+	 * \return Index of the home stripe
+	 *
+	 * Threads are assigned to stripes in turn, as they first write, starting from an offset based on the ID of the
+	 * writing process.
+	 */
+	size_t HomeStripe() const;
+
+	/**
+	 * \brief Find a buffer for writing, in the calling thread's home stripe if possible
+	 * \param overwrite Whether Full buffers may be overwritten (see SharedMemoryManager::GetBufferForWriting)
+	 * \return The buffer reserved for writing, or an invalid StripedBuffer if no stripe has one
+	 */
+	StripedBuffer GetBufferForWriting(bool overwrite);
+
+	/**
+	 * \brief Find a buffer for reading, taking the stripes in turn
+	 * \return The buffer reserved for reading, or an invalid StripedBuffer if no stripe has a Full buffer
+	 *
+	 * Buffers come in sequence order within each stripe, but not in write order across stripes: the events of
+	 * the stripes are interleaved round-robin, not merged by sequence ID or time.
+	 */
+	StripedBuffer GetBufferForReading();
+
+	/**
+	 * \brief Write data into a buffer, see SharedMemoryManager::Write
+	 * \param buffer Buffer to write to
+	 * \param data Pointer to the data
+	 * \param size Size of the data
+	 * \return The number of bytes written
+	 */
+	size_t Write(StripedBuffer const& buffer, void* data, size_t size) { return Stripe(buffer.stripe).Write(buffer.buffer, data, size); }
+
+	/**
+	 * \brief Read data from a buffer, see SharedMemoryManager::Read
+	 * \param buffer Buffer to read from
+	 * \param data Destination of the data
+	 * \param size Size of the data
+	 * \return Whether the read was successful
+	 */
+	bool Read(StripedBuffer const& buffer, void* data, size_t size) { return Stripe(buffer.stripe).Read(buffer.buffer, data, size); }
+
+	/**
+	 * \brief Release a buffer from a writer, marking it Full and ready for a reader
+	 * \param buffer Buffer to release
+	 * \param destination If desired, a destination manager ID (within the stripe) may be specified
+	 */
+	void MarkBufferFull(StripedBuffer const& buffer, int destination = -1) { Stripe(buffer.stripe).MarkBufferFull(buffer.buffer, destination); }
+
+	/**
+	 * \brief Release a buffer from a reader, marking it Empty and ready to accept more data
+	 * \param buffer Buffer to release
+	 * \param force Force buffer to Empty state (only if the stripe's manager ID is 0)
+	 */
+	void MarkBufferEmpty(StripedBuffer const& buffer, bool force = false) { Stripe(buffer.stripe).MarkBufferEmpty(buffer.buffer, force); }
+
+	/**
+	 * \brief Count the buffers ready for reading, in all stripes
+	 * \return The number of buffers ready for reading
+	 */
+	size_t ReadReadyCount();
+
+	/**
+	 * \brief Count the buffers ready for writing, in all stripes
+	 * \param overwrite Whether Full buffers count as ready for writing
+	 * \return The number of buffers ready for writing
+	 */
+	size_t WriteReadyCount(bool overwrite);
+
+	/**
+	 * \brief Write information about the stripes to a string
+	 * \return String with the state of every stripe
+	 */
+	std::string toString();
+
+private:
+	std::vector<std::unique_ptr<SharedMemoryManager>> stripes_;
+	std::atomic<size_t> next_read_stripe_{0};
+};
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_StripedSharedMemoryManager_hh
@@ -0,0 +1,229 @@
+#define TRACE_NAME "ThreadPolicy"
+#include "artdaq-core/Core/ThreadPolicy.hh"
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include "TRACE/tracemf.h"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+namespace {
+pid_t current_tid()
+{
+	return static_cast<pid_t>(syscall(SYS_gettid));
+}
+}  // namespace
+
+artdaq::ThreadPolicy& artdaq::ThreadPolicy::getInstance()
+{
+	static ThreadPolicy singletonInstance;
+	return singletonInstance;
+}
+
+void artdaq::ThreadPolicy::configure(fhicl::ParameterSet const& pset)
+{
+	std::map<std::string, Policy> policies;
+	for (auto const& role : pset.get_pset_names())
+	{
+		auto role_pset = pset.get<fhicl::ParameterSet>(role);
+		Policy policy;
+		policy.cpus = role_pset.get<std::vector<size_t>>("cpus", std::vector<size_t>());
+		if (role_pset.has_key("scheduler"))
+		{
+			policy.scheduler = SchedulerFromString(role_pset.get<std::string>("scheduler"));
+		}
+		policy.priority = role_pset.get<int>("priority", 0);
+		validate_(role, policy);
+		policies[role] = policy;
+	}
+
+	std::lock_guard<std::mutex> lk(mutex_);
+	for (auto const& policy : policies)
+	{
+		TLOG(TLVL_INFO) << "Thread role " << policy.first << ": scheduler=" << SchedulerToString(policy.second.scheduler) << ", priority=" << policy.second.priority << ", cpus=" << policy.second.cpus.size();
+		policies_[policy.first] = policy.second;
+		reapply_(policy.first);
+	}
+}
+
+void artdaq::ThreadPolicy::setPolicy(std::string const& role, Policy const& policy)
+{
+	validate_(role, policy);
+	std::lock_guard<std::mutex> lk(mutex_);
+	policies_[role] = policy;
+	reapply_(role);
+}
+
+bool artdaq::ThreadPolicy::hasPolicy(std::string const& role) const
+{
+	std::lock_guard<std::mutex> lk(mutex_);
+	return policies_.count(role) != 0u;
+}
+
+artdaq::ThreadPolicy::Policy artdaq::ThreadPolicy::getPolicy(std::string const& role) const
+{
+	std::lock_guard<std::mutex> lk(mutex_);
+	auto it = policies_.find(role);
+	if (it == policies_.end()) return Policy();
+	return it->second;
+}
+
+bool artdaq::ThreadPolicy::registerCurrentThread(std::string const& role)
+{
+	auto tid = current_tid();
+	std::lock_guard<std::mutex> lk(mutex_);
+	threads_[tid] = role;
+
+	auto it = policies_.find(role);
+	if (it == policies_.end())
+	{
+		TLOG(TLVL_DEBUG + 32) << "Thread " << tid << " registered with role " << role << ", which has no policy";
+		return true;
+	}
+	TLOG(TLVL_DEBUG + 32) << "Thread " << tid << " registered with role " << role << ", applying policy";
+	return apply(it->second, tid);
+}
+
+void artdaq::ThreadPolicy::unregisterCurrentThread()
+{
+	std::lock_guard<std::mutex> lk(mutex_);
+	threads_.erase(current_tid());
+}
+
+bool artdaq::ThreadPolicy::apply(Policy const& policy, pid_t tid)
+{
+	bool success = true;
+	if (!policy.cpus.empty())
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (auto cpu : policy.cpus)
+		{
+			CPU_SET(cpu, &cpus);
+		}
+		if (sched_setaffinity(tid, sizeof(cpus), &cpus) != 0)
+		{
+			TLOG(TLVL_WARNING) << "Could not set CPU affinity of thread " << tid << ": " << strerror(errno);
+			success = false;
+		}
+	}
+
+	// A policy which only places the thread must not reset a real-time scheduler set elsewhere
+	if (policy.scheduler == KeepScheduler)
+	{
+		return success;
+	}
+
+	sched_param param{};
+	param.sched_priority = (policy.scheduler == SCHED_FIFO || policy.scheduler == SCHED_RR) ? policy.priority : 0;
+	if (sched_setscheduler(tid, policy.scheduler, &param) != 0)
+	{
+		TLOG(TLVL_WARNING) << "Could not set scheduler of thread " << tid << " to " << SchedulerToString(policy.scheduler) << " (priority " << param.sched_priority << "): " << strerror(errno);
+		success = false;
+	}
+	return success;
+}
+
+int artdaq::ThreadPolicy::SchedulerFromString(std::string const& name)
+{
+	if (name == "other") return SCHED_OTHER;
+	if (name == "batch") return SCHED_BATCH;
+	if (name == "idle") return SCHED_IDLE;
+	if (name == "fifo") return SCHED_FIFO;
+	if (name == "rr") return SCHED_RR;
+	throw cet::exception("ThreadPolicy") << "Unknown scheduler \"" << name << "\", expected one of other, batch, idle, fifo, rr";  // NOLINT(cert-err60-cpp)
+}
+
+std::string artdaq::ThreadPolicy::SchedulerToString(int scheduler)
+{
+	switch (scheduler)
+	{
+		case SCHED_OTHER:
+			return "other";
+		case SCHED_BATCH:
+			return "batch";
+		case SCHED_IDLE:
+			return "idle";
+		case SCHED_FIFO:
+			return "fifo";
+		case SCHED_RR:
+			return "rr";
+		case KeepScheduler:
+			return "unchanged";
+	}
+	return "unknown";
+}
+
+std::string artdaq::ThreadPolicy::toString() const
+{
+	std::lock_guard<std::mutex> lk(mutex_);
+	std::ostringstream ostr;
+	for (auto const& policy : policies_)
+	{
+		ostr << "Role " << policy.first << ": scheduler=" << SchedulerToString(policy.second.scheduler)
+		     << ", priority=" << policy.second.priority << ", cpus=[";
+		for (size_t ii = 0; ii < policy.second.cpus.size(); ++ii)
+		{
+			ostr << (ii > 0 ? "," : "") << policy.second.cpus[ii];
+		}
+		ostr << "]" << std::endl;
+	}
+	for (auto const& thread : threads_)
+	{
+		ostr << "Thread " << thread.first << ": role " << thread.second << std::endl;
+	}
+	return ostr.str();
+}
+
+void artdaq::ThreadPolicy::validate_(std::string const& role, Policy const& policy)
+{
+	for (auto cpu : policy.cpus)
+	{
+		if (cpu >= CPU_SETSIZE)
+		{
+			throw cet::exception("ThreadPolicy") << "Thread role " << role << ": CPU " << cpu << " is out of range (CPU_SETSIZE=" << CPU_SETSIZE << ")";  // NOLINT(cert-err60-cpp)
+		}
+	}
+
+	if (policy.scheduler == KeepScheduler)
+	{
+		return;
+	}
+
+	auto min = sched_get_priority_min(policy.scheduler);
+	auto max = sched_get_priority_max(policy.scheduler);
+	if (min == -1 || max == -1)
+	{
+		throw cet::exception("ThreadPolicy") << "Thread role " << role << ": invalid scheduler " << policy.scheduler;  // NOLINT(cert-err60-cpp)
+	}
+	if ((policy.scheduler == SCHED_FIFO || policy.scheduler == SCHED_RR) && (policy.priority < min || policy.priority > max))
+	{
+		throw cet::exception("ThreadPolicy") << "Thread role " << role << ": priority " << policy.priority << " is outside of the range [" << min << ", " << max << "] for scheduler " << SchedulerToString(policy.scheduler);  // NOLINT(cert-err60-cpp)
+	}
+}
+
+void artdaq::ThreadPolicy::reapply_(std::string const& role)
+{
+	auto policy = policies_.at(role);
+	for (auto it = threads_.begin(); it != threads_.end();)
+	{
+		if (it->second != role)
+		{
+			++it;
+			continue;
+		}
+		if (syscall(SYS_tgkill, getpid(), it->first, 0) != 0 && errno == ESRCH)
+		{
+			TLOG(TLVL_WARNING) << "Thread " << it->first << " (role " << role << ") no longer exists, removing it";
+			it = threads_.erase(it);
+			continue;
+		}
+		apply(policy, it->first);
+		++it;
+	}
+}
@@ -0,0 +1,142 @@
+#ifndef artdaq_core_Core_ThreadPolicy_hh
+#define artdaq_core_Core_ThreadPolicy_hh 1
+
+#include <sys/types.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fhicl {
+class ParameterSet;
+}
+
+namespace artdaq {
+/**
+ * \brief The ThreadPolicy singleton assigns CPU affinity, scheduling class and priority to named thread roles
+ *
+ * Thread roles (e.g. "StatColl", "generator", "reader") are configured from a FHiCL table, where each
+ * key is a role name and each value is a table with the following optional parameters:
+ *
+ *     thread_policy: {
+ *       StatColl:  { cpus: [0, 1]  scheduler: "other" }
+ *       generator: { cpus: [4, 5]  scheduler: "fifo"  priority: 50 }
+ *     }
+ *
+ * cpus: List of CPUs the thread may run on (default: leave affinity unchanged)
+ * scheduler: One of "other", "batch", "idle", "fifo" or "rr" (default: leave the scheduler and priority unchanged)
+ * priority: Real-time priority for "fifo" and "rr", ignored otherwise (default: 0)
+ *
+ * Threads register themselves under a role with registerCurrentThread(). The policy for that role is applied
+ * immediately if one is configured, and is re-applied whenever configure() is called later, so threads started
+ * before the configuration is known (such as the StatisticsCollection thread) pick it up as well. A thread must
+ * call unregisterCurrentThread() before it exits.
+ */
+class ThreadPolicy
+{
+public:
+	static constexpr int KeepScheduler = -1;  ///< Policy::scheduler value which leaves the scheduler and priority of the thread unchanged
+
+	/**
+	 * \brief The placement and scheduling policy for one thread role
+	 */
+	struct Policy
+	{
+		std::vector<size_t> cpus;        ///< CPUs the thread may run on. Empty means leave the affinity unchanged
+		int scheduler{KeepScheduler};  ///< Scheduling class (SCHED_OTHER, SCHED_FIFO, ...). KeepScheduler means leave it unchanged
+		int priority{0};                 ///< Static priority, only meaningful for SCHED_FIFO and SCHED_RR
+	};
+
+	/**
+	 * \brief Returns the singleton instance of the ThreadPolicy
+	 * \return ThreadPolicy instance
+	 */
+	static ThreadPolicy& getInstance();
+
+	/**
+	 * \brief Read thread role policies from a FHiCL table, and re-apply them to all registered threads
+	 * \param pset ParameterSet containing one table per thread role
+	 * \exception cet::exception if a policy is malformed (unknown scheduler, CPU or priority out of range)
+	 */
+	void configure(fhicl::ParameterSet const& pset);
+
+	/**
+	 * \brief Set the policy for a thread role, and re-apply it to registered threads with that role
+	 * \param role Name of the thread role
+	 * \param policy Policy to use for threads with this role
+	 * \exception cet::exception if the policy is malformed
+	 */
+	void setPolicy(std::string const& role, Policy const& policy);
+
+	/**
+	 * \brief Whether a policy is configured for the given role
+	 * \param role Name of the thread role
+	 * \return True if a policy has been configured for role
+	 */
+	bool hasPolicy(std::string const& role) const;
+
+	/**
+	 * \brief Get the policy configured for the given role
+	 * \param role Name of the thread role
+	 * \return The configured Policy, or a default Policy if none is configured
+	 */
+	Policy getPolicy(std::string const& role) const;
+
+	/**
+	 * \brief Register the calling thread under a role and apply the role's policy to it
+	 * \param role Name of the thread role
+	 * \return False if a policy exists for the role but could not be applied (e.g. insufficient privileges for SCHED_FIFO)
+	 */
+	bool registerCurrentThread(std::string const& role);
+
+	/**
+	 * \brief Remove the calling thread from the list of registered threads
+	 */
+	void unregisterCurrentThread();
+
+	/**
+	 * \brief Apply a policy to a thread
+	 * \param policy Policy to apply
+	 * \param tid Kernel thread ID of the thread (0 for the calling thread)
+	 * \return True if the policy was applied
+	 */
+	static bool apply(Policy const& policy, pid_t tid = 0);
+
+	/**
+	 * \brief Convert a scheduler name to its SCHED_* value
+	 * \param name Scheduler name ("other", "batch", "idle", "fifo" or "rr")
+	 * \return SCHED_* constant
+	 * \exception cet::exception if the name is not recognized
+	 */
+	static int SchedulerFromString(std::string const& name);
+
+	/**
+	 * \brief Convert a SCHED_* value to its name
+	 * \param scheduler SCHED_* constant, or KeepScheduler
+	 * \return Name of the scheduler, "unchanged" for KeepScheduler, or "unknown"
+	 */
+	static std::string SchedulerToString(int scheduler);
+
+	/**
+	 * \brief Describe the configured policies and registered threads
+	 * \return String listing each role, its policy, and the threads registered under it
+	 */
+	std::string toString() const;
+
+private:
+	ThreadPolicy() = default;
+	ThreadPolicy(ThreadPolicy const&) = delete;
+	ThreadPolicy(ThreadPolicy&&) = delete;
+	ThreadPolicy& operator=(ThreadPolicy const&) = delete;
+	ThreadPolicy& operator=(ThreadPolicy&&) = delete;
+
+	static void validate_(std::string const& role, Policy const& policy);
+	void reapply_(std::string const& role);
+
+	std::map<std::string, Policy> policies_;
+	std::map<pid_t, std::string> threads_;  // Kernel thread ID -> role
+	mutable std::mutex mutex_;
+};
+}  // namespace artdaq
+
+#endif  // artdaq_core_Core_ThreadPolicy_hh
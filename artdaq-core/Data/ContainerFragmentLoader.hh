@@ -16,6 +16,7 @@
 #include "TRACE/tracemf.h"
 
 #include <iostream>
+#include <utility>
 
 namespace artdaq {
 class ContainerFragmentLoader;
@@ -159,8 +160,10 @@ inline void artdaq::ContainerFragmentLoader::addFragment(artdaq::Fragment& frag,
 		addSpace_((lastFragmentIndex() + frag.sizeBytes() + sizeof(size_t) * (metadata()->block_count + 2)) - artdaq_Fragment_.dataSizeBytes());
 	}
 	// frag.setSequenceID(artdaq_Fragment_.sequenceID());
-	TLOG(TLVL_DEBUG + 33, "ContainerFragmentLoader") << "addFragment, copying " << frag.sizeBytes() << " bytes from " << static_cast<void*>(frag.headerAddress()) << " to " << static_cast<void*>(dataEnd_());
-	memcpy(dataEnd_(), frag.headerAddress(), frag.sizeBytes());
+	// Read through the const accessor, so that a shared Fragment (see Fragment::makeShared) is not copied first
+	auto fragAddr = &*std::as_const(frag).headerBegin();
+	TLOG(TLVL_DEBUG + 33, "ContainerFragmentLoader") << "addFragment, copying " << frag.sizeBytes() << " bytes from " << static_cast<void const*>(fragAddr) << " to " << static_cast<void*>(dataEnd_());
+	memcpy(dataEnd_(), fragAddr, frag.sizeBytes());
 	metadata()->has_index = 0;
 
 	metadata()->block_count++;
@@ -204,8 +207,9 @@ inline void artdaq::ContainerFragmentLoader::addFragments(artdaq::FragmentPtrs&
 		}
 
 		// frag->setSequenceID(artdaq_Fragment_.sequenceID());
-		TLOG(TLVL_DEBUG + 33, "ContainerFragmentLoader") << "addFragments, copying " << frag->sizeBytes() << " bytes from " << static_cast<void*>(frag->headerAddress()) << " to " << static_cast<void*>(dataEnd_());
-		memcpy(data_ptr, frag->headerAddress(), frag->sizeBytes());
+		auto fragAddr = &*std::as_const(*frag).headerBegin();
+		TLOG(TLVL_DEBUG + 33, "ContainerFragmentLoader") << "addFragments, copying " << frag->sizeBytes() << " bytes from " << static_cast<void const*>(fragAddr) << " to " << static_cast<void*>(dataEnd_());
+		memcpy(data_ptr, fragAddr, frag->sizeBytes());
 		data_ptr = static_cast<uint8_t*>(data_ptr) + frag->sizeBytes();
 	}
 	metadata()->has_index = 0;
@@ -2,6 +2,7 @@
 #define artdaq_core_Data_Fragment_hh
 
 #include <algorithm>
+#include <atomic>
 // #include <cassert>
 #include <cmath>
 #include <cstddef>
@@ -105,10 +106,12 @@ public:
 	// http://stackoverflow.com/questions/33939687
 	// This should generate an exception if artdaq::Fragment is not move-constructible
 	/**
-	 * \brief Default copy constructor
+	 * \brief Copy constructor
 	 * \todo Decide if Copy constructor should be declared =delete
+	 *
+	 * A copy of a shared Fragment (see makeShared) references the same storage instead of copying it.
 	 */
-	Fragment(const Fragment&) = default;
+	Fragment(const Fragment&);
 	/**
 	 * \brief Move Constructor
 	 *
@@ -118,11 +121,13 @@ public:
 	 */
 	Fragment(Fragment&&) noexcept;
 	/**
-	 * \brief Default copy-assignment operator
+	 * \brief Copy-assignment operator
 	 * \return Reference to new Fragment
 	 * \todo Decide if copy-assignment operator should be declared =delete
+	 *
+	 * A copy of a shared Fragment (see makeShared) references the same storage instead of copying it.
 	 */
-	Fragment& operator=(const Fragment&) = default;
+	Fragment& operator=(const Fragment&);
 	/**
 	 * \brief Move-assignment operator
 	 * \return Reference to Fragment
@@ -132,6 +137,10 @@ public:
 	 * This should generate an exception if artdaq::Fragment is not move-constructible
 	 */
 	Fragment& operator=(Fragment&&) noexcept;
+	/**
+	 * \brief Fragment Destructor. Storage shared with other Fragments is freed by the last one
+	 */
+	~Fragment();
 
 	typedef detail::RawFragmentHeader::version_t version_t;          ///< typedef for version_t from RawFragmentHeader
 	typedef detail::RawFragmentHeader::type_t type_t;                ///< typedef for type_t from RawFragmentHeader
@@ -668,7 +677,39 @@ public:
 	 *
 	 * Since all Fragment header information is stored in the data vector, this is equivalent to swapping two Fragment objects
 	 */
-	void swap(DATAVEC_T& other) noexcept { vals_.swap(other); };
+	void swap(DATAVEC_T& other)
+	{
+		unshare();
+		vals_.swap(other);
+	};
+
+	/**
+	 * \brief Make the storage of the Fragment reference-counted and immutable
+	 *
+	 * Copies of a shared Fragment reference the same storage instead of duplicating it, which makes
+	 * sending the same Fragment to several consumers cheap. The storage is copied by the first
+	 * call that can modify the Fragment while other Fragments still reference it: header setters,
+	 * resize, setMetadata, updateMetadata, or any non-const accessor returning a pointer or iterator
+	 * into the data (dataBegin(), dataAddress(), headerBegin(), ...). The last Fragment referencing
+	 * the storage takes it over instead. Const accessors read the shared storage directly.
+	 *
+	 * The header and payload stay in the persistent storage, so a shared Fragment is written out
+	 * with ROOT like any other.
+	 */
+	void makeShared();
+
+	/**
+	 * \brief Whether the Fragment references shared storage (see makeShared)
+	 * \return True if the Fragment is in shared mode
+	 */
+	bool isShared() const { return shared_refs_ != nullptr; }
+
+	/**
+	 * \brief Give the Fragment private storage, copying it if other Fragments still reference it
+	 *
+	 * Does nothing if the Fragment is not in shared mode.
+	 */
+	void unshare();
 
 	/**
 	 * \brief Returns a RawDataType pointer to the beginning of the payload
@@ -749,11 +790,14 @@ private:
 	void updateFragmentHeaderWC_();
 
 	DATAVEC_T vals_;
+	std::atomic<size_t>* shared_refs_{nullptr};  //!< Number of Fragments whose vals_ reference the same storage, in shared mode (see makeShared). Transient
 
 #if HIDE_FROM_ROOT
 
 	detail::RawFragmentHeader* fragmentHeaderPtr();
 
+	void releaseShared_() noexcept;
+
 #endif
 };
 
@@ -761,8 +805,45 @@ private:
 
 // http://stackoverflow.com/questions/33939687
 // This should generate an exception if artdaq::Fragment is not move-constructible
-inline artdaq::Fragment::Fragment(artdaq::Fragment&&) noexcept = default;
-inline artdaq::Fragment& artdaq::Fragment::operator=(artdaq::Fragment&&) noexcept = default;
+inline artdaq::Fragment::Fragment(artdaq::Fragment&& other) noexcept
+    : vals_(std::move(other.vals_))
+    , shared_refs_(other.shared_refs_)
+{
+	other.shared_refs_ = nullptr;
+}
+
+inline artdaq::Fragment& artdaq::Fragment::operator=(artdaq::Fragment&& other) noexcept
+{
+	Fragment tmp(std::move(other));
+	swap(tmp);
+	return *this;
+}
+
+inline artdaq::Fragment::Fragment(artdaq::Fragment const& other)
+    : vals_(other.shared_refs_ != nullptr ? DATAVEC_T(const_cast<RawDataType*>(other.vals_.begin()), other.vals_.size(), other.vals_.capacity())  // NOLINT(cppcoreguidelines-pro-type-const-cast)
+                                          : DATAVEC_T(other.vals_))
+    , shared_refs_(other.shared_refs_)
+{
+	if (shared_refs_ != nullptr)
+	{
+		shared_refs_->fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+inline artdaq::Fragment& artdaq::Fragment::operator=(artdaq::Fragment const& other)
+{
+	if (this != &other)
+	{
+		Fragment tmp(other);
+		swap(tmp);
+	}
+	return *this;
+}
+
+inline artdaq::Fragment::~Fragment()
+{
+	releaseShared_();
+}
 
 inline bool constexpr artdaq::Fragment::
     isUserFragmentType(type_t fragmentType)
@@ -858,7 +939,8 @@ artdaq::Fragment::type() const
 inline std::string
 artdaq::Fragment::typeString() const
 {
-	return std::to_string(type()) + (isSystemFragmentType(type()) ? " (" + detail::RawFragmentHeader::SystemTypeToString(type()) + ")" : "");
+	auto t = type();
+	return std::to_string(t) + (isSystemFragmentType(t) ? " (" + detail::RawFragmentHeader::SystemTypeToString(t) + ")" : "");
 }
 
 inline artdaq::Fragment::sequence_id_t
@@ -957,6 +1039,7 @@ T* artdaq::Fragment::metadata()
 		    << "No metadata has been stored in this Fragment.";
 	}
 
+	unshare();
 	return reinterpret_cast_checked<T*>(&vals_[headerSizeWords()]);
 }
 
@@ -981,6 +1064,7 @@ void artdaq::Fragment::setMetadata(const T& metadata)
 		    << "Metadata has already been stored in this Fragment.";
 	}
 	auto const mdSize = validatedMetadataSize_<T>();
+	unshare();
 	vals_.insert(dataBegin(), mdSize, 0);
 	updateFragmentHeaderWC_();
 	fragmentHeaderPtr()->metadata_word_count = mdSize;
@@ -1005,12 +1089,14 @@ void artdaq::Fragment::updateMetadata(const T& metadata)
 		    << "Mismatch between type of metadata struct passed to updateMetadata and existing metadata struct";
 	}
 
+	unshare();
 	memcpy(metadataAddress(), &metadata, sizeof(T));
 }
 
 inline void
 artdaq::Fragment::resize(std::size_t sz)
 {
+	unshare();
 	vals_.resize(sz + fragmentHeaderPtr()->metadata_word_count +
 	             headerSizeWords());
 	updateFragmentHeaderWC_();
@@ -1019,6 +1105,7 @@ artdaq::Fragment::resize(std::size_t sz)
 inline void
 artdaq::Fragment::resize(std::size_t sz, RawDataType v)
 {
+	unshare();
 	vals_.resize(sz + fragmentHeaderPtr()->metadata_word_count +
 	                 headerSizeWords(),
 	             v);
@@ -1036,6 +1123,7 @@ inline void
 artdaq::Fragment::resizeBytesWithCushion(std::size_t szbytes, double growthFactor)
 {
 	RawDataType nwords = ceil(szbytes / static_cast<double>(sizeof(RawDataType)));
+	unshare();
 	vals_.resizeWithCushion(nwords + fragmentHeaderPtr()->metadata_word_count +
 	                            headerSizeWords(),
 	                        growthFactor);
@@ -1062,6 +1150,7 @@ artdaq::Fragment::resizeBytes(std::size_t szbytes, byte_t v)
 inline void
 artdaq::Fragment::autoResize()
 {
+	unshare();
 	vals_.resize(fragmentHeaderPtr()->word_count);
 	updateFragmentHeaderWC_();
 }
@@ -1069,6 +1158,7 @@ artdaq::Fragment::autoResize()
 inline artdaq::Fragment::iterator
 artdaq::Fragment::dataBegin()
 {
+	unshare();
 	return vals_.begin() + headerSizeWords() +
 	       fragmentHeader().metadata_word_count;
 }
@@ -1076,12 +1166,14 @@ artdaq::Fragment::dataBegin()
 inline artdaq::Fragment::iterator
 artdaq::Fragment::dataEnd()
 {
+	unshare();
 	return vals_.end();
 }
 
 inline artdaq::Fragment::iterator
 artdaq::Fragment::headerBegin()
 {
+	unshare();
 	return vals_.begin();
 }
 
@@ -1104,9 +1196,64 @@ artdaq::Fragment::headerBegin() const
 	return vals_.begin();
 }
 
+inline void
+artdaq::Fragment::makeShared()
+{
+	if (shared_refs_ != nullptr)
+	{
+		return;
+	}
+
+	fragmentHeaderPtr();  // Upgrade old header versions now, since that resizes the storage
+	shared_refs_ = new std::atomic<size_t>(1);
+}
+
+inline void
+artdaq::Fragment::unshare()
+{
+	if (shared_refs_ == nullptr)
+	{
+		return;
+	}
+
+	// Acquire pairs with the release of the other references, so their reads of the storage come before any write through this one
+	if (shared_refs_->load(std::memory_order_acquire) == 1)
+	{
+		delete shared_refs_;
+		shared_refs_ = nullptr;
+		return;
+	}
+
+	TLOG(53, "Fragment") << "Copying shared storage of " << vals_.size() << " words";
+	DATAVEC_T copy(vals_);
+	releaseShared_();
+	vals_.swap(copy);
+}
+
+inline void
+artdaq::Fragment::releaseShared_() noexcept
+{
+	if (shared_refs_ == nullptr)
+	{
+		return;
+	}
+
+	if (shared_refs_->fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		// This was the last reference, so vals_ owns the storage again
+		delete shared_refs_;
+	}
+	else
+	{
+		vals_.release();
+	}
+	shared_refs_ = nullptr;
+}
+
 inline void
 artdaq::Fragment::clear()
 {
+	unshare();
 	vals_.erase(dataBegin(), dataEnd());
 	updateFragmentHeaderWC_();
 }
@@ -1121,6 +1268,7 @@ artdaq::Fragment::empty()
 inline void
 artdaq::Fragment::reserve(std::size_t cap)
 {
+	unshare();
 	vals_.reserve(cap + headerSizeWords() +
 	              fragmentHeader().metadata_word_count);
 }
@@ -1129,11 +1277,13 @@ inline void
 artdaq::Fragment::swap(Fragment& other) noexcept
 {
 	vals_.swap(other.vals_);
+	std::swap(shared_refs_, other.shared_refs_);
 }
 
 inline artdaq::RawDataType*
 artdaq::Fragment::dataAddress()
 {
+	unshare();
 	return &vals_[0] + headerSizeWords() +  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 	       fragmentHeader().metadata_word_count;
 }
@@ -1146,12 +1296,14 @@ artdaq::Fragment::metadataAddress()
 		throw cet::exception("InvalidRequest")  // NOLINT(cert-err60-cpp)
 		    << "No metadata has been stored in this Fragment.";
 	}
+	unshare();
 	return &vals_[0] + headerSizeWords();  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 }
 
 inline artdaq::RawDataType*
 artdaq::Fragment::headerAddress()
 {
+	unshare();
 	return &vals_[0];
 }
 
@@ -1189,6 +1341,7 @@ artdaq::Fragment::headerSizeWords() const
 inline artdaq::detail::RawFragmentHeader*
 artdaq::Fragment::fragmentHeaderPtr()
 {
+	unshare();
 	auto hdr = reinterpret_cast_checked<detail::RawFragmentHeader*>(&vals_[0]);
 	if (hdr->version != detail::RawFragmentHeader::CurrentVersion)
 	{
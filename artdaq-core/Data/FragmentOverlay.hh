@@ -0,0 +1,261 @@
+#ifndef artdaq_core_Data_FragmentOverlay_hh
+#define artdaq_core_Data_FragmentOverlay_hh
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "cetlib_except/exception.h"
+
+namespace artdaq {
+/**
+ * \brief A non-owning, unchecked view of a contiguous array (a minimal stand-in for C++20 std::span)
+ * \tparam T Element type
+ */
+template<typename T>
+class FragmentSpan
+{
+public:
+	typedef T element_type;  ///< Type of the elements
+	typedef T* iterator;     ///< Iterators are plain pointers
+
+	/**
+	 * \brief Create an empty FragmentSpan
+	 */
+	constexpr FragmentSpan()
+	    : data_(nullptr), size_(0) {}
+
+	/**
+	 * \brief Create a FragmentSpan
+	 * \param data Pointer to the first element
+	 * \param size Number of elements
+	 */
+	constexpr FragmentSpan(T* data, size_t size)
+	    : data_(data), size_(size) {}
+
+	/**
+	 * \brief Get a pointer to the first element
+	 * \return Pointer to the first element
+	 */
+	constexpr T* data() const { return data_; }
+	/**
+	 * \brief Get the number of elements
+	 * \return The number of elements
+	 */
+	constexpr size_t size() const { return size_; }
+	/**
+	 * \brief Get the size of the view in bytes
+	 * \return The size of the view in bytes
+	 */
+	constexpr size_t size_bytes() const { return size_ * sizeof(T); }
+	/**
+	 * \brief Whether the view is empty
+	 * \return True if there are no elements
+	 */
+	constexpr bool empty() const { return size_ == 0; }
+	/**
+	 * \brief Iterator to the first element
+	 * \return Iterator to the first element
+	 */
+	constexpr iterator begin() const { return data_; }
+	/**
+	 * \brief Iterator past the last element
+	 * \return Iterator past the last element
+	 */
+	constexpr iterator end() const { return data_ + size_; }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	/**
+	 * \brief Access an element. No bounds checking is performed
+	 * \param ii Index of the element
+	 * \return Reference to the element
+	 */
+	constexpr T& operator[](size_t ii) const { return data_[ii]; }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+private:
+	T* data_;
+	size_t size_;
+};
+
+template<typename Metadata, typename PayloadElement>
+class FragmentOverlay;
+}  // namespace artdaq
+
+/**
+ * \brief A typed, read-only overlay of a Fragment with a Metadata struct and a payload of PayloadElement
+ * \tparam Metadata Type of the Fragment metadata, or void if the Fragment has none
+ * \tparam PayloadElement Type of the elements of the payload
+ *
+ * Size, alignment and layout requirements of the Metadata and PayloadElement types are checked at
+ * compile time. The Fragment itself is validated once, when the overlay is constructed (header
+ * version, metadata word count, word count); after that, all accessors are unchecked and inline, so
+ * using the overlay costs the same as hand-written pointer arithmetic.
+ *
+ * An overlay can be built from a Fragment, or directly on a serialized Fragment (e.g. in a shared
+ * memory buffer) without copying it. The overlay does not own the data, which must outlive it and
+ * must not be resized while it is in use.
+ */
+template<typename Metadata, typename PayloadElement = artdaq::RawDataType>
+class artdaq::FragmentOverlay
+{
+	static_assert(std::is_void<Metadata>::value || std::is_trivially_copyable<Metadata>::value, "FragmentOverlay Metadata must be trivially copyable");
+	static_assert(std::is_trivially_copyable<PayloadElement>::value, "FragmentOverlay PayloadElement must be trivially copyable");
+	static_assert(alignof(PayloadElement) <= alignof(RawDataType), "FragmentOverlay PayloadElement cannot require stricter alignment than RawDataType");
+
+	// sizeof/alignof cannot be applied to void, so use a one-byte stand-in type for the checks below
+	typedef typename std::conditional<std::is_void<Metadata>::value, char, Metadata>::type metadata_storage_t;
+	static_assert(alignof(metadata_storage_t) <= alignof(RawDataType), "FragmentOverlay Metadata cannot require stricter alignment than RawDataType");
+
+public:
+	typedef typename std::add_const<PayloadElement>::type const_element_t;  ///< Payload element type, as seen through the overlay
+
+	/// Number of RawDataType words taken up by the Metadata in the Fragment
+	static constexpr size_t metadata_words = std::is_void<Metadata>::value ? 0 : (sizeof(metadata_storage_t) + sizeof(RawDataType) - 1) / sizeof(RawDataType);
+	static_assert(metadata_words <= std::numeric_limits<detail::RawFragmentHeader::metadata_word_count_t>::max(), "FragmentOverlay Metadata is too large to be stored in a Fragment");
+
+	/**
+	 * \brief Build an overlay of a Fragment
+	 * \param frag Fragment to overlay. Its payload must not be reallocated while the overlay is in use
+	 * \exception cet::exception if the Fragment's metadata does not have the size of Metadata
+	 */
+	explicit FragmentOverlay(Fragment const& frag)
+	    : header_(frag.fragmentHeader())
+	{
+		validate_(header_.metadata_word_count);
+		init_(&*frag.headerBegin() + frag.headerSizeWords(), frag.dataSizeBytes());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	/**
+	 * \brief Build an overlay directly on a serialized Fragment, without copying it
+	 * \param words Pointer to the first word of the Fragment header
+	 * \param available_words Number of readable words starting at words. Used to check the Fragment's word count
+	 * \exception cet::exception if the header is not the current RawFragmentHeader version, the Fragment is truncated, or its metadata does not have the size of Metadata
+	 */
+	FragmentOverlay(RawDataType const* words, size_t available_words)
+	{
+		if (available_words < detail::RawFragmentHeader::num_words())
+		{
+			throw cet::exception("FragmentOverlay") << "Buffer of " << available_words << " words is too small to hold a Fragment header";  // NOLINT(cert-err60-cpp)
+		}
+		memcpy(&header_, words, sizeof(header_));
+		if (header_.version != detail::RawFragmentHeader::CurrentVersion)
+		{
+			throw cet::exception("FragmentOverlay") << "Cannot overlay a Fragment with header version " << header_.version  // NOLINT(cert-err60-cpp)
+			                                        << " in place; expected version " << detail::RawFragmentHeader::CurrentVersion;
+		}
+		if (header_.word_count > available_words || header_.word_count < detail::RawFragmentHeader::num_words() + header_.metadata_word_count)
+		{
+			throw cet::exception("FragmentOverlay") << "Fragment word count " << header_.word_count  // NOLINT(cert-err60-cpp)
+			                                        << " is inconsistent with the buffer size (" << available_words << " words) or the header";
+		}
+		validate_(header_.metadata_word_count);
+		auto metadataBegin = words + detail::RawFragmentHeader::num_words();  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		init_(metadataBegin, (header_.word_count - detail::RawFragmentHeader::num_words() - header_.metadata_word_count) * sizeof(RawDataType));
+	}
+
+	/**
+	 * \brief Get the header of the Fragment, as it was when the overlay was built
+	 * \return Reference to the header
+	 */
+	detail::RawFragmentHeader const& header() const { return header_; }
+	/**
+	 * \brief Get the sequence ID of the Fragment
+	 * \return The sequence ID of the Fragment
+	 */
+	Fragment::sequence_id_t sequenceID() const { return header_.sequence_id; }
+	/**
+	 * \brief Get the fragment ID of the Fragment
+	 * \return The fragment ID of the Fragment
+	 */
+	Fragment::fragment_id_t fragmentID() const { return header_.fragment_id; }
+	/**
+	 * \brief Get the timestamp of the Fragment
+	 * \return The timestamp of the Fragment
+	 */
+	Fragment::timestamp_t timestamp() const { return header_.timestamp; }
+	/**
+	 * \brief Get the type of the Fragment
+	 * \return The type of the Fragment
+	 */
+	Fragment::type_t type() const { return static_cast<Fragment::type_t>(header_.type); }
+
+	/**
+	 * \brief Get the metadata of the Fragment. Only available if Metadata is not void
+	 * \return Reference to the metadata
+	 */
+	template<typename M = Metadata, typename = typename std::enable_if<!std::is_void<M>::value>::type>
+	M const& metadata() const
+	{
+		return *reinterpret_cast<M const*>(metadata_);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+
+	/**
+	 * \brief Get the payload of the Fragment as an array of PayloadElement
+	 * \return View of the payload. Trailing bytes that do not make up a whole PayloadElement are not included
+	 */
+	FragmentSpan<const_element_t> payload() const { return FragmentSpan<const_element_t>(payload_, payload_count_); }
+
+	/**
+	 * \brief Get the number of PayloadElement in the payload
+	 * \return The number of elements in the payload
+	 */
+	size_t size() const { return payload_count_; }
+
+	/**
+	 * \brief Access an element of the payload. No bounds checking is performed
+	 * \param ii Index of the element
+	 * \return Reference to the element
+	 */
+	const_element_t& operator[](size_t ii) const { return payload_[ii]; }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	/**
+	 * \brief Iterator to the first payload element
+	 * \return Pointer to the first payload element
+	 */
+	const_element_t* begin() const { return payload_; }
+	/**
+	 * \brief Iterator past the last payload element
+	 * \return Pointer past the last payload element
+	 */
+	const_element_t* end() const { return payload_ + payload_count_; }  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	/**
+	 * \brief Create a Fragment laid out for this overlay
+	 * \param payload_count Number of PayloadElement in the payload
+	 * \param sequence_id Sequence ID of the new Fragment
+	 * \param fragment_id Fragment ID of the new Fragment
+	 * \param type Type of the new Fragment
+	 * \param metadata Metadata of the new Fragment
+	 * \param timestamp Timestamp of the new Fragment
+	 * \return The new Fragment. Its payload is not initialized
+	 */
+	template<typename M = Metadata, typename = typename std::enable_if<!std::is_void<M>::value>::type>
+	static FragmentPtr Create(size_t payload_count, Fragment::sequence_id_t sequence_id, Fragment::fragment_id_t fragment_id,
+	                          Fragment::type_t type, M const& metadata, Fragment::timestamp_t timestamp = Fragment::InvalidTimestamp)
+	{
+		return Fragment::FragmentBytes(payload_count * sizeof(PayloadElement), sequence_id, fragment_id, type, metadata, timestamp);
+	}
+
+private:
+	void validate_(size_t metadata_word_count) const
+	{
+		if (!std::is_void<Metadata>::value && metadata_word_count != metadata_words)
+		{
+			throw cet::exception("FragmentOverlay") << "Fragment has " << metadata_word_count  // NOLINT(cert-err60-cpp)
+			                                        << " words of metadata, but the overlay expects " << metadata_words;
+		}
+	}
+
+	void init_(RawDataType const* metadataBegin, size_t payload_bytes)
+	{
+		metadata_ = metadataBegin;
+		payload_ = reinterpret_cast<const_element_t*>(metadataBegin + header_.metadata_word_count);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		payload_count_ = payload_bytes / sizeof(PayloadElement);
+	}
+
+	detail::RawFragmentHeader header_;
+	RawDataType const* metadata_{nullptr};
+	const_element_t* payload_{nullptr};
+	size_t payload_count_{0};
+};
+
+#endif  // artdaq_core_Data_FragmentOverlay_hh
@@ -0,0 +1,167 @@
+#include "artdaq-core/Data/FragmentSort.hh"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace {
+// Below this size, the passes over the histogram cost more than a comparison sort
+constexpr size_t RadixSortThreshold = 64;
+
+artdaq::Fragment const& Deref(artdaq::FragmentPtr const& frag) { return *frag; }
+artdaq::Fragment const& Deref(artdaq::Fragment const& frag) { return frag; }
+
+template<typename Stream, typename Emit>
+void MergeStreams(std::vector<Stream>& streams, artdaq::FragmentSortKey key, Emit emit)
+{
+	// Min-heap of (key, stream index); ties go to the lower-numbered stream
+	typedef std::pair<uint64_t, size_t> head_t;
+	std::priority_queue<head_t, std::vector<head_t>, std::greater<>> heads;
+	std::vector<typename Stream::iterator> positions;
+	positions.reserve(streams.size());
+	for (size_t ii = 0; ii < streams.size(); ++ii)
+	{
+		positions.push_back(streams[ii].begin());
+		if (positions[ii] != streams[ii].end())
+		{
+			heads.emplace(artdaq::GetFragmentSortKey(Deref(*positions[ii]), key), ii);
+		}
+	}
+
+	while (!heads.empty())
+	{
+		auto stream = heads.top().second;
+		heads.pop();
+		auto current = positions[stream]++;
+		if (positions[stream] != streams[stream].end())
+		{
+			heads.emplace(artdaq::GetFragmentSortKey(Deref(*positions[stream]), key), stream);
+		}
+		emit(streams[stream], current);
+	}
+}
+}  // namespace
+
+uint64_t artdaq::GetFragmentSortKey(Fragment const& frag, FragmentSortKey key)
+{
+	auto hdr = frag.fragmentHeader();
+	if (key == FragmentSortKey::Timestamp)
+	{
+		return hdr.timestamp;
+	}
+	return (static_cast<uint64_t>(hdr.sequence_id) << 16) | hdr.fragment_id;
+}
+
+void artdaq::detail::RadixSort(std::vector<FragmentSortEntry>& entries)
+{
+	auto compare = [](FragmentSortEntry const& a, FragmentSortEntry const& b) { return a.key < b.key; };
+	if (entries.size() < RadixSortThreshold)
+	{
+		std::stable_sort(entries.begin(), entries.end(), compare);
+		return;
+	}
+
+	constexpr size_t digits = sizeof(uint64_t);
+	std::array<std::array<size_t, 256>, digits> counts{};
+	for (auto const& entry : entries)
+	{
+		for (size_t digit = 0; digit < digits; ++digit)
+		{
+			++counts[digit][(entry.key >> (8 * digit)) & 0xFF];
+		}
+	}
+
+	std::vector<FragmentSortEntry> scratch(entries.size());
+	for (size_t digit = 0; digit < digits; ++digit)
+	{
+		auto& count = counts[digit];
+		// Every key has the same value for this digit: the pass would not change the order
+		if (count[(entries[0].key >> (8 * digit)) & 0xFF] == entries.size())
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (auto& bucket : count)
+		{
+			auto n = bucket;
+			bucket = offset;
+			offset += n;
+		}
+		for (auto const& entry : entries)
+		{
+			scratch[count[(entry.key >> (8 * digit)) & 0xFF]++] = entry;
+		}
+		entries.swap(scratch);
+	}
+}
+
+void artdaq::SortFragments(FragmentPtrs& frags, FragmentSortKey key)
+{
+	std::vector<FragmentPtrs::iterator> positions;
+	std::vector<detail::FragmentSortEntry> entries;
+	positions.reserve(frags.size());
+	entries.reserve(frags.size());
+	for (auto it = frags.begin(); it != frags.end(); ++it)
+	{
+		entries.push_back({GetFragmentSortKey(**it, key), positions.size()});
+		positions.push_back(it);
+	}
+
+	detail::RadixSort(entries);
+
+	// Relink the list nodes in sorted order; no Fragment or node is moved or reallocated
+	FragmentPtrs sorted;
+	for (auto const& entry : entries)
+	{
+		sorted.splice(sorted.end(), frags, positions[entry.index]);
+	}
+	frags.swap(sorted);
+}
+
+void artdaq::SortFragments(Fragments& frags, FragmentSortKey key)
+{
+	std::vector<detail::FragmentSortEntry> entries;
+	entries.reserve(frags.size());
+	for (size_t ii = 0; ii < frags.size(); ++ii)
+	{
+		entries.push_back({GetFragmentSortKey(frags[ii], key), ii});
+	}
+
+	detail::RadixSort(entries);
+
+	Fragments sorted;
+	sorted.reserve(frags.size());
+	for (auto const& entry : entries)
+	{
+		sorted.push_back(std::move(frags[entry.index]));
+	}
+	frags.swap(sorted);
+}
+
+artdaq::FragmentPtrs artdaq::MergeSortedFragments(std::vector<FragmentPtrs>& streams, FragmentSortKey key)
+{
+	FragmentPtrs merged;
+	MergeStreams(streams, key, [&merged](FragmentPtrs& stream, FragmentPtrs::iterator it) { merged.splice(merged.end(), stream, it); });
+	return merged;
+}
+
+artdaq::Fragments artdaq::MergeSortedFragments(std::vector<Fragments>& streams, FragmentSortKey key)
+{
+	size_t total = 0;
+	for (auto const& stream : streams)
+	{
+		total += stream.size();
+	}
+
+	Fragments merged;
+	merged.reserve(total);
+	MergeStreams(streams, key, [&merged](Fragments&, Fragments::iterator it) { merged.push_back(std::move(*it)); });
+	for (auto& stream : streams)
+	{
+		stream.clear();
+	}
+	return merged;
+}
@@ -0,0 +1,85 @@
+#ifndef artdaq_core_Data_FragmentSort_hh
+#define artdaq_core_Data_FragmentSort_hh
+
+#include <cstdint>
+#include <vector>
+
+#include "artdaq-core/Data/Fragment.hh"
+
+namespace artdaq {
+/**
+ * \brief The key used to order Fragments
+ */
+enum class FragmentSortKey
+{
+	SequenceID,  ///< Order by sequence ID, then by fragment ID
+	Timestamp    ///< Order by timestamp
+};
+
+/**
+ * \brief Get the 64-bit sort key of a Fragment
+ * \param frag Fragment to get the key of
+ * \param key Which key to use
+ * \return For FragmentSortKey::SequenceID, the 48-bit sequence ID followed by the 16-bit fragment ID. For FragmentSortKey::Timestamp, the timestamp
+ */
+uint64_t GetFragmentSortKey(Fragment const& frag, FragmentSortKey key);
+
+/**
+ * \brief Sort a list of Fragments in place
+ * \param frags Fragments to sort
+ * \param key Which key to sort by
+ *
+ * The keys are extracted into a compact array (decoding each Fragment header once), sorted with
+ * an LSD radix sort, and the list nodes are then relinked in sorted order. The sort is stable, so
+ * Fragments with equal keys keep their relative order.
+ */
+void SortFragments(FragmentPtrs& frags, FragmentSortKey key = FragmentSortKey::SequenceID);
+
+/**
+ * \brief Sort a vector of Fragments in place
+ * \param frags Fragments to sort
+ * \param key Which key to sort by
+ *
+ * See SortFragments(FragmentPtrs&, FragmentSortKey). Fragments are moved, not copied.
+ */
+void SortFragments(Fragments& frags, FragmentSortKey key = FragmentSortKey::SequenceID);
+
+/**
+ * \brief Merge several sorted lists of Fragments into one sorted list
+ * \param streams Lists to merge, each already sorted by key (e.g. one per data source). They are empty on return
+ * \param key Which key the lists are sorted by
+ * \return The merged list. Fragments with equal keys are taken from the lower-numbered stream first
+ */
+FragmentPtrs MergeSortedFragments(std::vector<FragmentPtrs>& streams, FragmentSortKey key = FragmentSortKey::SequenceID);
+
+/**
+ * \brief Merge several sorted vectors of Fragments into one sorted vector
+ * \param streams Vectors to merge, each already sorted by key. They are empty on return
+ * \param key Which key the vectors are sorted by
+ * \return The merged vector. Fragments with equal keys are taken from the lower-numbered stream first
+ */
+Fragments MergeSortedFragments(std::vector<Fragments>& streams, FragmentSortKey key = FragmentSortKey::SequenceID);
+
+namespace detail {
+/**
+ * \brief An entry in the array sorted by RadixSort: a sort key and the position of its item in the input
+ */
+struct FragmentSortEntry
+{
+	uint64_t key;  ///< Sort key
+	size_t index;  ///< Position of the item in the input
+};
+
+/**
+ * \brief Stable LSD radix sort of an array of FragmentSortEntry by key
+ * \param entries Array to sort
+ *
+ * Sorts eight bits per pass. Digits which are the same in every key (e.g. the high bytes of
+ * sequence IDs in a batch of nearby events) are skipped, so a batch costs one counting pass plus one
+ * pass per varying byte. Small arrays are sorted with std::stable_sort instead.
+ */
+void RadixSort(std::vector<FragmentSortEntry>& entries);
+}  // namespace detail
+}  // namespace artdaq
+
+#endif  // artdaq_core_Data_FragmentSort_hh
@@ -6,7 +6,9 @@
 // of Fragment is intended to be used to access the data.
 
 // #include <cstddef>
+#include <array>
 #include <map>
+#include <string_view>
 #include "artdaq-core/Data/dictionarycontrol.hh"
 #include "artdaq-core/Utilities/TimeUtils.hh"
 #include "cetlib_except/exception.h"
@@ -63,37 +65,44 @@ struct artdaq::detail::RawFragmentHeader
 	static constexpr type_t ContainerFragmentType = FIRST_SYSTEM_TYPE + 7;    ///< This Fragment is a ContainerFragment and analysis code should unpack it
 	static constexpr type_t ErrorFragmentType = FIRST_SYSTEM_TYPE + 8;        ///< This Fragment has experienced some error, and no attempt should be made to read it
 
+	typedef std::array<std::string_view, 256> TypeNameTable;  ///< Table of type names, indexed by type code. Undefined types have empty names
+
+	/**
+	 * \brief Builds a table of system type names at compile time
+	 * \param verbose If true, all defined system types (and INVALID_TYPE) are named. Otherwise, only the most-commonly used types are
+	 * \return Table of type names, indexed by type code
+	 */
+	static constexpr TypeNameTable MakeSystemTypeTable(bool verbose);
+
+	/**
+	 * \brief Get the name of a system type, without allocating
+	 * \param type Type to look up
+	 * \return Name of the type, or an empty string_view if the type has no name
+	 */
+	static constexpr std::string_view SystemTypeName(type_t type);
+
+	/**
+	 * \brief Converts a type name table into a map of the named types
+	 * \param table Table of type names, indexed by type code
+	 * \return A map containing every type with a non-empty name in the table
+	 */
+	static std::map<type_t, std::string> MakeTypeMap(TypeNameTable const& table);
+
 	/**
 	 * \brief Returns a map of the most-commonly used system types
 	 * \return A map of the system types used in the _artdaq_ data stream
+	 *
+	 * Compatibility wrapper around the compile-time SystemTypeNames table
 	 */
-	static std::map<type_t, std::string> MakeSystemTypeMap()
-	{
-		return std::map<type_t, std::string>{
-		    {type_t(DataFragmentType), "Data"},
-		    {type_t(EmptyFragmentType), "Empty"},
-		    {type_t(ErrorFragmentType), "Error"},
-		    {type_t(InvalidFragmentType), "Invalid"},
-		    {232, "Container"}};
-	}
+	static std::map<type_t, std::string> MakeSystemTypeMap();
 
 	/**
 	 * \brief Returns a map of all system types
 	 * \return A map of all defined system types
+	 *
+	 * Compatibility wrapper around the compile-time VerboseSystemTypeNames table
 	 */
-	static std::map<type_t, std::string> MakeVerboseSystemTypeMap()
-	{
-		return std::map<type_t, std::string>{
-		    {type_t(INVALID_TYPE), "INVALID"},
-		    {type_t(EndOfDataFragmentType), "EndOfData"},
-		    {type_t(DataFragmentType), "Data"},
-		    {type_t(InitFragmentType), "Init"},
-		    {type_t(EndOfRunFragmentType), "EndOfRun"},
-		    {type_t(EndOfSubrunFragmentType), "EndOfSubrun"},
-		    {type_t(ShutdownFragmentType), "Shutdown"},
-		    {type_t(EmptyFragmentType), "Empty"},
-		    {type_t(ContainerFragmentType), "Container"}};
-	}
+	static std::map<type_t, std::string> MakeVerboseSystemTypeMap();
 
 	/**
 	 * \brief Print a system type's string name
@@ -102,12 +111,8 @@ struct artdaq::detail::RawFragmentHeader
 	 */
 	static std::string SystemTypeToString(type_t type)
 	{
-		auto map = MakeVerboseSystemTypeMap();
-		if (map.count(type))
-		{
-			return map[type];
-		}
-		return "Unknown";
+		auto name = SystemTypeName(type);
+		return name.empty() ? "Unknown" : std::string(name);
 	}
 
 	// Each of the following invalid values is chosen based on the
@@ -207,6 +212,80 @@ artdaq::detail::RawFragmentHeader::num_words()
 	return sizeof(detail::RawFragmentHeader) / sizeof(RawDataType);
 }
 
+inline constexpr artdaq::detail::RawFragmentHeader::TypeNameTable
+artdaq::detail::RawFragmentHeader::MakeSystemTypeTable(bool verbose)
+{
+	TypeNameTable table{};
+	// Assign every entry explicitly; GCC 12 does not treat value-initialized entries as constant when read back
+	for (auto& name : table)
+	{
+		name = "";
+	}
+	if (verbose)
+	{
+		table[INVALID_TYPE] = "INVALID";
+		table[EndOfDataFragmentType] = "EndOfData";
+		table[DataFragmentType] = "Data";
+		table[InitFragmentType] = "Init";
+		table[EndOfRunFragmentType] = "EndOfRun";
+		table[EndOfSubrunFragmentType] = "EndOfSubrun";
+		table[ShutdownFragmentType] = "Shutdown";
+		table[EmptyFragmentType] = "Empty";
+		table[ContainerFragmentType] = "Container";
+		table[ErrorFragmentType] = "Error";
+	}
+	else
+	{
+		table[DataFragmentType] = "Data";
+		table[EmptyFragmentType] = "Empty";
+		table[ErrorFragmentType] = "Error";
+		table[InvalidFragmentType] = "Invalid";
+		table[ContainerFragmentType] = "Container";
+	}
+	return table;
+}
+
+namespace artdaq {
+namespace detail {
+/// Names of the most-commonly used system types, indexed by type code
+inline constexpr RawFragmentHeader::TypeNameTable SystemTypeNames = RawFragmentHeader::MakeSystemTypeTable(false);
+/// Names of all defined system types, indexed by type code
+inline constexpr RawFragmentHeader::TypeNameTable VerboseSystemTypeNames = RawFragmentHeader::MakeSystemTypeTable(true);
+}  // namespace detail
+}  // namespace artdaq
+
+inline constexpr std::string_view
+artdaq::detail::RawFragmentHeader::SystemTypeName(type_t type)
+{
+	return VerboseSystemTypeNames[type];
+}
+
+inline std::map<artdaq::detail::RawFragmentHeader::type_t, std::string>
+artdaq::detail::RawFragmentHeader::MakeTypeMap(TypeNameTable const& table)
+{
+	std::map<type_t, std::string> map;
+	for (size_t type = 0; type < table.size(); ++type)
+	{
+		if (!table[type].empty()) map[static_cast<type_t>(type)] = std::string(table[type]);
+	}
+	return map;
+}
+
+inline std::map<artdaq::detail::RawFragmentHeader::type_t, std::string>
+artdaq::detail::RawFragmentHeader::MakeSystemTypeMap()
+{
+	return MakeTypeMap(SystemTypeNames);
+}
+
+inline std::map<artdaq::detail::RawFragmentHeader::type_t, std::string>
+artdaq::detail::RawFragmentHeader::MakeVerboseSystemTypeMap()
+{
+	return MakeTypeMap(VerboseSystemTypeNames);
+}
+
+static_assert(artdaq::detail::RawFragmentHeader::SystemTypeName(artdaq::detail::RawFragmentHeader::ContainerFragmentType) == "Container",
+              "System type name table is not available at compile time!");
+
 // Compile-time check that the assumption made in num_words() above is
 // actually true.
 static_assert((artdaq::detail::RawFragmentHeader::num_words() *
@@ -0,0 +1,210 @@
+#ifndef ARTDAQ_CORE_TEST_BENCHMARKS_BENCHMARKSHIMS_HH
+#define ARTDAQ_CORE_TEST_BENCHMARKS_BENCHMARKSHIMS_HH
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Small helpers shared by the artdaq-core microbenchmarks
+ *
+ * Each benchmark is a callable that performs one operation. RunBenchmark calibrates the
+ * iteration count so that a repetition takes at least MinimumTime() seconds, runs a few
+ * repetitions and keeps the fastest one. Results are printed as one table row per
+ * (operation, size) pair, with an optional comparison against a baseline row.
+ *
+ * Environment:
+ *   ARTDAQ_BENCH_MIN_TIME   Minimum duration of one repetition, in seconds (default 0.2)
+ *   ARTDAQ_BENCH_REPEAT     Number of repetitions; the fastest is reported (default 3)
+ */
+namespace bench {
+
+/**
+ * \brief Prevent the compiler from optimizing away the computation of value
+ * \param value Value which must be materialized
+ */
+template<typename T>
+inline void DoNotOptimize(T const& value)
+{
+	asm volatile(""
+	             :
+	             : "r,m"(value)
+	             : "memory");
+}
+
+/**
+ * \brief Force all pending writes to memory to be considered observable
+ */
+inline void ClobberMemory()
+{
+	asm volatile(""
+	             :
+	             :
+	             : "memory");
+}
+
+/**
+ * \brief Outcome of a single benchmark
+ */
+struct BenchmarkResult
+{
+	std::string name;          ///< Name of the measured operation
+	size_t bytes{0};           ///< Bytes processed per operation (0 if not meaningful)
+	size_t iterations{0};      ///< Number of operations in the fastest repetition
+	double ns_per_op{0.0};     ///< Nanoseconds per operation
+	double bytes_per_sec{0.0};  ///< Throughput, bytes per second (0 if bytes == 0)
+};
+
+/**
+ * \brief Minimum duration of one benchmark repetition
+ * \return Duration in seconds, from ARTDAQ_BENCH_MIN_TIME (default 0.2)
+ */
+inline double MinimumTime()
+{
+	auto env = getenv("ARTDAQ_BENCH_MIN_TIME");
+	return env != nullptr ? std::max(0.001, atof(env)) : 0.2;
+}
+
+/**
+ * \brief Number of repetitions of each benchmark
+ * \return Repetition count, from ARTDAQ_BENCH_REPEAT (default 3)
+ */
+inline int Repetitions()
+{
+	auto env = getenv("ARTDAQ_BENCH_REPEAT");
+	return env != nullptr ? std::max(1, atoi(env)) : 3;
+}
+
+/**
+ * \brief Time iterations calls of op
+ * \param iterations Number of calls
+ * \param op Operation to time
+ * \return Elapsed wall-clock time in seconds
+ */
+template<typename Op>
+inline double TimeIterations(size_t iterations, Op& op)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (size_t ii = 0; ii < iterations; ++ii)
+	{
+		op();
+	}
+	ClobberMemory();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * \brief Measure the cost of one operation
+ * \param name Name of the operation, used in the report
+ * \param bytes_per_op Number of bytes processed by each call (used for the throughput column)
+ * \param op Callable performing one operation
+ * \return BenchmarkResult of the fastest repetition
+ */
+template<typename Op>
+inline BenchmarkResult RunBenchmark(std::string const& name, size_t bytes_per_op, Op&& op)
+{
+	auto const min_time = MinimumTime();
+
+	size_t iterations = 1;
+	auto elapsed = TimeIterations(iterations, op);
+	while (elapsed < min_time / 10 && iterations < (1ULL << 40))
+	{
+		iterations *= 10;
+		elapsed = TimeIterations(iterations, op);
+	}
+	if (elapsed < min_time)
+	{
+		iterations = static_cast<size_t>(iterations * (min_time / std::max(elapsed, 1e-9))) + 1;
+	}
+
+	BenchmarkResult result;
+	result.name = name;
+	result.bytes = bytes_per_op;
+	result.iterations = iterations;
+	double best = 0.0;
+	for (int rep = 0; rep < Repetitions(); ++rep)
+	{
+		auto time = TimeIterations(iterations, op);
+		if (rep == 0 || time < best) best = time;
+	}
+	result.ns_per_op = best * 1e9 / iterations;
+	result.bytes_per_sec = bytes_per_op > 0 ? bytes_per_op * iterations / best : 0.0;
+	return result;
+}
+
+/**
+ * \brief Format a byte count using binary prefixes
+ * \param bytes Byte count
+ * \return Human-readable string, e.g. "64 KiB"
+ */
+inline std::string FormatBytes(size_t bytes)
+{
+	char buf[32];
+	if (bytes >= (1ULL << 30) && bytes % (1ULL << 30) == 0)
+		snprintf(buf, sizeof(buf), "%zu GiB", bytes >> 30);
+	else if (bytes >= (1ULL << 20) && bytes % (1ULL << 20) == 0)
+		snprintf(buf, sizeof(buf), "%zu MiB", bytes >> 20);
+	else if (bytes >= (1ULL << 10) && bytes % (1ULL << 10) == 0)
+		snprintf(buf, sizeof(buf), "%zu KiB", bytes >> 10);
+	else
+		snprintf(buf, sizeof(buf), "%zu B", bytes);
+	return buf;
+}
+
+/**
+ * \brief Print a section title and the column headings
+ * \param title Title of the section
+ */
+inline void PrintHeader(std::string const& title)
+{
+	printf("\n== %s ==\n", title.c_str());
+	printf("%-52s %10s %12s %12s %12s %10s\n", "benchmark", "size", "iterations", "ns/op", "MB/s", "vs base");
+}
+
+/**
+ * \brief Print one result row
+ * \param size Size label of the row (the swept parameter)
+ * \param result Result to print
+ * \param baseline Optional baseline; if given, the ratio baseline_ns / result_ns is printed
+ *
+ * A ratio above 1 means the measured operation is faster than the baseline.
+ */
+inline void PrintResult(size_t size, BenchmarkResult const& result, BenchmarkResult const* baseline = nullptr)
+{
+	char ratio[16] = "";
+	if (baseline != nullptr && result.ns_per_op > 0)
+	{
+		snprintf(ratio, sizeof(ratio), "%.2fx", baseline->ns_per_op / result.ns_per_op);
+	}
+	char rate[16] = "-";
+	if (result.bytes_per_sec > 0)
+	{
+		snprintf(rate, sizeof(rate), "%.1f", result.bytes_per_sec / 1e6);
+	}
+	printf("%-52s %10s %12zu %12.1f %12s %10s\n", result.name.c_str(), FormatBytes(size).c_str(), result.iterations, result.ns_per_op, rate, ratio);
+	fflush(stdout);
+}
+
+/**
+ * \brief Determine the sizes to sweep
+ * \param argc Argument count from main
+ * \param argv Arguments from main; each one, if present, is a size in bytes
+ * \param defaults Sizes to use if no arguments are given
+ * \return List of sizes, in bytes
+ */
+inline std::vector<size_t> SizeSweep(int argc, char** argv, std::vector<size_t> const& defaults)
+{
+	std::vector<size_t> sizes;
+	for (int ii = 1; ii < argc; ++ii)
+	{
+		sizes.push_back(strtoull(argv[ii], nullptr, 0));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	return sizes.empty() ? defaults : sizes;
+}
+
+}  // namespace bench
+
+#endif  // ARTDAQ_CORE_TEST_BENCHMARKS_BENCHMARKSHIMS_HH
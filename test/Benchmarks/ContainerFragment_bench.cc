@@ -0,0 +1,204 @@
+// Build and unpack benchmarks for artdaq::ContainerFragment
+//
+// Usage: ContainerFragment_bench
+// Sweeps the number of contained blocks and the size of each block, and reports the cost of
+// building a container (addFragment per block and a single addFragments call) and of
+// unpacking it (at(), fragSize() and fragmentIndex() over every block). Containers using the
+// fixed-size MetadataV0 layout are measured separately, since every access to them goes
+// through the metadata upgrade path.
+//
+// Environment:
+//   ARTDAQ_BENCH_MAX_BYTES          Skip combinations whose total payload exceeds this (default 256 MiB)
+//   ARTDAQ_BENCH_MAX_ADD_BLOCKS     Largest block count measured with per-block addFragment (default 10000),
+//                                   since each addFragment call rebuilds the whole index
+
+#include "artdaq-core/Data/ContainerFragmentLoader.hh"
+
+#include "BenchmarkShims.hh"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+size_t EnvOrDefault(char const* name, size_t def)
+{
+	auto env = getenv(name);
+	return env != nullptr ? strtoull(env, nullptr, 0) : def;
+}
+
+artdaq::FragmentPtrs MakeBlocks(size_t count, size_t block_bytes)
+{
+	artdaq::FragmentPtrs blocks;
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		auto frag = artdaq::Fragment::FragmentBytes(block_bytes);
+		frag->setSequenceID(1);
+		frag->setFragmentID(ii);
+		frag->setUserType(1);
+		memset(frag->dataBeginBytes(), static_cast<int>(ii), block_bytes);
+		blocks.push_back(std::move(frag));
+	}
+	return blocks;
+}
+
+/// Build a container in the pre-index layout: MetadataV0 with its fixed array of offsets
+artdaq::Fragment MakeV0Container(artdaq::FragmentPtrs const& blocks)
+{
+	artdaq::ContainerFragment::MetadataV0 md{};
+	md.block_count = blocks.size();
+	md.fragment_type = 1;
+	md.missing_data = 0;
+
+	size_t total = 0;
+	size_t ii = 0;
+	for (auto const& block : blocks)
+	{
+		total += block->sizeBytes();
+		md.index[ii++] = total;  // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+	}
+
+	artdaq::Fragment container(total / sizeof(artdaq::RawDataType), 1, 0, artdaq::Fragment::ContainerFragmentType, md);
+	auto dest = container.dataBeginBytes();
+	for (auto const& block : blocks)
+	{
+		memcpy(dest, block->headerAddress(), block->sizeBytes());
+		dest += block->sizeBytes();  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	return container;
+}
+
+std::string Label(std::string const& op, size_t count)
+{
+	return op + " (" + std::to_string(count) + " blocks)";
+}
+
+void BuildBenchmarks(artdaq::FragmentPtrs& blocks, size_t block_bytes, size_t max_add_blocks)
+{
+	auto count = blocks.size();
+	auto total = count * block_bytes;
+
+	// Baseline: copy the same bytes into a preallocated buffer
+	std::vector<uint8_t> flat(total + count * sizeof(artdaq::detail::RawFragmentHeader));
+	auto memcpyResult = bench::RunBenchmark(Label("memcpy blocks [baseline]", count), total, [&] {
+		auto dest = flat.data();
+		for (auto& block : blocks)
+		{
+			memcpy(dest, block->headerAddress(), block->sizeBytes());
+			dest += block->sizeBytes();  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		}
+		bench::DoNotOptimize(flat.data());
+	});
+	bench::PrintResult(block_bytes, memcpyResult);
+
+	if (count <= max_add_blocks)
+	{
+		auto add = bench::RunBenchmark(Label("addFragment per block", count), total, [&] {
+			artdaq::Fragment container(0);
+			artdaq::ContainerFragmentLoader loader(container);
+			for (auto& block : blocks)
+			{
+				loader.addFragment(block);
+			}
+			bench::DoNotOptimize(container.headerAddress());
+		});
+		bench::PrintResult(block_bytes, add, &memcpyResult);
+	}
+
+	auto addAll = bench::RunBenchmark(Label("addFragments", count), total, [&] {
+		artdaq::Fragment container(0);
+		artdaq::ContainerFragmentLoader loader(container);
+		loader.addFragments(blocks);
+		bench::DoNotOptimize(container.headerAddress());
+	});
+	bench::PrintResult(block_bytes, addAll, &memcpyResult);
+}
+
+void UnpackBenchmarks(artdaq::Fragment const& container, size_t block_bytes, std::string const& layout)
+{
+	artdaq::ContainerFragment cf(container);
+	auto count = cf.block_count();
+	auto total = count * block_bytes;
+
+	auto at = bench::RunBenchmark(Label(layout + " at() every block", count), total, [&] {
+		for (size_t ii = 0; ii < count; ++ii)
+		{
+			auto frag = cf.at(ii);
+			bench::DoNotOptimize(frag->headerAddress());
+		}
+	});
+	bench::PrintResult(block_bytes, at);
+
+	auto sizes = bench::RunBenchmark(Label(layout + " fragSize() every block", count), 0, [&] {
+		size_t sum = 0;
+		for (size_t ii = 0; ii < count; ++ii)
+		{
+			sum += cf.fragSize(ii);
+		}
+		bench::DoNotOptimize(sum);
+	});
+	bench::PrintResult(block_bytes, sizes);
+
+	auto index = bench::RunBenchmark(Label(layout + " fragmentIndex() every block", count), 0, [&] {
+		size_t sum = 0;
+		for (size_t ii = 0; ii < count; ++ii)
+		{
+			sum += cf.fragmentIndex(ii);
+		}
+		bench::DoNotOptimize(sum);
+	});
+	bench::PrintResult(block_bytes, index);
+
+	// A fresh ContainerFragment per access is the common pattern in art modules; for V0 this
+	// re-runs the metadata upgrade each time
+	auto fresh = bench::RunBenchmark(Label(layout + " new view + fragSize(last)", count), 0, [&] {
+		artdaq::ContainerFragment view(container);
+		bench::DoNotOptimize(view.fragSize(view.block_count() - 1));
+	});
+	bench::PrintResult(block_bytes, fresh);
+}
+
+}  // namespace
+
+int main(int, char**)
+{
+	auto const max_bytes = EnvOrDefault("ARTDAQ_BENCH_MAX_BYTES", 256 * 1024 * 1024);
+	auto const max_add_blocks = EnvOrDefault("ARTDAQ_BENCH_MAX_ADD_BLOCKS", 10000);
+
+	// Metadata::block_count is a 16-bit field, so 65535 is the largest container that can be built
+	std::vector<size_t> const counts{10, 100, 1000, 10000, 65535};
+	std::vector<size_t> const block_sizes{64, 1024, 16 * 1024, 256 * 1024, 1024 * 1024};
+
+	bench::PrintHeader("ContainerFragment build");
+	for (auto count : counts)
+	{
+		for (auto block_bytes : block_sizes)
+		{
+			if (count * block_bytes > max_bytes) continue;
+			auto blocks = MakeBlocks(count, block_bytes);
+			BuildBenchmarks(blocks, block_bytes, max_add_blocks);
+		}
+	}
+
+	bench::PrintHeader("ContainerFragment unpack");
+	for (auto count : counts)
+	{
+		for (auto block_bytes : block_sizes)
+		{
+			if (count * block_bytes > max_bytes) continue;
+			auto blocks = MakeBlocks(count, block_bytes);
+			artdaq::Fragment container(0);
+			artdaq::ContainerFragmentLoader loader(container);
+			loader.addFragments(blocks);
+			UnpackBenchmarks(container, block_bytes, "V1");
+
+			if (count <= static_cast<size_t>(artdaq::ContainerFragment::MetadataV0::CONTAINER_FRAGMENT_COUNT_MAX))
+			{
+				auto v0 = MakeV0Container(blocks);
+				UnpackBenchmarks(v0, block_bytes, "V0");
+			}
+		}
+	}
+
+	return 0;
+}
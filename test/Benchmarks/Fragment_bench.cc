@@ -0,0 +1,365 @@
+// Microbenchmarks for artdaq::Fragment and artdaq::QuickVec
+//
+// Usage: Fragment_bench [size_in_bytes ...]
+// Without arguments, a default sweep of payload sizes is measured. Each row reports the
+// cost of one operation in ns and the corresponding payload throughput; rows measuring
+// Fragment or QuickVec are compared against the equivalent std::vector operation.
+
+#include "artdaq-core/Core/QuickVec.hh"
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core/Data/FragmentSort.hh"
+
+#include "BenchmarkShims.hh"
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct BenchMetadata
+{
+	uint64_t run;
+	uint64_t board;
+	uint64_t channel_mask;
+};
+
+size_t Words(size_t bytes)
+{
+	return (bytes + sizeof(artdaq::RawDataType) - 1) / sizeof(artdaq::RawDataType);
+}
+
+/// Build a Fragment whose header is still in the RawFragmentHeaderV1 layout, so that every
+/// header access has to go through the version upgrade path
+artdaq::Fragment MakeV1Fragment(size_t payload_words)
+{
+	auto hdr_words = artdaq::detail::RawFragmentHeaderV1::num_words();
+	artdaq::QuickVec<artdaq::RawDataType> vals(hdr_words + payload_words, 0);
+	artdaq::detail::RawFragmentHeaderV1 hdr{};
+	hdr.word_count = hdr_words + payload_words;
+	hdr.version = artdaq::detail::RawFragmentHeaderV1::CurrentVersion;
+	hdr.type = artdaq::Fragment::DataFragmentType;
+	hdr.metadata_word_count = 0;
+	hdr.sequence_id = 1;
+	hdr.fragment_id = 2;
+	hdr.timestamp = 3;
+	memcpy(&vals[0], &hdr, sizeof(hdr));
+
+	artdaq::Fragment frag;
+	frag.swap(vals);
+	return frag;
+}
+
+void ConstructionBenchmarks(size_t bytes)
+{
+	auto words = Words(bytes);
+	auto vec = bench::RunBenchmark("std::vector<RawDataType>(n) [baseline]", bytes, [&] {
+		std::vector<artdaq::RawDataType> v(words);
+		bench::DoNotOptimize(v.data());
+	});
+	bench::PrintResult(bytes, vec);
+
+	auto qv = bench::RunBenchmark("QuickVec<RawDataType>(n)", bytes, [&] {
+		artdaq::QuickVec<artdaq::RawDataType> q(words);
+		bench::DoNotOptimize(q.begin());
+	});
+	bench::PrintResult(bytes, qv, &vec);
+
+	auto frag = bench::RunBenchmark("Fragment(n)", bytes, [&] {
+		artdaq::Fragment f(words);
+		bench::DoNotOptimize(f.headerAddress());
+	});
+	bench::PrintResult(bytes, frag, &vec);
+
+	auto fragBytes = bench::RunBenchmark("Fragment::FragmentBytes(nbytes)", bytes, [&] {
+		auto f = artdaq::Fragment::FragmentBytes(bytes);
+		bench::DoNotOptimize(f->headerAddress());
+	});
+	bench::PrintResult(bytes, fragBytes, &vec);
+}
+
+void ResizeBenchmarks(size_t bytes)
+{
+	auto words = Words(bytes);
+	auto vec = bench::RunBenchmark("std::vector::resize (0 -> n) [baseline]", bytes, [&] {
+		std::vector<artdaq::RawDataType> v;
+		v.resize(words);
+		bench::DoNotOptimize(v.data());
+	});
+	bench::PrintResult(bytes, vec);
+
+	auto frag = bench::RunBenchmark("Fragment::resizeBytes (0 -> n)", bytes, [&] {
+		artdaq::Fragment f;
+		f.resizeBytes(bytes);
+		bench::DoNotOptimize(f.headerAddress());
+	});
+	bench::PrintResult(bytes, frag, &vec);
+
+	// Growing a payload in small steps is what readout code appending hardware blocks does
+	size_t const step = 4096;
+	auto vecGrow = bench::RunBenchmark("std::vector::resize (grow 4 KiB steps) [baseline]", bytes, [&] {
+		std::vector<artdaq::RawDataType> v;
+		for (size_t sz = step; sz < bytes + step; sz += step)
+		{
+			v.resize(Words(std::min(sz, bytes)));
+		}
+		bench::DoNotOptimize(v.data());
+	});
+	bench::PrintResult(bytes, vecGrow);
+
+	auto fragGrow = bench::RunBenchmark("Fragment::resizeBytes (grow 4 KiB steps)", bytes, [&] {
+		artdaq::Fragment f;
+		for (size_t sz = step; sz < bytes + step; sz += step)
+		{
+			f.resizeBytes(std::min(sz, bytes));
+		}
+		bench::DoNotOptimize(f.headerAddress());
+	});
+	bench::PrintResult(bytes, fragGrow, &vecGrow);
+
+	auto fragCushion = bench::RunBenchmark("Fragment::resizeBytesWithCushion (grow 4 KiB)", bytes, [&] {
+		artdaq::Fragment f;
+		for (size_t sz = step; sz < bytes + step; sz += step)
+		{
+			f.resizeBytesWithCushion(std::min(sz, bytes));
+		}
+		bench::DoNotOptimize(f.headerAddress());
+	});
+	bench::PrintResult(bytes, fragCushion, &vecGrow);
+}
+
+void MetadataBenchmarks(size_t bytes)
+{
+	auto words = Words(bytes);
+	BenchMetadata md{1, 2, 0xFF};
+
+	auto ctor = bench::RunBenchmark("Fragment(n, seq, id, type, metadata)", bytes, [&] {
+		artdaq::Fragment f(words, 1, 2, 1, md);
+		bench::DoNotOptimize(f.headerAddress());
+	});
+	bench::PrintResult(bytes, ctor);
+
+	// setMetadata on an existing payload has to shift the payload to make room
+	auto set = bench::RunBenchmark("Fragment(n) + setMetadata", bytes, [&] {
+		artdaq::Fragment f(words);
+		f.setMetadata(md);
+		bench::DoNotOptimize(f.headerAddress());
+	});
+	bench::PrintResult(bytes, set, &ctor);
+
+	artdaq::Fragment frag(words, 1, 2, 1, md);
+	auto update = bench::RunBenchmark("Fragment::updateMetadata", bytes, [&] {
+		frag.updateMetadata(md);
+		bench::ClobberMemory();
+	});
+	bench::PrintResult(bytes, update);
+
+	artdaq::Fragment const& cfrag = frag;
+	auto read = bench::RunBenchmark("Fragment::metadata<T>() const", bytes, [&] {
+		bench::DoNotOptimize(cfrag.metadata<BenchMetadata>()->channel_mask);
+		bench::ClobberMemory();
+	});
+	bench::PrintResult(bytes, read);
+}
+
+void HeaderAccessorBenchmarks(size_t bytes)
+{
+	auto words = Words(bytes);
+	artdaq::Fragment current(words);
+	current.setSequenceID(1);
+	current.setFragmentID(2);
+	current.setTimestamp(3);
+	artdaq::Fragment const& cur = current;
+
+	// Baseline: read the bitfield directly from the current-version header
+	auto raw = bench::RunBenchmark("RawFragmentHeader::sequence_id [baseline]", 0, [&] {
+		auto hdr = reinterpret_cast<artdaq::detail::RawFragmentHeader const*>(&*cur.headerBegin());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		bench::DoNotOptimize(hdr->sequence_id);
+		bench::ClobberMemory();
+	});
+	bench::PrintResult(bytes, raw);
+
+	auto seq = bench::RunBenchmark("Fragment::sequenceID (V2)", 0, [&] {
+		bench::DoNotOptimize(cur.sequenceID());
+		bench::ClobberMemory();
+	});
+	bench::PrintResult(bytes, seq, &raw);
+
+	auto all = bench::RunBenchmark("Fragment seq+id+ts+type+size (V2)", 0, [&] {
+		bench::DoNotOptimize(cur.sequenceID());
+		bench::DoNotOptimize(cur.fragmentID());
+		bench::DoNotOptimize(cur.timestamp());
+		bench::DoNotOptimize(cur.type());
+		bench::DoNotOptimize(cur.size());
+		bench::ClobberMemory();
+	});
+	bench::PrintResult(bytes, all, &raw);
+
+	auto dataSize = bench::RunBenchmark("Fragment::dataSizeBytes (V2)", 0, [&] {
+		bench::DoNotOptimize(cur.dataSizeBytes());
+		bench::ClobberMemory();
+	});
+	bench::PrintResult(bytes, dataSize, &raw);
+
+	auto old = MakeV1Fragment(words);
+	artdaq::Fragment const& oldc = old;
+	auto seqV1 = bench::RunBenchmark("Fragment::sequenceID (V1, upgraded per call)", 0, [&] {
+		bench::DoNotOptimize(oldc.sequenceID());
+		bench::ClobberMemory();
+	});
+	bench::PrintResult(bytes, seqV1, &raw);
+
+	auto allV1 = bench::RunBenchmark("Fragment seq+id+ts+type+size (V1)", 0, [&] {
+		bench::DoNotOptimize(oldc.sequenceID());
+		bench::DoNotOptimize(oldc.fragmentID());
+		bench::DoNotOptimize(oldc.timestamp());
+		bench::DoNotOptimize(oldc.type());
+		bench::DoNotOptimize(oldc.size());
+		bench::ClobberMemory();
+	});
+	bench::PrintResult(bytes, allV1, &raw);
+}
+
+void CopyMoveBenchmarks(size_t bytes)
+{
+	auto words = Words(bytes);
+	std::vector<artdaq::RawDataType> vsrc(words, 1);
+	artdaq::QuickVec<artdaq::RawDataType> qsrc(words, 1);
+	artdaq::Fragment fsrc(words);
+	fsrc.setSequenceID(1);
+
+	auto vecCopy = bench::RunBenchmark("std::vector copy-construct [baseline]", bytes, [&] {
+		std::vector<artdaq::RawDataType> v(vsrc);
+		bench::DoNotOptimize(v.data());
+	});
+	bench::PrintResult(bytes, vecCopy);
+
+	auto qvCopy = bench::RunBenchmark("QuickVec copy-construct", bytes, [&] {
+		artdaq::QuickVec<artdaq::RawDataType> q(qsrc);
+		bench::DoNotOptimize(q.begin());
+	});
+	bench::PrintResult(bytes, qvCopy, &vecCopy);
+
+	auto fragCopy = bench::RunBenchmark("Fragment copy-construct", bytes, [&] {
+		artdaq::Fragment f(fsrc);
+		bench::DoNotOptimize(f.headerAddress());
+	});
+	bench::PrintResult(bytes, fragCopy, &vecCopy);
+
+	std::vector<artdaq::RawDataType> va(vsrc), vb;
+	auto vecMove = bench::RunBenchmark("std::vector move-assign x2 [baseline]", 0, [&] {
+		vb = std::move(va);
+		va = std::move(vb);
+		bench::DoNotOptimize(va.data());
+	});
+	bench::PrintResult(bytes, vecMove);
+
+	artdaq::QuickVec<artdaq::RawDataType> qa(qsrc), qb(0);
+	auto qvMove = bench::RunBenchmark("QuickVec move-assign x2", 0, [&] {
+		qb = std::move(qa);
+		qa = std::move(qb);
+		bench::DoNotOptimize(qa.begin());
+	});
+	bench::PrintResult(bytes, qvMove, &vecMove);
+
+	artdaq::Fragment fa(fsrc), fb;
+	auto fragMove = bench::RunBenchmark("Fragment move-assign x2", 0, [&] {
+		fb = std::move(fa);
+		fa = std::move(fb);
+		bench::DoNotOptimize(fa.headerAddress());
+	});
+	bench::PrintResult(bytes, fragMove, &vecMove);
+}
+
+void SortBenchmarks(size_t count)
+{
+	// Sequence IDs and timestamps are uncorrelated, so alternating between the two keys keeps
+	// every sort working on unsorted input
+	std::mt19937_64 gen(count);
+	artdaq::FragmentPtrs frags;
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		frags.emplace_back(new artdaq::Fragment(1000 + gen() % (count / 8 + 1), gen() % 64, artdaq::Fragment::FirstUserFragmentType, gen() >> 16));
+	}
+	auto bytes = count * frags.front()->sizeBytes();
+	auto suffix = ", " + std::to_string(count) + " frags";
+
+	auto bySeq = [](artdaq::FragmentPtr const& a, artdaq::FragmentPtr const& b) {
+		return a->sequenceID() < b->sequenceID() || (a->sequenceID() == b->sequenceID() && a->fragmentID() < b->fragmentID());
+	};
+	auto byTs = [](artdaq::FragmentPtr const& a, artdaq::FragmentPtr const& b) { return a->timestamp() < b->timestamp(); };
+	auto listSort = bench::RunBenchmark("std::list::sort seq then ts" + suffix + " [baseline]", bytes, [&] {
+		frags.sort(bySeq);
+		frags.sort(byTs);
+		bench::DoNotOptimize(frags.front().get());
+	});
+	bench::PrintResult(bytes, listSort);
+
+	auto radixSort = bench::RunBenchmark("SortFragments seq then ts" + suffix, bytes, [&] {
+		artdaq::SortFragments(frags, artdaq::FragmentSortKey::SequenceID);
+		artdaq::SortFragments(frags, artdaq::FragmentSortKey::Timestamp);
+		bench::DoNotOptimize(frags.front().get());
+	});
+	bench::PrintResult(bytes, radixSort, &listSort);
+
+	// Merging: split the batch into per-source streams, each sorted by sequence ID
+	size_t const sources = 16;
+	std::vector<artdaq::FragmentPtrs> streams(sources);
+	auto resetStreams = [&] {
+		for (auto& frag : frags)
+		{
+			streams[frag->fragmentID() % sources].push_back(std::move(frag));
+		}
+		frags.clear();
+		for (auto& stream : streams)
+		{
+			artdaq::SortFragments(stream);
+		}
+	};
+
+	auto resortAll = bench::RunBenchmark("split + SortFragments all" + suffix + " [baseline]", bytes, [&] {
+		resetStreams();
+		for (auto& stream : streams)
+		{
+			frags.splice(frags.end(), stream);
+		}
+		artdaq::SortFragments(frags);
+		bench::DoNotOptimize(frags.front().get());
+	});
+	bench::PrintResult(bytes, resortAll);
+
+	auto merge = bench::RunBenchmark("split + MergeSortedFragments" + suffix, bytes, [&] {
+		resetStreams();
+		frags = artdaq::MergeSortedFragments(streams);
+		bench::DoNotOptimize(frags.front().get());
+	});
+	bench::PrintResult(bytes, merge, &resortAll);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	auto sizes = bench::SizeSweep(argc, argv, {0, 64, 1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024, 64 * 1024 * 1024});
+
+	bench::PrintHeader("Construction");
+	for (auto size : sizes) ConstructionBenchmarks(size);
+
+	bench::PrintHeader("Resize");
+	for (auto size : sizes) ResizeBenchmarks(size);
+
+	bench::PrintHeader("Metadata");
+	for (auto size : sizes) MetadataBenchmarks(size);
+
+	bench::PrintHeader("Header accessors");
+	HeaderAccessorBenchmarks(sizes.front());
+
+	bench::PrintHeader("Copy and move");
+	for (auto size : sizes) CopyMoveBenchmarks(size);
+
+	bench::PrintHeader("Sorting and merging");
+	for (auto count : {1000, 10000, 100000}) SortBenchmarks(count);
+
+	return 0;
+}
@@ -0,0 +1,225 @@
+// Multi-threaded contention benchmark for artdaq::MonitoredQuantity and artdaq::StatisticsCollection
+//
+// Usage: MonitoredQuantity_bench [thread_count ...]
+// For each thread count, worker threads call addSample() in a tight loop, either all on one
+// shared MonitoredQuantity or each on its own, while a calculator thread repeatedly runs
+// calculateStatistics() over every quantity the way StatisticsCollection::run() does. The
+// quantities are also registered with the StatisticsCollection singleton, so its own
+// calculation thread runs concurrently as it would in a DAQ process. Reported are the
+// aggregate sample rate, the addSample() latency distribution (1 call in 16 is timed) and
+// the duration of the calculation passes. A final section measures the calculation pass
+// duration against the number of registered quantities.
+//
+// Environment:
+//   ARTDAQ_BENCH_DURATION           Duration of each measurement, in seconds (default 1.0)
+//   ARTDAQ_BENCH_CALC_INTERVAL_MS   Interval between calculation passes, in ms (default 10)
+
+#include "artdaq-core/Core/StatisticsCollection.hh"
+
+#include "BenchmarkShims.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double EnvOrDefault(char const* name, double def)
+{
+	auto env = getenv(name);
+	return env != nullptr ? atof(env) : def;
+}
+
+double Percentile(std::vector<double>& values, double fraction)
+{
+	if (values.empty()) return 0.0;
+	auto idx = static_cast<size_t>(fraction * (values.size() - 1));
+	std::nth_element(values.begin(), values.begin() + idx, values.end());
+	return values[idx];
+}
+
+struct CalculationTimes
+{
+	std::vector<double> pass_ns;
+};
+
+/// Mimics StatisticsCollection::run(): take the map lock, then calculate every quantity
+void CalculatorLoop(std::vector<artdaq::MonitoredQuantityPtr> const& quantities, std::mutex& map_mutex,
+                    std::atomic<bool>& stop, double interval_ms, CalculationTimes& times)
+{
+	while (!stop.load())
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(interval_ms * 1000)));
+		auto start = Clock::now();
+		{
+			std::lock_guard<std::mutex> lk(map_mutex);
+			auto now = artdaq::MonitoredQuantity::getCurrentTime();
+			for (auto const& mq : quantities)
+			{
+				mq->calculateStatistics(now);
+			}
+		}
+		times.pass_ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+	}
+}
+
+struct WorkerResult
+{
+	uint64_t samples{0};
+	std::vector<double> latency_ns;
+};
+
+void WorkerLoop(artdaq::MonitoredQuantity& mq, std::atomic<bool>& go, std::atomic<bool>& stop, WorkerResult& result)
+{
+	result.latency_ns.reserve(1 << 20);
+	while (!go.load()) {}
+
+	uint64_t count = 0;
+	while (!stop.load(std::memory_order_relaxed))
+	{
+		if ((count & 0xF) == 0)
+		{
+			auto start = Clock::now();
+			mq.addSample(1.0);
+			auto ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+			if (result.latency_ns.size() < result.latency_ns.capacity()) result.latency_ns.push_back(ns);
+		}
+		else
+		{
+			mq.addSample(1.0);
+		}
+		++count;
+	}
+	result.samples = count;
+}
+
+artdaq::MonitoredQuantityPtr MakeQuantity(std::string const& name)
+{
+	auto mq = std::make_shared<artdaq::MonitoredQuantity>(1.0, 60.0);
+	artdaq::StatisticsCollection::getInstance().addMonitoredQuantity(name, mq);
+	return mq;
+}
+
+void ContentionBenchmark(size_t threads, bool shared, double duration, double interval_ms)
+{
+	std::vector<artdaq::MonitoredQuantityPtr> quantities;
+	for (size_t ii = 0; ii < (shared ? 1 : threads); ++ii)
+	{
+		quantities.push_back(MakeQuantity("MonitoredQuantity_bench_" + std::to_string(ii)));
+	}
+
+	std::atomic<bool> go{false};
+	std::atomic<bool> stop{false};
+	std::atomic<bool> calc_stop{false};
+	std::mutex map_mutex;
+	CalculationTimes calc_times;
+	std::thread calculator(CalculatorLoop, std::cref(quantities), std::ref(map_mutex), std::ref(calc_stop), interval_ms, std::ref(calc_times));
+
+	std::vector<WorkerResult> results(threads);
+	std::vector<std::thread> workers;
+	for (size_t ii = 0; ii < threads; ++ii)
+	{
+		auto& mq = *quantities[shared ? 0 : ii];
+		workers.emplace_back(WorkerLoop, std::ref(mq), std::ref(go), std::ref(stop), std::ref(results[ii]));
+	}
+
+	auto start = Clock::now();
+	go = true;
+	std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+	stop = true;
+	for (auto& worker : workers) worker.join();
+	auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+	calc_stop = true;
+	calculator.join();
+
+	uint64_t samples = 0;
+	std::vector<double> latencies;
+	for (auto& result : results)
+	{
+		samples += result.samples;
+		latencies.insert(latencies.end(), result.latency_ns.begin(), result.latency_ns.end());
+	}
+
+	printf("%-8s %8zu %14.3g %12.0f %10.0f %10.0f %10.0f %12.0f %10zu %12.0f %12.0f\n",
+	       shared ? "shared" : "private", threads, samples / elapsed, samples / elapsed / threads,
+	       Percentile(latencies, 0.5), Percentile(latencies, 0.99), Percentile(latencies, 0.999),
+	       latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end()),
+	       calc_times.pass_ns.size(), Percentile(calc_times.pass_ns, 0.5),
+	       calc_times.pass_ns.empty() ? 0.0 : *std::max_element(calc_times.pass_ns.begin(), calc_times.pass_ns.end()));
+	fflush(stdout);
+}
+
+void CalculationPassBenchmark(size_t quantity_count, size_t writer_threads, double duration, double interval_ms)
+{
+	std::vector<artdaq::MonitoredQuantityPtr> quantities;
+	for (size_t ii = 0; ii < quantity_count; ++ii)
+	{
+		quantities.push_back(std::make_shared<artdaq::MonitoredQuantity>(1.0, 60.0));
+	}
+
+	std::atomic<bool> stop{false};
+	std::atomic<bool> calc_stop{false};
+	std::mutex map_mutex;
+	CalculationTimes calc_times;
+	std::thread calculator(CalculatorLoop, std::cref(quantities), std::ref(map_mutex), std::ref(calc_stop), interval_ms, std::ref(calc_times));
+
+	std::vector<std::thread> writers;
+	for (size_t ii = 0; ii < writer_threads; ++ii)
+	{
+		writers.emplace_back([&, ii] {
+			size_t idx = ii;
+			while (!stop.load(std::memory_order_relaxed))
+			{
+				quantities[idx % quantity_count]->addSample(1.0);
+				idx += writer_threads;
+			}
+		});
+	}
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+	stop = true;
+	for (auto& writer : writers) writer.join();
+	calc_stop = true;
+	calculator.join();
+
+	printf("%12zu %8zu %10zu %14.0f %14.0f %14.0f %14.1f\n", quantity_count, writer_threads, calc_times.pass_ns.size(),
+	       Percentile(calc_times.pass_ns, 0.5), Percentile(calc_times.pass_ns, 0.99),
+	       calc_times.pass_ns.empty() ? 0.0 : *std::max_element(calc_times.pass_ns.begin(), calc_times.pass_ns.end()),
+	       Percentile(calc_times.pass_ns, 0.5) / quantity_count);
+	fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	auto const duration = EnvOrDefault("ARTDAQ_BENCH_DURATION", 1.0);
+	auto const interval_ms = EnvOrDefault("ARTDAQ_BENCH_CALC_INTERVAL_MS", 10.0);
+	auto thread_counts = bench::SizeSweep(argc, argv, {1, 2, 4, 8, 16, 32, 64});
+
+	printf("\n== MonitoredQuantity::addSample contention (hardware threads: %u) ==\n", std::thread::hardware_concurrency());
+	printf("%-8s %8s %14s %12s %10s %10s %10s %12s %10s %12s %12s\n", "mode", "threads", "samples/s", "per thread",
+	       "p50 ns", "p99 ns", "p99.9 ns", "max ns", "calc pass", "calc p50 ns", "calc max ns");
+	for (auto threads : thread_counts)
+	{
+		ContentionBenchmark(threads, true, duration, interval_ms);
+		ContentionBenchmark(threads, false, duration, interval_ms);
+	}
+
+	printf("\n== Calculation pass duration vs number of quantities (4 writer threads) ==\n");
+	printf("%12s %8s %10s %14s %14s %14s %14s\n", "quantities", "writers", "passes", "p50 ns", "p99 ns", "max ns", "ns/quantity");
+	for (size_t count : {1, 10, 100, 1000, 10000})
+	{
+		CalculationPassBenchmark(count, 4, duration, interval_ms);
+	}
+
+	artdaq::StatisticsCollection::getInstance().requestStop();
+	return 0;
+}
@@ -0,0 +1,179 @@
+// Benchmark for the per-buffer operations of artdaq::SharedMemoryManager
+//
+// Usage: SharedMemoryManager_bench [fragments_per_event ...]
+// For each count, an event of that many small Fragments is written into one buffer, then a reader
+// walks it the way SharedMemoryEventReceiver::GetFragmentsByType does: MoreDataInBuffer, CheckBuffer,
+// Read of the Fragment header and IncrementReadPos over the payload, for every Fragment. The walk is
+// timed once with buffer IDs (one buffer mutex lock per call) and once with a BufferToken (no locks).
+//
+// The second section measures the event rate of several writer threads sharing one segment, compared
+// with a StripedSharedMemoryManager with one stripe per writer. A reader thread drains the buffers.
+//
+// The third section measures writes into a full monitoring segment that nobody reads: overwrite mode
+// (two scans per event) compared with RingMode (next buffer in O(1)).
+
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Core/StripedSharedMemoryManager.hh"
+#include "artdaq-core/Data/Fragment.hh"
+
+#include "BenchmarkShims.hh"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t PayloadWords = 8;
+
+using Flags = artdaq::SharedMemoryManager::BufferSemaphoreFlags;
+
+template<typename Handle>
+size_t WalkEvent(artdaq::SharedMemoryManager& reader, Handle const& handle)
+{
+	size_t fragments = 0;
+	artdaq::detail::RawFragmentHeader header;
+	reader.ResetReadPos(handle);
+	while (reader.MoreDataInBuffer(handle))
+	{
+		if (!reader.CheckBuffer(handle, Flags::Reading)) break;
+		reader.Read(handle, &header, sizeof(header));
+		reader.IncrementReadPos(handle, (header.word_count - artdaq::detail::RawFragmentHeader::num_words()) * sizeof(artdaq::RawDataType));
+		++fragments;
+	}
+	return fragments;
+}
+
+void WalkBenchmarks(size_t count)
+{
+	auto fragment_bytes = (artdaq::detail::RawFragmentHeader::num_words() + PayloadWords) * sizeof(artdaq::RawDataType);
+	auto key = 0x7E570000 + (getpid() & 0xFFFF);
+	// No buffer timeout: the reader holds its buffer for the whole benchmark
+	artdaq::SharedMemoryManager writer(key, 2, count * fragment_bytes, 0);
+	artdaq::SharedMemoryManager reader(key);
+
+	auto buffer = writer.GetBufferForWriting(false);
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		artdaq::Fragment frag(PayloadWords);
+		frag.setSequenceID(1);
+		frag.setFragmentID(ii);
+		frag.setUserType(1);
+		writer.Write(buffer, frag.headerAddress(), frag.sizeBytes());
+	}
+	writer.MarkBufferFull(buffer);
+
+	auto token = reader.GetBufferTokenForReading();
+	if (!token.valid())
+	{
+		printf("Unable to claim the event buffer\n");
+		return;
+	}
+
+	auto baseline = bench::RunBenchmark("walk with buffer ID [baseline]", 0, [&] { bench::DoNotOptimize(WalkEvent(reader, token.buffer())); });
+	bench::PrintResult(count * fragment_bytes, baseline);
+	auto result = bench::RunBenchmark("walk with BufferToken", 0, [&] { bench::DoNotOptimize(WalkEvent(reader, token)); });
+	bench::PrintResult(count * fragment_bytes, result, &baseline);
+	printf("  %zu Fragments: %.1f ns/Fragment with buffer ID, %.1f ns/Fragment with BufferToken\n", count, baseline.ns_per_op / count, result.ns_per_op / count);
+
+	reader.MarkBufferEmpty(token.buffer());
+}
+
+// Events per second written by the given number of threads, each writing events_per_writer small events
+double WriteRate(size_t writers, size_t stripes, size_t events_per_writer)
+{
+	std::vector<uint32_t> keys;
+	for (size_t ii = 0; ii < stripes; ++ii)
+	{
+		keys.push_back(0x7E580000 + ((getpid() & 0xFFF) << 4) + ii);
+	}
+	artdaq::StripedSharedMemoryManager man(keys, 64 / stripes, 0x400, 0);
+	artdaq::StripedSharedMemoryManager reader(keys);
+	std::atomic<bool> done{false};
+
+	std::thread drain([&] {
+		while (!done || reader.ReadReadyCount() > 0)
+		{
+			auto buf = reader.GetBufferForReading();
+			if (buf.valid())
+				reader.MarkBufferEmpty(buf);
+			else
+				std::this_thread::yield();
+		}
+	});
+
+	uint8_t payload[0x100] = {};
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (size_t ww = 0; ww < writers; ++ww)
+	{
+		threads.emplace_back([&] {
+			for (size_t ii = 0; ii < events_per_writer; ++ii)
+			{
+				auto buf = man.GetBufferForWriting(false);
+				while (!buf.valid())
+				{
+					std::this_thread::yield();
+					buf = man.GetBufferForWriting(false);
+				}
+				man.Write(buf, payload, sizeof(payload));
+				man.MarkBufferFull(buf);
+			}
+		});
+	}
+	for (auto& thread : threads) thread.join();
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	done = true;
+	drain.join();
+	return writers * events_per_writer / seconds;
+}
+
+void WriterBenchmarks(size_t writers)
+{
+	const size_t events = 20000;
+	auto single = WriteRate(writers, 1, events);
+	auto striped = WriteRate(writers, writers, events);
+	printf("%8zu %18.0f %18.0f %10.2fx\n", writers, single, striped, striped / single);
+	fflush(stdout);
+}
+
+void OverwriteBenchmarks(size_t buffers)
+{
+	auto key = 0x7E590000 + (getpid() & 0xFFFF);
+	uint64_t payload = 0;
+	bench::BenchmarkResult baseline;
+	for (uint32_t flags : {0u, static_cast<uint32_t>(artdaq::SharedMemoryManager::RingMode)})
+	{
+		artdaq::SharedMemoryManager man(key, buffers, 0x100, 0, true, flags);
+		auto name = std::string(flags == 0 ? "overwrite mode [baseline]" : "RingMode");
+		auto result = bench::RunBenchmark(name, 0, [&] {
+			auto buf = man.GetBufferForWriting(true);
+			man.Write(buf, &payload, sizeof(payload));
+			man.MarkBufferFull(buf);
+		});
+		bench::PrintResult(buffers, result, flags == 0 ? nullptr : &baseline);
+		if (flags == 0) baseline = result;
+	}
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	auto counts = bench::SizeSweep(argc, argv, {10, 100, 1000});
+
+	bench::PrintHeader("Fragment walk (size is the event size)");
+	for (auto count : counts) WalkBenchmarks(count);
+
+	printf("\n== Concurrent writers (events/s, one segment vs one stripe per writer) ==\n");
+	printf("%8s %18s %18s %11s\n", "writers", "one segment", "striped", "speedup");
+	for (size_t writers : {1, 2, 4, 8, 16}) WriterBenchmarks(writers);
+
+	bench::PrintHeader("Writes into a full, unread segment (size is the buffer count)");
+	for (size_t buffers : {16, 256, 4096}) OverwriteBenchmarks(buffers);
+
+	return 0;
+}
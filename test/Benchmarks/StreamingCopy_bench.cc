@@ -0,0 +1,182 @@
+// Benchmark for artdaq::StreamingCopy, the copy kernels used by SharedMemoryManager::Write
+//
+// Usage: StreamingCopy_bench [size_in_bytes ...]
+// For each size, every supported kernel copies a source buffer into a rotating set of destination
+// buffers (as a writer filling shared memory buffers would). The first section reports the copy
+// throughput, compared against memcpy. The second section models the cost to the copying thread:
+// after each copy, the thread walks its own 1 MiB working set again. It reports the time of that
+// walk and, when perf_event_open is allowed, the cache misses per copy. Streaming kernels should
+// leave the working set in the cache, so the walk stays fast.
+//
+// Environment:
+//   ARTDAQ_BENCH_POOL_MB   Total size of the destination buffers, in MiB (default 256)
+
+#include "artdaq-core/Core/StreamingCopy.hh"
+
+#include "BenchmarkShims.hh"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using artdaq::StreamingCopy::Kernel;
+
+constexpr size_t WorkingSetBytes = 1024 * 1024;
+
+/// Counts hardware cache misses of the calling thread, if the kernel allows it
+class CacheMissCounter
+{
+public:
+	CacheMissCounter()
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+	~CacheMissCounter()
+	{
+		if (fd_ != -1) close(fd_);
+	}
+	CacheMissCounter(CacheMissCounter const&) = delete;
+	CacheMissCounter& operator=(CacheMissCounter const&) = delete;
+
+	bool valid() const { return fd_ != -1; }
+	void start()
+	{
+		if (fd_ == -1) return;
+		ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	uint64_t stop()
+	{
+		uint64_t count = 0;
+		if (fd_ == -1) return 0;
+		ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(fd_, &count, sizeof(count)) != sizeof(count)) return 0;
+		return count;
+	}
+
+private:
+	int fd_{-1};
+};
+
+struct Buffers
+{
+	explicit Buffers(size_t size)
+	    : src(size, 0x5A)
+	{
+		auto env = getenv("ARTDAQ_BENCH_POOL_MB");
+		size_t pool = (env != nullptr ? strtoull(env, nullptr, 0) : 256) * 1024 * 1024;
+		auto count = std::max<size_t>(2, pool / std::max<size_t>(size, 1));
+		dest.resize(std::min<size_t>(count, 4096));
+		for (auto& buf : dest) buf.resize(size, 0);
+	}
+
+	uint8_t* next() { return dest[index++ % dest.size()].data(); }
+
+	std::vector<uint8_t> src;
+	std::vector<std::vector<uint8_t>> dest;
+	size_t index{0};
+};
+
+uint64_t WalkWorkingSet(std::vector<uint64_t> const& working_set)
+{
+	uint64_t sum = 0;
+	for (size_t ii = 0; ii < working_set.size(); ii += 8)  // one access per cache line
+	{
+		sum += working_set[ii];
+	}
+	return sum;
+}
+
+std::vector<Kernel> SupportedKernels()
+{
+	std::vector<Kernel> kernels;
+	for (auto kernel : {Kernel::Scalar, Kernel::AVX2, Kernel::AVX512})
+	{
+		if (artdaq::StreamingCopy::IsSupported(kernel)) kernels.push_back(kernel);
+	}
+	return kernels;
+}
+
+void ThroughputBenchmarks(size_t bytes)
+{
+	Buffers buffers(bytes);
+	bench::BenchmarkResult baseline;
+	for (auto kernel : SupportedKernels())
+	{
+		auto name = "CopyWith(" + artdaq::StreamingCopy::KernelToString(kernel) + ")" + (kernel == Kernel::Scalar ? " [baseline]" : "");
+		auto result = bench::RunBenchmark(name, bytes, [&] {
+			artdaq::StreamingCopy::CopyWith(kernel, buffers.next(), buffers.src.data(), bytes);
+			bench::ClobberMemory();
+		});
+		if (kernel == Kernel::Scalar) baseline = result;
+		bench::PrintResult(bytes, result, kernel == Kernel::Scalar ? nullptr : &baseline);
+	}
+}
+
+void WorkingSetBenchmarks(size_t bytes, CacheMissCounter& counter)
+{
+	Buffers buffers(bytes);
+	std::vector<uint64_t> working_set(WorkingSetBytes / sizeof(uint64_t), 1);
+	auto iterations = std::max<size_t>(16, (512 * 1024 * 1024) / std::max<size_t>(bytes, 1));
+	iterations = std::min<size_t>(iterations, 20000);
+
+	for (auto kernel : SupportedKernels())
+	{
+		bench::DoNotOptimize(WalkWorkingSet(working_set));
+		double walk_ns = 0.0;
+		counter.start();
+		auto start = std::chrono::steady_clock::now();
+		for (size_t ii = 0; ii < iterations; ++ii)
+		{
+			artdaq::StreamingCopy::CopyWith(kernel, buffers.next(), buffers.src.data(), bytes);
+			auto walk_start = std::chrono::steady_clock::now();
+			bench::DoNotOptimize(WalkWorkingSet(working_set));
+			walk_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - walk_start).count();
+		}
+		auto total_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		auto misses = counter.stop();
+
+		char miss_str[32] = "n/a";
+		if (counter.valid()) snprintf(miss_str, sizeof(miss_str), "%.0f", static_cast<double>(misses) / iterations);
+		printf("%-12s %10s %12zu %14.1f %14.1f %16s\n", artdaq::StreamingCopy::KernelToString(kernel).c_str(), bench::FormatBytes(bytes).c_str(),
+		       iterations, (total_ns - walk_ns) / iterations, walk_ns / iterations, miss_str);
+		fflush(stdout);
+	}
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	auto sizes = bench::SizeSweep(argc, argv, {64 * 1024, 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024});
+
+	printf("Selected kernel: %s, Copy threshold: %zu bytes\n", artdaq::StreamingCopy::KernelToString(artdaq::StreamingCopy::SelectedKernel()).c_str(),
+	       artdaq::StreamingCopy::Threshold());
+
+	bench::PrintHeader("Copy throughput");
+	for (auto size : sizes) ThroughputBenchmarks(size);
+
+	CacheMissCounter counter;
+	printf("\n== Working set disturbance (%s working set walked after each copy) ==\n", bench::FormatBytes(WorkingSetBytes).c_str());
+	if (!counter.valid()) printf("perf_event_open is not available (see /proc/sys/kernel/perf_event_paranoid), cache misses are not reported\n");
+	printf("%-12s %10s %12s %14s %14s %16s\n", "kernel", "size", "iterations", "copy ns/op", "walk ns/op", "cache misses/op");
+	for (auto size : sizes) WorkingSetBenchmarks(size, counter);
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+#include "artdaq-core/Core/SharedMemoryAwaitables.hh"
+
+#define BOOST_TEST_MODULE SharedMemoryAwaitables_t
+#include "cetlib/quiet_unit_test.hpp"
+#include "cetlib_except/exception.h"
+
+#define TRACE_NAME "SharedMemoryAwaitables_t"
+#include "SharedMemoryTestShims.hh"
+#include "TRACE/tracemf.h"
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryAwaitables_test)
+
+#ifdef ARTDAQ_CORE_HAS_COROUTINES
+namespace {
+artdaq::SharedMemoryTask Produce(artdaq::SharedMemoryEventLoop& loop, artdaq::SharedMemoryManager& segment, size_t first, size_t count)
+{
+	for (size_t value = first; value < first + count; ++value)
+	{
+		int buf = co_await loop.reserve_for_write(segment);
+		if (buf == -1) co_return;
+		segment.Write(buf, &value, sizeof(value));
+		segment.MarkBufferFull(buf);
+	}
+}
+
+artdaq::SharedMemoryTask Consume(artdaq::SharedMemoryEventLoop& loop, artdaq::SharedMemoryManager& segment, size_t count, std::vector<size_t>& values)
+{
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		int buf = co_await loop.next_buffer(segment);
+		if (buf == -1) co_return;
+		size_t value = 0;
+		segment.Read(buf, &value, sizeof(value));
+		values.push_back(value);
+		segment.MarkBufferEmpty(buf);
+	}
+}
+
+artdaq::SharedMemoryTask Fail(artdaq::SharedMemoryEventLoop& loop, artdaq::SharedMemoryManager& segment)
+{
+	co_await loop.next_buffer(segment);
+	throw cet::exception("AwaitableTest") << "Consumer failed";
+}
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(ProducerAndConsumer)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ProducerAndConsumer";
+	uint32_t key = GetRandomKey(0xA3A1);
+	artdaq::SharedMemoryManager writer(key, 4, 0x100);
+	artdaq::SharedMemoryManager reader(key);
+
+	// The producer fills the segment, then both coroutines take turns on one thread
+	artdaq::SharedMemoryEventLoop loop;
+	std::vector<size_t> values;
+	loop.spawn(Consume(loop, reader, 20, values));
+	loop.spawn(Produce(loop, writer, 0, 20));
+	BOOST_REQUIRE_EQUAL(loop.task_count(), 2);
+	loop.run();
+	BOOST_REQUIRE_EQUAL(values.size(), 20);
+	for (size_t ii = 0; ii < values.size(); ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(values[ii], ii);
+	}
+	TLOG(TLVL_DEBUG) << "END TEST ProducerAndConsumer";
+}
+
+BOOST_AUTO_TEST_CASE(SeveralSegments)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST SeveralSegments";
+	uint32_t key = GetRandomKey(0xA3A1);
+	artdaq::SharedMemoryManager data_writer(key, 4, 0x100);
+	artdaq::SharedMemoryManager broadcast_writer(key + 1, 4, 0x100);
+	artdaq::SharedMemoryManager data(key);
+	artdaq::SharedMemoryManager broadcasts(key + 1);
+
+	artdaq::SharedMemoryEventLoop loop;
+	std::vector<size_t> data_values, broadcast_values;
+	loop.spawn(Consume(loop, data, 3, data_values));
+	loop.spawn(Consume(loop, broadcasts, 1, broadcast_values));
+	BOOST_REQUIRE_EQUAL(loop.run_once(1000), 0);
+
+	// Writes from another thread wake up the loop
+	std::thread other([&] {
+		usleep(10000);
+		for (size_t value : {1, 2, 3})
+		{
+			auto buf = data_writer.GetBufferForWriting(false);
+			data_writer.Write(buf, &value, sizeof(value));
+			data_writer.MarkBufferFull(buf);
+		}
+		size_t value = 100;
+		auto buf = broadcast_writer.GetBufferForWriting(false);
+		broadcast_writer.Write(buf, &value, sizeof(value));
+		broadcast_writer.MarkBufferFull(buf);
+	});
+	auto start = artdaq::TimeUtils::gettimeofday_us();
+	while (loop.task_count() > 0 && artdaq::TimeUtils::gettimeofday_us() - start < 10000000)
+	{
+		loop.run_once(1000000);
+	}
+	other.join();
+	BOOST_REQUIRE_EQUAL(loop.task_count(), 0);
+	BOOST_REQUIRE(data_values == std::vector<size_t>({1, 2, 3}));
+	BOOST_REQUIRE(broadcast_values == std::vector<size_t>({100}));
+	TLOG(TLVL_DEBUG) << "END TEST SeveralSegments";
+}
+
+BOOST_AUTO_TEST_CASE(Exceptions)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Exceptions";
+	uint32_t key = GetRandomKey(0xA3A1);
+	artdaq::SharedMemoryManager writer(key, 4, 0x100);
+	artdaq::SharedMemoryManager reader(key);
+	artdaq::SharedMemoryEventLoop loop;
+	loop.spawn(Fail(loop, reader));
+	loop.spawn(Produce(loop, writer, 0, 1));
+	BOOST_REQUIRE_EXCEPTION(loop.run_once(1000), cet::exception, [&](cet::exception e) { return e.category() == "AwaitableTest"; });
+	BOOST_REQUIRE_EQUAL(loop.task_count(), 0);
+	TLOG(TLVL_DEBUG) << "END TEST Exceptions";
+}
+#else
+BOOST_AUTO_TEST_CASE(NoCoroutines)
+{
+	TLOG(TLVL_INFO) << "The compiler does not support C++20 coroutines, SharedMemoryEventLoop is not available";
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,219 @@
+#include <vector>
+
+#include "artdaq-core/Core/SharedMemoryEventReceiver.hh"
+#include "artdaq-core/Core/SharedMemoryManager.hh"
+#include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core/Data/RawEvent.hh"
+#include "artdaq-core/Utilities/TimeUtils.hh"
+#include "artdaq-core/Utilities/configureMessageFacility.hh"
+
+#define BOOST_TEST_MODULE SharedMemoryEventReceiver_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#define TRACE_NAME "SharedMemoryEventReceiver_t"
+#include "SharedMemoryTestShims.hh"
+#include "TRACE/tracemf.h"
+
+namespace {
+// Write an event with one Fragment, whose payload starts with the sequence ID
+void WriteEvent(artdaq::SharedMemoryManager& man, artdaq::Fragment::sequence_id_t seq)
+{
+	auto buf = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	artdaq::detail::RawEventHeader hdr(1, 1, 1, seq, 0);
+	man.Write(buf, &hdr, sizeof(hdr));
+	artdaq::Fragment frag(4);
+	frag.setSequenceID(seq);
+	frag.setFragmentID(1);
+	frag.setUserType(3);
+	*frag.dataBegin() = seq;
+	man.Write(buf, frag.headerAddress(), frag.sizeBytes());
+	man.MarkBufferFull(buf);
+}
+
+// Wait for the prefetch thread of a receiver to claim a buffer, as seen from another manager
+bool WaitForPrefetch(artdaq::SharedMemoryManager& man)
+{
+	auto start = artdaq::TimeUtils::gettimeofday_us();
+	while (artdaq::TimeUtils::gettimeofday_us() - start < 1000000)
+	{
+		for (auto const& buf : man.GetBufferReport())
+		{
+			if (buf.second == artdaq::SharedMemoryManager::BufferSemaphoreFlags::Reading)
+			{
+				return true;
+			}
+		}
+		usleep(1000);
+	}
+	return false;
+}
+
+// Read the next event from a receiver, returning its sequence ID (0 if there is none)
+artdaq::Fragment::sequence_id_t ReadEvent(artdaq::SharedMemoryEventReceiver& recv)
+{
+	if (!recv.ReadyForRead(false, 100000))
+	{
+		return 0;
+	}
+	bool err = false;
+	auto hdr = recv.ReadHeader(err);
+	BOOST_REQUIRE(!err && hdr != nullptr);
+	auto seq = hdr->sequence_id;
+	auto frags = recv.GetFragmentsByType(err, 3);
+	BOOST_REQUIRE(!err && frags->size() == 1);
+	BOOST_REQUIRE_EQUAL(*frags->front().dataBegin(), seq);
+	recv.ReleaseBuffer();
+	return seq;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryEventReceiver_test)
+
+BOOST_AUTO_TEST_CASE(Prefetch)
+{
+	artdaq::configureMessageFacility("SharedMemoryEventReceiver_t", true, true);
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Prefetch";
+	uint32_t key = GetRandomKey(0xE7E7);
+	artdaq::SharedMemoryManager man(key, 4, 0x400);
+	artdaq::SharedMemoryManager broadcasts(key + 1, 2, 0x400);
+	artdaq::SharedMemoryEventReceiver recv(key, key + 1);
+
+	recv.SetPrefetch(true);
+	BOOST_REQUIRE(recv.GetPrefetch());
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 3; ++seq)
+	{
+		WriteEvent(man, seq);
+	}
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 1);
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 2);
+
+	// Event 3 is held by the prefetch thread; disabling prefetching gives it back unread
+	BOOST_REQUIRE(WaitForPrefetch(man));
+	recv.SetPrefetch(false);
+	BOOST_REQUIRE(!recv.GetPrefetch());
+	BOOST_REQUIRE_EQUAL(man.ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 3);
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 0);
+	TLOG(TLVL_DEBUG) << "END TEST Prefetch";
+}
+
+BOOST_AUTO_TEST_CASE(PrefetchBroadcastMode)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST PrefetchBroadcastMode";
+	uint32_t key = GetRandomKey(0xE7E7);
+	artdaq::SharedMemoryManager man(key, 4, 0x400, 100 * 1000000, false);
+	artdaq::SharedMemoryManager broadcasts(key + 1, 2, 0x400);
+	artdaq::SharedMemoryEventReceiver recv(key, key + 1);
+
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 3; ++seq)
+	{
+		WriteEvent(man, seq);
+	}
+	recv.SetPrefetch(true);
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 1);
+	BOOST_REQUIRE(WaitForPrefetch(man));
+	recv.SetPrefetch(false);
+
+	// The event held in advance was not seen, so it is not skipped
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 2);
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 3);
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 0);
+	TLOG(TLVL_DEBUG) << "END TEST PrefetchBroadcastMode";
+}
+
+BOOST_AUTO_TEST_CASE(PrefetchKeepsBufferFresh)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST PrefetchKeepsBufferFresh";
+	uint32_t key = GetRandomKey(0xE7E7);
+	artdaq::SharedMemoryManager man(key, 4, 0x400, 100000);
+	artdaq::SharedMemoryManager broadcasts(key + 1, 2, 0x400);
+	artdaq::SharedMemoryManager other(key);
+	artdaq::SharedMemoryEventReceiver recv(key, key + 1);
+
+	WriteEvent(man, 1);
+	recv.SetPrefetch(true);
+	BOOST_REQUIRE(WaitForPrefetch(man));
+
+	// Held for several buffer timeouts; another reader must not find it stale
+	for (int ii = 0; ii < 5; ++ii)
+	{
+		usleep(100000);
+		for (size_t buf = 0; buf < other.size(); ++buf)
+		{
+			BOOST_REQUIRE(!other.ResetBuffer(buf));
+		}
+	}
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 1);
+	TLOG(TLVL_DEBUG) << "END TEST PrefetchKeepsBufferFresh";
+}
+
+BOOST_AUTO_TEST_CASE(DestroyWhilePrefetching)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST DestroyWhilePrefetching";
+	uint32_t key = GetRandomKey(0xE7E7);
+	artdaq::SharedMemoryManager man(key, 4, 0x400);
+	artdaq::SharedMemoryManager broadcasts(key + 1, 2, 0x400);
+
+	WriteEvent(man, 1);
+	WriteEvent(man, 2);
+	{
+		artdaq::SharedMemoryEventReceiver recv(key, key + 1);
+		recv.SetPrefetch(true);
+		BOOST_REQUIRE_EQUAL(ReadEvent(recv), 1);
+		BOOST_REQUIRE(WaitForPrefetch(man));
+	}
+
+	// The destructor gave the prefetched event back to the other readers
+	BOOST_REQUIRE_EQUAL(man.ReadReadyCount(), 1);
+	artdaq::SharedMemoryEventReceiver recv(key, key + 1);
+	BOOST_REQUIRE_EQUAL(ReadEvent(recv), 2);
+	TLOG(TLVL_DEBUG) << "END TEST DestroyWhilePrefetching";
+}
+
+BOOST_AUTO_TEST_CASE(LateReceiverCatchUp)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST LateReceiverCatchUp";
+	uint32_t key = GetRandomKey(0xE7E7);
+	artdaq::SharedMemoryManager man(key, 4, 0x400);
+	artdaq::SharedMemoryManager broadcasts(key + 1, 4, 0x400, 100 * 1000000, false, artdaq::SharedMemoryManager::PinnedSlots);
+
+	auto write_broadcast = [&broadcasts](artdaq::Fragment::type_t type, artdaq::Fragment::sequence_id_t seq, bool pin) {
+		auto buf = broadcasts.GetBufferForWriting(true);
+		BOOST_REQUIRE_NE(buf, -1);
+		artdaq::detail::RawEventHeader hdr(1, 1, 1, seq, 0);
+		broadcasts.Write(buf, &hdr, sizeof(hdr));
+		artdaq::Fragment frag(1);
+		frag.setSequenceID(seq);
+		frag.setSystemType(type);
+		broadcasts.Write(buf, frag.headerAddress(), frag.sizeBytes());
+		BOOST_REQUIRE_EQUAL(!pin || broadcasts.PinBuffer(buf, type), true);
+		broadcasts.MarkBufferFull(buf);
+	};
+
+	// The pinned events are also still in live broadcast buffers when the receiver attaches
+	write_broadcast(artdaq::Fragment::InitFragmentType, 1, true);
+	write_broadcast(artdaq::Fragment::EndOfSubrunFragmentType, 2, true);
+	write_broadcast(artdaq::Fragment::EndOfRunFragmentType, 3, false);
+	WriteEvent(man, 4);
+
+	artdaq::SharedMemoryEventReceiver recv(key, key + 1);
+	BOOST_REQUIRE_EQUAL(recv.CatchUpCount(), 2);
+	std::vector<artdaq::Fragment::sequence_id_t> seen;
+	while (recv.ReadyForRead(false, 100000))
+	{
+		bool err = false;
+		auto hdr = recv.ReadHeader(err);
+		BOOST_REQUIRE(!err && hdr != nullptr);
+		seen.push_back(hdr->sequence_id);
+		recv.ReleaseBuffer();
+	}
+
+	// Each event exactly once: the pinned copies first, then the newer broadcast, then the data
+	std::vector<artdaq::Fragment::sequence_id_t> expected{1, 2, 3, 4};
+	BOOST_REQUIRE_EQUAL_COLLECTIONS(seen.begin(), seen.end(), expected.begin(), expected.end());
+	BOOST_REQUIRE_EQUAL(recv.CatchUpCount(), 0);
+	TLOG(TLVL_DEBUG) << "END TEST LateReceiverCatchUp";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
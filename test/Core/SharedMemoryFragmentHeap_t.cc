@@ -0,0 +1,194 @@
+#define TRACE_NAME "SharedMemoryFragmentHeap_t"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "TRACE/tracemf.h"
+#include "artdaq-core/Core/SharedMemoryFragmentHeap.hh"
+#include "artdaq-core/Data/Fragment.hh"
+
+#define BOOST_TEST_MODULE(SharedMemoryFragmentHeap_t)
+#include "SharedMemoryTestShims.hh"
+#include "cetlib/quiet_unit_test.hpp"
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryFragmentHeap_test)
+
+BOOST_AUTO_TEST_CASE(AllocateAndFree)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST AllocateAndFree";
+	uint32_t key = GetRandomKey(0x4EA9);
+	artdaq::SharedMemoryFragmentHeap heap(key, 0x10000);
+	BOOST_REQUIRE_EQUAL(heap.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(heap.ArenaSize(), 0x10000);
+
+	auto small = heap.Allocate(100);
+	auto large = heap.Allocate(0x1001);
+	BOOST_REQUIRE(small != nullptr);
+	BOOST_REQUIRE(large != nullptr);
+	BOOST_REQUIRE_EQUAL(reinterpret_cast<uintptr_t>(small) % QV_ALIGN, 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	BOOST_REQUIRE_EQUAL(heap.UsableSize(small), QV_ALIGN);
+	BOOST_REQUIRE_EQUAL(heap.UsableSize(large), 0x2000);
+	BOOST_REQUIRE_EQUAL(heap.UsedBytes(), QV_ALIGN + 0x2000);
+
+	// Freed blocks are reused for the same size class
+	heap.Free(large);
+	BOOST_REQUIRE_EQUAL(heap.UsedBytes(), QV_ALIGN);
+	BOOST_REQUIRE_EQUAL(heap.Allocate(0x1800), large);
+
+	// When the arena is used up, free blocks of larger classes are handed out
+	std::vector<void*> blocks;
+	for (auto block = heap.Allocate(QV_ALIGN); block != nullptr; block = heap.Allocate(QV_ALIGN))
+	{
+		blocks.push_back(block);
+	}
+	heap.Free(large);
+	BOOST_REQUIRE_EQUAL(heap.Allocate(QV_ALIGN), large);
+	BOOST_REQUIRE(heap.Allocate(QV_ALIGN) == nullptr);
+	TLOG(TLVL_INFO) << "END TEST AllocateAndFree";
+}
+
+BOOST_AUTO_TEST_CASE(ZeroCopyHandoff)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST ZeroCopyHandoff";
+	uint32_t key = GetRandomKey(0x4EA9);
+	artdaq::SharedMemoryFragmentHeap writer(key, 0x100000);
+	artdaq::SharedMemoryFragmentHeap reader(key);
+	BOOST_REQUIRE_EQUAL(reader.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(reader.ArenaSize(), 0x100000);
+
+	artdaq::SharedMemoryFragmentHeap::Handle handle;
+	{
+		artdaq::SharedMemoryFragmentHeap::Scope scope(writer);
+		artdaq::Fragment frag(0);
+		frag.setSequenceID(7);
+		frag.setFragmentID(3);
+		frag.setUserType(2);
+		BOOST_REQUIRE(writer.Contains(frag.headerBeginBytes()));
+
+		// Grow the Fragment the way generators do; it stays in the arena
+		for (size_t words = 16; words <= 0x2000; words *= 2)
+		{
+			auto old_size = frag.dataSize();
+			frag.resizeBytesWithCushion(words * sizeof(artdaq::RawDataType));
+			for (size_t ii = old_size; ii < words; ++ii)
+			{
+				*(frag.dataBegin() + ii) = ii;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			}
+			BOOST_REQUIRE(writer.Contains(frag.headerBeginBytes()));
+		}
+		handle = writer.Export(std::move(frag));
+	}
+	BOOST_REQUIRE(handle.valid());
+	BOOST_REQUIRE_EQUAL(handle.length, (0x2000 + artdaq::detail::RawFragmentHeader::num_words()) * sizeof(artdaq::RawDataType));
+	auto used = writer.UsedBytes();
+	BOOST_REQUIRE_GT(used, 0);
+
+	// The reader maps the same memory at another address
+	artdaq::Fragment received;
+	BOOST_REQUIRE_EQUAL(reader.Import(handle, received), true);
+	BOOST_REQUIRE(reader.Contains(received.headerBeginBytes()));
+	BOOST_REQUIRE(!writer.Contains(received.headerBeginBytes()));
+	BOOST_REQUIRE_EQUAL(received.sequenceID(), 7);
+	BOOST_REQUIRE_EQUAL(received.fragmentID(), 3);
+	BOOST_REQUIRE_EQUAL(received.dataSize(), 0x2000);
+	for (size_t ii = 0; ii < received.dataSize(); ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(*(received.dataBegin() + ii), ii);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	BOOST_REQUIRE_EQUAL(reader.UsedBytes(), used);
+
+	// The handle was consumed by the Import, in whichever process tries it again
+	artdaq::Fragment duplicate;
+	BOOST_REQUIRE_EQUAL(writer.Import(handle, duplicate), false);
+	BOOST_REQUIRE_EQUAL(reader.Import(handle, duplicate), false);
+	reader.Release(handle);
+	BOOST_REQUIRE_EQUAL(reader.UsedBytes(), used);
+
+	// Destroying the received Fragment returns the block to the heap
+	received = artdaq::Fragment();
+	BOOST_REQUIRE_EQUAL(writer.UsedBytes(), 0);
+	TLOG(TLVL_INFO) << "END TEST ZeroCopyHandoff";
+}
+
+BOOST_AUTO_TEST_CASE(ExportCopiesHeapFragments)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST ExportCopiesHeapFragments";
+	uint32_t key = GetRandomKey(0x4EA9);
+	artdaq::SharedMemoryFragmentHeap heap(key, 0x4000);
+
+	artdaq::Fragment frag(4);
+	frag.setSequenceID(1);
+	BOOST_REQUIRE(!heap.Contains(frag.headerBeginBytes()));
+	auto handle = heap.Export(std::move(frag));
+	BOOST_REQUIRE(handle.valid());
+	BOOST_REQUIRE_EQUAL(heap.UsedBytes(), QV_ALIGN);
+
+	// A handle which is not imported is released explicitly
+	heap.Release(handle);
+	BOOST_REQUIRE_EQUAL(heap.UsedBytes(), 0);
+	artdaq::Fragment received;
+	BOOST_REQUIRE_EQUAL(heap.Import(handle, received), false);
+
+	// A released handle stays consumed when its block is allocated again
+	auto block = heap.Allocate(QV_ALIGN);
+	BOOST_REQUIRE(block != nullptr);
+	heap.Release(handle);
+	BOOST_REQUIRE_EQUAL(heap.Import(handle, received), false);
+	BOOST_REQUIRE_EQUAL(heap.UsedBytes(), QV_ALIGN);
+	heap.Free(block);
+	BOOST_REQUIRE_EQUAL(heap.UsedBytes(), 0);
+
+	// Fragments which do not fit are refused
+	BOOST_REQUIRE(!heap.Export(artdaq::Fragment(0x1000)).valid());
+	TLOG(TLVL_INFO) << "END TEST ExportCopiesHeapFragments";
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentAllocations)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST ConcurrentAllocations";
+	const size_t threads = 4;
+	const size_t iterations = 5000;
+	uint32_t key = GetRandomKey(0x4EA9);
+	artdaq::SharedMemoryFragmentHeap heap(key, 0x400000);
+
+	std::vector<std::thread> workers;
+	std::atomic<size_t> corrupted{0};
+	for (size_t tt = 0; tt < threads; ++tt)
+	{
+		workers.emplace_back([&heap, &corrupted, tt, iterations] {
+			std::vector<void*> held;
+			for (size_t ii = 0; ii < iterations; ++ii)
+			{
+				auto block = heap.Allocate(QV_ALIGN << (ii % 4));
+				if (block != nullptr)
+				{
+					// Stamp the block, so that a block handed out twice is detected below
+					memset(block, static_cast<int>(tt + 1), QV_ALIGN);
+					held.push_back(block);
+				}
+				if (held.size() > 8)
+				{
+					auto victim = held.front();
+					if (*static_cast<uint8_t*>(victim) != tt + 1) ++corrupted;
+					heap.Free(victim);
+					held.erase(held.begin());
+				}
+			}
+			for (auto block : held)
+			{
+				heap.Free(block);
+			}
+		});
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	BOOST_REQUIRE_EQUAL(corrupted, 0);
+	BOOST_REQUIRE_EQUAL(heap.UsedBytes(), 0);
+	TLOG(TLVL_INFO) << "END TEST ConcurrentAllocations";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,7 +17,7 @@ BOOST_AUTO_TEST_CASE(Construct)
 {
 	artdaq::configureMessageFacility("SharedMemoryFragmentManager_t", true, true);
 	TLOG(TLVL_INFO) << "BEGIN TEST Construct";
-	artdaq::SharedMemoryFragmentManager man(GetRandomKey(0xF4A6), 10, 0x1000);
+	artdaq::SharedMemoryFragmentManager man(GetRandomKey(0xF4A6), 10, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
 	BOOST_REQUIRE_EQUAL(man.IsValid(), true);
 	BOOST_REQUIRE_EQUAL(man.GetMyId(), 0);
 	BOOST_REQUIRE_EQUAL(man.size(), 10);
@@ -29,8 +29,8 @@ BOOST_AUTO_TEST_CASE(Attach)
 {
 	TLOG(TLVL_INFO) << "BEGIN TEST Attach";
 	uint32_t key = GetRandomKey(0xF4A6);
-	artdaq::SharedMemoryFragmentManager man(key, 10, 0x1000);
-	artdaq::SharedMemoryFragmentManager man2(key);
+	artdaq::SharedMemoryFragmentManager man(key, 10, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryFragmentManager man2(key, 0, 0, 0, SHM_TEST_FLAGS);
 
 	BOOST_REQUIRE_EQUAL(man.IsValid(), true);
 	BOOST_REQUIRE_EQUAL(man.GetMyId(), 0);
@@ -48,8 +48,8 @@ BOOST_AUTO_TEST_CASE(Reattach)
 {
 	TLOG(TLVL_INFO) << "BEGIN TEST Reattach";
 	uint32_t key = GetRandomKey(0xF4A6);
-	std::unique_ptr<artdaq::SharedMemoryFragmentManager> man(new artdaq::SharedMemoryFragmentManager(key, 10, 0x1000));
-	std::unique_ptr<artdaq::SharedMemoryFragmentManager> man2(new artdaq::SharedMemoryFragmentManager(key));
+	std::unique_ptr<artdaq::SharedMemoryFragmentManager> man(new artdaq::SharedMemoryFragmentManager(key, 10, 0x1000, 100 * 1000000, SHM_TEST_FLAGS));
+	std::unique_ptr<artdaq::SharedMemoryFragmentManager> man2(new artdaq::SharedMemoryFragmentManager(key, 0, 0, 0, SHM_TEST_FLAGS));
 
 	BOOST_REQUIRE_EQUAL(man->IsValid(), true);
 	BOOST_REQUIRE_EQUAL(man->GetMyId(), 0);
@@ -65,7 +65,7 @@ BOOST_AUTO_TEST_CASE(Reattach)
 	BOOST_REQUIRE_EQUAL(man->IsValid(), true);
 	BOOST_REQUIRE_EQUAL(man->GetAttachedCount(), 1);
 
-	man2 = std::make_unique<artdaq::SharedMemoryFragmentManager>(key);
+	man2 = std::make_unique<artdaq::SharedMemoryFragmentManager>(key, 0, 0, 0, SHM_TEST_FLAGS);
 	BOOST_REQUIRE_EQUAL(man->IsValid(), true);
 	BOOST_REQUIRE_EQUAL(man->GetMyId(), 0);
 	BOOST_REQUIRE_EQUAL(man->size(), 10);
@@ -86,7 +86,7 @@ BOOST_AUTO_TEST_CASE(Reattach)
 	man2->Attach();
 	BOOST_REQUIRE_EQUAL(man2->IsValid(), false);
 
-	man = std::make_unique<artdaq::SharedMemoryFragmentManager>(key, 10, 0x1000);
+	man = std::make_unique<artdaq::SharedMemoryFragmentManager>(key, 10, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
 	BOOST_REQUIRE_EQUAL(man->IsValid(), true);
 	BOOST_REQUIRE_EQUAL(man->GetMyId(), 0);
 	BOOST_REQUIRE_EQUAL(man->size(), 10);
@@ -107,8 +107,8 @@ BOOST_AUTO_TEST_CASE(DataFlow)
 	TLOG(TLVL_INFO) << "BEGIN TEST DataFlow";
 	TLOG(TLVL_DEBUG) << "Initializing SharedMemoryFragmentManagers for DataFlow test";
 	uint32_t key = GetRandomKey(0xF4A6);
-	artdaq::SharedMemoryFragmentManager man(key, 10, 0x1000);
-	artdaq::SharedMemoryFragmentManager man2(key);
+	artdaq::SharedMemoryFragmentManager man(key, 10, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryFragmentManager man2(key, 0, 0, 0, SHM_TEST_FLAGS);
 
 	auto fragSizeWords = 0x1000 / sizeof(artdaq::RawDataType) - artdaq::detail::RawFragmentHeader::num_words() - 1;
 
@@ -159,8 +159,8 @@ BOOST_AUTO_TEST_CASE(WholeFragment)
 	TLOG(TLVL_INFO) << "BEGIN TEST WholeFragment";
 	TLOG(TLVL_DEBUG) << "Initializing SharedMemoryFragmentManagers for WholeFragment Test";
 	uint32_t key = GetRandomKey(0xF4A6);
-	artdaq::SharedMemoryFragmentManager man(key, 10, 0x1000);
-	artdaq::SharedMemoryFragmentManager man2(key);
+	artdaq::SharedMemoryFragmentManager man(key, 10, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryFragmentManager man2(key, 0, 0, 0, SHM_TEST_FLAGS);
 
 	auto fragSizeWords = 0x1000 / sizeof(artdaq::RawDataType) - artdaq::detail::RawFragmentHeader::num_words() - 1;
 
@@ -202,12 +202,44 @@ BOOST_AUTO_TEST_CASE(WholeFragment)
 	TLOG(TLVL_INFO) << "END TEST WholeFragment";
 }
 
+BOOST_AUTO_TEST_CASE(SharedFragment)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST SharedFragment";
+	uint32_t key = GetRandomKey(0xF4A6);
+	artdaq::SharedMemoryFragmentManager man(key, 10, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryFragmentManager man2(key, 0, 0, 0, SHM_TEST_FLAGS);
+
+	artdaq::Fragment frag(64);
+	frag.setSequenceID(0x10);
+	for (size_t ii = 0; ii < 64; ++ii)
+	{
+		*(frag.dataBegin() + ii) = ii;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	frag.makeShared();
+
+	// The copy is written straight from the shared storage, without unsharing either Fragment
+	artdaq::Fragment copy(frag);
+	BOOST_REQUIRE_EQUAL(man.WriteFragment(std::move(copy), false, 0), 0);
+	BOOST_REQUIRE_EQUAL(copy.isShared(), true);  // NOLINT(bugprone-use-after-move,hicpp-invalid-access-moved)
+	BOOST_REQUIRE_EQUAL(frag.isShared(), true);
+
+	artdaq::Fragment recvdFrag;
+	BOOST_REQUIRE_EQUAL(man2.ReadFragment(recvdFrag), 0);
+	BOOST_REQUIRE_EQUAL(recvdFrag.sequenceID(), 0x10);
+	BOOST_REQUIRE_EQUAL(recvdFrag.dataSize(), 64);
+	for (size_t ii = 0; ii < 64; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(*(recvdFrag.dataBegin() + ii), ii);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	TLOG(TLVL_INFO) << "END TEST SharedFragment";
+}
+
 BOOST_AUTO_TEST_CASE(Timeout)
 {
 	TLOG(TLVL_INFO) << "BEGIN TEST Timeout";
 	TLOG(TLVL_DEBUG) << "Initializing SharedMemoryFragmentManagers for Timeout Test";
 	uint32_t key = GetRandomKey(0xF4A6);
-	artdaq::SharedMemoryFragmentManager man(key, 1, 0x1000);
+	artdaq::SharedMemoryFragmentManager man(key, 1, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
 
 	auto fragSizeWords = 0x1000 / sizeof(artdaq::RawDataType) - artdaq::detail::RawFragmentHeader::num_words() - 1;
 
@@ -239,4 +271,101 @@ BOOST_AUTO_TEST_CASE(Timeout)
 	TLOG(TLVL_INFO) << "END TEST Timeout";
 }
 
+BOOST_AUTO_TEST_CASE(Spill)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST Spill";
+	uint32_t key = GetRandomKey(0xF4A6);
+	artdaq::SharedMemoryFragmentManager man(key, 4, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryFragmentManager man2(key, 0, 0, 0, SHM_TEST_FLAGS);
+
+	auto path = "/tmp/SharedMemoryFragmentManager_t_spill_" + std::to_string(getpid());
+	BOOST_REQUIRE_EQUAL(man.EnableSpill(path, 0.5), true);
+
+	// The first two Fragments fill the segment up to the watermark, the rest are spilled
+	for (size_t seq = 1; seq <= 6; ++seq)
+	{
+		artdaq::Fragment frag(seq * 0x20);
+		frag.setSequenceID(seq);
+		frag.setFragmentID(0x20);
+		frag.setSystemType(artdaq::Fragment::DataFragmentType);
+		for (size_t ii = 0; ii < frag.dataSize(); ++ii)
+		{
+			*(frag.dataBegin() + ii) = seq + ii;
+		}
+		BOOST_REQUIRE_EQUAL(man.WriteFragment(std::move(frag), false, 0), 0);
+	}
+	auto stats = man.GetSpillStats();
+	BOOST_REQUIRE_EQUAL(man.ReadReadyCount(), 2);
+	BOOST_REQUIRE_EQUAL(stats.depth_fragments, 4);
+	BOOST_REQUIRE_EQUAL(stats.spilled_fragments, 4);
+	BOOST_REQUIRE_EQUAL(stats.restored_fragments, 0);
+
+	// Spilled Fragments are fed back in order as the reader frees buffers
+	for (size_t seq = 1; seq <= 6; ++seq)
+	{
+		man.DrainSpill();
+		artdaq::Fragment recvdFrag;
+		BOOST_REQUIRE_EQUAL(man2.ReadFragment(recvdFrag), 0);
+		BOOST_REQUIRE_EQUAL(recvdFrag.sequenceID(), seq);
+		BOOST_REQUIRE_EQUAL(recvdFrag.dataSize(), seq * 0x20);
+		for (size_t ii = 0; ii < recvdFrag.dataSize(); ++ii)
+		{
+			BOOST_REQUIRE_EQUAL(*(recvdFrag.dataBegin() + ii), seq + ii);
+		}
+	}
+	stats = man.GetSpillStats();
+	BOOST_REQUIRE_EQUAL(stats.depth_fragments, 0);
+	BOOST_REQUIRE_EQUAL(stats.depth_bytes, 0);
+	BOOST_REQUIRE_EQUAL(stats.restored_fragments, 4);
+
+	man.DisableSpill();
+	BOOST_REQUIRE_EQUAL(access(path.c_str(), F_OK), -1);
+	TLOG(TLVL_INFO) << "END TEST Spill";
+}
+
+BOOST_AUTO_TEST_CASE(SpillKeptAcrossDisable)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST SpillKeptAcrossDisable";
+	uint32_t key = GetRandomKey(0xF4A6);
+	artdaq::SharedMemoryFragmentManager man(key, 4, 0x1000, 100 * 1000000, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryFragmentManager man2(key, 0, 0, 0, SHM_TEST_FLAGS);
+
+	auto path = "/tmp/SharedMemoryFragmentManager_t_spillkept_" + std::to_string(getpid());
+	BOOST_REQUIRE_EQUAL(man.EnableSpill(path, 0.5), true);
+	for (size_t seq = 1; seq <= 6; ++seq)
+	{
+		artdaq::Fragment frag(seq * 0x20);
+		frag.setSequenceID(seq);
+		frag.setFragmentID(0x20);
+		frag.setSystemType(artdaq::Fragment::DataFragmentType);
+		BOOST_REQUIRE_EQUAL(man.WriteFragment(std::move(frag), false, 0), 0);
+	}
+
+	// Feed back one Fragment, so that the ones left do not start at the beginning of the file
+	artdaq::Fragment recvdFrag;
+	BOOST_REQUIRE_EQUAL(man2.ReadFragment(recvdFrag), 0);
+	BOOST_REQUIRE_EQUAL(recvdFrag.sequenceID(), 1);
+	BOOST_REQUIRE_EQUAL(man.DrainSpill(), 1);
+
+	// Nothing reads during the drain timeout, so the last three Fragments stay in the file
+	man.DisableSpill(0);
+	BOOST_REQUIRE_EQUAL(access(path.c_str(), F_OK), 0);
+
+	BOOST_REQUIRE_EQUAL(man.EnableSpill(path, 0.5), true);
+	auto stats = man.GetSpillStats();
+	BOOST_REQUIRE_EQUAL(stats.depth_fragments, 3);
+	for (size_t seq = 2; seq <= 6; ++seq)
+	{
+		man.DrainSpill();
+		BOOST_REQUIRE_EQUAL(man2.ReadFragment(recvdFrag), 0);
+		BOOST_REQUIRE_EQUAL(recvdFrag.sequenceID(), seq);
+		BOOST_REQUIRE_EQUAL(recvdFrag.dataSize(), seq * 0x20);
+	}
+	BOOST_REQUIRE_EQUAL(man.GetSpillStats().depth_fragments, 0);
+
+	man.DisableSpill();
+	BOOST_REQUIRE_EQUAL(access(path.c_str(), F_OK), -1);
+	TLOG(TLVL_INFO) << "END TEST SpillKeptAcrossDisable";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+#define TRACE_NAME "SharedMemoryFragmentRouter_t"
+
+#include <cstring>
+#include <set>
+
+#include "TRACE/tracemf.h"
+#include "artdaq-core/Core/SharedMemoryFragmentRouter.hh"
+#include "artdaq-core/Data/Fragment.hh"
+
+#define BOOST_TEST_MODULE(SharedMemoryFragmentRouter_t)
+#include "SharedMemoryTestShims.hh"
+#include "cetlib/quiet_unit_test.hpp"
+
+namespace {
+artdaq::Fragment MakeFragment(artdaq::Fragment::type_t type, artdaq::Fragment::fragment_id_t fragment_id, size_t words)
+{
+	artdaq::Fragment frag(words);
+	frag.setSequenceID(1);
+	frag.setFragmentID(fragment_id);
+	frag.setUserType(type);
+	for (size_t ii = 0; ii < words; ++ii)
+	{
+		*(frag.dataBegin() + ii) = ii + fragment_id;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	return frag;
+}
+
+std::vector<artdaq::SharedMemoryFragmentRouter::Route> MakeRoutes(uint32_t key, bool owner)
+{
+	std::vector<artdaq::SharedMemoryFragmentRouter::Route> routes(3);
+	// Small trigger primitives, Fragment IDs 0-99
+	routes[0].shm_key = key;
+	routes[0].types = {2};
+	routes[0].max_fragment_id = 99;
+	// Large waveforms
+	routes[1].shm_key = key + 1;
+	routes[1].types = {3};
+	// Everything else
+	routes[2].shm_key = key + 2;
+	if (owner)
+	{
+		routes[0].buffer_count = 10;
+		routes[0].max_buffer_size = 0x100;
+		routes[1].buffer_count = 2;
+		routes[1].max_buffer_size = 0x10000;
+		routes[2].buffer_count = 4;
+		routes[2].max_buffer_size = 0x1000;
+	}
+	return routes;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(SharedMemoryFragmentRouter_test)
+
+BOOST_AUTO_TEST_CASE(Routing)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST Routing";
+	uint32_t key = GetRandomKey(0xF4A6);
+	artdaq::SharedMemoryFragmentRouter writer(MakeRoutes(key, true));
+	artdaq::SharedMemoryFragmentRouter reader(MakeRoutes(key, false));
+	BOOST_REQUIRE_EQUAL(writer.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(reader.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(reader.RouteCount(), 3);
+
+	// Each route keeps its own buffer geometry
+	BOOST_REQUIRE_EQUAL(reader.Segment(0).size(), 10);
+	BOOST_REQUIRE_EQUAL(reader.Segment(1).BufferSize(), 0x10000);
+
+	BOOST_REQUIRE_EQUAL(writer.FindRoute(2, 5), 0);
+	BOOST_REQUIRE_EQUAL(writer.FindRoute(2, 100), 2);
+	BOOST_REQUIRE_EQUAL(writer.FindRoute(3, 5), 1);
+	BOOST_REQUIRE_EQUAL(writer.FindRoute(4, 5), 2);
+
+	BOOST_REQUIRE_EQUAL(writer.WriteFragment(MakeFragment(3, 1, 0x1000), false, 0), 0);
+	BOOST_REQUIRE_EQUAL(writer.WriteFragment(MakeFragment(2, 1, 4), false, 0), 0);
+	BOOST_REQUIRE_EQUAL(writer.WriteFragment(MakeFragment(2, 200, 4), false, 0), 0);
+	BOOST_REQUIRE_EQUAL(reader.Segment(0).ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(reader.Segment(1).ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(reader.Segment(2).ReadReadyCount(), 1);
+
+	// A consumer of one stream reads its route only
+	artdaq::Fragment frag;
+	BOOST_REQUIRE_EQUAL(reader.ReadFragment(0, frag), 0);
+	BOOST_REQUIRE_EQUAL(frag.type(), 2);
+	BOOST_REQUIRE_EQUAL(frag.fragmentID(), 1);
+	BOOST_REQUIRE_EQUAL(reader.ReadFragment(0, frag), -1);
+
+	// The unified read takes whatever is ready
+	std::set<artdaq::Fragment::fragment_id_t> ids;
+	while (reader.ReadReadyCount() > 0)
+	{
+		BOOST_REQUIRE_EQUAL(reader.ReadFragment(frag), 0);
+		ids.insert(frag.fragmentID());
+		auto expected = MakeFragment(frag.type(), frag.fragmentID(), frag.dataSize());
+		BOOST_REQUIRE_EQUAL(memcmp(frag.dataBegin(), expected.dataBegin(), frag.dataSizeBytes()), 0);
+	}
+	BOOST_REQUIRE(ids == std::set<artdaq::Fragment::fragment_id_t>({1, 200}));
+	BOOST_REQUIRE_EQUAL(reader.ReadFragment(frag), -1);
+	TLOG(TLVL_INFO) << "END TEST Routing";
+}
+
+BOOST_AUTO_TEST_CASE(NoRoute)
+{
+	TLOG(TLVL_INFO) << "BEGIN TEST NoRoute";
+	uint32_t key = GetRandomKey(0xF4A6);
+	std::vector<artdaq::SharedMemoryFragmentRouter::Route> routes(1);
+	routes[0].shm_key = key;
+	routes[0].buffer_count = 2;
+	routes[0].max_buffer_size = 0x100;
+	routes[0].types = {2};
+	artdaq::SharedMemoryFragmentRouter writer(routes);
+	BOOST_REQUIRE_EQUAL(writer.FindRoute(3, 0), -1);
+	BOOST_REQUIRE_EQUAL(writer.WriteFragment(MakeFragment(3, 0, 4), false, 0), -4);
+	BOOST_REQUIRE_EQUAL(writer.ReadReadyCount(), 0);
+	TLOG(TLVL_INFO) << "END TEST NoRoute";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,3 +1,9 @@
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <limits>
+#include <map>
+#include <thread>
+
 #include "artdaq-core/Core/SharedMemoryManager.hh"
 #include "artdaq-core/Utilities/TimeUtils.hh"
 #include "artdaq-core/Utilities/configureMessageFacility.hh"
@@ -17,7 +23,7 @@ BOOST_AUTO_TEST_CASE(Construct)
 	artdaq::configureMessageFacility("SharedMemoryManager_t", true, true);
 	TLOG(TLVL_DEBUG) << "BEGIN TEST Construct";
 	uint32_t key = GetRandomKey(0x7357);
-	artdaq::SharedMemoryManager man(key, 10, 0x1000, 0x10000);
+	artdaq::SharedMemoryManager man(key, 10, 0x1000, 0x10000, true, SHM_TEST_FLAGS);
 	BOOST_REQUIRE_EQUAL(man.IsValid(), true);
 	BOOST_REQUIRE_EQUAL(man.GetMyId(), 0);
 	BOOST_REQUIRE_EQUAL(man.size(), 10);
@@ -30,8 +36,8 @@ BOOST_AUTO_TEST_CASE(Attach)
 {
 	TLOG(TLVL_DEBUG) << "BEGIN TEST Attach";
 	uint32_t key = GetRandomKey(0x7357);
-	artdaq::SharedMemoryManager man(key, 10, 0x1000, 0x10000);
-	artdaq::SharedMemoryManager man2(key);
+	artdaq::SharedMemoryManager man(key, 10, 0x1000, 0x10000, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager man2(key, 0, 0, 0, true, SHM_TEST_FLAGS);
 
 	BOOST_REQUIRE_EQUAL(man.IsValid(), true);
 	BOOST_REQUIRE_EQUAL(man.GetMyId(), 0);
@@ -52,8 +58,8 @@ BOOST_AUTO_TEST_CASE(DataFlow)
 {
 	TLOG(TLVL_DEBUG) << "BEGIN TEST DataFlow";
 	uint32_t key = GetRandomKey(0x7357);
-	artdaq::SharedMemoryManager man(key, 10, 0x1000);
-	artdaq::SharedMemoryManager man2(key);
+	artdaq::SharedMemoryManager man(key, 10, 0x1000, 100 * 1000000, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager man2(key, 0, 0, 0, true, SHM_TEST_FLAGS);
 
 	BOOST_REQUIRE_EQUAL(man.ReadyForWrite(false), true);
 	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 10);
@@ -118,8 +124,8 @@ BOOST_AUTO_TEST_CASE(Exceptions)
 	artdaq::configureMessageFacility("SharedMemoryManager_t", true, true);
 	TLOG(TLVL_DEBUG) << "BEGIN TEST Exceptions";
 	uint32_t key = GetRandomKey(0x7357);
-	artdaq::SharedMemoryManager man(key, 10, 0x1000);
-	artdaq::SharedMemoryManager man2(key);
+	artdaq::SharedMemoryManager man(key, 10, 0x1000, 100 * 1000000, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager man2(key, 0, 0, 0, true, SHM_TEST_FLAGS);
 	BOOST_REQUIRE_EQUAL(man.ReadyForWrite(false), true);
 	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 10);
 	BOOST_REQUIRE_EQUAL(man.ReadyForRead(), false);
@@ -238,9 +244,9 @@ BOOST_AUTO_TEST_CASE(Broadcast)
 {
 	TLOG(TLVL_DEBUG) << "BEGIN TEST Broadcast";
 	uint32_t key = GetRandomKey(0x7357);
-	artdaq::SharedMemoryManager man(key, 10, 0x1000, 0x10000, false);
-	artdaq::SharedMemoryManager man2(key);
-	artdaq::SharedMemoryManager man3(key);
+	artdaq::SharedMemoryManager man(key, 10, 0x1000, 0x10000, false, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager man2(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager man3(key, 0, 0, 0, true, SHM_TEST_FLAGS);
 
 	BOOST_REQUIRE_EQUAL(man.ReadyForWrite(false), true);
 	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 10);
@@ -341,4 +347,728 @@ BOOST_AUTO_TEST_CASE(Broadcast)
 	TLOG(TLVL_DEBUG) << "END TEST Broadcast";
 }
 
+BOOST_AUTO_TEST_CASE(NumaPlacement)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST NumaPlacement";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 4, 0x10000, 0x10000, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager man2(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+
+	BOOST_REQUIRE_EQUAL(man.SetNumaPolicy(artdaq::NumaUtils::Policy::Bind, {0}), true);
+	BOOST_REQUIRE_EQUAL(man.SetBufferNumaPolicy(2, 2, artdaq::NumaUtils::Policy::Interleave, {0}), true);
+	BOOST_REQUIRE_EQUAL(man.SetBufferNumaPolicy(3, 2, artdaq::NumaUtils::Policy::Interleave, {0}), false);
+	BOOST_REQUIRE_EQUAL(man.SetBufferNumaPolicy(-1, 1, artdaq::NumaUtils::Policy::Interleave, {0}), false);
+
+	// Buffers smaller than a page share their pages with their neighbours, so their placement is left alone
+	artdaq::SharedMemoryManager small(key + 1, 4, 0x100, 0x10000, true, SHM_TEST_FLAGS);
+	BOOST_REQUIRE_EQUAL(small.SetBufferNumaPolicy(1, 1, artdaq::NumaUtils::Policy::Interleave, {0}), false);
+
+	// The policy is recorded in the segment, so other managers see it
+	auto str = man2.toString();
+	BOOST_REQUIRE(str.find("NUMA Policy: Bind (nodes 0)") != std::string::npos);
+
+	int buf = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_EQUAL(buf, 0);
+	std::vector<uint8_t> data(0x10000, 0x5A);
+	man.Write(buf, &data[0], data.size());
+	auto nodes = artdaq::NumaUtils::PageNodes(man.GetBufferStart(buf), data.size());
+	BOOST_REQUIRE(!nodes.empty());
+	for (auto node : nodes)
+	{
+		if (node >= 0) BOOST_REQUIRE_EQUAL(node, 0);
+	}
+
+	BOOST_REQUIRE_EQUAL(man.SetNumaPolicy(artdaq::NumaUtils::Policy::Default, {}), true);
+	BOOST_REQUIRE(man.toString().find("NUMA Policy: Default\n") != std::string::npos);
+	TLOG(TLVL_DEBUG) << "END TEST NumaPlacement";
+}
+
+BOOST_AUTO_TEST_CASE(EndOfData)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST EndOfData";
+	uint32_t key = GetRandomKey(0x7357);
+	auto man = std::make_unique<artdaq::SharedMemoryManager>(key, 10, 0x1000, 0x10000, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager man2(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+	man2.SetEndOfDataCheckInterval(1000000000);
+
+	// First call checks the segment status, later calls only look at the end-of-data word
+	BOOST_REQUIRE_EQUAL(man2.IsEndOfData(), false);
+	BOOST_REQUIRE_EQUAL(man2.IsEndOfData(), false);
+
+	man.reset(nullptr);
+	BOOST_REQUIRE_EQUAL(man2.IsEndOfData(), true);
+
+	// SysV segments removed from outside are still detected through the periodic check
+	key = GetRandomKey(0x7357);
+	man = std::make_unique<artdaq::SharedMemoryManager>(key, 10, 0x1000, 0x10000);
+	artdaq::SharedMemoryManager man3(key);
+	man3.SetEndOfDataCheckInterval(0);
+	BOOST_REQUIRE_EQUAL(man3.IsEndOfData(), false);
+	shmctl(shmget(key, 0, 0666), IPC_RMID, nullptr);
+	BOOST_REQUIRE_EQUAL(man3.IsEndOfData(), true);
+	TLOG(TLVL_DEBUG) << "END TEST EndOfData";
+}
+
+BOOST_AUTO_TEST_CASE(AttachTiming)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST AttachTiming";
+	uint32_t key = GetRandomKey(0x7357);
+
+	// The reader starts first and has to wait for the owner to initialize the segment
+	std::unique_ptr<artdaq::SharedMemoryManager> reader;
+	std::thread reader_thread([&] { reader = std::make_unique<artdaq::SharedMemoryManager>(key, 0, 0, 0, true, SHM_TEST_FLAGS); });
+	usleep(50000);
+
+	artdaq::SharedMemoryManager man(key, 20000, 0x40, 0x10000, true, SHM_TEST_FLAGS);
+	reader_thread.join();
+	BOOST_REQUIRE_EQUAL(man.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(reader->IsValid(), true);
+	BOOST_REQUIRE_EQUAL(reader->size(), 20000);
+	BOOST_REQUIRE_EQUAL(reader->GetMyId(), 1);
+
+	auto owner_timing = man.GetAttachTiming();
+	BOOST_REQUIRE_GE(owner_timing.init_threads, 1);
+	BOOST_REQUIRE_GT(owner_timing.total_s, 0.0);
+	BOOST_REQUIRE_EQUAL(owner_timing.wait_s, 0.0);
+	auto reader_timing = reader->GetAttachTiming();
+	BOOST_REQUIRE_EQUAL(reader_timing.init_threads, 0);
+	BOOST_REQUIRE_GE(reader_timing.total_s, reader_timing.wait_s);
+
+	auto buffers = man.GetBufferReport();
+	for (auto const& buf : buffers)
+	{
+		BOOST_REQUIRE_EQUAL(buf.first, -1);
+		BOOST_REQUIRE(buf.second == artdaq::SharedMemoryManager::BufferSemaphoreFlags::Empty);
+	}
+	TLOG(TLVL_DEBUG) << "END TEST AttachTiming";
+}
+
+BOOST_AUTO_TEST_CASE(AttachUninitialized)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST AttachUninitialized";
+	uint32_t key = GetRandomKey(0x7357);
+
+	// A segment that no owner ever initializes must not hang the attacher
+	auto segment = shmget(key, 0x10000, IPC_CREAT | 0666);
+	BOOST_REQUIRE_NE(segment, -1);
+	auto start = std::chrono::steady_clock::now();
+	artdaq::SharedMemoryManager reader(key);
+	BOOST_REQUIRE_EQUAL(reader.IsValid(), false);
+	BOOST_REQUIRE_LT(artdaq::TimeUtils::GetElapsedTime(start), 5.0);
+	BOOST_REQUIRE_EQUAL(reader.Attach(100000), false);
+
+	shmid_ds info;
+	shmctl(segment, IPC_STAT, &info);
+	BOOST_REQUIRE_EQUAL(info.shm_nattch, 0);
+	shmctl(segment, IPC_RMID, nullptr);
+	TLOG(TLVL_DEBUG) << "END TEST AttachUninitialized";
+}
+
+BOOST_AUTO_TEST_CASE(PersistentSegment)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST PersistentSegment";
+	uint32_t key = GetRandomKey(0x7357);
+	auto flags = artdaq::SharedMemoryManager::PersistentSegment;
+	auto man = std::make_unique<artdaq::SharedMemoryManager>(key, 10, 0x1000, 0x10000, true, flags);
+	artdaq::SharedMemoryManager reader(key);
+	BOOST_REQUIRE_EQUAL(man->IsPersistent(), true);
+	BOOST_REQUIRE_EQUAL(man->AdoptedSegment(), false);
+	BOOST_REQUIRE_EQUAL(reader.GetOwnerPid(), getpid());
+
+	uint8_t n[0x1000];
+	for (int ii = 0; ii < 3; ++ii)
+	{
+		memset(n, ii, sizeof(n));
+		auto buf = man->GetBufferForWriting(false);
+		man->Write(buf, n, sizeof(n));
+		man->MarkBufferFull(buf);
+	}
+	// A partially-written buffer is discarded when the owner goes away
+	auto partial = man->GetBufferForWriting(false);
+	man->Write(partial, n, 0x10);
+
+	// A second owner cannot take over while the first one is still attached
+	artdaq::SharedMemoryManager rival(key, 10, 0x1000, 0x10000, true, flags);
+	BOOST_REQUIRE_EQUAL(rival.IsValid(), false);
+
+	man.reset(nullptr);
+	BOOST_REQUIRE_EQUAL(reader.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(reader.IsEndOfData(), false);
+	BOOST_REQUIRE_EQUAL(reader.GetOwnerPid(), 0);
+
+	man = std::make_unique<artdaq::SharedMemoryManager>(key, 10, 0x1000, 0x10000, true, flags);
+	BOOST_REQUIRE_EQUAL(man->IsValid(), true);
+	BOOST_REQUIRE_EQUAL(man->AdoptedSegment(), true);
+	BOOST_REQUIRE_EQUAL(man->GetMyId(), 0);
+	BOOST_REQUIRE_EQUAL(reader.GetOwnerPid(), getpid());
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 3);
+	BOOST_REQUIRE_EQUAL(man->WriteReadyCount(false), 7);
+
+	uint8_t check[0x1000];
+	for (int ii = 0; ii < 3; ++ii)
+	{
+		auto buf = reader.GetBufferForReading();
+		BOOST_REQUIRE_NE(buf, -1);
+		BOOST_REQUIRE_EQUAL(reader.Read(buf, check, sizeof(check)), true);
+		BOOST_REQUIRE_EQUAL(check[0], ii);
+		reader.MarkBufferEmpty(buf);
+	}
+
+	// A different layout is not reinitialized while another manager is still attached...
+	man.reset(nullptr);
+	man = std::make_unique<artdaq::SharedMemoryManager>(key, 10, 0x800, 0x10000, true, flags);
+	BOOST_REQUIRE_EQUAL(man->IsValid(), false);
+	BOOST_REQUIRE_EQUAL(reader.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(reader.BufferSize(), 0x1000);
+
+	// ...but is once it is the only one
+	reader.Detach();
+	man = std::make_unique<artdaq::SharedMemoryManager>(key, 10, 0x800, 0x10000, true, flags);
+	BOOST_REQUIRE_EQUAL(man->IsValid(), true);
+	BOOST_REQUIRE_EQUAL(man->AdoptedSegment(), false);
+	BOOST_REQUIRE_EQUAL(man->BufferSize(), 0x800);
+
+	// Forcing the detach removes a persistent segment
+	man->Detach(false, "", "", true);
+	BOOST_REQUIRE_EQUAL(shmget(key, 0, 0666), -1);
+	TLOG(TLVL_DEBUG) << "END TEST PersistentSegment";
+}
+
+BOOST_AUTO_TEST_CASE(PersistentSegmentDeadOwner)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST PersistentSegmentDeadOwner";
+	uint32_t key = GetRandomKey(0x7357);
+	auto flags = artdaq::SharedMemoryManager::PersistentSegment;
+
+	// The first owner registers as a reader and a writer, then dies without detaching
+	auto pid = fork();
+	if (pid == 0)
+	{
+		artdaq::SharedMemoryManager owner(key, 4, 0x100, 0x10000, true, flags);
+		owner.GetBufferForReading();
+		auto buf = owner.GetBufferForWriting(false);
+		owner.MarkBufferFull(buf);
+		_exit(0);
+	}
+	BOOST_REQUIRE_GT(pid, 0);
+	int status = 0;
+	waitpid(pid, &status, 0);
+	BOOST_REQUIRE_EQUAL(WEXITSTATUS(status), 0);
+
+	artdaq::SharedMemoryManager man(key, 4, 0x100, 0x10000, true, flags);
+	BOOST_REQUIRE_EQUAL(man.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(man.AdoptedSegment(), true);
+	auto report = man.toString();
+	BOOST_REQUIRE_NE(report.find("Number of Writers: 0"), std::string::npos);
+	BOOST_REQUIRE_NE(report.find("Number of Readers: 0"), std::string::npos);
+	BOOST_REQUIRE_EQUAL(man.ReadReadyCount(), 1);
+
+	man.Detach(false, "", "", true);
+	TLOG(TLVL_DEBUG) << "END TEST PersistentSegmentDeadOwner";
+}
+
+BOOST_AUTO_TEST_CASE(ChainedBuffers)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ChainedBuffers";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 8, 0x100, 0x10000, true, artdaq::SharedMemoryManager::ChainedBuffers | SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager reader(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+	BOOST_REQUIRE_EQUAL(reader.GetSegmentFlags(), artdaq::SharedMemoryManager::ChainedBuffers | SHM_TEST_FLAGS);
+
+	uint8_t n[0x380];
+	for (size_t ii = 0; ii < sizeof(n); ++ii)
+	{
+		n[ii] = static_cast<uint8_t>(ii * 3);
+	}
+
+	// The event is written in two pieces, the second one starting the chain
+	auto buf = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	BOOST_REQUIRE_EQUAL(man.Write(buf, n, 0x80), 0x80);
+	BOOST_REQUIRE_EQUAL(man.Write(buf, n + 0x80, sizeof(n) - 0x80), sizeof(n) - 0x80);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 4);
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 0);
+	man.MarkBufferFull(buf);
+
+	// Only the head buffer is visible to readers
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 1);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(true), 5);
+	auto rbuf = reader.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(rbuf, buf);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(), -1);
+	BOOST_REQUIRE_EQUAL(reader.BufferDataSize(rbuf), sizeof(n));
+
+	auto segments = reader.GetBufferSegments(rbuf);
+	BOOST_REQUIRE_EQUAL(segments.size(), 4);
+	size_t total = 0;
+	for (auto const& segment : segments)
+	{
+		BOOST_REQUIRE_EQUAL(memcmp(segment.data, n + total, segment.size), 0);
+		total += segment.size;
+	}
+	BOOST_REQUIRE_EQUAL(total, sizeof(n));
+
+	// Reads straddle the segment boundaries
+	uint8_t check[0x380];
+	BOOST_REQUIRE_EQUAL(reader.Read(rbuf, check, 0xF0), true);
+	BOOST_REQUIRE_EQUAL(*static_cast<uint8_t*>(reader.GetReadPos(rbuf)), n[0xF0]);
+	BOOST_REQUIRE_EQUAL(reader.Read(rbuf, check + 0xF0, sizeof(n) - 0xF0), true);
+	BOOST_REQUIRE_EQUAL(memcmp(check, n, sizeof(n)), 0);
+	BOOST_REQUIRE_EQUAL(reader.MoreDataInBuffer(rbuf), false);
+
+	// The whole chain is released with the head buffer
+	reader.MarkBufferEmpty(rbuf);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 8);
+	auto buffers = man.GetBufferReport();
+	for (auto const& report : buffers)
+	{
+		BOOST_REQUIRE(report.second == artdaq::SharedMemoryManager::BufferSemaphoreFlags::Empty);
+	}
+
+	// A write needing more continuation buffers than are Empty fails without claiming any of them
+	buf = man.GetBufferForWriting(false);
+	auto held = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(held, -1);
+	uint8_t big[0x100 * 8];
+	memset(big, 0x11, sizeof(big));
+	BOOST_REQUIRE_EQUAL(man.Write(buf, big, sizeof(big)), 0);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 6);
+	BOOST_REQUIRE_EQUAL(man.BufferDataSize(buf), 0);
+	BOOST_REQUIRE_EQUAL(man.Write(buf, big, 0x100 * 7), 0x100 * 7);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 0);
+	man.MarkBufferEmpty(held, true);
+	man.MarkBufferFull(buf);
+	rbuf = reader.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(reader.BufferDataSize(rbuf), 0x100 * 7);
+	reader.MarkBufferEmpty(rbuf);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 8);
+
+	// Without the flag, an oversized write still detaches
+	uint32_t plain_key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager plain(plain_key, 8, 0x100, 0x10000, true, SHM_TEST_FLAGS);
+	buf = plain.GetBufferForWriting(false);
+	BOOST_REQUIRE_EXCEPTION(plain.Write(buf, n, sizeof(n)), cet::exception, [&](cet::exception e) { return e.category() == "SharedMemoryWrite"; });
+
+	// Chained writes only claim Empty buffers, so they cannot follow a RingMode writer
+	BOOST_REQUIRE_THROW(artdaq::SharedMemoryManager(GetRandomKey(0x7357), 8, 0x100, 0x10000, true, artdaq::SharedMemoryManager::ChainedBuffers | artdaq::SharedMemoryManager::RingMode | SHM_TEST_FLAGS), cet::exception);
+	TLOG(TLVL_DEBUG) << "END TEST ChainedBuffers";
+}
+
+BOOST_AUTO_TEST_CASE(BufferTokens)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST BufferTokens";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 4, 0x1000, 0x10000, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager reader(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+
+	uint8_t n[0x100];
+	memset(n, 0x5A, sizeof(n));
+	auto wtoken = man.GetBufferTokenForWriting(false);
+	BOOST_REQUIRE(wtoken.valid());
+	BOOST_REQUIRE_EQUAL(man.CheckBuffer(wtoken, artdaq::SharedMemoryManager::BufferSemaphoreFlags::Writing), true);
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(man.Write(wtoken, n, sizeof(n)), sizeof(n));
+	}
+	BOOST_REQUIRE_EQUAL(man.BufferDataSize(wtoken), 4 * sizeof(n));
+	man.MarkBufferFull(wtoken.buffer());
+
+	// Token operations are checked against the state the buffer was claimed for
+	{
+		artdaq::SharedMemoryManager other(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+		auto otoken = other.GetBufferTokenForWriting(false);
+		BOOST_REQUIRE(otoken.valid());
+		BOOST_REQUIRE_EXCEPTION(other.IncrementReadPos(otoken, 1), cet::exception, [&](cet::exception e) { return e.category() == "StateAccessViolation"; });
+		BOOST_REQUIRE_EQUAL(other.IsValid(), false);
+	}
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 3);
+	BOOST_REQUIRE_EQUAL(man.CheckBuffer(wtoken, artdaq::SharedMemoryManager::BufferSemaphoreFlags::Writing), false);
+
+	auto rtoken = reader.GetBufferTokenForReading();
+	BOOST_REQUIRE(rtoken.valid());
+	BOOST_REQUIRE_EQUAL(rtoken.buffer(), wtoken.buffer());
+	uint8_t check[0x80];
+	BOOST_REQUIRE_EQUAL(reader.MoreDataInBuffer(rtoken), true);
+	BOOST_REQUIRE_EQUAL(reader.Read(rtoken, check, sizeof(check)), true);
+	BOOST_REQUIRE_EQUAL(memcmp(check, n, sizeof(check)), 0);
+	reader.IncrementReadPos(rtoken, 4 * sizeof(n) - sizeof(check));
+	BOOST_REQUIRE_EQUAL(reader.MoreDataInBuffer(rtoken), false);
+	reader.ResetReadPos(rtoken);
+	BOOST_REQUIRE_EQUAL(reader.MoreDataInBuffer(rtoken), true);
+	reader.MarkBufferEmpty(rtoken.buffer());
+	BOOST_REQUIRE_EQUAL(reader.CheckBuffer(rtoken, artdaq::SharedMemoryManager::BufferSemaphoreFlags::Reading), false);
+	// A token which outlived its buffer is caught
+	BOOST_REQUIRE_EXCEPTION(reader.Read(rtoken, check, sizeof(check)), cet::exception, [&](cet::exception e) { return e.category() == "TokenAccessViolation"; });
+	TLOG(TLVL_DEBUG) << "END TEST BufferTokens";
+}
+
+BOOST_AUTO_TEST_CASE(OrderedDelivery)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST OrderedDelivery";
+	using State = artdaq::SharedMemoryManager::SequenceState;
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 4, 0x100, 0x10000, true, artdaq::SharedMemoryManager::OrderedDelivery | SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager reader(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+	BOOST_REQUIRE_EQUAL(reader.GetSegmentFlags(), artdaq::SharedMemoryManager::OrderedDelivery | SHM_TEST_FLAGS);
+
+	uint8_t n[0x10];
+	memset(n, 0x5A, sizeof(n));
+	auto first = man.GetBufferForWriting(false);
+	auto second = man.GetBufferForWriting(false);
+	auto third = man.GetBufferForWriting(false);
+	BOOST_REQUIRE(first != -1 && second != -1 && third != -1);
+	for (auto buf : {first, second, third})
+	{
+		BOOST_REQUIRE_EQUAL(man.Write(buf, n, sizeof(n)), sizeof(n));
+	}
+	BOOST_REQUIRE(reader.GetSequenceState(1) == State::NotYetWritten);
+
+	// Completed out of order, and the second event is abandoned by its writer
+	int buffer = -1;
+	man.MarkBufferFull(third);
+	BOOST_REQUIRE(reader.GetSequenceState(3, &buffer) == State::Ready);
+	BOOST_REQUIRE_EQUAL(buffer, third);
+	man.MarkBufferFull(first);
+	man.MarkBufferEmpty(second, true);
+	BOOST_REQUIRE(reader.GetSequenceState(1) == State::Ready);
+	BOOST_REQUIRE(reader.GetSequenceState(2) == State::Skipped);
+	BOOST_REQUIRE(reader.GetSequenceState(4) == State::NotYetWritten);
+	BOOST_REQUIRE(reader.GetSequenceState(100) == State::NotYetWritten);
+
+	// Events are delivered in sequence, stepping over the skipped one
+	auto rbuf = reader.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(rbuf, first);
+	reader.MarkBufferEmpty(rbuf);
+	BOOST_REQUIRE(reader.GetSequenceState(1) == State::Expired);
+	rbuf = reader.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(rbuf, third);
+	BOOST_REQUIRE_EQUAL(reader.GetLastSeenBufferID(), 3);
+	reader.MarkBufferEmpty(rbuf);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferForReading(), -1);
+
+	// Slots are reused once the sequence IDs wrap around the buffer count
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		auto buf = man.GetBufferForWriting(false);
+		BOOST_REQUIRE_NE(buf, -1);
+		man.MarkBufferFull(buf);
+	}
+	BOOST_REQUIRE(reader.GetSequenceState(3) == State::Expired);
+	BOOST_REQUIRE(reader.GetSequenceState(7) == State::Ready);
+	for (size_t seq = 4; seq <= 7; ++seq)
+	{
+		rbuf = reader.GetBufferForReading();
+		BOOST_REQUIRE_NE(rbuf, -1);
+		BOOST_REQUIRE_EQUAL(reader.GetLastSeenBufferID(), seq);
+		reader.MarkBufferEmpty(rbuf);
+	}
+
+	// Without the flag, there are no slots to look in
+	artdaq::SharedMemoryManager plain(GetRandomKey(0x7357), 4, 0x100, 100 * 1000000, true, SHM_TEST_FLAGS);
+	BOOST_REQUIRE(plain.GetSequenceState(1) == State::Expired);
+	TLOG(TLVL_DEBUG) << "END TEST OrderedDelivery";
+}
+
+BOOST_AUTO_TEST_CASE(RingMode)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST RingMode";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 4, 0x100, 0x10000, true, artdaq::SharedMemoryManager::RingMode | SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager reader(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+
+	// The writer never runs out of buffers, and always takes the oldest one
+	for (size_t ii = 1; ii <= 6; ++ii)
+	{
+		auto buf = man.GetBufferForWriting(false);
+		BOOST_REQUIRE_EQUAL(buf, static_cast<int>((ii - 1) % 4));
+		BOOST_REQUIRE_EQUAL(man.Write(buf, &ii, sizeof(ii)), sizeof(ii));
+		man.MarkBufferFull(buf);
+	}
+
+	// The latest events are found from the newest buffer backwards, without claiming them
+	uint8_t data[0x100];
+	size_t seq = 0;
+	auto newest = reader.GetNewestBuffer();
+	BOOST_REQUIRE_EQUAL(newest, 1);
+	for (size_t expected = 6; expected > 2; --expected)
+	{
+		auto buf = static_cast<int>((expected - 1) % 4);
+		BOOST_REQUIRE_EQUAL(reader.CopyBufferSnapshot(buf, data, seq), sizeof(size_t));
+		BOOST_REQUIRE_EQUAL(seq, expected);
+		BOOST_REQUIRE_EQUAL(*reinterpret_cast<size_t*>(data), expected);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 4);
+
+	// A buffer held by a writer cannot be copied, and a buffer held by a reader is not overwritten
+	auto wbuf = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_EQUAL(wbuf, 2);
+	BOOST_REQUIRE_EQUAL(reader.CopyBufferSnapshot(wbuf, data, seq), 0);
+	man.MarkBufferFull(wbuf);
+	BOOST_REQUIRE_EQUAL(reader.GetNewestBuffer(), 2);
+	auto rbuf = reader.GetBufferForReading();
+	BOOST_REQUIRE_EQUAL(rbuf, 3);
+	BOOST_REQUIRE_EQUAL(man.GetBufferForWriting(false), 0);
+	man.MarkBufferFull(0);
+	BOOST_REQUIRE_EQUAL(man.GetBufferForWriting(false), 1);
+	man.MarkBufferFull(1);
+	BOOST_REQUIRE_EQUAL(man.GetBufferForWriting(false), 2);
+	man.MarkBufferFull(2);
+	BOOST_REQUIRE_EQUAL(man.GetBufferForWriting(false), 0);
+	man.MarkBufferFull(0);
+	BOOST_REQUIRE_EQUAL(reader.CheckBuffer(rbuf, artdaq::SharedMemoryManager::BufferSemaphoreFlags::Reading), true);
+	reader.MarkBufferEmpty(rbuf);
+
+	// Copies racing with the writer are either consistent or rejected
+	std::atomic<bool> done{false};
+	std::thread writer([&] {
+		for (size_t ii = 0; ii < 20000; ++ii)
+		{
+			auto buf = man.GetBufferForWriting(false);
+			if (buf == -1) continue;
+			uint8_t fill[0x100];
+			memset(fill, static_cast<int>(ii & 0xFF), sizeof(fill));
+			man.Write(buf, fill, sizeof(fill));
+			man.MarkBufferFull(buf);
+		}
+		done = true;
+	});
+	size_t good = 0;
+	while (!done)
+	{
+		auto buf = reader.GetNewestBuffer();
+		if (buf == -1 || reader.CopyBufferSnapshot(buf, data, seq) == 0) continue;
+		for (auto byte : data)
+		{
+			BOOST_REQUIRE_EQUAL(byte, data[0]);
+		}
+		++good;
+	}
+	writer.join();
+	TLOG(TLVL_DEBUG) << "RingMode: " << good << " consistent snapshots";
+	TLOG(TLVL_DEBUG) << "END TEST RingMode";
+}
+
+BOOST_AUTO_TEST_CASE(AbandonedWrites)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST AbandonedWrites";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 4, 0x100, 100 * 1000000, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager writer(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager other(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+
+	// A write taken away by another manager's forced release still leaves a readable buffer behind
+	size_t n = 0x5A5A;
+	auto buf = writer.GetBufferForWriting(false);
+	BOOST_REQUIRE_NE(buf, -1);
+	BOOST_REQUIRE_EQUAL(writer.Write(buf, &n, sizeof(n)), sizeof(n));
+	other.MarkBufferEmpty(buf, true);
+	size_t data = 0;
+	size_t seq = 0;
+	BOOST_REQUIRE_EQUAL(other.CopyBufferSnapshot(buf, &data, seq), sizeof(n));
+	BOOST_REQUIRE_EQUAL(data, n);
+	man.MarkBufferEmpty(buf, true);
+
+	// Writers losing freshly-claimed buffers to forced releases do not leave them marked as being written
+	std::atomic<bool> stop{false};
+	std::thread thief([&] {
+		while (!stop)
+		{
+			for (int ii = 0; ii < 4; ++ii)
+			{
+				other.MarkBufferEmpty(ii, true);
+			}
+		}
+	});
+	for (int ii = 0; ii < 20000; ++ii)
+	{
+		buf = writer.GetBufferForWriting(true);
+		if (buf != -1)
+		{
+			writer.MarkBufferEmpty(buf, true);
+		}
+	}
+	stop = true;
+	thief.join();
+
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		man.MarkBufferEmpty(ii, true);
+	}
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		buf = man.GetBufferForWriting(false);
+		BOOST_REQUIRE_NE(buf, -1);
+		n = ii;
+		man.Write(buf, &n, sizeof(n));
+		man.MarkBufferFull(buf);
+		BOOST_REQUIRE_EQUAL(other.CopyBufferSnapshot(buf, &data, seq), sizeof(n));
+		BOOST_REQUIRE_EQUAL(data, n);
+	}
+	TLOG(TLVL_DEBUG) << "END TEST AbandonedWrites";
+}
+
+BOOST_AUTO_TEST_CASE(BufferEpoch)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST BufferEpoch";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 2, 0x100, 100 * 1000000, true, SHM_TEST_FLAGS);
+	artdaq::SharedMemoryManager reader(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+
+	auto epoch = reader.GetBufferEpoch();
+	BOOST_REQUIRE_EQUAL(reader.WaitForBufferChange(epoch, 1000), false);
+	auto buf = man.GetBufferForWriting(false);
+	BOOST_REQUIRE_EQUAL(reader.GetBufferEpoch(), epoch);
+
+	// A waiter is woken when a buffer is marked Full
+	std::thread writer([&] {
+		usleep(10000);
+		man.MarkBufferFull(buf);
+	});
+	auto start = artdaq::TimeUtils::gettimeofday_us();
+	BOOST_REQUIRE_EQUAL(reader.WaitForBufferChange(epoch, 5000000), true);
+	BOOST_REQUIRE_LT(artdaq::TimeUtils::gettimeofday_us() - start, 5000000);
+	writer.join();
+	BOOST_REQUIRE_NE(reader.GetBufferEpoch(), epoch);
+
+	epoch = reader.GetBufferEpoch();
+	reader.MarkBufferEmpty(reader.GetBufferForReading());
+	BOOST_REQUIRE_EQUAL(reader.WaitForBufferChange(epoch, 0), true);
+
+	// A timeout too long to be expressed in nanoseconds still waits for the change
+	epoch = reader.GetBufferEpoch();
+	buf = man.GetBufferForWriting(false);
+	std::thread late_writer([&] {
+		usleep(10000);
+		man.MarkBufferFull(buf);
+	});
+	BOOST_REQUIRE_EQUAL(reader.WaitForBufferChange(epoch, std::numeric_limits<size_t>::max()), true);
+	late_writer.join();
+	TLOG(TLVL_DEBUG) << "END TEST BufferEpoch";
+}
+
+BOOST_AUTO_TEST_CASE(PinnedSlots)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST PinnedSlots";
+	uint32_t key = GetRandomKey(0x7357);
+	artdaq::SharedMemoryManager man(key, 2, 0x100, 0x10000, false, artdaq::SharedMemoryManager::PinnedSlots | SHM_TEST_FLAGS);
+	BOOST_REQUIRE_EQUAL(man.GetPinnedSlotCount(), 4);
+
+	auto write_event = [&man](size_t value, uint32_t tag) {
+		auto buf = man.GetBufferForWriting(true);
+		man.Write(buf, &value, sizeof(value));
+		auto pinned = tag != 0 && man.PinBuffer(buf, tag);
+		man.MarkBufferFull(buf);
+		return pinned;
+	};
+
+	// Events pinned with the same tag replace each other; the buffers themselves are reused
+	BOOST_REQUIRE_EQUAL(write_event(10, 1), true);
+	BOOST_REQUIRE_EQUAL(write_event(20, 2), true);
+	BOOST_REQUIRE_EQUAL(write_event(30, 0), false);
+	BOOST_REQUIRE_EQUAL(write_event(40, 2), true);
+	BOOST_REQUIRE_EQUAL(write_event(50, 3), true);
+	BOOST_REQUIRE_EQUAL(write_event(60, 4), true);
+	BOOST_REQUIRE_EQUAL(write_event(70, 5), false);
+	BOOST_REQUIRE_EQUAL(man.PinBuffer(man.GetNewestBuffer(), 1), true);  // Full buffers can be pinned after the fact
+
+	// A reader attaching now finds the pinned events, although their buffers were overwritten
+	artdaq::SharedMemoryManager reader(key, 0, 0, 0, true, SHM_TEST_FLAGS);
+	BOOST_REQUIRE_EQUAL(reader.GetPinnedSlotCount(), 4);
+	std::map<uint32_t, std::pair<size_t, size_t>> pinned;
+	for (size_t ii = 0; ii < reader.GetPinnedSlotCount(); ++ii)
+	{
+		uint8_t data[0x100];
+		uint32_t tag = 0;
+		size_t seq = 0;
+		BOOST_REQUIRE_EQUAL(reader.CopyPinnedSlot(ii, data, tag, seq), sizeof(size_t));
+		pinned[tag] = std::make_pair(seq, *reinterpret_cast<size_t*>(data));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+	BOOST_REQUIRE_EQUAL(pinned.size(), 4);
+	BOOST_REQUIRE_EQUAL(pinned[1].first, 7);
+	BOOST_REQUIRE_EQUAL(pinned[1].second, 70);
+	BOOST_REQUIRE_EQUAL(pinned[2].first, 4);
+	BOOST_REQUIRE_EQUAL(pinned[2].second, 40);
+	BOOST_REQUIRE_EQUAL(pinned[3].second, 50);
+	BOOST_REQUIRE_EQUAL(pinned[4].second, 60);
+
+	// Only complete events held by the writer, or Full, can be pinned
+	auto rbuf = reader.GetBufferForReading();
+	BOOST_REQUIRE_NE(rbuf, -1);
+	BOOST_REQUIRE_EQUAL(man.PinBuffer(rbuf, 1), false);
+
+	artdaq::SharedMemoryManager plain(GetRandomKey(0x7357), 2, 0x100, 100 * 1000000, true, SHM_TEST_FLAGS);
+	BOOST_REQUIRE_EQUAL(plain.GetPinnedSlotCount(), 0);
+	auto buf = plain.GetBufferForWriting(false);
+	BOOST_REQUIRE_EQUAL(plain.PinBuffer(buf, 1), false);
+	TLOG(TLVL_DEBUG) << "END TEST PinnedSlots";
+}
+
+BOOST_AUTO_TEST_CASE(InProcess)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST InProcess";
+	uint32_t key = GetRandomKey(0x7357);
+	auto man = std::make_unique<artdaq::SharedMemoryManager>(key, 4, 0x100, 0x10000, true, artdaq::SharedMemoryManager::InProcess);
+	BOOST_REQUIRE_EQUAL(man->IsValid(), true);
+	BOOST_REQUIRE_EQUAL(man->IsInProcess(), true);
+	BOOST_REQUIRE_EQUAL(man->GetMyId(), 0);
+	BOOST_REQUIRE_EQUAL(shmget(key, 0, 0666), -1);  // No SysV segment was created
+
+	// Other managers with the flag find the segment by key, and the buffer protocol is unchanged
+	artdaq::SharedMemoryManager reader(key, 0, 0, 0, true, artdaq::SharedMemoryManager::InProcess);
+	BOOST_REQUIRE_EQUAL(reader.IsInProcess(), true);
+	BOOST_REQUIRE_EQUAL(reader.GetMyId(), 1);
+	BOOST_REQUIRE_EQUAL(reader.size(), 4);
+	BOOST_REQUIRE_EQUAL(man->GetAttachedCount(), 2);
+
+	std::thread writer([key] {
+		artdaq::SharedMemoryManager writer_man(key, 0, 0, 0, true, artdaq::SharedMemoryManager::InProcess);
+		for (size_t ii = 1; ii <= 20; ++ii)
+		{
+			int buf = -1;
+			while ((buf = writer_man.GetBufferForWriting(false)) == -1)
+			{
+				writer_man.WaitForBufferChange(writer_man.GetBufferEpoch(), 1000);
+			}
+			writer_man.Write(buf, &ii, sizeof(ii));
+			writer_man.MarkBufferFull(buf);
+		}
+	});
+	size_t expected = 1;
+	while (expected <= 20)
+	{
+		if (!reader.ReadyForRead())
+		{
+			reader.WaitForBufferChange(reader.GetBufferEpoch(), 1000);
+			continue;
+		}
+		auto buf = reader.GetBufferForReading();
+		size_t value = 0;
+		reader.Read(buf, &value, sizeof(value));
+		reader.MarkBufferEmpty(buf);
+		BOOST_REQUIRE_EQUAL(value, expected++);
+	}
+	writer.join();
+
+	// Without the flag, the key refers to a SysV segment, which is a different one
+	artdaq::SharedMemoryManager sysv_reader(key);
+	BOOST_REQUIRE_EQUAL(sysv_reader.IsValid(), false);
+	{
+		artdaq::SharedMemoryManager sysv(key, 2, 0x100, 0x10000);
+		BOOST_REQUIRE_EQUAL(sysv.IsInProcess(), false);
+		BOOST_REQUIRE_EQUAL(sysv.GetMyId(), 0);
+		BOOST_REQUIRE_EQUAL(sysv.size(), 2);
+	}
+	BOOST_REQUIRE_EQUAL(reader.size(), 4);
+	BOOST_REQUIRE_EQUAL(man->GetAttachedCount(), 2);
+
+	// Removing the segment ends the data for the remaining managers, and frees the key at once
+	man.reset(nullptr);
+	BOOST_REQUIRE_EQUAL(reader.IsEndOfData(), true);
+	artdaq::SharedMemoryManager next(key, 2, 0x100, 0x10000, true, artdaq::SharedMemoryManager::InProcess);
+	BOOST_REQUIRE_EQUAL(next.GetMyId(), 0);
+	BOOST_REQUIRE_EQUAL(next.GetAttachedCount(), 1);
+	BOOST_REQUIRE_EQUAL(next.IsEndOfData(), false);
+	TLOG(TLVL_DEBUG) << "END TEST InProcess";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,8 +2,13 @@
 #define ARTDAQ_CORE_TEST_CORE_SHAREDMEMORYTESTSHIMS_HH
 
 #include <random>
+#include "artdaq-core/Core/SharedMemoryManager.hh"
 #include "artdaq-core/Utilities/TimeUtils.hh"
 
+// Segment flags the tests run with. In-process segments cannot collide with the tests of other processes, and leave
+// nothing behind when a test fails. Tests of SysV behavior (persistence, removal from outside, fork) do not use them
+#define SHM_TEST_FLAGS artdaq::SharedMemoryManager::InProcess
+
 inline unsigned GetRandomKey(uint16_t identifier)
 {
 	static std::mt19937 rng(artdaq::TimeUtils::gettimeofday_us());
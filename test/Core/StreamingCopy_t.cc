@@ -0,0 +1,92 @@
+#include "artdaq-core/Core/StreamingCopy.hh"
+
+#define BOOST_TEST_MODULE StreamingCopy_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#define TRACE_NAME "StreamingCopy_t"
+#include "TRACE/tracemf.h"
+
+namespace {
+std::vector<uint8_t> MakePattern(size_t size)
+{
+	std::vector<uint8_t> pattern(size);
+	for (size_t ii = 0; ii < size; ++ii)
+	{
+		pattern[ii] = static_cast<uint8_t>(ii * 7 + (ii >> 8));
+	}
+	return pattern;
+}
+
+// Copy into the middle of a larger, poisoned buffer, so that writes outside the destination are detected
+void CheckCopy(artdaq::StreamingCopy::Kernel kernel, size_t size, size_t src_offset, size_t dest_offset)
+{
+	auto src = MakePattern(size + src_offset);
+	std::vector<uint8_t> dest(size + dest_offset + 64, 0xA5);
+	artdaq::StreamingCopy::CopyWith(kernel, &dest[dest_offset], &src[src_offset], size);
+	for (size_t ii = 0; ii < dest_offset; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(dest[ii], 0xA5);
+	}
+	for (size_t ii = 0; ii < size; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(dest[dest_offset + ii], src[src_offset + ii]);
+	}
+	for (size_t ii = dest_offset + size; ii < dest.size(); ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(dest[ii], 0xA5);
+	}
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(StreamingCopy_test)
+
+BOOST_AUTO_TEST_CASE(KernelSelection)
+{
+	BOOST_REQUIRE(artdaq::StreamingCopy::IsSupported(artdaq::StreamingCopy::Kernel::Scalar));
+	auto kernel = artdaq::StreamingCopy::SelectedKernel();
+	BOOST_REQUIRE(artdaq::StreamingCopy::IsSupported(kernel));
+	TLOG(TLVL_INFO) << "Selected kernel: " << artdaq::StreamingCopy::KernelToString(kernel);
+	if (artdaq::StreamingCopy::IsSupported(artdaq::StreamingCopy::Kernel::AVX512))
+	{
+		BOOST_REQUIRE(artdaq::StreamingCopy::IsSupported(artdaq::StreamingCopy::Kernel::AVX2));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Kernels)
+{
+	std::vector<size_t> sizes = {0, 1, 31, 63, 64, 127, 128, 255, 256, 257, 1000, 4096, 65536 + 3};
+	for (auto kernel : {artdaq::StreamingCopy::Kernel::Scalar, artdaq::StreamingCopy::Kernel::AVX2, artdaq::StreamingCopy::Kernel::AVX512})
+	{
+		// Unsupported kernels fall back to memcpy, so they are checked as well
+		for (auto size : sizes)
+		{
+			for (size_t offset : {0, 1, 8, 33})
+			{
+				CheckCopy(kernel, size, offset, offset);
+				CheckCopy(kernel, size, 0, offset);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Threshold)
+{
+	auto threshold = artdaq::StreamingCopy::Threshold();
+	artdaq::StreamingCopy::SetThreshold(100);
+	BOOST_REQUIRE_EQUAL(artdaq::StreamingCopy::Threshold(), 100);
+
+	// Above and below the threshold
+	for (size_t size : {99, 100, 5000})
+	{
+		auto src = MakePattern(size);
+		std::vector<uint8_t> dest(size);
+		artdaq::StreamingCopy::Copy(dest.data(), src.data(), size);
+		BOOST_REQUIRE(dest == src);
+	}
+	artdaq::StreamingCopy::SetThreshold(threshold);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
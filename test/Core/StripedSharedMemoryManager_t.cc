@@ -0,0 +1,165 @@
+#include <unistd.h>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "artdaq-core/Core/StripedSharedMemoryManager.hh"
+#include "artdaq-core/Utilities/TimeUtils.hh"
+
+#define BOOST_TEST_MODULE StripedSharedMemoryManager_t
+#include "cetlib/quiet_unit_test.hpp"
+#include "cetlib_except/exception.h"
+
+#define TRACE_NAME "StripedSharedMemoryManager_t"
+#include "SharedMemoryTestShims.hh"
+#include "TRACE/tracemf.h"
+
+// Stripe keys are unrelated to each other, like the keys of separately configured segments
+std::vector<uint32_t> GetStripeKeys(size_t count)
+{
+	std::vector<uint32_t> keys;
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		keys.push_back(GetRandomKey(0x5700 + ii));
+	}
+	return keys;
+}
+
+BOOST_AUTO_TEST_SUITE(StripedSharedMemoryManager_test)
+
+BOOST_AUTO_TEST_CASE(Construct)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST Construct";
+	auto keys = GetStripeKeys(3);
+
+	// The segment at the key following the first stripe's belongs to somebody else and is left alone
+	artdaq::SharedMemoryManager neighbour(keys[0] + 1, 2, 0x80);
+	artdaq::StripedSharedMemoryManager man(keys, 4, 0x100);
+	BOOST_REQUIRE_EQUAL(man.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(man.StripeCount(), 3);
+	BOOST_REQUIRE_EQUAL(man.WriteReadyCount(false), 12);
+	BOOST_REQUIRE_EQUAL(man.ReadReadyCount(), 0);
+	BOOST_REQUIRE_LT(man.HomeStripe(), 3);
+
+	artdaq::StripedSharedMemoryManager reader(keys);
+	BOOST_REQUIRE_EQUAL(reader.IsValid(), true);
+	for (size_t ii = 0; ii < 3; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(reader.Stripe(ii).GetKey(), keys[ii]);
+		BOOST_REQUIRE_EQUAL(reader.Stripe(ii).size(), 4);
+		BOOST_REQUIRE_EQUAL(reader.Stripe(ii).BufferSize(), 0x100);
+	}
+	BOOST_REQUIRE_EQUAL(neighbour.IsValid(), true);
+	BOOST_REQUIRE_EQUAL(neighbour.size(), 2);
+	BOOST_REQUIRE_EQUAL(neighbour.BufferSize(), 0x80);
+
+	BOOST_REQUIRE_THROW(artdaq::StripedSharedMemoryManager(std::vector<uint32_t>()), cet::exception);
+	TLOG(TLVL_DEBUG) << "END TEST Construct";
+}
+
+BOOST_AUTO_TEST_CASE(HomeStripe)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST HomeStripe";
+	auto keys = GetStripeKeys(2);
+	artdaq::StripedSharedMemoryManager man(keys, 2, 0x100);
+	artdaq::StripedSharedMemoryManager reader(keys);
+
+	// Writers stay in their home stripe until it is full
+	auto home = static_cast<int>(man.HomeStripe());
+	std::vector<artdaq::StripedSharedMemoryManager::StripedBuffer> buffers;
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		auto buf = man.GetBufferForWriting(false);
+		BOOST_REQUIRE(buf.valid());
+		BOOST_REQUIRE_EQUAL(buf.stripe, ii < 2 ? home : 1 - home);
+		BOOST_REQUIRE_EQUAL(man.Write(buf, &ii, sizeof(ii)), sizeof(ii));
+		buffers.push_back(buf);
+	}
+	BOOST_REQUIRE(!man.GetBufferForWriting(false).valid());
+	for (auto const& buf : buffers)
+	{
+		man.MarkBufferFull(buf);
+	}
+
+	// Each stripe counts its own sequence IDs, and readers take the stripes in turn
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 4);
+	std::set<int> seen;
+	int last_stripe = -1;
+	for (int ii = 0; ii < 4; ++ii)
+	{
+		auto buf = reader.GetBufferForReading();
+		BOOST_REQUIRE(buf.valid());
+		BOOST_REQUIRE_NE(buf.stripe, last_stripe);
+		last_stripe = buf.stripe;
+		BOOST_REQUIRE_EQUAL(reader.Stripe(buf.stripe).GetLastSeenBufferID(), ii / 2 + 1);
+		int value = -1;
+		BOOST_REQUIRE_EQUAL(reader.Read(buf, &value, sizeof(value)), true);
+		seen.insert(value);
+		reader.MarkBufferEmpty(buf);
+	}
+	BOOST_REQUIRE_EQUAL(seen.size(), 4);
+	BOOST_REQUIRE(!reader.GetBufferForReading().valid());
+	TLOG(TLVL_DEBUG) << "END TEST HomeStripe";
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentWriters)
+{
+	TLOG(TLVL_DEBUG) << "BEGIN TEST ConcurrentWriters";
+	const size_t writers = 8;
+	const size_t events = 200;
+	auto keys = GetStripeKeys(4);
+	artdaq::StripedSharedMemoryManager man(keys, 8, 0x100);
+	artdaq::StripedSharedMemoryManager reader(keys);
+
+	std::vector<std::thread> threads;
+	for (size_t ww = 0; ww < writers; ++ww)
+	{
+		threads.emplace_back([&man, ww, events] {
+			for (size_t ii = 0; ii < events; ++ii)
+			{
+				auto buf = man.GetBufferForWriting(false);
+				while (!buf.valid())
+				{
+					usleep(100);
+					buf = man.GetBufferForWriting(false);
+				}
+				size_t value = ww * events + ii;
+				man.Write(buf, &value, sizeof(value));
+				man.MarkBufferFull(buf);
+			}
+		});
+	}
+
+	std::vector<size_t> per_stripe(4, 0);
+	std::set<size_t> values;
+	auto start = artdaq::TimeUtils::gettimeofday_us();
+	while (values.size() < writers * events && artdaq::TimeUtils::gettimeofday_us() - start < 30000000)
+	{
+		auto buf = reader.GetBufferForReading();
+		if (!buf.valid())
+		{
+			usleep(10);
+			continue;
+		}
+		++per_stripe[buf.stripe];
+		size_t value = 0;
+		BOOST_REQUIRE_EQUAL(reader.Read(buf, &value, sizeof(value)), true);
+		BOOST_REQUIRE(values.insert(value).second);
+		reader.MarkBufferEmpty(buf);
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	BOOST_REQUIRE_EQUAL(values.size(), writers * events);
+	BOOST_REQUIRE_EQUAL(reader.ReadReadyCount(), 0);
+	for (size_t ii = 0; ii < per_stripe.size(); ++ii)
+	{
+		// Threads get consecutive home stripes, so all stripes are used
+		BOOST_REQUIRE_GT(per_stripe[ii], 0);
+		TLOG(TLVL_DEBUG) << "Stripe " << ii << " delivered " << per_stripe[ii] << " events";
+	}
+	TLOG(TLVL_DEBUG) << "END TEST ConcurrentWriters";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
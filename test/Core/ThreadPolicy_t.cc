@@ -0,0 +1,163 @@
+#include "artdaq-core/Core/ThreadPolicy.hh"
+
+#define BOOST_TEST_MODULE ThreadPolicy_t
+#include "cetlib/quiet_unit_test.hpp"
+#include "cetlib_except/exception.h"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <sched.h>
+#include <thread>
+
+#define TRACE_NAME "ThreadPolicy_t"
+#include "TRACE/tracemf.h"
+
+namespace {
+fhicl::ParameterSet MakeRolePSet(std::vector<size_t> const& cpus, std::string const& scheduler, int priority = 0)
+{
+	fhicl::ParameterSet role;
+	role.put<std::vector<size_t>>("cpus", cpus);
+	role.put<std::string>("scheduler", scheduler);
+	role.put<int>("priority", priority);
+	return role;
+}
+
+std::vector<size_t> CurrentAffinity()
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	sched_getaffinity(0, sizeof(set), &set);
+	std::vector<size_t> cpus;
+	for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+	{
+		if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+	}
+	return cpus;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(ThreadPolicy_test)
+
+BOOST_AUTO_TEST_CASE(SchedulerNames)
+{
+	for (auto name : {"other", "batch", "idle", "fifo", "rr"})
+	{
+		BOOST_REQUIRE_EQUAL(artdaq::ThreadPolicy::SchedulerToString(artdaq::ThreadPolicy::SchedulerFromString(name)), name);
+	}
+	BOOST_REQUIRE_THROW(artdaq::ThreadPolicy::SchedulerFromString("deadline"), cet::exception);
+}
+
+BOOST_AUTO_TEST_CASE(ConfigureAndRegister)
+{
+	auto original = CurrentAffinity();
+	auto cpu = original.front();
+
+	fhicl::ParameterSet pset;
+	pset.put<fhicl::ParameterSet>("ThreadPolicy_t_configure", MakeRolePSet({cpu}, "other"));
+	artdaq::ThreadPolicy::getInstance().configure(pset);
+	BOOST_REQUIRE(artdaq::ThreadPolicy::getInstance().hasPolicy("ThreadPolicy_t_configure"));
+	BOOST_REQUIRE(!artdaq::ThreadPolicy::getInstance().hasPolicy("ThreadPolicy_t_missing"));
+
+	auto policy = artdaq::ThreadPolicy::getInstance().getPolicy("ThreadPolicy_t_configure");
+	BOOST_REQUIRE_EQUAL(policy.cpus.size(), 1);
+	BOOST_REQUIRE_EQUAL(policy.scheduler, SCHED_OTHER);
+
+	std::thread worker([&] {
+		BOOST_REQUIRE(artdaq::ThreadPolicy::getInstance().registerCurrentThread("ThreadPolicy_t_configure"));
+		auto affinity = CurrentAffinity();
+		artdaq::ThreadPolicy::getInstance().unregisterCurrentThread();
+		BOOST_REQUIRE_EQUAL(affinity.size(), 1);
+		BOOST_REQUIRE_EQUAL(affinity[0], cpu);
+	});
+	worker.join();
+
+	// The main thread was not registered, so its affinity is unchanged
+	BOOST_REQUIRE_EQUAL(CurrentAffinity().size(), original.size());
+}
+
+BOOST_AUTO_TEST_CASE(ReapplyToRegisteredThread)
+{
+	auto original = CurrentAffinity();
+	auto cpu = original.back();
+
+	std::thread worker([&] {
+		// No policy for this role yet, registering leaves the thread alone
+		BOOST_REQUIRE(artdaq::ThreadPolicy::getInstance().registerCurrentThread("ThreadPolicy_t_reapply"));
+		BOOST_REQUIRE_EQUAL(CurrentAffinity().size(), original.size());
+
+		artdaq::ThreadPolicy::Policy policy;
+		policy.cpus = {cpu};
+		artdaq::ThreadPolicy::getInstance().setPolicy("ThreadPolicy_t_reapply", policy);
+
+		auto affinity = CurrentAffinity();
+		artdaq::ThreadPolicy::getInstance().unregisterCurrentThread();
+		BOOST_REQUIRE_EQUAL(affinity.size(), 1);
+		BOOST_REQUIRE_EQUAL(affinity[0], cpu);
+	});
+	worker.join();
+}
+
+BOOST_AUTO_TEST_CASE(AffinityOnlyKeepsScheduler)
+{
+	auto cpu = CurrentAffinity().front();
+
+	std::thread worker([&] {
+		// SCHED_BATCH needs no privileges, and stands in for a scheduler set outside of ThreadPolicy
+		sched_param param{};
+		BOOST_REQUIRE_EQUAL(sched_setscheduler(0, SCHED_BATCH, &param), 0);
+
+		fhicl::ParameterSet role;
+		role.put<std::vector<size_t>>("cpus", {cpu});
+		fhicl::ParameterSet pset;
+		pset.put<fhicl::ParameterSet>("ThreadPolicy_t_affinity", role);
+		artdaq::ThreadPolicy::getInstance().configure(pset);
+		BOOST_REQUIRE_EQUAL(artdaq::ThreadPolicy::getInstance().getPolicy("ThreadPolicy_t_affinity").scheduler, artdaq::ThreadPolicy::KeepScheduler);
+
+		BOOST_REQUIRE(artdaq::ThreadPolicy::getInstance().registerCurrentThread("ThreadPolicy_t_affinity"));
+		auto scheduler = sched_getscheduler(0);
+		auto affinity = CurrentAffinity();
+		artdaq::ThreadPolicy::getInstance().unregisterCurrentThread();
+		BOOST_REQUIRE_EQUAL(scheduler, SCHED_BATCH);
+		BOOST_REQUIRE_EQUAL(affinity.size(), 1);
+	});
+	worker.join();
+}
+
+BOOST_AUTO_TEST_CASE(InvalidPolicies)
+{
+	fhicl::ParameterSet badScheduler;
+	badScheduler.put<fhicl::ParameterSet>("ThreadPolicy_t_bad", MakeRolePSet({}, "deadline"));
+	BOOST_REQUIRE_THROW(artdaq::ThreadPolicy::getInstance().configure(badScheduler), cet::exception);
+
+	fhicl::ParameterSet badCpu;
+	badCpu.put<fhicl::ParameterSet>("ThreadPolicy_t_bad", MakeRolePSet({CPU_SETSIZE}, "other"));
+	BOOST_REQUIRE_THROW(artdaq::ThreadPolicy::getInstance().configure(badCpu), cet::exception);
+
+	fhicl::ParameterSet badPriority;
+	badPriority.put<fhicl::ParameterSet>("ThreadPolicy_t_bad", MakeRolePSet({}, "fifo", 1000));
+	BOOST_REQUIRE_THROW(artdaq::ThreadPolicy::getInstance().configure(badPriority), cet::exception);
+
+	BOOST_REQUIRE(!artdaq::ThreadPolicy::getInstance().hasPolicy("ThreadPolicy_t_bad"));
+}
+
+BOOST_AUTO_TEST_CASE(RealTimeWithoutPrivileges)
+{
+	// SCHED_FIFO needs CAP_SYS_NICE; without it, registration reports failure instead of throwing
+	artdaq::ThreadPolicy::Policy policy;
+	policy.scheduler = SCHED_FIFO;
+	policy.priority = 1;
+	artdaq::ThreadPolicy::getInstance().setPolicy("ThreadPolicy_t_fifo", policy);
+
+	std::thread worker([] {
+		auto applied = artdaq::ThreadPolicy::getInstance().registerCurrentThread("ThreadPolicy_t_fifo");
+		TLOG(TLVL_INFO) << "SCHED_FIFO policy applied: " << std::boolalpha << applied;
+		if (applied)
+		{
+			BOOST_REQUIRE_EQUAL(sched_getscheduler(0), SCHED_FIFO);
+		}
+		artdaq::ThreadPolicy::getInstance().unregisterCurrentThread();
+	});
+	worker.join();
+	TLOG(TLVL_DEBUG) << artdaq::ThreadPolicy::getInstance().toString();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -101,6 +101,35 @@ BOOST_AUTO_TEST_CASE(AddFragment_Ref)
 	BOOST_REQUIRE_EQUAL(*(outfrag->dataBegin() + 1), 2);
 }
 
+BOOST_AUTO_TEST_CASE(AddSharedFragment)
+{
+	std::vector<artdaq::Fragment::value_type> fakeData{1, 2, 3, 4};
+	artdaq::FragmentPtr
+	    tmpFrag(artdaq::Fragment::dataFrag(1,
+	                                       0,
+	                                       fakeData.begin(),
+	                                       fakeData.end()));
+	tmpFrag->setUserType(artdaq::Fragment::FirstUserFragmentType);
+	tmpFrag->setFragmentID(5);
+	tmpFrag->makeShared();
+	artdaq::Fragment frag(*tmpFrag);
+
+	artdaq::Fragment f(0);
+	f.setSequenceID(1);
+	artdaq::ContainerFragmentLoader cfl(f);
+	auto cf = reinterpret_cast<artdaq::ContainerFragment*>(&cfl);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	cfl.addFragment(frag);
+
+	// Adding a shared Fragment does not copy it out of the shared storage
+	BOOST_REQUIRE_EQUAL(frag.isShared(), true);
+	BOOST_REQUIRE_EQUAL(tmpFrag->isShared(), true);
+	BOOST_REQUIRE_EQUAL(cf->block_count(), 1);
+	auto outfrag = cf->at(0);
+	BOOST_REQUIRE_EQUAL(outfrag->fragmentID(), 5);
+	BOOST_REQUIRE_EQUAL(outfrag->dataSize(), 4);
+	BOOST_REQUIRE_EQUAL(*(outfrag->dataBegin() + 3), 4);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
 BOOST_AUTO_TEST_CASE(AddFragments)
 {
 	std::vector<artdaq::Fragment::value_type> fakeData1{1, 2, 3, 4};
@@ -0,0 +1,109 @@
+#include "artdaq-core/Data/FragmentOverlay.hh"
+
+#define BOOST_TEST_MODULE(FragmentOverlay_t)
+#include <cetlib/quiet_unit_test.hpp>
+#include "cetlib_except/exception.h"
+
+/**
+ * \brief Test Metadata, three words long
+ */
+struct TestMetadata
+{
+	uint64_t board;    ///< Board number
+	uint32_t channel;  ///< Channel number
+	uint32_t flags;    ///< Flags
+	uint64_t extra;    ///< Extra word
+};
+
+/**
+ * \brief Test Metadata, one word long
+ */
+struct SmallMetadata
+{
+	uint32_t value;  ///< A value
+};
+
+typedef artdaq::FragmentOverlay<TestMetadata, uint16_t> TestOverlay;
+
+static_assert(TestOverlay::metadata_words == 3, "TestMetadata should take three words");
+static_assert(artdaq::FragmentOverlay<SmallMetadata>::metadata_words == 1, "SmallMetadata should take one word");
+static_assert(artdaq::FragmentOverlay<void, uint8_t>::metadata_words == 0, "void Metadata should take no words");
+
+BOOST_AUTO_TEST_SUITE(FragmentOverlay_test)
+
+BOOST_AUTO_TEST_CASE(OverlayFragment)
+{
+	TestMetadata md{1, 2, 3, 4};
+	auto frag = TestOverlay::Create(100, 10, 11, artdaq::Fragment::FirstUserFragmentType, md, 12);
+	auto data = reinterpret_cast<uint16_t*>(frag->dataBeginBytes());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	for (uint16_t ii = 0; ii < 100; ++ii)
+	{
+		data[ii] = ii * 3;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	TestOverlay overlay(*frag);
+	BOOST_REQUIRE_EQUAL(overlay.sequenceID(), 10);
+	BOOST_REQUIRE_EQUAL(overlay.fragmentID(), 11);
+	BOOST_REQUIRE_EQUAL(overlay.timestamp(), 12);
+	BOOST_REQUIRE_EQUAL(overlay.type(), artdaq::Fragment::FirstUserFragmentType);
+	BOOST_REQUIRE_EQUAL(overlay.metadata().board, 1);
+	BOOST_REQUIRE_EQUAL(overlay.metadata().extra, 4);
+
+	// The payload is rounded up to whole words when the Fragment is created
+	BOOST_REQUIRE_EQUAL(overlay.size(), frag->dataSizeBytes() / sizeof(uint16_t));
+	BOOST_REQUIRE_GE(overlay.size(), 100);
+	BOOST_REQUIRE_EQUAL(overlay.payload().data(), data);
+	BOOST_REQUIRE_EQUAL(overlay[99], 297);
+	size_t count = 0;
+	for (auto value : overlay.payload())
+	{
+		if (count < 100) BOOST_REQUIRE_EQUAL(value, count * 3);
+		++count;
+	}
+	BOOST_REQUIRE_EQUAL(count, overlay.size());
+
+	// Metadata size mismatch is detected at construction
+	artdaq::Fragment small(4, 1, 2, artdaq::Fragment::FirstUserFragmentType, SmallMetadata{5});
+	BOOST_REQUIRE_THROW(TestOverlay bad(small), cet::exception);
+	artdaq::FragmentOverlay<SmallMetadata> smallOverlay(small);
+	BOOST_REQUIRE_EQUAL(smallOverlay.metadata().value, 5);
+	BOOST_REQUIRE_EQUAL(smallOverlay.size(), 4);
+
+	artdaq::Fragment noMetadata(8);
+	BOOST_REQUIRE_THROW(TestOverlay bad(noMetadata), cet::exception);
+	artdaq::FragmentOverlay<void, uint8_t> bytes(noMetadata);
+	BOOST_REQUIRE_EQUAL(bytes.size(), 64);
+
+	// void Metadata skips any metadata that is present
+	artdaq::FragmentOverlay<void, uint16_t> skip(*frag);
+	BOOST_REQUIRE_EQUAL(skip.payload().data(), data);
+}
+
+BOOST_AUTO_TEST_CASE(OverlayBuffer)
+{
+	TestMetadata md{7, 8, 9, 10};
+	auto frag = TestOverlay::Create(16, 20, 21, artdaq::Fragment::FirstUserFragmentType, md);
+	for (uint16_t ii = 0; ii < 16; ++ii)
+	{
+		reinterpret_cast<uint16_t*>(frag->dataBeginBytes())[ii] = ii;  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	// Serialize, as if the Fragment had been written to a shared memory buffer
+	std::vector<artdaq::RawDataType> buffer(frag->size() + 5);
+	memcpy(&buffer[0], frag->headerAddress(), frag->sizeBytes());
+
+	TestOverlay overlay(&buffer[0], buffer.size());
+	BOOST_REQUIRE_EQUAL(overlay.sequenceID(), 20);
+	BOOST_REQUIRE_EQUAL(overlay.metadata().channel, 8);
+	BOOST_REQUIRE_EQUAL(overlay.size(), 16);
+	BOOST_REQUIRE_EQUAL(overlay[15], 15);
+	BOOST_REQUIRE_EQUAL(reinterpret_cast<artdaq::RawDataType const*>(overlay.begin()), &buffer[0] + frag->headerSizeWords() + 3);  // NOLINT
+
+	// Truncated buffers and bad headers are rejected
+	BOOST_REQUIRE_THROW(TestOverlay bad(&buffer[0], frag->size() - 1), cet::exception);
+	BOOST_REQUIRE_THROW(TestOverlay bad(&buffer[0], 2), cet::exception);
+	buffer[0] = 0;
+	BOOST_REQUIRE_THROW(TestOverlay bad(&buffer[0], buffer.size()), cet::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+#include "artdaq-core/Data/FragmentSort.hh"
+
+#include <random>
+
+#define BOOST_TEST_MODULE(FragmentSort_t)
+#include <cetlib/quiet_unit_test.hpp>
+
+namespace {
+artdaq::FragmentPtrs MakeFragments(size_t count, uint64_t seed)
+{
+	std::mt19937_64 gen(seed);
+	std::uniform_int_distribution<uint64_t> seqs(1000, 1000 + count / 4);
+	std::uniform_int_distribution<uint16_t> ids(0, 20);
+	std::uniform_int_distribution<uint64_t> timestamps(0, 0xFFFFFFFFFFFFULL);
+
+	artdaq::FragmentPtrs frags;
+	for (size_t ii = 0; ii < count; ++ii)
+	{
+		frags.emplace_back(new artdaq::Fragment(seqs(gen), ids(gen), artdaq::Fragment::FirstUserFragmentType, timestamps(gen)));
+		frags.back()->resize(1);
+		*frags.back()->dataBegin() = ii;  // Original position, to check stability
+	}
+	return frags;
+}
+
+void CheckSorted(artdaq::FragmentPtrs const& frags, artdaq::FragmentSortKey key)
+{
+	artdaq::FragmentPtr const* prev = nullptr;
+	for (auto const& frag : frags)
+	{
+		if (prev != nullptr)
+		{
+			auto prevKey = artdaq::GetFragmentSortKey(**prev, key);
+			auto thisKey = artdaq::GetFragmentSortKey(*frag, key);
+			BOOST_REQUIRE_LE(prevKey, thisKey);
+			if (prevKey == thisKey)
+			{
+				BOOST_REQUIRE_LT(*(*prev)->dataBegin(), *frag->dataBegin());
+			}
+		}
+		prev = &frag;
+	}
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(FragmentSort_test)
+
+BOOST_AUTO_TEST_CASE(SortKey)
+{
+	artdaq::Fragment frag(0x123456789ABCULL, 0x4321, artdaq::Fragment::FirstUserFragmentType, 0xFEDCBA9876543210ULL);
+	BOOST_REQUIRE_EQUAL(artdaq::GetFragmentSortKey(frag, artdaq::FragmentSortKey::SequenceID), 0x123456789ABC4321ULL);
+	BOOST_REQUIRE_EQUAL(artdaq::GetFragmentSortKey(frag, artdaq::FragmentSortKey::Timestamp), 0xFEDCBA9876543210ULL);
+}
+
+BOOST_AUTO_TEST_CASE(RadixSort)
+{
+	for (size_t count : {0, 1, 10, 63, 64, 1000, 10000})
+	{
+		std::mt19937_64 gen(count);
+		std::vector<artdaq::detail::FragmentSortEntry> entries;
+		for (size_t ii = 0; ii < count; ++ii)
+		{
+			// Few distinct values, so there are many ties
+			entries.push_back({gen() & 0xFF00FF000000FF00ULL, ii});
+		}
+		auto expected = entries;
+		std::stable_sort(expected.begin(), expected.end(), [](auto const& a, auto const& b) { return a.key < b.key; });
+
+		artdaq::detail::RadixSort(entries);
+		BOOST_REQUIRE_EQUAL(entries.size(), expected.size());
+		for (size_t ii = 0; ii < count; ++ii)
+		{
+			BOOST_REQUIRE_EQUAL(entries[ii].key, expected[ii].key);
+			BOOST_REQUIRE_EQUAL(entries[ii].index, expected[ii].index);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SortFragmentPtrs)
+{
+	auto frags = MakeFragments(5000, 1);
+	artdaq::SortFragments(frags);
+	BOOST_REQUIRE_EQUAL(frags.size(), 5000);
+	CheckSorted(frags, artdaq::FragmentSortKey::SequenceID);
+
+	artdaq::SortFragments(frags, artdaq::FragmentSortKey::Timestamp);
+	BOOST_REQUIRE_EQUAL(frags.size(), 5000);
+	for (auto it = frags.begin(); std::next(it) != frags.end(); ++it)
+	{
+		BOOST_REQUIRE_LE((*it)->timestamp(), (*std::next(it))->timestamp());
+	}
+
+	auto small = MakeFragments(10, 2);
+	artdaq::SortFragments(small);
+	CheckSorted(small, artdaq::FragmentSortKey::SequenceID);
+}
+
+BOOST_AUTO_TEST_CASE(SortFragments)
+{
+	auto ptrs = MakeFragments(2000, 3);
+	artdaq::Fragments frags;
+	for (auto& ptr : ptrs)
+	{
+		frags.push_back(std::move(*ptr));
+	}
+
+	artdaq::SortFragments(frags);
+	BOOST_REQUIRE_EQUAL(frags.size(), 2000);
+	BOOST_REQUIRE(std::is_sorted(frags.begin(), frags.end(), artdaq::fragmentSequenceIDCompare));
+	for (size_t ii = 1; ii < frags.size(); ++ii)
+	{
+		if (frags[ii - 1].sequenceID() == frags[ii].sequenceID())
+		{
+			BOOST_REQUIRE_LE(frags[ii - 1].fragmentID(), frags[ii].fragmentID());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Merge)
+{
+	std::vector<artdaq::FragmentPtrs> streams;
+	size_t total = 0;
+	for (size_t ii = 0; ii < 7; ++ii)
+	{
+		streams.push_back(MakeFragments(100 * ii, 10 + ii));
+		artdaq::SortFragments(streams.back());
+		total += streams.back().size();
+	}
+	streams.emplace_back();  // An empty stream
+
+	auto merged = artdaq::MergeSortedFragments(streams);
+	BOOST_REQUIRE_EQUAL(merged.size(), total);
+	for (auto const& stream : streams)
+	{
+		BOOST_REQUIRE(stream.empty());
+	}
+	for (auto it = merged.begin(); std::next(it) != merged.end(); ++it)
+	{
+		BOOST_REQUIRE_LE(artdaq::GetFragmentSortKey(**it, artdaq::FragmentSortKey::SequenceID),
+		                 artdaq::GetFragmentSortKey(**std::next(it), artdaq::FragmentSortKey::SequenceID));
+	}
+
+	std::vector<artdaq::Fragments> vstreams(3);
+	for (size_t ii = 0; ii < 30; ++ii)
+	{
+		vstreams[ii % 3].emplace_back(ii, ii % 3, artdaq::Fragment::FirstUserFragmentType, 100 - ii);
+	}
+	for (auto& stream : vstreams)
+	{
+		std::reverse(stream.begin(), stream.end());  // Sorted by timestamp
+	}
+	auto vmerged = artdaq::MergeSortedFragments(vstreams, artdaq::FragmentSortKey::Timestamp);
+	BOOST_REQUIRE_EQUAL(vmerged.size(), 30);
+	for (size_t ii = 0; ii < 30; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(vmerged[ii].timestamp(), 71 + ii);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,8 @@
 #include "artdaq-core/Data/Fragment.hh"
 #include "artdaq-core/Data/detail/RawFragmentHeader.hh"
 
+#include <utility>
+
 #define BOOST_TEST_MODULE(Fragment_t)
 #include <cetlib/quiet_unit_test.hpp>
 
@@ -143,6 +145,15 @@ BOOST_AUTO_TEST_CASE(FragmentType)
 	BOOST_REQUIRE(map.size() > 0);
 	map = artdaq::detail::RawFragmentHeader::MakeSystemTypeMap();
 	BOOST_REQUIRE(map.size() > 0);
+	BOOST_REQUIRE_EQUAL(map[artdaq::Fragment::ContainerFragmentType], "Container");
+	BOOST_REQUIRE_EQUAL(map.count(artdaq::Fragment::InitFragmentType), 0);
+
+	static_assert(artdaq::detail::RawFragmentHeader::SystemTypeName(artdaq::Fragment::EndOfRunFragmentType) == "EndOfRun");
+	static_assert(artdaq::detail::RawFragmentHeader::SystemTypeName(artdaq::detail::RawFragmentHeader::FIRST_USER_TYPE).empty());
+	BOOST_REQUIRE_EQUAL(artdaq::detail::RawFragmentHeader::SystemTypeToString(artdaq::Fragment::InitFragmentType), "Init");
+	BOOST_REQUIRE_EQUAL(artdaq::detail::RawFragmentHeader::SystemTypeToString(250), "Unknown");
+	frag.setSystemType(artdaq::Fragment::ErrorFragmentType);
+	BOOST_REQUIRE_EQUAL(frag.typeString(), "233 (Error)");
 }
 
 BOOST_AUTO_TEST_CASE(SequenceID)
@@ -679,4 +690,109 @@ BOOST_AUTO_TEST_CASE(Upgrade_V1)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(SharedPayload)
+{
+	MetadataTypeOne mdOneA;
+	mdOneA.field1 = 5;
+	mdOneA.field2 = 10;
+	mdOneA.field3 = 15;
+
+	artdaq::Fragment f1(64, 1, 2, 3, mdOneA, 4);
+	for (size_t ii = 0; ii < 64; ++ii)
+	{
+		*(f1.dataBegin() + ii) = ii;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	BOOST_REQUIRE_EQUAL(f1.isShared(), false);
+
+	f1.makeShared();
+	BOOST_REQUIRE_EQUAL(f1.isShared(), true);
+	artdaq::Fragment f2(f1);
+	artdaq::Fragment f3 = f1;
+	BOOST_REQUIRE_EQUAL(f2.isShared(), true);
+
+	// Const access reads the shared payload
+	artdaq::Fragment const& cf1 = f1;
+	artdaq::Fragment const& cf2 = f2;
+	BOOST_REQUIRE_EQUAL(cf1.dataBegin(), cf2.dataBegin());
+	BOOST_REQUIRE_EQUAL(cf2.dataSize(), 64);
+	BOOST_REQUIRE_EQUAL(cf2.sizeBytes(), f1.sizeBytes());
+	BOOST_REQUIRE_EQUAL(*(cf2.dataBegin() + 10), 10);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	BOOST_REQUIRE_EQUAL(cf2.metadata<MetadataTypeOne>()->field2, 10);
+
+	// The persistent storage holds the whole Fragment, contiguously
+	BOOST_REQUIRE_EQUAL(cf2.headerBegin(), cf1.headerBegin());
+	BOOST_REQUIRE_EQUAL(cf2.headerBegin() + cf2.size(), cf2.dataEnd());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	// Changing the header of a Fragment whose storage is still referenced elsewhere copies it
+	f2.setSequenceID(11);
+	f2.setFragmentID(12);
+	f2.setTimestamp(14);
+	BOOST_REQUIRE_EQUAL(f2.isShared(), false);
+	BOOST_REQUIRE_NE(cf1.dataBegin(), cf2.dataBegin());
+	BOOST_REQUIRE_EQUAL(f1.sequenceID(), 1);
+	BOOST_REQUIRE_EQUAL(f2.sequenceID(), 11);
+	BOOST_REQUIRE_EQUAL(f2.fragmentID(), 12);
+	BOOST_REQUIRE_EQUAL(f2.timestamp(), 14);
+	BOOST_REQUIRE_EQUAL(*(cf2.dataBegin() + 63), 63);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto hdr = reinterpret_cast<artdaq::detail::RawFragmentHeader const*>(cf2.headerBegin());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	BOOST_REQUIRE_EQUAL(hdr->sequence_id, 11);
+	hdr = reinterpret_cast<artdaq::detail::RawFragmentHeader const*>(cf1.headerBegin());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	BOOST_REQUIRE_EQUAL(hdr->sequence_id, 1);
+
+	// The first mutating call copies the payload
+	*f3.dataBegin() = 1000;
+	BOOST_REQUIRE_EQUAL(f3.isShared(), false);
+	BOOST_REQUIRE_EQUAL(*f3.dataBegin(), 1000);
+	BOOST_REQUIRE_EQUAL(*cf1.dataBegin(), 0);
+	BOOST_REQUIRE_EQUAL(f3.sequenceID(), 1);
+	BOOST_REQUIRE_EQUAL(*(f3.dataBegin() + 63), 63);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	f2.resize(128);
+	BOOST_REQUIRE_EQUAL(f2.dataSize(), 128);
+	BOOST_REQUIRE_EQUAL(f2.sequenceID(), 11);
+	BOOST_REQUIRE_EQUAL(f2.metadata<MetadataTypeOne>()->field3, 15);
+	BOOST_REQUIRE_EQUAL(*(f2.dataBegin() + 63), 63);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	BOOST_REQUIRE_EQUAL(f1.dataSize(), 64);
+
+	// The last reference takes over the storage without copying it, also for header changes
+	auto payload = cf1.dataBegin();
+	f1.setSequenceID(21);
+	BOOST_REQUIRE_EQUAL(f1.isShared(), false);
+	BOOST_REQUIRE_EQUAL(&*f1.dataBegin(), payload);
+	BOOST_REQUIRE_EQUAL(f1.sequenceID(), 21);
+
+	// Copies, moves and destruction of shared Fragments
+	{
+		artdaq::Fragment f6(16);
+		*f6.dataBegin() = 6;
+		f6.makeShared();
+		std::vector<artdaq::Fragment> copies(3, f6);
+		artdaq::Fragment moved(std::move(copies[0]));
+		copies[1] = f6;
+		copies[2] = std::move(moved);
+		BOOST_REQUIRE_EQUAL(copies[2].isShared(), true);
+		BOOST_REQUIRE_EQUAL(std::as_const(copies[2]).dataBegin(), std::as_const(f6).dataBegin());
+		BOOST_REQUIRE_EQUAL(*std::as_const(copies[1]).dataBegin(), 6);
+	}
+
+	// swap(DATAVEC_T&) hands out private storage
+	artdaq::Fragment f7(4);
+	f7.makeShared();
+	artdaq::Fragment f8(f7);
+	artdaq::QuickVec<artdaq::RawDataType> vec(artdaq::detail::RawFragmentHeader::num_words() + 2);
+	f8.swap(vec);
+	BOOST_REQUIRE_EQUAL(f8.isShared(), false);
+	BOOST_REQUIRE_NE(vec.begin(), std::as_const(f7).headerBegin());
+	BOOST_REQUIRE_EQUAL(vec.size(), f7.size());
+
+	// Setting metadata on a shared Fragment
+	artdaq::Fragment f4(8);
+	f4.makeShared();
+	artdaq::Fragment f5(f4);
+	f5.setMetadata(mdOneA);
+	BOOST_REQUIRE_EQUAL(f4.hasMetadata(), false);
+	BOOST_REQUIRE_EQUAL(f5.hasMetadata(), true);
+	BOOST_REQUIRE_EQUAL(f5.dataSize(), 8);
+}
+
 BOOST_AUTO_TEST_SUITE_END()